@@ -79,6 +79,22 @@
 		int  ip4addr_aton(const char *cp, ip4_addr_t *addr);
 		int ps2ip_getconfig(char* netif_name,t_ip_info* ip_info);
 		int ps2ip_setconfig(const t_ip_info* ip_info);
+	#else
+		/* the host has no lwip, its sockets take the same calls */
+		#define lwip_shutdown shutdown
+		#define lwip_setsockopt setsockopt
+		#define lwip_close close
+		#define lwip_connect connect
+		#define lwip_recv recv
+		#define lwip_send send
+		#define lwip_bind bind
+		#define lwip_recvfrom recvfrom
+		#define lwip_sendto sendto
+		#define lwip_socket socket
+		#define lwip_select select
+		#define lwip_ioctl ioctl
+		#define lwip_getaddrinfo getaddrinfo
+		#define lwip_freeaddrinfo freeaddrinfo
 	#endif
 
 #elif defined(CONF_FAMILY_WINDOWS)
@@ -619,7 +635,10 @@ void thread_destroy(void *thread)
 void thread_yield()
 {
 #if defined(_EE)
-	
+	/* the kernel doesn't time slice, let the next thread of the same priority run */
+	ee_thread_status_t info;
+	ReferThreadStatus(GetThreadId(), &info);
+	RotateThreadReadyQueue(info.current_priority);
 #elif defined(CONF_FAMILY_UNIX)
 	sched_yield();
 #elif defined(CONF_FAMILY_WINDOWS)
@@ -1700,7 +1719,7 @@ int net_would_block()
 #endif
 }
 
-
+#if defined(_EE)
 // https://github.com/ps2dev/ps2sdk/blob/master/NETMAN.txt
 // https://github.com/ps2dev/ps2sdk/blob/master/ee/network/tcpip/samples/tcpip_dhcp/ps2ip.c
 static void ethStatusCheckCb(s32 alarm_id, u16 time, void *common)
@@ -1766,6 +1785,7 @@ static int ethEnableDHCP()
 	}
 	return 1;
 }
+#endif
 
 
 int net_init()
@@ -1805,6 +1825,7 @@ int net_init()
 	return 0;
 }
 
+#if defined(_EE)
 // Using dirent to loop through dirs doesn't work because entry->d_name is null
 // However with fioDread this works, although the function returns an iox_dirent_t
 // instead of the expected io_dirent_t, and thus the offset to the name is different
@@ -1815,6 +1836,7 @@ static char* GetEntryName(char* src)
 
 	return NULL;
 }
+#endif
 
 int fs_listdir_info(const char *dir, FS_LISTDIR_INFO_CALLBACK cb, int type, void *user)
 {
@@ -1844,7 +1866,7 @@ int fs_listdir_info(const char *dir, FS_LISTDIR_INFO_CALLBACK cb, int type, void
 
 	FindClose(handle);
 	return 0;
-#else
+#elif defined(_EE)
 	io_dirent_t entry;
 	char buffer[1024*2];
 	int length;
@@ -1870,6 +1892,28 @@ int fs_listdir_info(const char *dir, FS_LISTDIR_INFO_CALLBACK cb, int type, void
 	/* close the directory and return */
 	fioDclose(fd);
 	return 0;
+#else
+	struct dirent *entry;
+	char buffer[1024*2];
+	int length;
+	DIR *d = opendir(dir);
+
+	if(!d)
+		return 0;
+
+	str_format(buffer, sizeof(buffer), "%s/", dir);
+	length = str_length(buffer);
+
+	while((entry = readdir(d)) != NULL)
+	{
+		str_copy(buffer+length, entry->d_name, (int)sizeof(buffer)-length);
+		if(cb(entry->d_name, fs_getmtime(buffer), fs_is_dir(buffer), type, user))
+			break;
+	}
+
+	/* close the directory and return */
+	closedir(d);
+	return 0;
 #endif
 }
 
@@ -1901,7 +1945,7 @@ int fs_listdir(const char *dir, FS_LISTDIR_CALLBACK cb, int type, void *user)
 
 	FindClose(handle);
 	return 0;
-#else
+#elif defined(_EE)
 	io_dirent_t entry;
 	char buffer[1024*2];
 	int length;
@@ -1927,6 +1971,28 @@ int fs_listdir(const char *dir, FS_LISTDIR_CALLBACK cb, int type, void *user)
 	/* close the directory and return */
 	fioDclose(fd);
 	return 0;
+#else
+	struct dirent *entry;
+	char buffer[1024*2];
+	int length;
+	DIR *d = opendir(dir);
+
+	if(!d)
+		return 0;
+
+	str_format(buffer, sizeof(buffer), "%s/", dir);
+	length = str_length(buffer);
+
+	while((entry = readdir(d)) != NULL)
+	{
+		str_copy(buffer+length, entry->d_name, (int)sizeof(buffer)-length);
+		if(cb(entry->d_name, fs_is_dir(buffer), type, user))
+			break;
+	}
+
+	/* close the directory and return */
+	closedir(d);
+	return 0;
 #endif
 }
 
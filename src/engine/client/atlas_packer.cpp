@@ -0,0 +1,52 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "atlas_packer.h"
+
+int CAtlasPacker::Pack(CRect *pRects, int Num, int Width, int Height, int Padding)
+{
+	dbg_assert(Num <= MAX_RECTS, "atlas packer: too many rectangles");
+
+	// tallest first, ties keep their order
+	int aOrder[MAX_RECTS];
+	for(int i = 0; i < Num; i++)
+	{
+		int j = i;
+		for(; j > 0 && pRects[aOrder[j-1]].m_H < pRects[i].m_H; j--)
+			aOrder[j] = aOrder[j-1];
+		aOrder[j] = i;
+	}
+
+	int ShelfX = 0, ShelfY = 0, ShelfH = 0;
+	int Placed = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		CRect *pRect = &pRects[aOrder[i]];
+		int w = pRect->m_W + Padding*2;
+		int h = pRect->m_H + Padding*2;
+		pRect->m_X = -1;
+		pRect->m_Y = -1;
+
+		if(w > Width)
+			continue;
+		if(ShelfX + w > Width)
+		{
+			// start a new shelf below the current one
+			ShelfY += ShelfH;
+			ShelfX = 0;
+			ShelfH = 0;
+		}
+		if(ShelfY + h > Height)
+			continue;
+
+		pRect->m_X = ShelfX + Padding;
+		pRect->m_Y = ShelfY + Padding;
+		ShelfX += w;
+		if(h > ShelfH)
+			ShelfH = h;
+		Placed++;
+	}
+
+	return Placed;
+}
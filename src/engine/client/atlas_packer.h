@@ -0,0 +1,38 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_ATLAS_PACKER_H
+#define ENGINE_CLIENT_ATLAS_PACKER_H
+
+/*
+	Class: CAtlasPacker
+		Places rectangles into a texture atlas, tallest first on shelves
+		that run from left to right.
+
+		Every rectangle gets Padding free pixels on each side, so the
+		caller can repeat the edge pixels there and linear filtering does
+		not pull in the neighbours. It only computes positions and has no
+		dependency on the graphics backend.
+*/
+class CAtlasPacker
+{
+public:
+	enum
+	{
+		MAX_RECTS = 64,
+	};
+
+	struct CRect
+	{
+		int m_W, m_H; // in
+		int m_X, m_Y; // out, -1 when it did not fit
+	};
+
+	// returns the number of rectangles that fit into Width x Height
+	static int Pack(CRect *pRects, int Num, int Width, int Height, int Padding);
+
+	// maps a texture coordinate of a packed rectangle to the atlas
+	static float RemapU(const CRect &Rect, int Width, float u) { return (Rect.m_X + u*Rect.m_W) / Width; }
+	static float RemapV(const CRect &Rect, int Height, float v) { return (Rect.m_Y + v*Rect.m_H) / Height; }
+};
+
+#endif
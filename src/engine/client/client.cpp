@@ -8,12 +8,14 @@
 #include <string.h>
 #include <climits>
 
-#include <sifrpc.h>
-#include <iopheap.h>
-#include <loadfile.h>
-#include <iopcontrol.h>
-#include <sbv_patches.h>
-#include <kernel.h>
+#if defined(_EE)
+	#include <sifrpc.h>
+	#include <iopheap.h>
+	#include <loadfile.h>
+	#include <iopcontrol.h>
+	#include <sbv_patches.h>
+	#include <kernel.h>
+#endif
 
 #include <base/math.h>
 #include <base/vmath.h>
@@ -62,6 +64,7 @@
 	#include <windows.h>
 #endif
 
+#include "frame_pacer.h"
 #include "friends.h"
 #include "serverbrowser.h"
 #include "fetcher.h"
@@ -279,6 +282,7 @@ CClient::CClient() : m_DemoPlayer(&m_SnapshotDelta)
 	m_RenderFrameTimeHigh = 0.0f;
 	m_RenderFrames = 0;
 	m_LastRenderTime = time_get();
+	m_LastPacedFrame = -1;
 
 	m_GameTickSpeed = SERVER_TICK_SPEED;
 
@@ -310,6 +314,9 @@ CClient::CClient() : m_DemoPlayer(&m_SnapshotDelta)
 	//
 	m_aCmdConnect[0] = 0;
 
+	m_aCmdBenchmark[0] = 0;
+	m_Benchmarking = false;
+
 	// map download
 	m_aMapdownloadFilename[0] = 0;
 	m_aMapdownloadName[0] = 0;
@@ -976,9 +983,39 @@ void CClient::DebugRender()
 		Graphics()->QuadsText(2, 14, 16, aBuffer);
 	}
 
+	str_format(aBuffer, sizeof(aBuffer), "pred: %d ms",
+		(int)((m_PredictedTime.Get(Now)-m_GameTime[g_Config.m_ClDummy].Get(Now))*1000/(float)time_freq()));
+	Graphics()->QuadsText(2, 70, 16, aBuffer);
+
+	// one line each below the prediction, then the data rates
+	float y = 86;
+	str_format(aBuffer, sizeof(aBuffer), "pacing: cost %.1f ms vsync %.1f ms missed %d of %d",
+		m_FramePacer.Cost()*1000.0f/time_freq(), m_FramePacer.Period()*1000.0f/time_freq(),
+		m_FramePacer.NumMissed(), m_FramePacer.NumShown());
+	Graphics()->QuadsText(2, y, 16, aBuffer);
+	y += 16;
+
+	{
+		const IGraphics::CRenderStats &Stats = Graphics()->RenderStats();
+		str_format(aBuffer, sizeof(aBuffer), "gfx: draws %d batches %d states %d verts %d sprites %d",
+			Stats.m_DrawCalls, Stats.m_Batches, Stats.m_StateChanges, Stats.m_Vertices, Stats.m_Sprites);
+		Graphics()->QuadsText(2, y, 16, aBuffer);
+		y += 16;
+		str_format(aBuffer, sizeof(aBuffer), "vram: uploads %d (%d KB) evictions %d",
+			Stats.m_TextureUploads, Stats.m_UploadBytes/1024, Stats.m_Evictions);
+		Graphics()->QuadsText(2, y, 16, aBuffer);
+		y += 16;
+	}
+	{
+		const ISound::CSoundStats &Stats = Sound()->SoundStats();
+		str_format(aBuffer, sizeof(aBuffer), "sound: played %d culled %d dropped %d stolen %d voices %d channels %d",
+			Stats.m_Played, Stats.m_Culled, Stats.m_Dropped, Stats.m_Stolen, Stats.m_ActiveVoices, Stats.m_ActiveChannels);
+		Graphics()->QuadsText(2, y, 16, aBuffer);
+		y += 16;
+	}
+
 	// render rates
 	{
-		int y = 0;
 		int i;
 		for(i = 0; i < 256; i++)
 		{
@@ -986,15 +1023,11 @@ void CClient::DebugRender()
 			{
 				str_format(aBuffer, sizeof(aBuffer), "%4d %20s: %8d %8d %8d", i, GameClient()->GetItemName(i), m_SnapshotDelta.GetDataRate(i)/8, m_SnapshotDelta.GetDataUpdates(i),
 					(m_SnapshotDelta.GetDataRate(i)/m_SnapshotDelta.GetDataUpdates(i))/8);
-				Graphics()->QuadsText(2, 100+y*12, 16, aBuffer);
-				y++;
+				Graphics()->QuadsText(2, y, 16, aBuffer);
+				y += 12;
 			}
 		}
 	}
-
-	str_format(aBuffer, sizeof(aBuffer), "pred: %d ms",
-		(int)((m_PredictedTime.Get(Now)-m_GameTime[g_Config.m_ClDummy].Get(Now))*1000/(float)time_freq()));
-	Graphics()->QuadsText(2, 70, 16, aBuffer);
 	Graphics()->QuadsEnd();
 
 	// render graphs
@@ -1014,6 +1047,28 @@ void CClient::DebugRender()
 	}
 }
 
+void CClient::PaceFrame()
+{
+	// learn from the last frame that was shown
+	IGraphics::CFrameTiming Timing;
+	m_pGraphics->LastFrameTiming(&Timing);
+	if(Timing.m_Frame >= 0 && Timing.m_Frame != m_LastPacedFrame)
+	{
+		m_FramePacer.FrameShown(Timing.m_Frame, Timing.m_ReadyTime, Timing.m_FlipTime);
+		m_LastPacedFrame = Timing.m_Frame;
+	}
+
+	const int64 Margin = g_Config.m_GfxFramePacingMargin*time_freq()/1000;
+	if(g_Config.m_GfxFramePacing && !m_Benchmarking)
+	{
+		int64 Now = time_get();
+		int Wait = (int)((m_FramePacer.WakeTime(Now, Margin) - Now)*1000/time_freq());
+		if(Wait > 0)
+			thread_sleep(Wait);
+	}
+	m_FramePacer.FrameStart(m_pGraphics->FrameNumber(), time_get(), Margin);
+}
+
 void CClient::Restart()
 {
 	char aBuf[512];
@@ -2563,7 +2618,12 @@ void CClient::Run()
 
 	// init graphics
 	{
-		m_pGraphics = CreateEngineGraphics();
+#if defined(_EE)
+		m_pGraphics = g_Config.m_GfxHeadless ? CreateEngineGraphicsNull() : CreateEngineGraphics();
+#else
+		// the host build has no gsKit, it is always headless
+		m_pGraphics = CreateEngineGraphicsNull();
+#endif
 
 		bool RegisterFail = false;
 		RegisterFail = RegisterFail || !Kernel()->RegisterInterface(static_cast<IEngineGraphics*>(m_pGraphics)); // register graphics as both
@@ -2634,6 +2694,7 @@ void CClient::Run()
 
 	//
 	m_FpsGraph.Init(0.0f, 200.0f);
+	m_FramePacer.Init(time_freq(), g_Config.m_GfxRefreshRate ? g_Config.m_GfxRefreshRate : 60);
 
 	// never start with the editor
 	g_Config.m_ClEditor = 0;
@@ -2661,6 +2722,31 @@ void CClient::Run()
 			m_aCmdConnect[0] = 0;
 		}
 
+		// handle pending benchmarks, they end with the demo
+		if(m_aCmdBenchmark[0])
+		{
+			const char *pError = DemoPlayer_Play(m_aCmdBenchmark, IStorage::TYPE_ALL);
+			if(pError)
+			{
+				dbg_msg("benchmark", "failed to play '%s': %s", m_aCmdBenchmark, pError);
+				Quit();
+			}
+			else
+			{
+				m_Benchmarking = true;
+				m_BenchmarkStartTime = time_get();
+				m_BenchmarkFrames = 0;
+				m_BenchmarkFrameTimeLow = 1.0f;
+				m_BenchmarkFrameTimeHigh = 0.0f;
+				m_BenchmarkDrawCalls = 0;
+				m_BenchmarkVertices = 0;
+				m_BenchmarkStateChanges = 0;
+			}
+			m_aCmdBenchmark[0] = 0;
+		}
+		else if(m_Benchmarking && (!m_DemoPlayer.IsPlaying() || m_DemoPlayer.BaseInfo()->m_Paused))
+			BenchmarkFinish();
+
 		// progress on dummy connect if security token handshake skipped/passed
 		if (m_DummySendConnInfo && !m_NetClient[1].SecurityTokenUnknown())
 		{
@@ -2687,6 +2773,9 @@ void CClient::Run()
 			SendMsgExY(&MsgEnter, MSGFLAG_VITAL|MSGFLAG_FLUSH, true, 1);
 		}
 
+		// wait until the input is read just early enough for the next vsync
+		PaceFrame();
+
 		// update input
 		if(Input()->Update())
 			break;	// SDL_QUIT
@@ -2805,6 +2894,17 @@ void CClient::Run()
 					}
 					m_pGraphics->Swap();
 				}
+
+				if(m_Benchmarking)
+				{
+					const IGraphics::CRenderStats &Stats = m_pGraphics->RenderStats();
+					m_BenchmarkFrames++;
+					m_BenchmarkFrameTimeLow = min(m_BenchmarkFrameTimeLow, m_RenderFrameTime);
+					m_BenchmarkFrameTimeHigh = max(m_BenchmarkFrameTimeHigh, m_RenderFrameTime);
+					m_BenchmarkDrawCalls += Stats.m_DrawCalls;
+					m_BenchmarkVertices += Stats.m_Vertices;
+					m_BenchmarkStateChanges += Stats.m_StateChanges;
+				}
 			}
 			if(Input()->VideoRestartNeeded())
 			{
@@ -3073,6 +3173,28 @@ void CClient::Con_Play(IConsole::IResult *pResult, void *pUserData)
 	pSelf->DemoPlayer_Play(pResult->GetString(0), IStorage::TYPE_ALL);
 }
 
+void CClient::BenchmarkFinish()
+{
+	float Seconds = (time_get() - m_BenchmarkStartTime) / (float)time_freq();
+	int Frames = max(m_BenchmarkFrames, 1);
+
+	dbg_msg("benchmark", "%d frames in %.2f s, %.1f fps, frame time %.2f ms min %.2f ms max",
+		m_BenchmarkFrames, Seconds, m_BenchmarkFrames / max(Seconds, 0.001f),
+		m_BenchmarkFrameTimeLow*1000.0f, m_BenchmarkFrameTimeHigh*1000.0f);
+	dbg_msg("benchmark", "per frame %.1f draw calls, %.1f vertices, %.1f state changes",
+		m_BenchmarkDrawCalls / (float)Frames, m_BenchmarkVertices / (float)Frames, m_BenchmarkStateChanges / (float)Frames);
+
+	m_Benchmarking = false;
+	Quit();
+}
+
+void CClient::Con_Benchmark(IConsole::IResult *pResult, void *pUserData)
+{
+	// played from the main loop, the command line is parsed before anything is loaded
+	CClient *pSelf = (CClient *)pUserData;
+	str_copy(pSelf->m_aCmdBenchmark, pResult->GetString(0), sizeof(pSelf->m_aCmdBenchmark));
+}
+
 void CClient::Con_DemoPlay(IConsole::IResult *pResult, void *pUserData)
 {
 	CClient *pSelf = (CClient *)pUserData;
@@ -3199,6 +3321,7 @@ void CClient::RegisterCommands()
 	m_pConsole->Register("rcon", "r[rcon-command]", CFGFLAG_CLIENT, Con_Rcon, this, "Send specified command to rcon");
 	m_pConsole->Register("rcon_auth", "s[password]", CFGFLAG_CLIENT, Con_RconAuth, this, "Authenticate to rcon");
 	m_pConsole->Register("play", "r[file]", CFGFLAG_CLIENT|CFGFLAG_STORE, Con_Play, this, "Play the file specified");
+	m_pConsole->Register("benchmark", "r[file]", CFGFLAG_CLIENT, Con_Benchmark, this, "Play the demo specified, print frame statistics and quit");
 	m_pConsole->Register("record", "?s[file]", CFGFLAG_CLIENT, Con_Record, this, "Record to the file");
 	m_pConsole->Register("stoprecord", "", CFGFLAG_CLIENT, Con_StopRecord, this, "Stop recording");
 	m_pConsole->Register("add_demomarker", "", CFGFLAG_CLIENT, Con_AddDemoMarker, this, "Add demo timeline marker");
@@ -3240,6 +3363,7 @@ static CClient *CreateClient()
 */
 
 
+#if defined(_EE)
 static SifRpcClientData_t client __attribute__((aligned(64)));
 #define	MASS_USB_ID	0x500C0F1
 #define STRINGIFY(a) #a
@@ -3248,6 +3372,7 @@ static SifRpcClientData_t client __attribute__((aligned(64)));
 	extern unsigned int  size_ ## name; \
 	ret = SifExecModuleBuffer(name, size_ ## name, 0, NULL, NULL); \
     if (ret < 0) dbg_msg("ps2", "SifExecModuleBuffer " STRINGIFY(name) " failed: %d", &ret);
+#endif
 
 
 #if defined(CONF_PLATFORM_MACOSX) || defined(__ANDROID__)
@@ -3269,6 +3394,7 @@ int main(int argc, const char **argv) // ignore_convention
 	}
 #endif
 
+#if defined(_EE)
 	// Reset the IOP
 	SifInitRpc(0);
 	while (!SifIopReset("", 0)) { }
@@ -3331,6 +3457,7 @@ int main(int argc, const char **argv) // ignore_convention
 
 	int main_id = GetThreadId();
 	ChangeThreadPriority(main_id, 80);
+#endif
 
 	CClient *pClient = CreateClient();
 	IKernel *pKernel = IKernel::Create();
@@ -3342,8 +3469,14 @@ int main(int argc, const char **argv) // ignore_convention
 	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
 	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
 	IConfig *pConfig = CreateConfig();
+#if defined(_EE)
 	IEngineSound *pEngineSound = CreateEngineSound();
 	IEngineInput *pEngineInput = CreateEngineInput();
+#else
+	// no audsrv and no pad on the host
+	IEngineSound *pEngineSound = CreateEngineSoundNull();
+	IEngineInput *pEngineInput = CreateEngineInputNull();
+#endif
 	IEngineTextRender *pEngineTextRender = CreateEngineTextRender();
 	IEngineMap *pEngineMap = CreateEngineMap();
 	IEngineMasterServer *pEngineMasterServer = CreateEngineMasterServer();
@@ -94,6 +94,9 @@ class CClient : public IClient, public CDemoPlayer::IListner
 	float m_RenderFrameTimeHigh;
 	int m_RenderFrames;
 
+	CFramePacer m_FramePacer;
+	int m_LastPacedFrame;
+
 	NETADDR m_ServerAddress;
 	int m_WindowMustRefocus;
 	int m_SnapCrcErrors;
@@ -124,6 +127,17 @@ class CClient : public IClient, public CDemoPlayer::IListner
 	//
 	char m_aCmdConnect[256];
 
+	// demo benchmark
+	char m_aCmdBenchmark[256];
+	bool m_Benchmarking;
+	int64 m_BenchmarkStartTime;
+	int m_BenchmarkFrames;
+	float m_BenchmarkFrameTimeLow;
+	float m_BenchmarkFrameTimeHigh;
+	int64 m_BenchmarkDrawCalls;
+	int64 m_BenchmarkVertices;
+	int64 m_BenchmarkStateChanges;
+
 	// map download
 	CFetchTask *m_pMapdownloadTask;
 	char m_aMapdownloadFilename[256];
@@ -275,6 +289,7 @@ public:
 
 	void Render();
 	void DebugRender();
+	void PaceFrame();
 
 	virtual void Restart();
 	virtual void Quit();
@@ -328,6 +343,7 @@ public:
 	static void Con_AddFavorite(IConsole::IResult *pResult, void *pUserData);
 	static void Con_RemoveFavorite(IConsole::IResult *pResult, void *pUserData);
 	static void Con_Play(IConsole::IResult *pResult, void *pUserData);
+	static void Con_Benchmark(IConsole::IResult *pResult, void *pUserData);
 	static void Con_Record(IConsole::IResult *pResult, void *pUserData);
 	static void Con_StopRecord(IConsole::IResult *pResult, void *pUserData);
 	static void Con_AddDemoMarker(IConsole::IResult *pResult, void *pUserData);
@@ -340,6 +356,7 @@ public:
 	void RegisterCommands();
 
 	const char *DemoPlayer_Play(const char *pFilename, int StorageType);
+	void BenchmarkFinish();
 	void DemoRecorder_Start(const char *pFilename, bool WithTimestamp, int Recorder);
 	void DemoRecorder_HandleAutoStart();
 	void DemoRecorder_Stop(int Recorder);
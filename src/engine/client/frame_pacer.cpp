@@ -0,0 +1,114 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "frame_pacer.h"
+
+CFramePacer::CFramePacer()
+{
+	Init(1000000, 60);
+}
+
+void CFramePacer::Init(int64 Freq, int RefreshRate)
+{
+	for(int i = 0; i < MAX_FRAMES; i++)
+		m_aFrames[i].m_Frame = -1;
+	m_NumCosts = 0;
+	m_NextCost = 0;
+
+	m_Freq = Freq;
+	m_Period = Freq/RefreshRate;
+	m_LastFlip = 0;
+	m_HaveFlip = false;
+	m_LastTarget = 0;
+	m_LastFrame = -1;
+	m_CorrectedFrame = -1;
+
+	m_NumShown = 0;
+	m_NumMissed = 0;
+}
+
+int64 CFramePacer::Cost() const
+{
+	int64 Cost = 0;
+	for(int i = 0; i < m_NumCosts; i++)
+		Cost = max(Cost, m_aCosts[i]);
+	return Cost;
+}
+
+int64 CFramePacer::Target(int64 Now, int64 Cost) const
+{
+	// two frames can't be flipped at the same vsync
+	int64 Earliest = Now + Cost;
+	if(m_LastTarget && Earliest < m_LastTarget + m_Period/2)
+		Earliest = m_LastTarget + m_Period/2;
+
+	int64 Vsyncs = (Earliest - m_LastFlip + m_Period - 1) / m_Period;
+	return m_LastFlip + max(Vsyncs, (int64)1)*m_Period;
+}
+
+int64 CFramePacer::WakeTime(int64 Now, int64 Margin) const
+{
+	if(!m_HaveFlip || !m_NumCosts)
+		return Now;
+
+	// a frame that takes longer than a vsync gains nothing from waiting
+	int64 Budget = Cost() + Margin;
+	if(Budget >= m_Period)
+		return Now;
+
+	int64 Wake = Target(Now, Budget) - Budget;
+	return clamp(Wake, Now, Now+m_Period);
+}
+
+void CFramePacer::FrameStart(int Frame, int64 Now, int64 Margin)
+{
+	CFrame *pFrame = &m_aFrames[Frame%MAX_FRAMES];
+	pFrame->m_Frame = Frame;
+	pFrame->m_Start = Now;
+	pFrame->m_Target = m_HaveFlip ? Target(Now, Cost()+Margin) : 0;
+	m_LastTarget = pFrame->m_Target;
+	m_LastFrame = Frame;
+}
+
+void CFramePacer::FrameShown(int Frame, int64 ReadyTime, int64 FlipTime)
+{
+	// flips are whole vsyncs apart, follow the period of the display
+	const int64 PrevFlip = m_HaveFlip ? m_LastFlip : 0;
+	if(m_HaveFlip)
+	{
+		int64 Interval = FlipTime - m_LastFlip;
+		int64 Vsyncs = (Interval + m_Period/2) / m_Period;
+		if(Vsyncs >= 1 && Vsyncs <= 4)
+			m_Period = (m_Period*7 + Interval/Vsyncs)/8;
+	}
+	m_LastFlip = FlipTime;
+	m_HaveFlip = true;
+
+	const CFrame *pFrame = &m_aFrames[Frame%MAX_FRAMES];
+	if(pFrame->m_Frame != Frame)
+		return;
+
+	// the backend only takes a frame once the one before it is flipped, a
+	// frame started before that waited for it and the wait isn't its cost
+	int64 Cost = ReadyTime - max(pFrame->m_Start, PrevFlip);
+	if(Cost > 0 && Cost < m_Freq)
+	{
+		m_aCosts[m_NextCost] = Cost;
+		m_NextCost = (m_NextCost+1)%NUM_COSTS;
+		m_NumCosts = min(m_NumCosts+1, (int)NUM_COSTS);
+	}
+
+	m_NumShown++;
+	if(pFrame->m_Target && FlipTime > pFrame->m_Target + m_Period/2)
+	{
+		m_NumMissed++;
+
+		// the frames started since are as late, once for all of them
+		if(Frame > m_CorrectedFrame)
+		{
+			m_LastTarget += FlipTime - pFrame->m_Target;
+			m_CorrectedFrame = m_LastFrame;
+		}
+	}
+}
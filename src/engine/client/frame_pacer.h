@@ -0,0 +1,78 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_FRAME_PACER_H
+#define ENGINE_CLIENT_FRAME_PACER_H
+
+#include <base/system.h>
+
+/*
+	Class: CFramePacer
+		Decides when the client starts a frame, so the input is read as
+		late as possible while the frame is still ready for its vsync.
+
+		The backend reports when each frame was done and when it was
+		flipped. The flips give the vsync period and phase. The cost of a
+		frame is the time from its start, or from the flip of the frame
+		before when that is later, until the backend is done with it. The
+		next frame starts the largest of the recent costs plus a margin
+		before the first vsync it can make, and never aims at the vsync
+		the frame before it is waiting for. When a frame is shown later
+		than it aimed, the frames after it are queued behind it, so the
+		next one aims that much later to let the queue drain.
+
+		It doesn't read the clock itself, all times are passed in, in
+		units of time_freq().
+*/
+class CFramePacer
+{
+	enum
+	{
+		MAX_FRAMES = 16,
+		NUM_COSTS = 8,
+	};
+
+	struct CFrame
+	{
+		int m_Frame;
+		int64 m_Start;
+		int64 m_Target;
+	};
+
+	CFrame m_aFrames[MAX_FRAMES];
+	int64 m_aCosts[NUM_COSTS];
+	int m_NumCosts;
+	int m_NextCost;
+
+	int64 m_Freq;
+	int64 m_Period;
+	int64 m_LastFlip;
+	bool m_HaveFlip;
+	int64 m_LastTarget;
+	int m_LastFrame;
+	int m_CorrectedFrame; // frames up to this one were started before the last correction
+
+	int m_NumShown;
+	int m_NumMissed;
+
+	// the vsync a frame started at Now with Cost can be shown at
+	int64 Target(int64 Now, int64 Cost) const;
+
+public:
+	CFramePacer();
+	void Init(int64 Freq, int RefreshRate);
+
+	// the input for the frame with the given number is read now
+	void FrameStart(int Frame, int64 Now, int64 Margin);
+	// the backend was done with the frame at ReadyTime and showed it at FlipTime
+	void FrameShown(int Frame, int64 ReadyTime, int64 FlipTime);
+
+	// when the next frame should start, Now when it should not wait
+	int64 WakeTime(int64 Now, int64 Margin) const;
+
+	int64 Cost() const;
+	int64 Period() const { return m_Period; }
+	int NumShown() const { return m_NumShown; }
+	int NumMissed() const { return m_NumMissed; }
+};
+
+#endif
@@ -0,0 +1,135 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "gif_packet.h"
+
+CGifPacket::CGifPacket()
+{
+	m_pData = 0;
+	m_MaxWords = 0;
+	Reset();
+}
+
+void CGifPacket::Init(void *pBuffer, int MaxQwords)
+{
+	m_pData = (uint64_t *)pBuffer;
+	m_MaxWords = MaxQwords*2;
+	Reset();
+}
+
+void CGifPacket::Reset()
+{
+	m_NumWords = 0;
+	m_pTag = 0;
+	m_BlockFlg = GIF_FLG_PACKED;
+	m_BlockRegs = 0;
+	m_BlockLoops = 0;
+}
+
+uint64_t CGifPacket::GifTag(int NLoop, bool Eop, bool Pre, uint64_t Prim, int Flg, int NReg)
+{
+	return (uint64_t)(NLoop&MAX_NLOOP) |
+		((uint64_t)(Eop ? 1 : 0)<<15) |
+		((uint64_t)(Pre ? 1 : 0)<<46) |
+		((Prim&0x7ff)<<47) |
+		((uint64_t)(Flg&3)<<58) |
+		((uint64_t)(NReg&0xf)<<60);
+}
+
+void CGifPacket::CloseBlock()
+{
+	if(!m_pTag)
+		return;
+
+	// patch the loop count into the tag
+	*m_pTag = (*m_pTag&~(uint64_t)MAX_NLOOP) | (uint64_t)m_BlockLoops;
+
+	// REGLIST data has to end on a quadword boundary, the extra word is discarded by the GIF
+	if(m_NumWords&1)
+	{
+		dbg_assert(m_NumWords < m_MaxWords, "gif packet overflow");
+		m_pData[m_NumWords++] = 0;
+	}
+
+	m_pTag = 0;
+	m_BlockLoops = 0;
+}
+
+void CGifPacket::BeginAD()
+{
+	CloseBlock();
+	dbg_assert(m_NumWords+2 <= m_MaxWords, "gif packet overflow");
+
+	m_pTag = &m_pData[m_NumWords];
+	m_pData[m_NumWords++] = GifTag(0, true, false, 0, GIF_FLG_PACKED, 1);
+	m_pData[m_NumWords++] = GS_REG_AD;
+	m_BlockFlg = GIF_FLG_PACKED;
+	m_BlockRegs = 1;
+}
+
+void CGifPacket::AddAD(int Reg, uint64_t Value)
+{
+	dbg_assert(m_pTag && m_BlockFlg == GIF_FLG_PACKED, "gif packet: A+D data without block");
+	dbg_assert(m_NumWords+2 <= m_MaxWords && m_BlockLoops < MAX_NLOOP, "gif packet overflow");
+
+	m_pData[m_NumWords++] = Value;
+	m_pData[m_NumWords++] = (uint64_t)Reg;
+	m_BlockLoops++;
+}
+
+void CGifPacket::BeginPrims(uint64_t Prim, bool Textured)
+{
+	CloseBlock();
+	dbg_assert(m_NumWords+2 <= m_MaxWords, "gif packet overflow");
+
+	m_pTag = &m_pData[m_NumWords];
+	if(Textured)
+	{
+		m_pData[m_NumWords++] = GifTag(0, true, true, Prim, GIF_FLG_REGLIST, 3);
+		m_pData[m_NumWords++] = GS_REG_RGBAQ | (GS_REG_UV<<4) | (GS_REG_XYZ2<<8);
+	}
+	else
+	{
+		m_pData[m_NumWords++] = GifTag(0, true, true, Prim, GIF_FLG_REGLIST, 2);
+		m_pData[m_NumWords++] = GS_REG_RGBAQ | (GS_REG_XYZ2<<4);
+	}
+	m_BlockFlg = GIF_FLG_REGLIST;
+	m_BlockRegs = Textured ? 3 : 2;
+}
+
+void CGifPacket::AddVertex(uint64_t Rgbaq, uint64_t Uv, uint64_t Xyz2)
+{
+	dbg_assert(m_NumWords+3 <= m_MaxWords && m_BlockLoops < MAX_NLOOP, "gif packet overflow");
+
+	m_pData[m_NumWords++] = Rgbaq;
+	m_pData[m_NumWords++] = Uv;
+	m_pData[m_NumWords++] = Xyz2;
+	m_BlockLoops++;
+}
+
+void CGifPacket::AddVertex(uint64_t Rgbaq, uint64_t Xyz2)
+{
+	dbg_assert(m_NumWords+2 <= m_MaxWords && m_BlockLoops < MAX_NLOOP, "gif packet overflow");
+
+	m_pData[m_NumWords++] = Rgbaq;
+	m_pData[m_NumWords++] = Xyz2;
+	m_BlockLoops++;
+}
+
+uint64_t *CGifPacket::AllocVertices(int Num)
+{
+	dbg_assert(m_pTag && m_BlockFlg == GIF_FLG_REGLIST, "gif packet: vertices without block");
+	dbg_assert(m_NumWords+Num*m_BlockRegs <= m_MaxWords && m_BlockLoops+Num <= MAX_NLOOP, "gif packet overflow");
+
+	uint64_t *pData = &m_pData[m_NumWords];
+	m_NumWords += Num*m_BlockRegs;
+	m_BlockLoops += Num;
+	return pData;
+}
+
+int CGifPacket::Finish()
+{
+	CloseBlock();
+	return Size();
+}
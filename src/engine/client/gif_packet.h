@@ -0,0 +1,112 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_GIF_PACKET_H
+#define ENGINE_CLIENT_GIF_PACKET_H
+
+#include <stdint.h>
+
+/*
+	Class: CGifPacket
+		Builds GIF packets (GIFtag + register data) into caller provided,
+		quadword aligned memory. It does not depend on gsKit so the exact
+		command stream can be produced and compared on any platform.
+
+		A packet is a sequence of blocks:
+		- A+D blocks (PACKED mode) for state registers like TEX0 or TEX1
+		- primitive blocks (REGLIST mode) with PRIM preset in the GIFtag
+		  and RGBAQ/UV/XYZ2 per vertex
+*/
+class CGifPacket
+{
+public:
+	enum
+	{
+		GIF_FLG_PACKED=0,
+		GIF_FLG_REGLIST=1,
+		GIF_FLG_IMAGE=2,
+
+		GS_REG_PRIM=0x00,
+		GS_REG_RGBAQ=0x01,
+		GS_REG_ST=0x02,
+		GS_REG_UV=0x03,
+		GS_REG_XYZ2=0x05,
+		GS_REG_TEX0_1=0x06,
+		GS_REG_TEX0_2=0x07,
+		GS_REG_TEX1_1=0x14,
+		GS_REG_TEX1_2=0x15,
+		GS_REG_FRAME_1=0x4c,
+		GS_REG_FRAME_2=0x4d,
+		GS_REG_AD=0x0e,
+		GS_REG_NOP=0x0f,
+
+		GS_PRIM_POINT=0,
+		GS_PRIM_LINE=1,
+		GS_PRIM_LINESTRIP=2,
+		GS_PRIM_TRIANGLE=3,
+		GS_PRIM_TRISTRIP=4,
+		GS_PRIM_TRIFAN=5,
+		GS_PRIM_SPRITE=6,
+
+		PRIMFLAG_GOURAUD=1<<3,
+		PRIMFLAG_TEXTURED=1<<4,
+		PRIMFLAG_FOG=1<<5,
+		PRIMFLAG_ALPHA=1<<6,
+		PRIMFLAG_ANTIALIAS=1<<7,
+		PRIMFLAG_UV=1<<8,
+		PRIMFLAG_CONTEXT2=1<<9,
+
+		MAX_NLOOP=0x7fff,
+	};
+
+private:
+	uint64_t *m_pData;
+	int m_MaxWords;
+	int m_NumWords;
+
+	// currently open block
+	uint64_t *m_pTag;
+	int m_BlockFlg;
+	int m_BlockRegs;
+	int m_BlockLoops;
+
+	void CloseBlock();
+
+public:
+	CGifPacket();
+
+	void Init(void *pBuffer, int MaxQwords);
+	void Reset();
+
+	const uint64_t *Data() const { return m_pData; }
+	int Size() const { return (m_NumWords+1)/2; }
+
+	// size helpers so the caller can reserve memory up front
+	static int AdQwords(int NumRegs) { return 1 + NumRegs; }
+	static int PrimQwords(int NumVertices, int RegsPerVertex) { return 1 + (NumVertices*RegsPerVertex+1)/2; }
+
+	static uint64_t GifTag(int NLoop, bool Eop, bool Pre, uint64_t Prim, int Flg, int NReg);
+	static uint64_t Prim(int Type, int Flags) { return (uint64_t)((Type&7) | Flags); }
+
+	static uint64_t RegRGBAQ(int r, int g, int b, int a) { return (uint64_t)(r&0xff) | ((uint64_t)(g&0xff)<<8) | ((uint64_t)(b&0xff)<<16) | ((uint64_t)(a&0xff)<<24); }
+	static uint64_t RegUV(int u, int v) { return (uint64_t)(u&0x3fff) | ((uint64_t)(v&0x3fff)<<16); }
+	static uint64_t RegXYZ2(int x, int y, unsigned z) { return (uint64_t)(x&0xffff) | ((uint64_t)(y&0xffff)<<16) | ((uint64_t)z<<32); }
+	// Fbp in pages, Fbw in units of 64 pixels, all bits written
+	static uint64_t RegFRAME(int Fbp, int Fbw, int Psm) { return (uint64_t)(Fbp&0x1ff) | ((uint64_t)(Fbw&0x3f)<<16) | ((uint64_t)(Psm&0x3f)<<24); }
+
+	// A+D block
+	void BeginAD();
+	void AddAD(int Reg, uint64_t Value);
+
+	// REGLIST primitive block, NLOOP is patched when the block is closed
+	void BeginPrims(uint64_t Prim, bool Textured);
+	void AddVertex(uint64_t Rgbaq, uint64_t Uv, uint64_t Xyz2);
+	void AddVertex(uint64_t Rgbaq, uint64_t Xyz2);
+
+	// reserves register words for Num vertices so a kernel can write them directly
+	uint64_t *AllocVertices(int Num);
+
+	// closes the last block and returns the packet size in quadwords
+	int Finish();
+};
+
+#endif
@@ -7,11 +7,13 @@
 #include <gsKit.h>
 #include <dmaKit.h>
 #include <graph.h>
+#include <kernel.h>
 
 #include <base/system.h>
 #include <engine/external/pnglite/pnglite.h>
 
 #include <engine/shared/config.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/storage.h>
 #include <engine/keys.h>
@@ -20,6 +22,14 @@
 #include <math.h> // cosf, sinf
 #include <malloc.h>
 
+#include "atlas_packer.h"
+#include "gif_packet.h"
+#include "gs_transform.h"
+#include "quad_emit.h"
+#include "render_thread.h"
+#include "texture_cache.h"
+#include "texture_quantize.h"
+#include "vram_cache.h"
 #include "graphics_gskit.h"
 
 #define GL_MAX_TEXTURE_SIZE 128
@@ -32,83 +42,604 @@
 
 static GSGLOBAL *gsGlobal;
 
-void CGraphics_PS2_gsKit::Flush()
+// the GIF channel's control register, STR is set while a transfer runs
+#define GIF_CHCR ((volatile u32 *)0x1000A000)
+#define GIF_CHCR_STR 0x100
+
+enum
+{
+	// just above the main thread, the render thread runs below it and is
+	// only raised while it waits for the blank it has to flip in
+	FLIP_THREAD_PRIORITY = 79,
+};
+
+// the render thread must not spin on the GS, it would keep every thread
+// below it from running. It blocks on these, signalled from the interrupts
+static int s_VsyncSema = -1;
+static int s_GifDmaSema = -1;
+static int s_VsyncHandler = -1;
+static int s_GifDmaHandler = -1;
+
+static int VsyncHandler(int Cause)
+{
+	iSignalSema(s_VsyncSema);
+	ExitHandler();
+	return 0;
+}
+
+static int GifDmaHandler(int Channel)
 {
-	if(m_NumVertices == 0)
+	iSignalSema(s_GifDmaSema);
+	ExitHandler();
+	return 0;
+}
+
+static void InitWaits()
+{
+	if(s_VsyncSema != -1)
 		return;
 
-	if(m_RenderEnable)
+	ee_sema_t Sema = {0};
+	Sema.init_count = 0;
+	Sema.max_count = 1;
+	s_VsyncSema = CreateSema(&Sema);
+	s_GifDmaSema = CreateSema(&Sema);
+	s_VsyncHandler = AddIntcHandler(INTC_VBLANK_S, VsyncHandler, 0);
+	EnableIntc(INTC_VBLANK_S);
+	s_GifDmaHandler = AddDmacHandler(DMAC_GIF, GifDmaHandler, 0);
+	EnableDmac(DMAC_GIF);
+}
+
+static void ShutdownWaits()
+{
+	if(s_VsyncSema == -1)
+		return;
+
+	RemoveDmacHandler(DMAC_GIF, s_GifDmaHandler);
+	RemoveIntcHandler(INTC_VBLANK_S, s_VsyncHandler);
+	DeleteSema(s_GifDmaSema);
+	DeleteSema(s_VsyncSema);
+	s_VsyncSema = s_GifDmaSema = -1;
+}
+
+// dmaKit_wait without the spin. A signal left from an earlier transfer only
+// makes it look at the channel once more
+static void WaitGifDma()
+{
+	while(PollSema(s_GifDmaSema) >= 0)
+		;
+	while(*GIF_CHCR & GIF_CHCR_STR)
+		WaitSema(s_GifDmaSema);
+}
+
+// gsKit_sync_flip, blocking until the next blank starts instead of spinning on CSR
+static void SyncFlip()
+{
+	if(!gsGlobal->FirstFrame)
 	{
-		int vertexPrim = (g_Config.m_GfxQuadAsTriangle) ? 3 : 4;
+		while(PollSema(s_VsyncSema) >= 0)
+			;
+		WaitSema(s_VsyncSema);
+		if(gsGlobal->DoubleBuffering == GS_SETTING_ON)
+		{
+			GS_SET_DISPFB2(gsGlobal->ScreenBuffer[gsGlobal->ActiveBuffer & 1] / 8192, gsGlobal->Width / 64, gsGlobal->PSM, 0, 0);
+			gsGlobal->ActiveBuffer ^= 1;
+			gsGlobal->PrimContext ^= 1;
+		}
+	}
+	gsKit_setactive(gsGlobal);
+}
+
+void CGraphics_PS2_gsKit::BeginPacket(int Qwords, GSTEXTURE *gsTex)
+{
+	if(gsTex)
+		Qwords += CGifPacket::AdQwords(2);
+
+	// the packet is placed in gsKit's drawing queue so it stays ordered with
+	// texture uploads and state changes and goes out with the queue's DMA chain
+	m_Packet.Init(gsKit_heap_alloc(gsGlobal, Qwords, Qwords*16, GIF_AD), Qwords);
 
-		for (int i=0; i<m_NumVertices; i+=vertexPrim)
+	if(gsTex)
+	{
+		int tw, th;
+		gsKit_set_tw_th(gsTex, &tw, &th);
+		m_Packet.BeginAD();
+		m_Packet.AddAD(CGifPacket::GS_REG_TEX0_1+gsGlobal->PrimContext,
+			GS_SETREG_TEX0(gsTex->Vram/256, gsTex->TBW, gsTex->PSM, tw, th, gsGlobal->PrimAlphaEnable, 0,
+				gsTex->VramClut/256, gsTex->ClutPSM, 0, 0, gsTex->VramClut ? GS_CLUT_STOREMODE_LOAD : GS_CLUT_STOREMODE_NOLOAD));
+		m_Packet.AddAD(CGifPacket::GS_REG_TEX1_1+gsGlobal->PrimContext,
+			GS_SETREG_TEX1(1, 0, gsTex->Filter, gsTex->Filter, 0, 0, 0));
+	}
+}
+
+void CGraphics_PS2_gsKit::EmitQuads(const CCommandList *pList, GSTEXTURE *gsTex, uint64_t Prim, uint64_t SpritePrim, int First, int Num)
+{
+	// where the corners of a quad are stored and how the general path splits it into
+	// triangles, see QuadsDrawTL. the sprite uses the top left and bottom right corner
+	static const int s_aQuadCorners[] = {0, 1, 2, 3};
+	static const int s_aQuadOrder[] = {0, 1, 2, 0, 2, 3};
+	static const int s_aTriangleCorners[] = {0, 1, 2, 5};
+	static const int s_aTriangleOrder[] = {0, 1, 2, 3, 4, 5};
+	const int QuadVertices = g_Config.m_GfxQuadAsTriangle ? 6 : 4;
+	const int *pCorners = g_Config.m_GfxQuadAsTriangle ? s_aTriangleCorners : s_aQuadCorners;
+	const int *pOrder = g_Config.m_GfxQuadAsTriangle ? s_aTriangleOrder : s_aQuadOrder;
+
+	const bool Textured = gsTex != 0;
+	const int NumRegs = Textured ? 3 : 2;
+
+	for(int Start = First; Start + QuadVertices <= First+Num; )
+	{
+		int NumQuads = min((First+Num-Start)/QuadVertices, (int)MAX_PACKET_PRIMS);
+		const CVertex *pQuads = &pList->m_aVertices[Start];
+
+		// classify first, runs of the same kind share one block of the packet
+		int Qwords = 0;
+		for(int q = 0, RunStart = 0; q < NumQuads; q++)
 		{
-			// adjust vertices based on ortho projection
-			for (int j=0; j<vertexPrim; j++)
+			m_aSpriteQuads[q] = CGsTransform::IsSprite((const CGsVertex *)&pQuads[q*QuadVertices], pCorners);
+			if(q > 0 && m_aSpriteQuads[q] != m_aSpriteQuads[q-1])
 			{
-				m_aVertices[i+j].m_Pos.x -= m_ScreenX0;
-				m_aVertices[i+j].m_Pos.y -= m_ScreenY0;
-
-				m_aVertices[i+j].m_Pos.x /= (m_ScreenX1-m_ScreenX0) / gsGlobal->Width;
-				m_aVertices[i+j].m_Pos.y /= (m_ScreenY1-m_ScreenY0) / gsGlobal->Height;
+				Qwords += CGifPacket::PrimQwords((q-RunStart) * (m_aSpriteQuads[q-1] ? 2 : 6), NumRegs);
+				RunStart = q;
 			}
+			if(q == NumQuads-1)
+				Qwords += CGifPacket::PrimQwords((NumQuads-RunStart) * (m_aSpriteQuads[q] ? 2 : 6), NumRegs);
+		}
 
-			if (m_CurrTexture == -1)
+		m_Transform.Transform((const CGsVertex *)pQuads, NumQuads*QuadVertices, Textured, m_aQuadWords);
+		BeginPacket(Qwords, gsTex);
+
+		for(int RunStart = 0; RunStart < NumQuads; )
+		{
+			const bool Sprite = m_aSpriteQuads[RunStart];
+			int RunEnd = RunStart+1;
+			while(RunEnd < NumQuads && m_aSpriteQuads[RunEnd] == Sprite)
+				RunEnd++;
+
+			m_Packet.BeginPrims(Sprite ? SpritePrim : Prim, Textured);
+			uint64_t *pOut = m_Packet.AllocVertices((RunEnd-RunStart) * (Sprite ? 2 : 6));
+			for(int q = RunStart; q < RunEnd; q++)
 			{
-				if (g_Config.m_GfxQuadAsTriangle)
-					gsKit_prim_triangle_gouraud_3d(gsGlobal,
-						m_aVertices[i+0].m_Pos.x, m_aVertices[i+0].m_Pos.y, 0,
-						m_aVertices[i+1].m_Pos.x, m_aVertices[i+1].m_Pos.y, 0,
-						m_aVertices[i+2].m_Pos.x, m_aVertices[i+2].m_Pos.y, 0,
-						GS_SETREG_RGBAQ(m_aVertices[i+0].m_Color.r*255, m_aVertices[i+0].m_Color.g*255, m_aVertices[i+0].m_Color.b*255, 128-m_aVertices[i+0].m_Color.a*128, 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+1].m_Color.r*255, m_aVertices[i+1].m_Color.g*255, m_aVertices[i+1].m_Color.b*255, 128-m_aVertices[i+1].m_Color.a*128, 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+2].m_Color.r*255, m_aVertices[i+2].m_Color.g*255, m_aVertices[i+2].m_Color.b*255, 128-m_aVertices[i+2].m_Color.a*128, 0));
+				const uint64_t *pWords = &m_aQuadWords[q*QuadVertices*NumRegs];
+				if(Sprite)
+				{
+					mem_copy(pOut, &pWords[pCorners[0]*NumRegs], NumRegs*sizeof(uint64_t));
+					mem_copy(pOut+NumRegs, &pWords[pCorners[2]*NumRegs], NumRegs*sizeof(uint64_t));
+					pOut += NumRegs*2;
+				}
 				else
-					gsKit_prim_quad_gouraud_3d(gsGlobal,
-						m_aVertices[i+0].m_Pos.x, m_aVertices[i+0].m_Pos.y, 0,
-						m_aVertices[i+1].m_Pos.x, m_aVertices[i+1].m_Pos.y, 0,
-						m_aVertices[i+2].m_Pos.x, m_aVertices[i+2].m_Pos.y, 0,
-						m_aVertices[i+3].m_Pos.x, m_aVertices[i+3].m_Pos.y, 0,
-						GS_SETREG_RGBAQ(m_aVertices[i+0].m_Color.r*255, m_aVertices[i+0].m_Color.g*255, m_aVertices[i+0].m_Color.b*255, 128-m_aVertices[i+0].m_Color.a*128, 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+1].m_Color.r*255, m_aVertices[i+1].m_Color.g*255, m_aVertices[i+1].m_Color.b*255, 128-m_aVertices[i+1].m_Color.a*128, 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+2].m_Color.r*255, m_aVertices[i+2].m_Color.g*255, m_aVertices[i+2].m_Color.b*255, 128-m_aVertices[i+2].m_Color.a*128, 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+3].m_Color.r*255, m_aVertices[i+3].m_Color.g*255, m_aVertices[i+3].m_Color.b*255, 128-m_aVertices[i+3].m_Color.a*128, 0));
+				{
+					for(int j = 0; j < 6; j++, pOut += NumRegs)
+						mem_copy(pOut, &pWords[pOrder[j]*NumRegs], NumRegs*sizeof(uint64_t));
+				}
+			}
+			if(Sprite)
+				m_BackendStats.m_Sprites += RunEnd-RunStart;
+			RunStart = RunEnd;
+		}
+		m_Packet.Finish();
+
+		Start += NumQuads*QuadVertices;
+	}
+}
+
+void CGraphics_PS2_gsKit::EmitVertices(const CCommandList *pList, const CRenderState &State, int First, int Num)
+{
+	const int VertexPrim = (g_Config.m_GfxQuadAsTriangle) ? 3 : 4;
+	const bool Textured = State.m_Texture != -1;
+	GSTEXTURE *gsTex = Textured ? (GSTEXTURE*)m_aTextures[State.m_Texture].m_Tex : 0;
+
+	int PrimFlags = CGifPacket::PRIMFLAG_GOURAUD;
+	if(gsGlobal->PrimAlphaEnable)
+		PrimFlags |= CGifPacket::PRIMFLAG_ALPHA;
+	if(gsGlobal->PrimAAEnable)
+		PrimFlags |= CGifPacket::PRIMFLAG_ANTIALIAS;
+	if(gsGlobal->PrimContext)
+		PrimFlags |= CGifPacket::PRIMFLAG_CONTEXT2;
+	if(Textured)
+		PrimFlags |= CGifPacket::PRIMFLAG_TEXTURED|CGifPacket::PRIMFLAG_UV;
+	const u64 Prim = CGifPacket::Prim(CGifPacket::GS_PRIM_TRIANGLE, PrimFlags);
+
+	const int NumRegs = Textured ? 3 : 2;
+	m_Transform.SetTexture(Textured ? gsTex->Width : 0, Textured ? gsTex->Height : 0);
+
+	// axis aligned quads can go out as sprites, two vertices instead of six. a
+	// flipped screen mapping would turn the corners around, those stay triangles
+	if(g_Config.m_GfxQuadSprites && State.m_Primitive == DRAWING_QUADS &&
+		State.m_ScreenX1 > State.m_ScreenX0 && State.m_ScreenY1 > State.m_ScreenY0)
+	{
+		const u64 SpritePrim = CGifPacket::Prim(CGifPacket::GS_PRIM_SPRITE, PrimFlags&~CGifPacket::PRIMFLAG_GOURAUD);
+		EmitQuads(pList, gsTex, Prim, SpritePrim, First, Num);
+		return;
+	}
+
+	for(int Start = First; Start + VertexPrim <= First+Num; )
+	{
+		int NumPrims = min((First+Num-Start)/VertexPrim, (int)MAX_PACKET_PRIMS);
+		int NumOut = NumPrims * (VertexPrim == 4 ? 6 : 3);
+		BeginPacket(CGifPacket::PrimQwords(NumOut, NumRegs), gsTex);
+
+		m_Packet.BeginPrims(Prim, Textured);
+		if(VertexPrim == 3)
+			m_Transform.Transform((const CGsVertex *)&pList->m_aVertices[Start], NumOut, Textured, m_Packet.AllocVertices(NumOut));
+		else
+		{
+			// quads are split into two triangles (0,1,2) and (0,2,3) of a triangle list
+			static const int s_aQuadOrder[] = {0, 1, 2, 0, 2, 3};
+			m_Transform.Transform((const CGsVertex *)&pList->m_aVertices[Start], NumPrims*4, Textured, m_aQuadWords);
+
+			uint64_t *pOut = m_Packet.AllocVertices(NumOut);
+			for(int p = 0; p < NumPrims; p++)
+				for(int j = 0; j < 6; j++, pOut += NumRegs)
+					mem_copy(pOut, &m_aQuadWords[(p*4 + s_aQuadOrder[j])*NumRegs], NumRegs*sizeof(uint64_t));
+		}
+		m_Packet.Finish();
+
+		Start += NumPrims*VertexPrim;
+	}
+}
+
+void CGraphics_PS2_gsKit::ApplyState(const CRenderState &State)
+{
+	const CRenderState *pOld = m_AppliedValid ? &m_AppliedState : 0;
+
+	if(!pOld || pOld->m_Texture != State.m_Texture)
+		m_BackendStats.m_StateChanges++;
+
+	// look it up for every batch, another texture might have evicted it in between.
+	// the upload goes into the drawing queue, so earlier draws still see the old contents
+	if(State.m_Texture != -1)
+	{
+		GSTEXTURE *gsTex = (GSTEXTURE*)m_aTextures[State.m_Texture].m_Tex;
+		bool Upload;
+		int ClutOffset;
+		int Page = m_VramCache.Use(State.m_Texture, VramSize(gsTex, &ClutOffset), &Upload);
+		dbg_assert(Page != -1, "texture does not fit in vram");
+		gsTex->Vram = Page*CVramCache::PAGE_SIZE;
+		if(gsTex->Clut)
+			gsTex->VramClut = gsTex->Vram + ClutOffset;
+		if(Upload)
+			gsKit_texture_upload(gsGlobal, gsTex);
+	}
+
+	if(!pOld || pOld->m_BlendMode != State.m_BlendMode)
+	{
+		gsKit_set_test(gsGlobal, State.m_BlendMode == BLEND_NONE ? GS_ATEST_OFF : GS_ATEST_ON);
+		m_BackendStats.m_StateChanges++;
+	}
+
+	if(!pOld || pOld->m_WrapMode != State.m_WrapMode)
+	{
+		gsKit_set_clamp(gsGlobal, State.m_WrapMode == WRAP_CLAMP ? GS_CMODE_CLAMP : GS_CMODE_REPEAT);
+		m_BackendStats.m_StateChanges++;
+	}
+
+	// clipping and the transform depend on the size of what is drawn into
+	const bool TargetChanged = !pOld || pOld->m_Target != State.m_Target;
+	if(TargetChanged)
+	{
+		SetFrame(State.m_Target);
+		m_BackendStats.m_StateChanges++;
+	}
+
+	if(TargetChanged || pOld->m_ClipEnable != State.m_ClipEnable || pOld->m_ClipX != State.m_ClipX || pOld->m_ClipY != State.m_ClipY ||
+		pOld->m_ClipW != State.m_ClipW || pOld->m_ClipH != State.m_ClipH)
+	{
+		if(State.m_Target != -1)
+		{
+			// clip rectangles are given in screen pixels
+			const GSTEXTURE *pTarget = (GSTEXTURE*)m_aTextures[State.m_Target].m_Tex;
+			const int Width = pTarget->Width, Height = pTarget->Height;
+			int x0 = 0, y0 = 0, x1 = Width-1, y1 = Height-1;
+			if(State.m_ClipEnable)
+			{
+				x0 = clamp(State.m_ClipX*Width/ScreenWidth(), 0, x1);
+				y0 = clamp(State.m_ClipY*Height/ScreenHeight(), 0, y1);
+				x1 = clamp((State.m_ClipX+State.m_ClipW)*Width/ScreenWidth(), 0, x1);
+				y1 = clamp((State.m_ClipY+State.m_ClipH)*Height/ScreenHeight(), 0, y1);
+			}
+			gsKit_set_scissor(gsGlobal, GS_SETREG_SCISSOR(x0, x1, y0, y1));
+		}
+		else if(m_DrawHalfHeight)
+		{
+			int x0 = 0, y0 = 0, x1 = gsGlobal->Width-1, y1 = DrawHeight()-1;
+			if(State.m_ClipEnable)
+			{
+				x0 = State.m_ClipX;
+				y0 = State.m_ClipY/2;
+				x1 = State.m_ClipX+State.m_ClipW;
+				y1 = (State.m_ClipY+State.m_ClipH)/2;
+			}
+			gsKit_set_scissor(gsGlobal, GS_SETREG_SCISSOR(x0, x1, y0, y1));
+		}
+		else if(State.m_ClipEnable)
+			gsKit_set_scissor(gsGlobal, GS_SETREG_SCISSOR(State.m_ClipX, State.m_ClipX+State.m_ClipW, State.m_ClipY, State.m_ClipY+State.m_ClipH));
+		else
+			gsKit_set_scissor(gsGlobal, GS_SCISSOR_RESET);
+		m_BackendStats.m_StateChanges++;
+	}
+
+	if(TargetChanged || pOld->m_ScreenX0 != State.m_ScreenX0 || pOld->m_ScreenY0 != State.m_ScreenY0 ||
+		pOld->m_ScreenX1 != State.m_ScreenX1 || pOld->m_ScreenY1 != State.m_ScreenY1)
+	{
+		if(State.m_Target != -1)
+		{
+			const GSTEXTURE *pTarget = (GSTEXTURE*)m_aTextures[State.m_Target].m_Tex;
+			m_Transform.SetScreen(State.m_ScreenX0, State.m_ScreenY0, State.m_ScreenX1, State.m_ScreenY1, pTarget->Width, pTarget->Height, gsGlobal->OffsetX, gsGlobal->OffsetY);
+		}
+		else
+			m_Transform.SetScreen(State.m_ScreenX0, State.m_ScreenY0, State.m_ScreenX1, State.m_ScreenY1, gsGlobal->Width, DrawHeight(), gsGlobal->OffsetX, gsGlobal->OffsetY);
+	}
+
+	m_AppliedState = State;
+	m_AppliedValid = true;
+}
+
+void CGraphics_PS2_gsKit::SetFrame(int Target)
+{
+	if(Target == -1)
+	{
+		// back to the buffer gsKit draws the frame into
+		gsKit_setactive(gsGlobal);
+		return;
+	}
+
+	// a render target is a frame buffer of its own, only FRAME has to point at it
+	const GSTEXTURE *pTarget = (GSTEXTURE*)m_aTextures[Target].m_Tex;
+	int Qwords = CGifPacket::AdQwords(1);
+	m_Packet.Init(gsKit_heap_alloc(gsGlobal, Qwords, Qwords*16, GIF_AD), Qwords);
+	m_Packet.BeginAD();
+	m_Packet.AddAD(CGifPacket::GS_REG_FRAME_1+gsGlobal->PrimContext, CGifPacket::RegFRAME(pTarget->Vram/CVramCache::PAGE_SIZE, pTarget->TBW, pTarget->PSM));
+	m_Packet.Finish();
+}
+
+int CGraphics_PS2_gsKit::DrawHeight() const
+{
+	return m_DrawHalfHeight ? gsGlobal->Height/2 : gsGlobal->Height;
+}
+
+void CGraphics_PS2_gsKit::SetDisplay(bool HalfHeight)
+{
+	// the display reads DH/(MagV+1) lines of the frame buffer, doubling the
+	// vertical magnification shows the upper half over the whole screen
+	int MagV = HalfHeight ? (gsGlobal->MagV+1)*2-1 : gsGlobal->MagV;
+	GS_SET_DISPLAY1(gsGlobal->StartX, gsGlobal->StartY, gsGlobal->MagH, MagV, gsGlobal->DW-1, gsGlobal->DH-1);
+	GS_SET_DISPLAY2(gsGlobal->StartX, gsGlobal->StartY, gsGlobal->MagH, MagV, gsGlobal->DW-1, gsGlobal->DH-1);
+	m_DisplayHalfHeight = HalfHeight;
+}
+
+void CGraphics_PS2_gsKit::RecordCommand()
+{
+	int Num = m_NumVertices - m_CommandStart;
+	if(Num <= 0)
+		return;
+
+	CCommand *pCmd = &m_pList->m_aCommands[m_NumCommands++];
+	pCmd->m_State = m_State;
+	pCmd->m_FirstVertex = m_CommandStart;
+	pCmd->m_NumVertices = Num;
+	pCmd->m_Next = -1;
+
+	// a mapping without width or height has no pixel bounds, the whole screen keeps it in order
+	if(m_State.m_ScreenX1 == m_State.m_ScreenX0 || m_State.m_ScreenY1 == m_State.m_ScreenY0)
+	{
+		pCmd->m_aBox[0] = 0.0f;
+		pCmd->m_aBox[1] = 0.0f;
+		pCmd->m_aBox[2] = ScreenWidth();
+		pCmd->m_aBox[3] = ScreenHeight();
+	}
+	else
+	{
+		// bounds in screen pixels so commands with different mappings can be compared
+		float MinX = m_pVertices[m_CommandStart].m_Pos.x, MaxX = MinX;
+		float MinY = m_pVertices[m_CommandStart].m_Pos.y, MaxY = MinY;
+		for(int i = m_CommandStart+1; i < m_NumVertices; i++)
+		{
+			MinX = min(MinX, m_pVertices[i].m_Pos.x);
+			MaxX = max(MaxX, m_pVertices[i].m_Pos.x);
+			MinY = min(MinY, m_pVertices[i].m_Pos.y);
+			MaxY = max(MaxY, m_pVertices[i].m_Pos.y);
+		}
+		const float ScaleX = ScreenWidth()/(m_State.m_ScreenX1-m_State.m_ScreenX0);
+		const float ScaleY = ScreenHeight()/(m_State.m_ScreenY1-m_State.m_ScreenY0);
+		float x0 = (MinX-m_State.m_ScreenX0)*ScaleX, x1 = (MaxX-m_State.m_ScreenX0)*ScaleX;
+		float y0 = (MinY-m_State.m_ScreenY0)*ScaleY, y1 = (MaxY-m_State.m_ScreenY0)*ScaleY;
+		pCmd->m_aBox[0] = min(x0, x1);
+		pCmd->m_aBox[1] = min(y0, y1);
+		pCmd->m_aBox[2] = max(x0, x1);
+		pCmd->m_aBox[3] = max(y0, y1);
+	}
+
+	m_CommandStart = m_NumVertices;
+	m_Stats.m_DrawCalls++;
+	m_Stats.m_Vertices += Num;
+
+	if(!g_Config.m_GfxRenderQueue || m_NumCommands == MAX_COMMANDS)
+		Flush();
+}
+
+void CGraphics_PS2_gsKit::ExecuteList(CCommandList *pList)
+{
+	if(pList->m_Clear)
+	{
+		if(m_AppliedValid && m_AppliedState.m_Target != -1)
+			SetFrame(-1);
+		// the clear is a sprite, the last list's clip rectangle would cut it
+		gsKit_set_scissor(gsGlobal, GS_SCISSOR_RESET);
+		m_AppliedValid = false;
+		gsKit_clear(gsGlobal, GS_SETREG_RGBAQ(pList->m_aClearColor[0]*255, pList->m_aClearColor[1]*255, pList->m_aClearColor[2]*255, 0, 0));
+	}
+
+	// group the recorded commands into batches. a command may join an earlier
+	// batch with the same state as long as it does not overlap anything that
+	// is drawn in between, so the visible result stays the same
+	int NumBatches = 0;
+	for(int i = 0; i < pList->m_NumCommands; i++)
+	{
+		CCommand *pCmd = &pList->m_aCommands[i];
+		int Target = -1;
+
+		for(int b = NumBatches-1; b >= 0 && b >= NumBatches-BATCH_LOOKBACK; b--)
+		{
+			if(SameState(pList->m_aCommands[m_aBatches[b].m_FirstCommand].m_State, pCmd->m_State))
+			{
+				Target = b;
+				break;
 			}
-			else
+			if(Overlaps(m_aBatches[b].m_aBox, pCmd->m_aBox))
+				break;
+		}
+
+		if(Target == -1)
+		{
+			CBatch *pBatch = &m_aBatches[NumBatches++];
+			pBatch->m_FirstCommand = i;
+			pBatch->m_LastCommand = i;
+			mem_copy(pBatch->m_aBox, pCmd->m_aBox, sizeof(pBatch->m_aBox));
+		}
+		else
+		{
+			CBatch *pBatch = &m_aBatches[Target];
+			pList->m_aCommands[pBatch->m_LastCommand].m_Next = i;
+			pBatch->m_LastCommand = i;
+			pBatch->m_aBox[0] = min(pBatch->m_aBox[0], pCmd->m_aBox[0]);
+			pBatch->m_aBox[1] = min(pBatch->m_aBox[1], pCmd->m_aBox[1]);
+			pBatch->m_aBox[2] = max(pBatch->m_aBox[2], pCmd->m_aBox[2]);
+			pBatch->m_aBox[3] = max(pBatch->m_aBox[3], pCmd->m_aBox[3]);
+		}
+	}
+
+	if(m_RenderEnable)
+	{
+		for(int b = 0; b < NumBatches; b++)
+		{
+			const CCommand *pCmd = &pList->m_aCommands[m_aBatches[b].m_FirstCommand];
+			const CRenderState &State = pCmd->m_State;
+			ApplyState(State);
+
+			// commands that were recorded back to back go out as one range
+			int First = pCmd->m_FirstVertex;
+			int Num = pCmd->m_NumVertices;
+			for(int c = pCmd->m_Next; c != -1; c = pList->m_aCommands[c].m_Next)
 			{
-				GSTEXTURE* gsTex = (GSTEXTURE*)m_aTextures[m_CurrTexture].m_Tex;
-
-				if (g_Config.m_GfxQuadAsTriangle)
-					gsKit_prim_triangle_goraud_texture_3d(gsGlobal, gsTex,
-						m_aVertices[i+0].m_Pos.x, m_aVertices[i+0].m_Pos.y, 0,    m_aVertices[i+0].m_Tex.u * gsTex->Width, m_aVertices[i+0].m_Tex.v * gsTex->Height,
-						m_aVertices[i+1].m_Pos.x, m_aVertices[i+1].m_Pos.y, 0,    m_aVertices[i+1].m_Tex.u * gsTex->Width, m_aVertices[i+1].m_Tex.v * gsTex->Height,
-						m_aVertices[i+2].m_Pos.x, m_aVertices[i+2].m_Pos.y, 0,    m_aVertices[i+2].m_Tex.u * gsTex->Width, m_aVertices[i+2].m_Tex.v * gsTex->Height,
-						GS_SETREG_RGBAQ(m_aVertices[i+0].m_Color.r*128, m_aVertices[i+0].m_Color.g*128, m_aVertices[i+0].m_Color.b*128, (m_aVertices[i+0].m_Color.a*128), 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+1].m_Color.r*128, m_aVertices[i+1].m_Color.g*128, m_aVertices[i+1].m_Color.b*128, (m_aVertices[i+1].m_Color.a*128), 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+2].m_Color.r*128, m_aVertices[i+2].m_Color.g*128, m_aVertices[i+2].m_Color.b*128, (m_aVertices[i+2].m_Color.a*128), 0));
+				if(pList->m_aCommands[c].m_FirstVertex == First+Num)
+					Num += pList->m_aCommands[c].m_NumVertices;
 				else
-					gsKit_prim_quad_goraud_texture_3d(gsGlobal, gsTex,
-						m_aVertices[i+0].m_Pos.x, m_aVertices[i+0].m_Pos.y, 0,    m_aVertices[i+0].m_Tex.u * gsTex->Width, m_aVertices[i+0].m_Tex.v * gsTex->Height,
-						m_aVertices[i+1].m_Pos.x, m_aVertices[i+1].m_Pos.y, 0,    m_aVertices[i+1].m_Tex.u * gsTex->Width, m_aVertices[i+1].m_Tex.v * gsTex->Height,
-						m_aVertices[i+2].m_Pos.x, m_aVertices[i+2].m_Pos.y, 0,    m_aVertices[i+2].m_Tex.u * gsTex->Width, m_aVertices[i+2].m_Tex.v * gsTex->Height,
-						m_aVertices[i+3].m_Pos.x, m_aVertices[i+3].m_Pos.y, 0,    m_aVertices[i+3].m_Tex.u * gsTex->Width, m_aVertices[i+3].m_Tex.v * gsTex->Height,
-						GS_SETREG_RGBAQ(m_aVertices[i+0].m_Color.r*128, m_aVertices[i+0].m_Color.g*128, m_aVertices[i+0].m_Color.b*128, (m_aVertices[i+0].m_Color.a*128), 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+1].m_Color.r*128, m_aVertices[i+1].m_Color.g*128, m_aVertices[i+1].m_Color.b*128, (m_aVertices[i+1].m_Color.a*128), 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+2].m_Color.r*128, m_aVertices[i+2].m_Color.g*128, m_aVertices[i+2].m_Color.b*128, (m_aVertices[i+2].m_Color.a*128), 0),
-						GS_SETREG_RGBAQ(m_aVertices[i+3].m_Color.r*128, m_aVertices[i+3].m_Color.g*128, m_aVertices[i+3].m_Color.b*128, (m_aVertices[i+3].m_Color.a*128), 0));
+				{
+					EmitVertices(pList, State, First, Num);
+					First = pList->m_aCommands[c].m_FirstVertex;
+					Num = pList->m_aCommands[c].m_NumVertices;
+				}
 			}
+			EmitVertices(pList, State, First, Num);
+		}
+	}
+
+	m_BackendStats.m_Batches += NumBatches;
+
+	if(pList->m_Swap)
+	{
+		m_VramCache.NextFrame();
+		m_BackendStats.m_TextureUploads = m_VramCache.Stats().m_Uploads;
+		m_BackendStats.m_UploadBytes = m_VramCache.Stats().m_UploadBytes;
+		m_BackendStats.m_Evictions = m_VramCache.Stats().m_Evictions;
+		m_FrameBackendStats = m_BackendStats;
+		mem_zero(&m_BackendStats, sizeof(m_BackendStats));
+
+		WaitGifDma();
+		gsKit_queue_exec(gsGlobal);
+		WaitGifDma();
+		int64 ReadyTime = time_get();
+
+		// the flip and the display change after it belong in the blank, the
+		// main thread may not hold them up. Unthreaded it is the main thread
+		ee_thread_status_t Thread;
+		ReferThreadStatus(GetThreadId(), &Thread);
+		const int Priority = Thread.current_priority;
+		if(Priority > FLIP_THREAD_PRIORITY)
+			ChangeThreadPriority(GetThreadId(), FLIP_THREAD_PRIORITY);
+
+		SyncFlip();
+		int64 FlipTime = time_get();
+
+		lock_wait(m_FrameTimingLock);
+		m_FrameTiming.m_Frame = pList->m_Frame;
+		m_FrameTiming.m_ReadyTime = ReadyTime;
+		m_FrameTiming.m_FlipTime = FlipTime;
+		lock_unlock(m_FrameTimingLock);
+
+		// still in the blank, the frame that is shown now decides how much
+		// of the buffer the display reads
+		if(m_DisplayHalfHeight != m_DrawHalfHeight)
+			SetDisplay(m_DrawHalfHeight);
+
+		if(Priority > FLIP_THREAD_PRIORITY)
+			ChangeThreadPriority(GetThreadId(), Priority);
+
+		// the flip points FRAME at the next buffer again
+		if(m_AppliedValid && m_AppliedState.m_Target != -1)
+			m_AppliedValid = false;
+
+		// scissor and transform follow the height of the next frame
+		if(m_DrawHalfHeight != pList->m_HalfHeight)
+		{
+			m_DrawHalfHeight = pList->m_HalfHeight;
+			m_AppliedValid = false;
 		}
 	}
 
+	// everything before the signals has been sent
+	for(int i = 0; i < pList->m_NumSignals; i++)
+		pList->m_apSignals[i]->signal();
+}
+
+void CGraphics_PS2_gsKit::ResetList(CCommandList *pList)
+{
+	pList->m_NumVertices = 0;
+	pList->m_NumCommands = 0;
+	pList->m_Clear = false;
+	pList->m_Swap = false;
+	pList->m_HalfHeight = false;
+	pList->m_NumSignals = 0;
+}
+
+void CGraphics_PS2_gsKit::RunBuffer(int Buffer)
+{
+	CCommandList *pList = m_apCommandLists[Buffer];
+	ExecuteList(pList);
+	ResetList(pList);
+}
+
+void CGraphics_PS2_gsKit::Flush()
+{
+	if(!m_NumCommands && !m_pList->m_Clear && !m_pList->m_Swap && !m_pList->m_NumSignals)
+		return;
+
+	// hand the list over. with the render thread it is replayed while we
+	// record into the other one, once that is free again
+	m_pList->m_NumVertices = m_NumVertices;
+	m_pList->m_NumCommands = m_NumCommands;
+	m_RenderThread.RunBuffer(m_CurrentList);
+	if(m_RenderThread.Threaded())
+		m_CurrentList = (m_CurrentList+1) % NUM_COMMAND_LISTS;
+	m_pList = m_apCommandLists[m_CurrentList];
+	m_pVertices = m_pList->m_aVertices;
+
 	// Reset pointer
+	m_NumCommands = 0;
 	m_NumVertices = 0;
+	m_CommandStart = 0;
 }
 
 void CGraphics_PS2_gsKit::AddVertices(int Count)
 {
 	m_NumVertices += Count;
 	if((m_NumVertices + Count) >= MAX_VERTICES)
+	{
+		// out of room, submit everything and continue the current draw from the start
+		RecordCommand();
 		Flush();
+	}
 }
 
 void CGraphics_PS2_gsKit::Rotate(const CPoint &rCenter, CVertex *pPoints, int NumPoints)
@@ -182,43 +713,85 @@ CGraphics_PS2_gsKit::CGraphics_PS2_gsKit()
 
 	m_RenderEnable = true;
 	m_DoScreenshot = false;
+
+	mem_zero(&m_State, sizeof(m_State));
+	m_State.m_Texture = -1;
+	m_State.m_Target = -1;
+	m_TextureGeneration = 0;
+	m_aClearColor[0] = m_aClearColor[1] = m_aClearColor[2] = 0.0f;
+	m_TexOffset.u = m_TexOffset.v = 0.0f;
+	m_TexScale.u = m_TexScale.v = 1.0f;
+	m_State.m_BlendMode = BLEND_NORMAL;
+	m_AppliedValid = false;
+	m_HalfHeight = false;
+	m_DrawHalfHeight = false;
+	m_DisplayHalfHeight = false;
+	m_NumCommands = 0;
+	m_CommandStart = 0;
+
+	for(int i = 0; i < NUM_COMMAND_LISTS; i++)
+		m_apCommandLists[i] = 0;
+	m_CurrentList = 0;
+	m_pList = 0;
+	m_pVertices = 0;
+
+	mem_zero(&m_Stats, sizeof(m_Stats));
+	mem_zero(&m_LastStats, sizeof(m_LastStats));
+	mem_zero(&m_BackendStats, sizeof(m_BackendStats));
+	mem_zero(&m_FrameBackendStats, sizeof(m_FrameBackendStats));
+
+	m_pEngine = 0;
+	mem_zero(m_aTextureLoads, sizeof(m_aTextureLoads));
+	m_TextureLoadLock = lock_create();
+	m_NumSwaps = 0;
+	m_FrameTiming.m_Frame = -1;
+	m_FrameTiming.m_ReadyTime = m_FrameTiming.m_FlipTime = 0;
+	m_FrameTimingLock = lock_create();
+	m_TextureLoaderActive = false;
+	m_NextLoadOrder = 0;
 }
 
+// state changes only take effect when the draws using them are submitted
 void CGraphics_PS2_gsKit::ClipEnable(int x, int y, int w, int h)
 {
-	gsKit_set_scissor(gsGlobal, GS_SETREG_SCISSOR(x, x+w, y, y+h));
+	m_State.m_ClipEnable = 1;
+	m_State.m_ClipX = x;
+	m_State.m_ClipY = y;
+	m_State.m_ClipW = w;
+	m_State.m_ClipH = h;
 }
 
 void CGraphics_PS2_gsKit::ClipDisable()
 {
-	gsKit_set_scissor(gsGlobal, GS_SCISSOR_RESET);
+	m_State.m_ClipEnable = 0;
+	m_State.m_ClipX = m_State.m_ClipY = m_State.m_ClipW = m_State.m_ClipH = 0;
 }
 
 void CGraphics_PS2_gsKit::BlendNone()
 {
-	gsKit_set_test(gsGlobal, GS_ATEST_OFF);
+	m_State.m_BlendMode = BLEND_NONE;
 }
 
 void CGraphics_PS2_gsKit::BlendNormal()
 {
-	gsKit_set_test(gsGlobal, GS_ATEST_ON);
+	m_State.m_BlendMode = BLEND_NORMAL;
 	//gsKit_set_primalpha(gsGlobal, GS_SETREG_ALPHA(A_COLOR_SOURCE, A_COLOR_DEST, A_ALPHA_SOURCE, A_COLOR_DEST, 0), 0);
 }
 
 void CGraphics_PS2_gsKit::BlendAdditive()
 {
-	gsKit_set_test(gsGlobal, GS_ATEST_ON);
+	m_State.m_BlendMode = BLEND_ADDITIVE;
 	//gsKit_set_primalpha(gsGlobal, GS_SETREG_ALPHA(A_COLOR_SOURCE, A_COLOR_NULL, A_ALPHA_FIX, A_COLOR_DEST, 0x80), 0);
 }
 
 void CGraphics_PS2_gsKit::WrapNormal()
 {
-	gsKit_set_clamp(gsGlobal, GS_CMODE_REPEAT);
+	m_State.m_WrapMode = WRAP_REPEAT;
 }
 
 void CGraphics_PS2_gsKit::WrapClamp()
 {
-	gsKit_set_clamp(gsGlobal, GS_CMODE_CLAMP);
+	m_State.m_WrapMode = WRAP_CLAMP;
 }
 
 int CGraphics_PS2_gsKit::MemoryUsage() const
@@ -233,6 +806,12 @@ void CGraphics_PS2_gsKit::MapScreen(float TopLeftX, float TopLeftY, float Bottom
 	m_ScreenX1 = BottomRightX;
 	m_ScreenY1 = BottomRightY;
 
+	// the transform is set up once per batch when it is submitted
+	m_State.m_ScreenX0 = m_ScreenX0;
+	m_State.m_ScreenY0 = m_ScreenY0;
+	m_State.m_ScreenX1 = m_ScreenX1;
+	m_State.m_ScreenY1 = m_ScreenY1;
+
 	/*
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
@@ -252,13 +831,14 @@ void CGraphics_PS2_gsKit::LinesBegin()
 {
 	dbg_assert(m_Drawing == 0, "called Graphics()->LinesBegin twice");
 	m_Drawing = DRAWING_LINES;
+	m_State.m_Primitive = DRAWING_LINES;
 	SetColor(1,1,1,1);
 }
 
 void CGraphics_PS2_gsKit::LinesEnd()
 {
 	dbg_assert(m_Drawing == DRAWING_LINES, "called Graphics()->LinesEnd without begin");
-	Flush();
+	RecordCommand();
 	m_Drawing = 0;
 }
 
@@ -270,33 +850,89 @@ void CGraphics_PS2_gsKit::LinesDraw(const CLineItem *pArray, int Num)
 
 	for(int i = 0; i < Num; ++i)
 	{
-		m_aVertices[m_NumVertices + 3*i].m_Pos.x = pArray[i].m_X0;
-		m_aVertices[m_NumVertices + 3*i].m_Pos.y = pArray[i].m_Y0;
-		m_aVertices[m_NumVertices + 3*i].m_Tex = m_aTexture[0];
-		m_aVertices[m_NumVertices + 3*i].m_Color = m_aColor[0];
+		m_pVertices[m_NumVertices + 3*i].m_Pos.x = pArray[i].m_X0;
+		m_pVertices[m_NumVertices + 3*i].m_Pos.y = pArray[i].m_Y0;
+		m_pVertices[m_NumVertices + 3*i].m_Tex = m_aTexture[0];
+		m_pVertices[m_NumVertices + 3*i].m_Color = m_aColor[0];
 
-		m_aVertices[m_NumVertices + 3*i + 1].m_Pos.x = pArray[i].m_X1;
-		m_aVertices[m_NumVertices + 3*i + 1].m_Pos.y = pArray[i].m_Y1;
-		m_aVertices[m_NumVertices + 3*i + 1].m_Tex = m_aTexture[1];
-		m_aVertices[m_NumVertices + 3*i + 1].m_Color = m_aColor[1];
+		m_pVertices[m_NumVertices + 3*i + 1].m_Pos.x = pArray[i].m_X1;
+		m_pVertices[m_NumVertices + 3*i + 1].m_Pos.y = pArray[i].m_Y1;
+		m_pVertices[m_NumVertices + 3*i + 1].m_Tex = m_aTexture[1];
+		m_pVertices[m_NumVertices + 3*i + 1].m_Color = m_aColor[1];
 
-		m_aVertices[m_NumVertices + 3*i + 2].m_Pos.x = pArray[i].m_X1;
-		m_aVertices[m_NumVertices + 3*i + 2].m_Pos.y = pArray[i].m_Y1;
-		m_aVertices[m_NumVertices + 3*i + 2].m_Tex = m_aTexture[1];
-		m_aVertices[m_NumVertices + 3*i + 2].m_Color = m_aColor[1];
+		m_pVertices[m_NumVertices + 3*i + 2].m_Pos.x = pArray[i].m_X1;
+		m_pVertices[m_NumVertices + 3*i + 2].m_Pos.y = pArray[i].m_Y1;
+		m_pVertices[m_NumVertices + 3*i + 2].m_Tex = m_aTexture[1];
+		m_pVertices[m_NumVertices + 3*i + 2].m_Color = m_aColor[1];
 
 		if (!g_Config.m_GfxQuadAsTriangle)
 		{
-			m_aVertices[m_NumVertices + 3*i + 3].m_Pos.x = pArray[i].m_X0;
-			m_aVertices[m_NumVertices + 3*i + 3].m_Pos.y = pArray[i].m_Y0;
-			m_aVertices[m_NumVertices + 3*i + 3].m_Tex = m_aTexture[0];
-			m_aVertices[m_NumVertices + 3*i + 3].m_Color = m_aColor[0];
+			m_pVertices[m_NumVertices + 3*i + 3].m_Pos.x = pArray[i].m_X0;
+			m_pVertices[m_NumVertices + 3*i + 3].m_Pos.y = pArray[i].m_Y0;
+			m_pVertices[m_NumVertices + 3*i + 3].m_Tex = m_aTexture[0];
+			m_pVertices[m_NumVertices + 3*i + 3].m_Color = m_aColor[0];
 		}
 	}
 
 	AddVertices(vertexPrim*Num);
 }
 
+int CGraphics_PS2_gsKit::VramSize(const GSTEXTURE *pTex, int *pClutOffset)
+{
+	// the palette sits in the block right behind the indices
+	int Size = (gsKit_texture_size(pTex->Width, pTex->Height, pTex->PSM) + 255) & ~255;
+	*pClutOffset = Size;
+	if(pTex->PSM == GS_PSM_T8)
+		Size += gsKit_texture_size(16, 16, pTex->ClutPSM);
+	else if(pTex->PSM == GS_PSM_T4)
+		Size += gsKit_texture_size(8, 2, pTex->ClutPSM);
+	return Size;
+}
+
+int CGraphics_PS2_gsKit::Palettize(GSTEXTURE *pTex, const unsigned *pPixels)
+{
+	const int NumPixels = pTex->Width*pTex->Height;
+	const float MaxError = (float)g_Config.m_GfxTexturePaletteError;
+	unsigned char *pIndices = (unsigned char *)mem_alloc(NumPixels, 1);
+	CTextureQuantizer::CResult Result;
+
+	// 4 bit when the colors fit without loss, else a single median cut to 256
+	int NumColors = CTextureQuantizer::CountColors(pPixels, NumPixels, 16);
+	int Colors = pTex->Width%2 == 0 && NumColors != -1 ? 16 : 256;
+	if(!CTextureQuantizer::Quantize(pPixels, NumPixels, Colors, MaxError, pIndices, &Result))
+	{
+		_mem_free(pIndices);
+		return 0;
+	}
+
+	pTex->PSM = Colors == 16 ? GS_PSM_T4 : GS_PSM_T8;
+	pTex->ClutPSM = GS_PSM_CT32;
+	pTex->ClutStorageMode = GS_CLUT_STORAGE_CSM1;
+	pTex->Clut = (u32*)mem_alloc(Colors*sizeof(u32), 1);
+	mem_zero(pTex->Clut, Colors*sizeof(u32));
+	pTex->Mem = (u32*)mem_alloc(gsKit_texture_size_ee(pTex->Width, pTex->Height, pTex->PSM), 1);
+
+	// CSM1 stores entries 8-15 and 16-23 of every 32 swapped
+	for(int i = 0; i < Result.m_NumColors; i++)
+	{
+		int Slot = Colors == 256 ? ((i & ~0x18) | ((i & 0x08) << 1) | ((i & 0x10) >> 1)) : i;
+		pTex->Clut[Slot] = Result.m_aPalette[i];
+	}
+
+	if(Colors == 256)
+		mem_copy(pTex->Mem, pIndices, NumPixels);
+	else
+	{
+		// two pixels per byte, the left one in the low nibble
+		u8 *pOut = (u8*)pTex->Mem;
+		for(int i = 0; i < NumPixels; i += 2)
+			pOut[i/2] = pIndices[i] | (pIndices[i+1] << 4);
+	}
+
+	_mem_free(pIndices);
+	return gsKit_texture_size_ee(pTex->Width, pTex->Height, pTex->PSM) + Colors*sizeof(u32);
+}
+
 int CGraphics_PS2_gsKit::UnloadTexture(int Index)
 {
 	if(Index == m_InvalidTexture)
@@ -305,37 +941,220 @@ int CGraphics_PS2_gsKit::UnloadTexture(int Index)
 	if(Index < 0)
 		return 0;
 
-	GSTEXTURE* gsTex = (GSTEXTURE*)m_aTextures[Index].m_Tex;
-	_mem_free(gsTex->Mem);
-	_mem_free(gsTex);
+	// queued draws might still use it
+	Flush();
+	WaitForIdle();
+	m_VramCache.Remove(Index);
+	m_aTextures[Index].m_RenderTarget = false;
+	m_TextureGeneration++;
+
+	// the result of a load that is still running is thrown away when it arrives
+	if(m_aTextures[Index].m_Loading)
+	{
+		lock_wait(m_TextureLoadLock);
+		for(int i = 0; i < MAX_TEXTURE_LOADS; i++)
+			if(m_aTextureLoads[i].m_Status != LOAD_FREE && m_aTextureLoads[i].m_Texture == Index)
+			{
+				m_aTextureLoads[i].m_Texture = -1;
+				if(m_aTextureLoads[i].m_Status == LOAD_QUEUED)
+					m_aTextureLoads[i].m_Status = LOAD_FREE;
+			}
+		lock_unlock(m_TextureLoadLock);
+		m_aTextures[Index].m_Loading = false;
+	}
+
+	// atlas members have no pixels of their own, the atlas goes with the last of them
+	int Atlas = m_aTextures[Index].m_Atlas;
+	if(Atlas == -1 && m_aTextures[Index].m_Tex)
+		DestroyTexture((GSTEXTURE*)m_aTextures[Index].m_Tex);
+	m_aTextures[Index].m_Tex = 0;
+	m_aTextures[Index].m_Atlas = -1;
 
 	m_aTextures[Index].m_Next = m_FirstFreeTexture;
 	m_TextureMemoryUsage -= m_aTextures[Index].m_MemSize;
 	m_FirstFreeTexture = Index;
+
+	if(Atlas != -1 && --m_aTextures[Atlas].m_AtlasRefs == 0)
+		UnloadTexture(Atlas);
 	return 0;
 }
 
+int CGraphics_PS2_gsKit::BuildTextureAtlas(const int *pTextures, int Num)
+{
+	// only plain 32 bit textures can be copied together
+	CAtlasPacker::CRect aRects[CAtlasPacker::MAX_RECTS];
+	int aMembers[CAtlasPacker::MAX_RECTS];
+	int NumMembers = 0;
+	for(int i = 0; i < Num && NumMembers < CAtlasPacker::MAX_RECTS; i++)
+	{
+		int Index = pTextures[i];
+		if(Index < 0 || Index == m_InvalidTexture || m_aTextures[Index].m_Atlas != -1 || !m_aTextures[Index].m_Tex ||
+			m_aTextures[Index].m_RenderTarget)
+			continue;
+		GSTEXTURE *gsTex = (GSTEXTURE*)m_aTextures[Index].m_Tex;
+		if(gsTex->PSM != GS_PSM_CT32)
+			continue;
+
+		aRects[NumMembers].m_W = gsTex->Width;
+		aRects[NumMembers].m_H = gsTex->Height;
+		aMembers[NumMembers++] = Index;
+	}
+
+	// grow the atlas until all of them fit, or take as many as fit into the largest one
+	int Width = 64, Height = 64;
+	while(CAtlasPacker::Pack(aRects, NumMembers, Width, Height, ATLAS_PADDING) < NumMembers && Height < MAX_ATLAS_SIZE)
+	{
+		if(Width <= Height)
+			Width *= 2;
+		else
+			Height *= 2;
+	}
+	int Placed = CAtlasPacker::Pack(aRects, NumMembers, Width, Height, ATLAS_PADDING);
+	if(Placed < 2)
+		return 0;
+
+	// queued draws might still use the members
+	Flush();
+	WaitForIdle();
+
+	int Atlas = GrabTexture();
+
+	GSTEXTURE* pAtlasTex = (GSTEXTURE*)mem_alloc(sizeof(GSTEXTURE), 1);
+	mem_zero(pAtlasTex, sizeof(GSTEXTURE));
+	pAtlasTex->Width = Width;
+	pAtlasTex->Height = Height;
+	pAtlasTex->Filter = GS_FILTER_LINEAR;
+	pAtlasTex->PSM = GS_PSM_CT32;
+	pAtlasTex->Mem = (u32*)mem_alloc(gsKit_texture_size_ee(Width, Height, GS_PSM_CT32), 1);
+	mem_zero(pAtlasTex->Mem, Width*Height*sizeof(u32));
+
+	m_aTextures[Atlas].m_Tex = (void*)pAtlasTex;
+	m_aTextures[Atlas].m_MemSize = Width*Height*4;
+	m_aTextures[Atlas].m_AtlasRefs = Placed;
+	m_TextureMemoryUsage += m_aTextures[Atlas].m_MemSize;
+
+	for(int i = 0; i < NumMembers; i++)
+	{
+		const CAtlasPacker::CRect *pRect = &aRects[i];
+		if(pRect->m_X == -1)
+			continue;
+
+		CTexture *pMember = &m_aTextures[aMembers[i]];
+		GSTEXTURE *gsTex = (GSTEXTURE*)pMember->m_Tex;
+
+		// copy it over with its edge pixels repeated into the padding
+		for(int y = -ATLAS_PADDING; y < pRect->m_H + ATLAS_PADDING; y++)
+		{
+			const u32 *pSrc = &gsTex->Mem[clamp(y, 0, pRect->m_H-1) * gsTex->Width];
+			u32 *pDst = &pAtlasTex->Mem[(pRect->m_Y + y) * Width + pRect->m_X];
+			for(int x = -ATLAS_PADDING; x < pRect->m_W + ATLAS_PADDING; x++)
+				pDst[x] = pSrc[clamp(x, 0, pRect->m_W-1)];
+		}
+
+		m_VramCache.Remove(aMembers[i]);
+		_mem_free(gsTex->Mem);
+		_mem_free(gsTex);
+		m_TextureMemoryUsage -= pMember->m_MemSize;
+
+		pMember->m_Tex = 0;
+		pMember->m_MemSize = 0;
+		pMember->m_Atlas = Atlas;
+		pMember->m_AtlasOffset.u = CAtlasPacker::RemapU(*pRect, Width, 0.0f);
+		pMember->m_AtlasOffset.v = CAtlasPacker::RemapV(*pRect, Height, 0.0f);
+		pMember->m_AtlasScale.u = pRect->m_W / (float)Width;
+		pMember->m_AtlasScale.v = pRect->m_H / (float)Height;
+	}
+
+	if(g_Config.m_Debug)
+		dbg_msg("graphics/texture", "built %dx%d atlas from %d of %d textures", Width, Height, Placed, Num);
+	return Placed;
+}
+
+int CGraphics_PS2_gsKit::CreateRenderTarget(int Width, int Height)
+{
+	// frame buffers are laid out in pages of 64x32 pixels
+	GSTEXTURE *gsTex = (GSTEXTURE*)mem_alloc(sizeof(GSTEXTURE), 1);
+	mem_zero(gsTex, sizeof(GSTEXTURE));
+	gsTex->Width = (Width+63)&~63;
+	gsTex->Height = (Height+31)&~31;
+	gsTex->PSM = GS_PSM_CT32;
+	gsTex->TBW = gsTex->Width/64;
+	gsTex->Filter = (int)gsTex->Width == ScreenWidth() && (int)gsTex->Height == ScreenHeight() ? GS_FILTER_NEAREST : GS_FILTER_LINEAR;
+	int Tex = AddTexture(gsTex, 0);
+
+	// it never leaves vram, nothing may be drawing around the pages it takes
+	Flush();
+	WaitForIdle();
+	int ClutOffset;
+	int Page = m_VramCache.Pin(Tex, VramSize(gsTex, &ClutOffset));
+	if(Page == -1)
+	{
+		UnloadTexture(Tex);
+		return -1;
+	}
+	gsTex->Vram = Page*CVramCache::PAGE_SIZE;
+
+	m_aTextures[Tex].m_RenderTarget = true;
+	m_aTextures[Tex].m_TargetGeneration = -1;
+	return Tex;
+}
+
+void CGraphics_PS2_gsKit::RenderTargetBegin(int TextureID)
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->RenderTargetBegin within begin");
+	dbg_assert(TextureID >= 0 && m_aTextures[TextureID].m_RenderTarget, "not a render target");
+
+	CTexture *pTarget = &m_aTextures[TextureID];
+	pTarget->m_TargetGeneration = m_TextureGeneration;
+	mem_copy(pTarget->m_aTargetClear, m_aClearColor, sizeof(m_aClearColor));
+
+	// gsKit_clear only knows the screen, cover the target with a quad instead
+	float aScreen[4];
+	GetScreen(&aScreen[0], &aScreen[1], &aScreen[2], &aScreen[3]);
+	CRenderState OldState = m_State;
+	CTexCoord OldOffset = m_TexOffset, OldScale = m_TexScale;
+
+	m_State.m_Target = TextureID;
+	TextureSet(-1);
+	BlendNone();
+	ClipDisable();
+	MapScreen(0, 0, 1, 1);
+	QuadsBegin();
+	SetColor(m_aClearColor[0], m_aClearColor[1], m_aClearColor[2], 1.0f);
+	CQuadItem QuadItem(0, 0, 1, 1);
+	QuadsDrawTL(&QuadItem, 1);
+	QuadsEnd();
+
+	m_State = OldState;
+	m_TexOffset = OldOffset;
+	m_TexScale = OldScale;
+	MapScreen(aScreen[0], aScreen[1], aScreen[2], aScreen[3]);
+	m_State.m_Target = TextureID;
+}
+
+void CGraphics_PS2_gsKit::RenderTargetEnd()
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->RenderTargetEnd within begin");
+	m_State.m_Target = -1;
+}
+
+bool CGraphics_PS2_gsKit::RenderTargetValid(int TextureID)
+{
+	const CTexture *pTarget = &m_aTextures[TextureID];
+	return pTarget->m_RenderTarget && pTarget->m_TargetGeneration == m_TextureGeneration &&
+		mem_comp(pTarget->m_aTargetClear, m_aClearColor, sizeof(m_aClearColor)) == 0;
+}
+
 int CGraphics_PS2_gsKit::LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData)
 {
     return 0;
 }
 
-int CGraphics_PS2_gsKit::LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
+GSTEXTURE *CGraphics_PS2_gsKit::CreateTexture(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags, int *pMemSize)
 {
 	u8* pTexData = (u8*)pData;
 	u8* pTmpData = 0;
 
-	int Tex = 0;
-
-	// don't waste memory on texture if we are stress testing
-	if(g_Config.m_DbgStress)
-		return 	m_InvalidTexture;
-
-	// grab texture
-	Tex = m_FirstFreeTexture;
-	m_FirstFreeTexture = m_aTextures[Tex].m_Next;
-	m_aTextures[Tex].m_Next = -1;
-
 	if(!(Flags&TEXLOAD_NORESAMPLE) && (Format == CImageInfo::FORMAT_RGBA || Format == CImageInfo::FORMAT_RGB))
 	{
 		if(Width > GL_MAX_TEXTURE_SIZE || Height > GL_MAX_TEXTURE_SIZE)
@@ -376,7 +1195,7 @@ int CGraphics_PS2_gsKit::LoadTextureRaw(int Width, int Height, int Format, const
 	{
 		if (pTmpData) _mem_free(pTmpData);
 		_mem_free(gsTex);
-		return m_InvalidTexture;
+		return 0;
 	}
 
 	for (int i=0; i<Width*Height; i++)
@@ -391,39 +1210,253 @@ int CGraphics_PS2_gsKit::LoadTextureRaw(int Width, int Height, int Format, const
 
 	if (pTmpData) _mem_free(pTmpData);
 
-	m_aTextures[Tex].m_Tex = (void*)gsTex;
-
 	// calculate memory usage
+	*pMemSize = Width*Height*PixelSize;
+
+	if(g_Config.m_GfxTexturePalette)
 	{
-		m_aTextures[Tex].m_MemSize = Width*Height*PixelSize;
+		u32 *pTrueColor = gsTex->Mem;
+		int Size = Palettize(gsTex, pTrueColor);
+		if(Size)
+		{
+			_mem_free(pTrueColor);
+			*pMemSize = Size;
+		}
 	}
 
+	return gsTex;
+}
+
+void CGraphics_PS2_gsKit::DestroyTexture(GSTEXTURE *pTex)
+{
+	if(pTex->Mem)
+		_mem_free(pTex->Mem);
+	if(pTex->Clut)
+		_mem_free(pTex->Clut);
+	_mem_free(pTex);
+}
+
+int CGraphics_PS2_gsKit::LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
+{
+	// don't waste memory on texture if we are stress testing
+	if(g_Config.m_DbgStress)
+		return 	m_InvalidTexture;
+
+	int MemSize;
+	GSTEXTURE *gsTex = CreateTexture(Width, Height, Format, pData, StoreFormat, Flags, &MemSize);
+	if(!gsTex)
+		return m_InvalidTexture;
+	return AddTexture(gsTex, MemSize);
+}
+
+int CGraphics_PS2_gsKit::GrabTexture()
+{
+	// a slot comes back from UnloadTexture with whatever it was used for last
+	int Tex = m_FirstFreeTexture;
+	m_FirstFreeTexture = m_aTextures[Tex].m_Next;
+
+	CTexture *pTex = &m_aTextures[Tex];
+	pTex->m_Tex = 0;
+	pTex->m_MemSize = 0;
+	pTex->m_Flags = 0;
+	pTex->m_Next = -1;
+	pTex->m_Loading = false;
+	pTex->m_Atlas = -1;
+	pTex->m_AtlasRefs = 0;
+	pTex->m_RenderTarget = false;
+	pTex->m_TargetGeneration = -1;
+	return Tex;
+}
+
+int CGraphics_PS2_gsKit::AddTexture(GSTEXTURE *gsTex, int MemSize)
+{
+	int Tex = GrabTexture();
+	m_aTextures[Tex].m_Tex = (void*)gsTex;
+	m_aTextures[Tex].m_MemSize = MemSize;
+
 	m_TextureMemoryUsage += m_aTextures[Tex].m_MemSize;
 	return Tex;
 }
 
+int CGraphics_PS2_gsKit::TextureLoadThread(void *pUser)
+{
+	CGraphics_PS2_gsKit *pSelf = (CGraphics_PS2_gsKit *)pUser;
+
+	while(1)
+	{
+		// take the most important load, the job ends when there is none left
+		lock_wait(pSelf->m_TextureLoadLock);
+		CTextureLoad *pLoad = 0;
+		for(int i = 0; i < MAX_TEXTURE_LOADS; i++)
+		{
+			CTextureLoad *pCur = &pSelf->m_aTextureLoads[i];
+			if(pCur->m_Status != LOAD_QUEUED)
+				continue;
+			if(!pLoad || pCur->m_Priority > pLoad->m_Priority || (pCur->m_Priority == pLoad->m_Priority && pCur->m_Order < pLoad->m_Order))
+				pLoad = pCur;
+		}
+		if(!pLoad)
+		{
+			pSelf->m_TextureLoaderActive = false;
+			lock_unlock(pSelf->m_TextureLoadLock);
+			return 0;
+		}
+		pLoad->m_Status = LOAD_RUNNING;
+		lock_unlock(pSelf->m_TextureLoadLock);
+
+		// decode, resample and swizzle without touching the texture table
+		int MemSize = 0;
+		GSTEXTURE *pTex = pSelf->LoadTextureFile(pLoad->m_aFilename, pLoad->m_StorageType, pLoad->m_StoreFormat, pLoad->m_Flags, &MemSize);
+
+		lock_wait(pSelf->m_TextureLoadLock);
+		pLoad->m_pResult = pTex;
+		pLoad->m_MemSize = MemSize;
+		pLoad->m_Status = LOAD_DONE;
+		lock_unlock(pSelf->m_TextureLoadLock);
+
+		// the job threads outrank the main thread on the EE, let it draw a frame in between
+		thread_sleep(1);
+	}
+}
+
+void CGraphics_PS2_gsKit::UpdateTextureLoads()
+{
+	lock_wait(m_TextureLoadLock);
+	for(int i = 0; i < MAX_TEXTURE_LOADS; i++)
+	{
+		CTextureLoad *pLoad = &m_aTextureLoads[i];
+		if(pLoad->m_Status != LOAD_DONE)
+			continue;
+
+		if(pLoad->m_Texture == -1)
+		{
+			if(pLoad->m_pResult)
+				DestroyTexture(pLoad->m_pResult);
+		}
+		else
+		{
+			// a failed load keeps drawing as the invalid texture
+			CTexture *pTexture = &m_aTextures[pLoad->m_Texture];
+			pTexture->m_Loading = false;
+			if(pLoad->m_pResult)
+			{
+				pTexture->m_Tex = (void*)pLoad->m_pResult;
+				pTexture->m_MemSize = pLoad->m_MemSize;
+				m_TextureMemoryUsage += pLoad->m_MemSize;
+				m_TextureGeneration++;
+				if(g_Config.m_Debug)
+					dbg_msg("graphics/texture", "loaded %s", pLoad->m_aFilename);
+			}
+		}
+		pLoad->m_pResult = 0;
+		pLoad->m_Status = LOAD_FREE;
+	}
+	lock_unlock(m_TextureLoadLock);
+}
+
+void CGraphics_PS2_gsKit::StopTextureLoads()
+{
+	lock_wait(m_TextureLoadLock);
+	for(int i = 0; i < MAX_TEXTURE_LOADS; i++)
+	{
+		m_aTextureLoads[i].m_Texture = -1;
+		if(m_aTextureLoads[i].m_Status == LOAD_QUEUED)
+			m_aTextureLoads[i].m_Status = LOAD_FREE;
+	}
+	lock_unlock(m_TextureLoadLock);
+
+	// the one that is running can't be interrupted
+	while(m_TextureLoaderActive)
+		thread_sleep(1);
+	UpdateTextureLoads();
+}
+
+int CGraphics_PS2_gsKit::LoadTextureAsync(const char *pFilename, int StorageType, int StoreFormat, int Flags, int Priority)
+{
+	if(!g_Config.m_GfxAsyncTextures || !m_pEngine || g_Config.m_DbgStress)
+		return LoadTexture(pFilename, StorageType, StoreFormat, Flags);
+	if(str_length(pFilename) < 3 || str_length(pFilename) >= (int)sizeof(m_aTextureLoads[0].m_aFilename))
+		return m_InvalidTexture;
+
+	lock_wait(m_TextureLoadLock);
+	CTextureLoad *pLoad = 0;
+	for(int i = 0; i < MAX_TEXTURE_LOADS && !pLoad; i++)
+		if(m_aTextureLoads[i].m_Status == LOAD_FREE)
+			pLoad = &m_aTextureLoads[i];
+	if(!pLoad)
+	{
+		lock_unlock(m_TextureLoadLock);
+		return LoadTexture(pFilename, StorageType, StoreFormat, Flags);
+	}
+
+	int Tex = GrabTexture();
+	m_aTextures[Tex].m_Loading = true;
+
+	str_copy(pLoad->m_aFilename, pFilename, sizeof(pLoad->m_aFilename));
+	pLoad->m_StorageType = StorageType;
+	pLoad->m_StoreFormat = StoreFormat;
+	pLoad->m_Flags = Flags;
+	pLoad->m_Priority = Priority;
+	pLoad->m_Order = m_NextLoadOrder++;
+	pLoad->m_Texture = Tex;
+	pLoad->m_pResult = 0;
+	pLoad->m_Status = LOAD_QUEUED;
+
+	bool StartJob = !m_TextureLoaderActive;
+	m_TextureLoaderActive = true;
+	lock_unlock(m_TextureLoadLock);
+
+	// one job works through all queued loads so the priorities are honoured
+	if(StartJob)
+		m_pEngine->AddJob(&m_TextureLoadJob, TextureLoadThread, this);
+	return Tex;
+}
+
 // simple uncompressed RGBA loaders
 int CGraphics_PS2_gsKit::LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags)
 {
 	int l = str_length(pFilename);
-	int ID;
-	CImageInfo Img;
 
 	if(l < 3)
 		return m_InvalidTexture;
-	if(LoadPNG(&Img, pFilename, StorageType))
-	{
-		if (StoreFormat == CImageInfo::FORMAT_AUTO)
-			StoreFormat = Img.m_Format;
 
-		ID = LoadTextureRaw(Img.m_Width, Img.m_Height, Img.m_Format, Img.m_pData, StoreFormat, Flags);
-		_mem_free(Img.m_pData);
-		if(ID != m_InvalidTexture && g_Config.m_Debug)
-			dbg_msg("graphics/texture", "loaded %s", pFilename);
-		return ID;
+	// don't waste memory on texture if we are stress testing
+	if(g_Config.m_DbgStress)
+		return m_InvalidTexture;
+
+	int MemSize;
+	GSTEXTURE *gsTex = LoadTextureFile(pFilename, StorageType, StoreFormat, Flags, &MemSize);
+	if(!gsTex)
+		return m_InvalidTexture;
+
+	if(g_Config.m_Debug)
+		dbg_msg("graphics/texture", "loaded %s", pFilename);
+	return AddTexture(gsTex, MemSize);
+}
+
+GSTEXTURE *CGraphics_PS2_gsKit::LoadTextureFile(const char *pFilename, int StorageType, int StoreFormat, int Flags, int *pMemSize)
+{
+	// textures that were converted before are found by a key of their png
+	unsigned Key = 0;
+	bool UseCache = g_Config.m_GfxTextureCache && m_TextureCache.SourceKey(pFilename, StorageType, &Key);
+	if(UseCache)
+	{
+		GSTEXTURE *gsTex = m_TextureCache.Load(Key, StoreFormat, Flags, pMemSize);
+		if(gsTex)
+			return gsTex;
 	}
 
-	return m_InvalidTexture;
+	CImageInfo Img;
+	if(!LoadPNG(&Img, pFilename, StorageType))
+		return 0;
+
+	int ImgStoreFormat = StoreFormat == CImageInfo::FORMAT_AUTO ? Img.m_Format : StoreFormat;
+	GSTEXTURE *gsTex = CreateTexture(Img.m_Width, Img.m_Height, Img.m_Format, Img.m_pData, ImgStoreFormat, Flags, pMemSize);
+	_mem_free(Img.m_pData);
+
+	if(gsTex && UseCache)
+		m_TextureCache.Save(Key, StoreFormat, Flags, gsTex, *pMemSize);
+	return gsTex;
 }
 
 int CGraphics_PS2_gsKit::LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType)
@@ -483,23 +1516,40 @@ void CGraphics_PS2_gsKit::TextureSet(int TextureID)
 {
 	dbg_assert(m_Drawing == 0, "called Graphics()->TextureSet within begin");
 
-	m_CurrTexture = TextureID;
-	if(TextureID != -1)
+	m_TexOffset.u = m_TexOffset.v = 0.0f;
+	m_TexScale.u = m_TexScale.v = 1.0f;
+	if(TextureID >= 0 && m_aTextures[TextureID].m_Atlas != -1)
 	{
-		GSTEXTURE* gsTex = (GSTEXTURE*)m_aTextures[TextureID].m_Tex;
-		gsKit_TexManager_bind(gsGlobal, gsTex);
+		m_TexOffset = m_aTextures[TextureID].m_AtlasOffset;
+		m_TexScale = m_aTextures[TextureID].m_AtlasScale;
+		TextureID = m_aTextures[TextureID].m_Atlas;
 	}
+	else if(TextureID >= 0 && !m_aTextures[TextureID].m_Tex)
+		TextureID = m_InvalidTexture; // still loading or failed to load
+
+	m_State.m_Texture = TextureID;
 }
 
 void CGraphics_PS2_gsKit::Clear(float r, float g, float b)
 {
-	gsKit_clear(gsGlobal, GS_SETREG_RGBAQ(r*255, g*255, b*255, 0, 0));
+	// the clear goes out before anything recorded after it
+	Flush();
+	m_pList->m_Clear = true;
+	m_pList->m_aClearColor[0] = r;
+	m_pList->m_aClearColor[1] = g;
+	m_pList->m_aClearColor[2] = b;
+
+	// render targets start out in it
+	m_aClearColor[0] = r;
+	m_aClearColor[1] = g;
+	m_aClearColor[2] = b;
 }
 
 void CGraphics_PS2_gsKit::QuadsBegin()
 {
 	dbg_assert(m_Drawing == 0, "called Graphics()->QuadsBegin twice");
 	m_Drawing = DRAWING_QUADS;
+	m_State.m_Primitive = DRAWING_QUADS;
 
 	QuadsSetSubset(0,0,1,1);
 	QuadsSetRotation(0);
@@ -509,7 +1559,7 @@ void CGraphics_PS2_gsKit::QuadsBegin()
 void CGraphics_PS2_gsKit::QuadsEnd()
 {
 	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsEnd without begin");
-	Flush();
+	RecordCommand();
 	m_Drawing = 0;
 }
 
@@ -547,21 +1597,17 @@ void CGraphics_PS2_gsKit::QuadsSetSubset(float TlU, float TlV, float BrU, float
 {
 	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsSetSubset without begin");
 
-	m_aTexture[0].u = TlU;	m_aTexture[1].u = BrU;
-	m_aTexture[0].v = TlV;	m_aTexture[1].v = TlV;
-
-	m_aTexture[3].u = TlU;	m_aTexture[2].u = BrU;
-	m_aTexture[3].v = BrV;	m_aTexture[2].v = BrV;
+	QuadsSetSubsetFree(TlU, TlV, BrU, TlV, BrU, BrV, TlU, BrV);
 }
 
 void CGraphics_PS2_gsKit::QuadsSetSubsetFree(
 	float x0, float y0, float x1, float y1,
 	float x2, float y2, float x3, float y3)
 {
-	m_aTexture[0].u = x0; m_aTexture[0].v = y0;
-	m_aTexture[1].u = x1; m_aTexture[1].v = y1;
-	m_aTexture[2].u = x2; m_aTexture[2].v = y2;
-	m_aTexture[3].u = x3; m_aTexture[3].v = y3;
+	m_aTexture[0].u = m_TexOffset.u + x0*m_TexScale.u; m_aTexture[0].v = m_TexOffset.v + y0*m_TexScale.v;
+	m_aTexture[1].u = m_TexOffset.u + x1*m_TexScale.u; m_aTexture[1].v = m_TexOffset.v + y1*m_TexScale.v;
+	m_aTexture[2].u = m_TexOffset.u + x2*m_TexScale.u; m_aTexture[2].v = m_TexOffset.v + y2*m_TexScale.v;
+	m_aTexture[3].u = m_TexOffset.u + x3*m_TexScale.u; m_aTexture[3].v = m_TexOffset.v + y3*m_TexScale.v;
 }
 
 void CGraphics_PS2_gsKit::QuadsDraw(CQuadItem *pArray, int Num)
@@ -575,164 +1621,145 @@ void CGraphics_PS2_gsKit::QuadsDraw(CQuadItem *pArray, int Num)
 	QuadsDrawTL(pArray, Num);
 }
 
-void CGraphics_PS2_gsKit::QuadsDrawTL(const CQuadItem *pArray, int Num)
+int CGraphics_PS2_gsKit::ReserveQuads(int Num)
 {
-	CPoint Center;
-	Center.z = 0;
+	// leave room so AddVertices does not have to flush in the middle of a call
+	int Count = min(Num, (MAX_VERTICES - m_NumVertices) / m_QuadEmitter.QuadVertices() - 1);
+	if(Count <= 0)
+	{
+		RecordCommand();
+		Flush();
+		Count = min(Num, (MAX_VERTICES - m_NumVertices) / m_QuadEmitter.QuadVertices() - 1);
+	}
+	return Count;
+}
 
+void CGraphics_PS2_gsKit::QuadsDrawTL(const CQuadItem *pArray, int Num)
+{
 	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawTL without begin");
 
-	if(g_Config.m_GfxQuadAsTriangle)
+	m_QuadEmitter.Setup(g_Config.m_GfxQuadAsTriangle, &m_aTexture[0].u, &m_aColor[0].r);
+	while(Num > 0)
 	{
-		for(int i = 0; i < Num; ++i)
-		{
-			// first triangle
-			m_aVertices[m_NumVertices + 6*i].m_Pos.x = pArray[i].m_X;
-			m_aVertices[m_NumVertices + 6*i].m_Pos.y = pArray[i].m_Y;
-			m_aVertices[m_NumVertices + 6*i].m_Tex = m_aTexture[0];
-			m_aVertices[m_NumVertices + 6*i].m_Color = m_aColor[0];
-
-			m_aVertices[m_NumVertices + 6*i + 1].m_Pos.x = pArray[i].m_X + pArray[i].m_Width;
-			m_aVertices[m_NumVertices + 6*i + 1].m_Pos.y = pArray[i].m_Y;
-			m_aVertices[m_NumVertices + 6*i + 1].m_Tex = m_aTexture[1];
-			m_aVertices[m_NumVertices + 6*i + 1].m_Color = m_aColor[1];
-
-			m_aVertices[m_NumVertices + 6*i + 2].m_Pos.x = pArray[i].m_X + pArray[i].m_Width;
-			m_aVertices[m_NumVertices + 6*i + 2].m_Pos.y = pArray[i].m_Y + pArray[i].m_Height;
-			m_aVertices[m_NumVertices + 6*i + 2].m_Tex = m_aTexture[2];
-			m_aVertices[m_NumVertices + 6*i + 2].m_Color = m_aColor[2];
-
-			// second triangle
-			m_aVertices[m_NumVertices + 6*i + 3].m_Pos.x = pArray[i].m_X;
-			m_aVertices[m_NumVertices + 6*i + 3].m_Pos.y = pArray[i].m_Y;
-			m_aVertices[m_NumVertices + 6*i + 3].m_Tex = m_aTexture[0];
-			m_aVertices[m_NumVertices + 6*i + 3].m_Color = m_aColor[0];
-
-			m_aVertices[m_NumVertices + 6*i + 4].m_Pos.x = pArray[i].m_X + pArray[i].m_Width;
-			m_aVertices[m_NumVertices + 6*i + 4].m_Pos.y = pArray[i].m_Y + pArray[i].m_Height;
-			m_aVertices[m_NumVertices + 6*i + 4].m_Tex = m_aTexture[2];
-			m_aVertices[m_NumVertices + 6*i + 4].m_Color = m_aColor[2];
-
-			m_aVertices[m_NumVertices + 6*i + 5].m_Pos.x = pArray[i].m_X;
-			m_aVertices[m_NumVertices + 6*i + 5].m_Pos.y = pArray[i].m_Y + pArray[i].m_Height;
-			m_aVertices[m_NumVertices + 6*i + 5].m_Tex = m_aTexture[3];
-			m_aVertices[m_NumVertices + 6*i + 5].m_Color = m_aColor[3];
+		int Count = ReserveQuads(Num);
+		CGsVertex *pOut = (CGsVertex *)&m_pVertices[m_NumVertices];
+		if(m_Rotation != 0)
+			m_QuadEmitter.Rotated(&pArray->m_X, Count, m_Rotation, pOut);
+		else
+			m_QuadEmitter.Rects(&pArray->m_X, Count, pOut);
 
-			if(m_Rotation != 0)
-			{
-				Center.x = pArray[i].m_X + pArray[i].m_Width/2;
-				Center.y = pArray[i].m_Y + pArray[i].m_Height/2;
+		AddVertices(Count*m_QuadEmitter.QuadVertices());
+		pArray += Count;
+		Num -= Count;
+	}
+}
 
-				Rotate(Center, &m_aVertices[m_NumVertices + 6*i], 6);
-			}
-		}
+void CGraphics_PS2_gsKit::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawFreeform without begin");
 
-		AddVertices(3*2*Num);
+	m_QuadEmitter.Setup(g_Config.m_GfxQuadAsTriangle, &m_aTexture[0].u, &m_aColor[0].r);
+	while(Num > 0)
+	{
+		int Count = ReserveQuads(Num);
+		m_QuadEmitter.Freeform(&pArray->m_X0, Count, (CGsVertex *)&m_pVertices[m_NumVertices]);
+
+		AddVertices(Count*m_QuadEmitter.QuadVertices());
+		pArray += Count;
+		Num -= Count;
 	}
-	else
+}
+
+void CGraphics_PS2_gsKit::QuadsDrawTexturedTL(const CTexturedQuadItem *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawTexturedTL without begin");
+
+	// corners per quad, see EmitVertices for how quads are split
+	static const int s_aTriangleCorners[] = {0, 1, 2, 0, 2, 3};
+	static const int s_aQuadCorners[] = {0, 1, 2, 3};
+	const int *pCorners = g_Config.m_GfxQuadAsTriangle ? s_aTriangleCorners : s_aQuadCorners;
+	const int VertexPrim = g_Config.m_GfxQuadAsTriangle ? 6 : 4;
+
+	while(Num > 0)
 	{
-		for(int i = 0; i < Num; ++i)
+		int Count = min(Num, (MAX_VERTICES - m_NumVertices) / VertexPrim - 1);
+		if(Count <= 0)
 		{
-			m_aVertices[m_NumVertices + 4*i].m_Pos.x = pArray[i].m_X;
-			m_aVertices[m_NumVertices + 4*i].m_Pos.y = pArray[i].m_Y;
-			m_aVertices[m_NumVertices + 4*i].m_Tex = m_aTexture[0];
-			m_aVertices[m_NumVertices + 4*i].m_Color = m_aColor[0];
-
-			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.x = pArray[i].m_X + pArray[i].m_Width;
-			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.y = pArray[i].m_Y;
-			m_aVertices[m_NumVertices + 4*i + 1].m_Tex = m_aTexture[1];
-			m_aVertices[m_NumVertices + 4*i + 1].m_Color = m_aColor[1];
-
-			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.x = pArray[i].m_X + pArray[i].m_Width;
-			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.y = pArray[i].m_Y + pArray[i].m_Height;
-			m_aVertices[m_NumVertices + 4*i + 2].m_Tex = m_aTexture[2];
-			m_aVertices[m_NumVertices + 4*i + 2].m_Color = m_aColor[2];
-
-			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.x = pArray[i].m_X;
-			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.y = pArray[i].m_Y + pArray[i].m_Height;
-			m_aVertices[m_NumVertices + 4*i + 3].m_Tex = m_aTexture[3];
-			m_aVertices[m_NumVertices + 4*i + 3].m_Color = m_aColor[3];
+			RecordCommand();
+			Flush();
+			continue;
+		}
 
-			if(m_Rotation != 0)
+		CVertex *pVertex = &m_pVertices[m_NumVertices];
+		for(int i = 0; i < Count; i++)
+		{
+			const CTexturedQuadItem *pItem = &pArray[i];
+			for(int j = 0; j < VertexPrim; j++, pVertex++)
 			{
-				Center.x = pArray[i].m_X + pArray[i].m_Width/2;
-				Center.y = pArray[i].m_Y + pArray[i].m_Height/2;
+				int Corner = pCorners[j];
+				pVertex->m_Pos.x = pItem->m_X + (Corner == 1 || Corner == 2 ? pItem->m_Width : 0.0f);
+				pVertex->m_Pos.y = pItem->m_Y + (Corner >= 2 ? pItem->m_Height : 0.0f);
+				pVertex->m_Tex.u = m_TexOffset.u + pItem->m_aU[Corner]*m_TexScale.u;
+				pVertex->m_Tex.v = m_TexOffset.v + pItem->m_aV[Corner]*m_TexScale.v;
+				pVertex->m_Color = m_aColor[Corner];
+			}
 
-				Rotate(Center, &m_aVertices[m_NumVertices + 4*i], 4);
+			if(m_Rotation != 0)
+			{
+				CPoint Center;
+				Center.x = pItem->m_X + pItem->m_Width/2;
+				Center.y = pItem->m_Y + pItem->m_Height/2;
+				Rotate(Center, pVertex - VertexPrim, VertexPrim);
 			}
 		}
 
-		AddVertices(4*Num);
+		AddVertices(Count*VertexPrim);
+		pArray += Count;
+		Num -= Count;
 	}
 }
 
-void CGraphics_PS2_gsKit::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
+void CGraphics_PS2_gsKit::QuadsDrawColoredFreeform(const CColoredFreeformItem *pArray, int Num)
 {
-	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawFreeform without begin");
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawColoredFreeform without begin");
+
+	// freeform points are top left, top right, bottom left, bottom right
+	static const int s_aTrianglePoints[] = {0, 1, 3, 0, 3, 2};
+	static const int s_aQuadPoints[] = {0, 1, 3, 2};
+	const int *pPoints = g_Config.m_GfxQuadAsTriangle ? s_aTrianglePoints : s_aQuadPoints;
+	const int VertexPrim = g_Config.m_GfxQuadAsTriangle ? 6 : 4;
 
-	if(g_Config.m_GfxQuadAsTriangle)
+	while(Num > 0)
 	{
-		for(int i = 0; i < Num; ++i)
+		int Count = min(Num, (MAX_VERTICES - m_NumVertices) / VertexPrim - 1);
+		if(Count <= 0)
 		{
-			m_aVertices[m_NumVertices + 6*i].m_Pos.x = pArray[i].m_X0;
-			m_aVertices[m_NumVertices + 6*i].m_Pos.y = pArray[i].m_Y0;
-			m_aVertices[m_NumVertices + 6*i].m_Tex = m_aTexture[0];
-			m_aVertices[m_NumVertices + 6*i].m_Color = m_aColor[0];
-
-			m_aVertices[m_NumVertices + 6*i + 1].m_Pos.x = pArray[i].m_X1;
-			m_aVertices[m_NumVertices + 6*i + 1].m_Pos.y = pArray[i].m_Y1;
-			m_aVertices[m_NumVertices + 6*i + 1].m_Tex = m_aTexture[1];
-			m_aVertices[m_NumVertices + 6*i + 1].m_Color = m_aColor[1];
-
-			m_aVertices[m_NumVertices + 6*i + 2].m_Pos.x = pArray[i].m_X3;
-			m_aVertices[m_NumVertices + 6*i + 2].m_Pos.y = pArray[i].m_Y3;
-			m_aVertices[m_NumVertices + 6*i + 2].m_Tex = m_aTexture[3];
-			m_aVertices[m_NumVertices + 6*i + 2].m_Color = m_aColor[3];
-
-			m_aVertices[m_NumVertices + 6*i + 3].m_Pos.x = pArray[i].m_X0;
-			m_aVertices[m_NumVertices + 6*i + 3].m_Pos.y = pArray[i].m_Y0;
-			m_aVertices[m_NumVertices + 6*i + 3].m_Tex = m_aTexture[0];
-			m_aVertices[m_NumVertices + 6*i + 3].m_Color = m_aColor[0];
-
-			m_aVertices[m_NumVertices + 6*i + 4].m_Pos.x = pArray[i].m_X3;
-			m_aVertices[m_NumVertices + 6*i + 4].m_Pos.y = pArray[i].m_Y3;
-			m_aVertices[m_NumVertices + 6*i + 4].m_Tex = m_aTexture[3];
-			m_aVertices[m_NumVertices + 6*i + 4].m_Color = m_aColor[3];
-
-			m_aVertices[m_NumVertices + 6*i + 5].m_Pos.x = pArray[i].m_X2;
-			m_aVertices[m_NumVertices + 6*i + 5].m_Pos.y = pArray[i].m_Y2;
-			m_aVertices[m_NumVertices + 6*i + 5].m_Tex = m_aTexture[2];
-			m_aVertices[m_NumVertices + 6*i + 5].m_Color = m_aColor[2];
+			RecordCommand();
+			Flush();
+			continue;
 		}
 
-		AddVertices(3*2*Num);
-	}
-	else
-	{
-		for(int i = 0; i < Num; ++i)
+		CVertex *pVertex = &m_pVertices[m_NumVertices];
+		for(int i = 0; i < Count; i++)
 		{
-			m_aVertices[m_NumVertices + 4*i].m_Pos.x = pArray[i].m_X0;
-			m_aVertices[m_NumVertices + 4*i].m_Pos.y = pArray[i].m_Y0;
-			m_aVertices[m_NumVertices + 4*i].m_Tex = m_aTexture[0];
-			m_aVertices[m_NumVertices + 4*i].m_Color = m_aColor[0];
-
-			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.x = pArray[i].m_X1;
-			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.y = pArray[i].m_Y1;
-			m_aVertices[m_NumVertices + 4*i + 1].m_Tex = m_aTexture[1];
-			m_aVertices[m_NumVertices + 4*i + 1].m_Color = m_aColor[1];
-
-			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.x = pArray[i].m_X3;
-			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.y = pArray[i].m_Y3;
-			m_aVertices[m_NumVertices + 4*i + 2].m_Tex = m_aTexture[3];
-			m_aVertices[m_NumVertices + 4*i + 2].m_Color = m_aColor[3];
-
-			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.x = pArray[i].m_X2;
-			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.y = pArray[i].m_Y2;
-			m_aVertices[m_NumVertices + 4*i + 3].m_Tex = m_aTexture[2];
-			m_aVertices[m_NumVertices + 4*i + 3].m_Color = m_aColor[2];
+			const CColoredFreeformItem *pItem = &pArray[i];
+			for(int j = 0; j < VertexPrim; j++, pVertex++)
+			{
+				int Point = pPoints[j];
+				pVertex->m_Pos.x = pItem->m_aX[Point];
+				pVertex->m_Pos.y = pItem->m_aY[Point];
+				pVertex->m_Tex.u = m_TexOffset.u + pItem->m_aU[Point]*m_TexScale.u;
+				pVertex->m_Tex.v = m_TexOffset.v + pItem->m_aV[Point]*m_TexScale.v;
+				pVertex->m_Color.r = pItem->m_aColors[Point][0];
+				pVertex->m_Color.g = pItem->m_aColors[Point][1];
+				pVertex->m_Color.b = pItem->m_aColors[Point][2];
+				pVertex->m_Color.a = pItem->m_aColors[Point][3];
+			}
 		}
 
-		AddVertices(4*Num);
+		AddVertices(Count*VertexPrim);
+		pArray += Count;
+		Num -= Count;
 	}
 }
 
@@ -769,6 +1796,27 @@ int CGraphics_PS2_gsKit::Init()
 {
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
+	m_pEngine = Kernel()->RequestInterface<IEngine>();
+
+	// a video restart comes through here again
+	m_RenderThread.StopProcessor();
+	StopTextureLoads();
+	m_TextureCache.Init(m_pStorage);
+
+	// the second command list is only needed when the render thread replays the first
+	const int NumLists = g_Config.m_GfxThreadedOld ? NUM_COMMAND_LISTS : 1;
+	for(int i = 0; i < NumLists; i++)
+	{
+		if(!m_apCommandLists[i])
+			m_apCommandLists[i] = (CCommandList *)memalign(16, sizeof(CCommandList));
+		ResetList(m_apCommandLists[i]);
+	}
+	m_CurrentList = 0;
+	m_pList = m_apCommandLists[0];
+	m_pVertices = m_pList->m_aVertices;
+	m_NumVertices = 0;
+	m_NumCommands = 0;
+	m_CommandStart = 0;
 
 	// default initialization
 	gsGlobal = gsKit_init_global();
@@ -782,26 +1830,32 @@ int CGraphics_PS2_gsKit::Init()
 	dmaKit_chan_init(DMA_CHANNEL_GIF);
 
 	gsKit_init_screen(gsGlobal);
+	InitWaits();
 
 	gsKit_mode_switch(gsGlobal, GS_ONESHOT);
 
-	gsKit_TexManager_init(gsGlobal);
+	// everything behind the frame buffers is ours for textures
+	{
+		int FirstPage = (gsGlobal->CurrentPointer + CVramCache::PAGE_SIZE - 1) / CVramCache::PAGE_SIZE;
+		m_VramCache.Init(FirstPage, CVramCache::MAX_PAGES - FirstPage);
+	}
 
 	gsKit_set_test(gsGlobal, GS_ZTEST_OFF);
 
 	m_ScreenWidth = g_Config.m_GfxScreenWidth = gsGlobal->Width;
 	m_ScreenHeight = g_Config.m_GfxScreenHeight = gsGlobal->Height;
 
-	m_CurrTexture = -1;
-
-	// Set all z to -5.0f
-	for(int i = 0; i < MAX_VERTICES; i++)
-		m_aVertices[i].m_Pos.z = -5.0f;
+	m_State.m_Texture = -1;
 
 	// init textures
 	m_FirstFreeTexture = 0;
 	for(int i = 0; i < MAX_TEXTURES; i++)
+	{
 		m_aTextures[i].m_Next = i+1;
+		m_aTextures[i].m_Loading = false;
+		m_aTextures[i].m_Atlas = -1;
+		m_aTextures[i].m_RenderTarget = false;
+	}
 	m_aTextures[MAX_TEXTURES-1].m_Next = -1;
 
 	/*
@@ -853,12 +1907,24 @@ int CGraphics_PS2_gsKit::Init()
 
 	m_InvalidTexture = LoadTextureRaw(4,4,CImageInfo::FORMAT_RGBA,aNullTextureData,CImageInfo::FORMAT_RGBA,TEXLOAD_NORESAMPLE);
 
+	m_RenderThread.StartProcessor(this, g_Config.m_GfxThreadedOld);
+
 	return 0;
 }
 
 void CGraphics_PS2_gsKit::Shutdown()
 {
+	StopTextureLoads();
+	m_TextureCache.Shutdown();
+	m_RenderThread.StopProcessor();
+	ShutdownWaits();
 	gsKit_deinit_global(gsGlobal);
+
+	for(int i = 0; i < NUM_COMMAND_LISTS; i++)
+	{
+		free(m_apCommandLists[i]);
+		m_apCommandLists[i] = 0;
+	}
 }
 
 void CGraphics_PS2_gsKit::Minimize()
@@ -899,9 +1965,41 @@ void CGraphics_PS2_gsKit::TakeCustomScreenshot(const char *pFilename)
 
 void CGraphics_PS2_gsKit::Swap()
 {
-	gsKit_queue_exec(gsGlobal);
-	gsKit_sync_flip(gsGlobal);
-	gsKit_TexManager_nextFrame(gsGlobal);
+	// the back end counters are from the last frame it finished
+	WaitForIdle();
+	m_LastStats = m_Stats;
+	m_LastStats.m_Batches = m_FrameBackendStats.m_Batches;
+	m_LastStats.m_Sprites = m_FrameBackendStats.m_Sprites;
+	m_LastStats.m_StateChanges = m_FrameBackendStats.m_StateChanges;
+	m_LastStats.m_TextureUploads = m_FrameBackendStats.m_TextureUploads;
+	m_LastStats.m_UploadBytes = m_FrameBackendStats.m_UploadBytes;
+	m_LastStats.m_Evictions = m_FrameBackendStats.m_Evictions;
+	mem_zero(&m_Stats, sizeof(m_Stats));
+
+	// the list is replayed and flipped while the next frame is recorded
+	m_pList->m_Swap = true;
+	m_pList->m_HalfHeight = m_HalfHeight;
+	m_pList->m_Frame = m_NumSwaps++;
+	Flush();
+
+	// finished loads show up from the next frame on
+	UpdateTextureLoads();
+}
+
+void CGraphics_PS2_gsKit::LastFrameTiming(CFrameTiming *pTiming)
+{
+	lock_wait(m_FrameTimingLock);
+	*pTiming = m_FrameTiming;
+	lock_unlock(m_FrameTimingLock);
+}
+
+bool CGraphics_PS2_gsKit::SetHalfHeight(bool Half)
+{
+	// MagV only goes up to 4 times
+	if(Half && gsGlobal->MagV > 1)
+		return false;
+	m_HalfHeight = Half;
+	return true;
 }
 
 
@@ -918,16 +2016,19 @@ int CGraphics_PS2_gsKit::GetVideoModes(CVideoMode *pModes, int MaxModes)
 // syncronization
 void CGraphics_PS2_gsKit::InsertSignal(semaphore *pSemaphore)
 {
-	
+	if(m_pList->m_NumSignals == MAX_SIGNALS)
+		Flush();
+	m_pList->m_apSignals[m_pList->m_NumSignals++] = pSemaphore;
 }
 
 bool CGraphics_PS2_gsKit::IsIdle()
 {
-	return true;
+	return m_RenderThread.IsIdle();
 }
 
 void CGraphics_PS2_gsKit::WaitForIdle()
 {
+	m_RenderThread.WaitForIdle();
 }
 
 extern IEngineGraphics *CreateEngineGraphics() { return new CGraphics_PS2_gsKit(); }
@@ -3,14 +3,14 @@
 #ifndef ENGINE_CLIENT_GRAPHICS_H
 #define ENGINE_CLIENT_GRAPHICS_H
 
-class CGraphics_PS2_gsKit : public IEngineGraphics
+class CGraphics_PS2_gsKit : public IEngineGraphics, public CRenderThread::ICommandProcessor
 {
 protected:
 	class IStorage *m_pStorage;
 	class IConsole *m_pConsole;
 
-	//
-	typedef struct { float x, y, z; } CPoint;
+	// keep in sync with CGsVertex, position/texture and color are one quadword each
+	typedef struct { float x, y; } CPoint;
 	typedef struct { float u, v; } CTexCoord;
 	typedef struct { float r, g, b, a; } CColor;
 
@@ -25,19 +25,124 @@ protected:
 	{
 		MAX_VERTICES = 32*1024,
 		MAX_TEXTURES = 1024*4,
+		MAX_TEXTURE_LOADS = 128,
+		MAX_ATLAS_SIZE = 512,
+		ATLAS_PADDING = 1,
+		MAX_PACKET_PRIMS = 512,
+		MAX_COMMANDS = 1024,
+		MAX_SIGNALS = 16,
+		NUM_COMMAND_LISTS = 2,
+		BATCH_LOOKBACK = 16,
 
 		DRAWING_QUADS=1,
-		DRAWING_LINES=2
+		DRAWING_LINES=2,
+
+		BLEND_NONE=0,
+		BLEND_NORMAL,
+		BLEND_ADDITIVE,
+
+		WRAP_REPEAT=0,
+		WRAP_CLAMP,
+
+		LOAD_FREE=0,
+		LOAD_QUEUED,
+		LOAD_RUNNING,
+		LOAD_DONE,
+	};
+
+	// everything a draw depends on besides its vertices
+	struct CRenderState
+	{
+		int m_Primitive; // DRAWING_QUADS or DRAWING_LINES
+		int m_Texture;
+		int m_Target; // render target texture, -1 for the screen
+		int m_BlendMode;
+		int m_WrapMode;
+		int m_ClipEnable;
+		int m_ClipX, m_ClipY, m_ClipW, m_ClipH;
+		float m_ScreenX0, m_ScreenY0, m_ScreenX1, m_ScreenY1;
+	};
+
+	// one QuadsEnd/LinesEnd worth of vertices
+	struct CCommand
+	{
+		CRenderState m_State;
+		int m_FirstVertex;
+		int m_NumVertices;
+		float m_aBox[4]; // bounds in screen pixels
+		int m_Next; // next command of the same batch
 	};
 
-	CVertex m_aVertices[MAX_VERTICES];
+	struct CBatch
+	{
+		int m_FirstCommand;
+		int m_LastCommand;
+		float m_aBox[4];
+	};
+
+	// everything the front end records between two submissions. the render
+	// thread replays one list while the front end fills the other
+	struct CCommandList
+	{
+		CVertex m_aVertices[MAX_VERTICES] __attribute__((aligned(16)));
+		CCommand m_aCommands[MAX_COMMANDS];
+		int m_NumVertices;
+		int m_NumCommands;
+		bool m_Clear;
+		float m_aClearColor[3];
+		bool m_Swap;
+		bool m_HalfHeight; // for the frames after the swap
+		int m_Frame;
+		semaphore *m_apSignals[MAX_SIGNALS];
+		int m_NumSignals;
+	};
+
+	CCommandList *m_apCommandLists[NUM_COMMAND_LISTS];
+	int m_CurrentList;
+	CRenderThread m_RenderThread;
+
+	// front end, records into the current list
+	CCommandList *m_pList;
+	CVertex *m_pVertices;
 	int m_NumVertices;
 
+	CGifPacket m_Packet;
+	CGsTransform m_Transform;
+	CQuadEmitter m_QuadEmitter;
+	uint64_t m_aQuadWords[MAX_PACKET_PRIMS*6*3];
+	bool m_aSpriteQuads[MAX_PACKET_PRIMS];
+
 	CColor m_aColor[4];
 	CTexCoord m_aTexture[4];
 
 	bool m_RenderEnable;
-	int m_BlendMode;
+
+	CRenderState m_State;
+	CRenderState m_AppliedState;
+	bool m_AppliedValid;
+
+	int m_NumCommands;
+	int m_CommandStart;
+
+	CRenderStats m_Stats;
+	CRenderStats m_LastStats;
+
+	// back end, only touched by whoever runs the command lists
+	CBatch m_aBatches[MAX_COMMANDS];
+	CRenderStats m_BackendStats;
+	CRenderStats m_FrameBackendStats;
+
+	// half height rendering, asked for by the front end and latched at a
+	// swap. the display is switched once a frame drawn that way is shown
+	bool m_HalfHeight;
+	bool m_DrawHalfHeight;
+	bool m_DisplayHalfHeight;
+
+	// swaps so far, and the timing of the last shown frame which the back
+	// end writes while the front end reads it
+	int m_NumSwaps;
+	CFrameTiming m_FrameTiming;
+	LOCK m_FrameTimingLock;
 
 	float m_Rotation;
 	int m_Drawing;
@@ -51,23 +156,92 @@ protected:
 
 	int m_InvalidTexture;
 
+	// bumped whenever the pixels a texture id stands for change
+	int m_TextureGeneration;
+	float m_aClearColor[3];
+
 	struct CTexture
 	{
 		void* m_Tex;
 		int m_MemSize;
 		int m_Flags;
 		int m_Next;
+		bool m_Loading; // m_Tex is set once its CTextureLoad is done
+
+		// textures that were moved into an atlas draw from it with remapped texture coordinates
+		int m_Atlas;
+		int m_AtlasRefs;
+		CTexCoord m_AtlasOffset;
+		CTexCoord m_AtlasScale;
+
+		// render targets are pinned in vram and have no pixels in main memory
+		bool m_RenderTarget;
+		int m_TargetGeneration; // -1 until it was drawn
+		float m_aTargetClear[3];
 	};
 
 	CTexture m_aTextures[MAX_TEXTURES];
+	CVramCache m_VramCache;
+	CTextureCache m_TextureCache;
+
+	// a texture that is decoded on the job pool, the lock guards m_Status and the result
+	struct CTextureLoad
+	{
+		char m_aFilename[128];
+		int m_StorageType;
+		int m_StoreFormat;
+		int m_Flags;
+		int m_Priority;
+		int m_Order; // keeps loads of the same priority first in, first out
+		int m_Texture; // -1 when it was unloaded before it finished
+		int m_Status;
+		GSTEXTURE *m_pResult;
+		int m_MemSize;
+	};
+
+	class IEngine *m_pEngine;
+	CTextureLoad m_aTextureLoads[MAX_TEXTURE_LOADS];
+	LOCK m_TextureLoadLock;
+	CJob m_TextureLoadJob;
+	volatile bool m_TextureLoaderActive;
+	int m_NextLoadOrder;
+
+	// texture coordinate mapping of the bound texture
+	CTexCoord m_TexOffset;
+	CTexCoord m_TexScale;
 	int m_FirstFreeTexture;
 	int m_TextureMemoryUsage;
-	int m_CurrTexture;
 
+	static bool SameState(const CRenderState &a, const CRenderState &b) { return mem_comp(&a, &b, sizeof(CRenderState)) == 0; }
+	static bool Overlaps(const float *pA, const float *pB) { return pA[0] < pB[2] && pB[0] < pA[2] && pA[1] < pB[3] && pB[1] < pA[3]; }
+
+	void RecordCommand();
+	void ApplyState(const CRenderState &State);
+	void SetFrame(int Target);
+	void SetDisplay(bool HalfHeight);
+	int DrawHeight() const;
+	void BeginPacket(int Qwords, GSTEXTURE *gsTex);
+	void EmitVertices(const CCommandList *pList, const CRenderState &State, int First, int Num);
+	void EmitQuads(const CCommandList *pList, GSTEXTURE *gsTex, uint64_t Prim, uint64_t SpritePrim, int First, int Num);
+	void ExecuteList(CCommandList *pList);
+	void ResetList(CCommandList *pList);
 	void Flush();
 	void AddVertices(int Count);
+	int ReserveQuads(int Num);
 	void Rotate(const CPoint &rCenter, CVertex *pPoints, int NumPoints);
 
+	static int VramSize(const GSTEXTURE *pTex, int *pClutOffset);
+	static int Palettize(GSTEXTURE *pTex, const unsigned *pPixels);
+	static GSTEXTURE *CreateTexture(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags, int *pMemSize);
+	static void DestroyTexture(GSTEXTURE *pTex);
+	GSTEXTURE *LoadTextureFile(const char *pFilename, int StorageType, int StoreFormat, int Flags, int *pMemSize);
+	int GrabTexture();
+	int AddTexture(GSTEXTURE *gsTex, int MemSize);
+
+	static int TextureLoadThread(void *pUser);
+	void UpdateTextureLoads();
+	void StopTextureLoads();
+
 	static unsigned char Sample(int w, int h, const unsigned char *pData, int u, int v, int Offset, int ScaleW, int ScaleH, int Bpp);
 	static unsigned char *Rescale(int Width, int Height, int NewWidth, int NewHeight, int Format, const unsigned char *pData);
 
@@ -85,6 +259,7 @@ public:
 	virtual void WrapClamp();
 
 	virtual int MemoryUsage() const;
+	virtual const CRenderStats &RenderStats() const { return m_LastStats; }
 
 	virtual void MapScreen(float TopLeftX, float TopLeftY, float BottomRightX, float BottomRightY);
 	virtual void GetScreen(float *pTopLeftX, float *pTopLeftY, float *pBottomRightX, float *pBottomRightY);
@@ -96,9 +271,16 @@ public:
 	virtual int UnloadTexture(int Index);
 	virtual int LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags);
 	virtual int LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData);
+	virtual int BuildTextureAtlas(const int *pTextures, int Num);
+
+	virtual int CreateRenderTarget(int Width, int Height);
+	virtual void RenderTargetBegin(int TextureID);
+	virtual void RenderTargetEnd();
+	virtual bool RenderTargetValid(int TextureID);
 
 	// simple uncompressed RGBA loaders
 	virtual int LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags);
+	virtual int LoadTextureAsync(const char *pFilename, int StorageType, int StoreFormat, int Flags, int Priority);
 	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType);
 
 	void ScreenshotDirect(const char *pFilename);
@@ -122,6 +304,8 @@ public:
 	virtual void QuadsDraw(CQuadItem *pArray, int Num);
 	virtual void QuadsDrawTL(const CQuadItem *pArray, int Num);
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
+	virtual void QuadsDrawTexturedTL(const CTexturedQuadItem *pArray, int Num);
+	virtual void QuadsDrawColoredFreeform(const CColoredFreeformItem *pArray, int Num);
 	virtual void QuadsText(float x, float y, float Size, const char *pText);
 
 	virtual int Init();
@@ -138,6 +322,9 @@ public:
 	virtual void TakeScreenshot(const char *pFilename);
 	virtual void TakeCustomScreenshot(const char *pFilename);
 	virtual void Swap();
+	virtual bool SetHalfHeight(bool Half);
+	virtual void LastFrameTiming(CFrameTiming *pTiming);
+	virtual int FrameNumber() { return m_NumSwaps; }
 
 	virtual int GetVideoModes(CVideoMode *pModes, int MaxModes);
 
@@ -145,6 +332,9 @@ public:
 	virtual void InsertSignal(semaphore *pSemaphore);
 	virtual bool IsIdle();
 	virtual void WaitForIdle();
+
+	// render thread
+	virtual void RunBuffer(int Buffer);
 };
 
 #endif
@@ -0,0 +1,1173 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/external/pnglite/pnglite.h>
+
+#include <engine/shared/config.h>
+#include <engine/graphics.h>
+#include <engine/storage.h>
+
+#include <math.h> // cosf, sinf, floorf
+
+#include "graphics_null.h"
+#include "gs_transform.h"
+
+static const char *s_apCommandNames[] = {"clear", "clip", "blend", "wrap", "texture", "screen", "quads", "lines", "target"};
+
+CGraphics_Null::CGraphics_Null()
+{
+	m_pStorage = 0;
+
+	m_ScreenWidth = -1;
+	m_ScreenHeight = -1;
+
+	for(int i = 0; i < NUM_COMMAND_LISTS; i++)
+		m_apCommandLists[i] = 0;
+	m_CurrentList = 0;
+	m_pList = 0;
+
+	m_Drawing = 0;
+	m_CommandStart = 0;
+	m_Rotation = 0;
+
+	m_Texture = -1;
+	m_BlendMode = BLEND_NORMAL;
+	m_WrapMode = WRAP_REPEAT;
+	m_ScreenX0 = m_ScreenY0 = m_ScreenX1 = m_ScreenY1 = 0;
+
+	m_FirstFreeTexture = 0;
+	m_TextureMemoryUsage = 0;
+	m_InvalidTexture = 0;
+	m_aClearColor[0] = m_aClearColor[1] = m_aClearColor[2] = 0.0f;
+
+	mem_zero(&m_Stats, sizeof(m_Stats));
+	mem_zero(&m_Totals, sizeof(m_Totals));
+	mem_zero(&m_LastStats, sizeof(m_LastStats));
+	m_Frame = 0;
+
+	m_aScreenshotName[0] = 0;
+	m_DoScreenshot = false;
+
+	m_LogFile = 0;
+	m_pFrameBuffer = 0;
+	m_pRasterPixels = 0;
+	m_RasterWidth = m_RasterHeight = 0;
+	mem_zero(m_aRasterClipArgs, sizeof(m_aRasterClipArgs));
+	m_RasterTexture = -1;
+	m_RasterBlend = BLEND_NORMAL;
+	m_RasterWrap = WRAP_REPEAT;
+	m_aRasterClip[0] = m_aRasterClip[1] = m_aRasterClip[2] = m_aRasterClip[3] = 0;
+	m_aRasterScreen[0] = m_aRasterScreen[1] = m_aRasterScreen[2] = m_aRasterScreen[3] = 0;
+}
+
+CGraphics_Null::CCommand *CGraphics_Null::AddCommand(int Cmd)
+{
+	// the last slot stays free for a draw that is still open
+	if(m_pList->m_NumCommands >= MAX_COMMANDS-1)
+		Flush();
+
+	CCommand *pCmd = &m_pList->m_aCommands[m_pList->m_NumCommands++];
+	mem_zero(pCmd, sizeof(CCommand));
+	pCmd->m_Cmd = Cmd;
+	return pCmd;
+}
+
+CGraphics_Null::CVertex *CGraphics_Null::AllocVertices(int Num)
+{
+	if(m_pList->m_NumVertices + Num > MAX_VERTICES || m_pList->m_NumCommands == MAX_COMMANDS)
+		Flush();
+
+	CVertex *pVertices = &m_pList->m_aVertices[m_pList->m_NumVertices];
+	m_pList->m_NumVertices += Num;
+	return pVertices;
+}
+
+void CGraphics_Null::EndDraw(int Cmd)
+{
+	int Num = m_pList->m_NumVertices - m_CommandStart;
+	if(Num > 0)
+	{
+		CCommand *pCmd = &m_pList->m_aCommands[m_pList->m_NumCommands++];
+		mem_zero(pCmd, sizeof(CCommand));
+		pCmd->m_Cmd = Cmd;
+		pCmd->m_FirstVertex = m_CommandStart;
+		pCmd->m_NumVertices = Num;
+
+		m_Stats.m_DrawCalls++;
+		if(Cmd == CMD_QUADS)
+		{
+			// decided when recorded like the gsKit backend does, the replay may run later
+			static const int s_aCorners[] = {0, 1, 2, 3};
+			pCmd->m_aArgs[0] = g_Config.m_GfxQuadSprites;
+			m_Stats.m_Quads += Num/4;
+			for(int q = 0; pCmd->m_aArgs[0] && q < Num/4; q++)
+				if(CGsTransform::IsSprite((const CGsVertex *)&m_pList->m_aVertices[m_CommandStart+q*4], s_aCorners))
+					m_Stats.m_Sprites++;
+		}
+		else
+			m_Stats.m_Lines += Num/2;
+	}
+	m_CommandStart = m_pList->m_NumVertices;
+}
+
+void CGraphics_Null::ResetList(CCommandList *pList)
+{
+	pList->m_NumVertices = 0;
+	pList->m_NumCommands = 0;
+	pList->m_Swap = false;
+	pList->m_NumSignals = 0;
+}
+
+void CGraphics_Null::Flush()
+{
+	// an open draw is split, the rest of it goes into the next list
+	if(m_Drawing)
+		EndDraw(m_Drawing == DRAWING_QUADS ? CMD_QUADS : CMD_LINES);
+
+	if(!m_pList->m_NumCommands && !m_pList->m_Swap && !m_pList->m_NumSignals)
+		return;
+
+	m_pList->m_Frame = m_Frame;
+	m_RenderThread.RunBuffer(m_CurrentList);
+	if(m_RenderThread.Threaded())
+		m_CurrentList = (m_CurrentList+1) % NUM_COMMAND_LISTS;
+	m_pList = m_apCommandLists[m_CurrentList];
+	m_CommandStart = 0;
+}
+
+void CGraphics_Null::LogCommand(const CCommand *pCmd)
+{
+	char aBuf[256];
+	switch(pCmd->m_Cmd)
+	{
+	case CMD_CLEAR:
+		str_format(aBuf, sizeof(aBuf), "%s %.3f %.3f %.3f", s_apCommandNames[pCmd->m_Cmd], pCmd->m_aValues[0], pCmd->m_aValues[1], pCmd->m_aValues[2]);
+		break;
+	case CMD_CLIP:
+		str_format(aBuf, sizeof(aBuf), "%s %d %d %d %d %d", s_apCommandNames[pCmd->m_Cmd], pCmd->m_aArgs[0], pCmd->m_aArgs[1], pCmd->m_aArgs[2], pCmd->m_aArgs[3], pCmd->m_aArgs[4]);
+		break;
+	case CMD_SCREEN:
+		str_format(aBuf, sizeof(aBuf), "%s %.2f %.2f %.2f %.2f", s_apCommandNames[pCmd->m_Cmd], pCmd->m_aValues[0], pCmd->m_aValues[1], pCmd->m_aValues[2], pCmd->m_aValues[3]);
+		break;
+	case CMD_QUADS:
+		str_format(aBuf, sizeof(aBuf), "%s %d", s_apCommandNames[pCmd->m_Cmd], pCmd->m_NumVertices/4);
+		break;
+	case CMD_LINES:
+		str_format(aBuf, sizeof(aBuf), "%s %d", s_apCommandNames[pCmd->m_Cmd], pCmd->m_NumVertices/2);
+		break;
+	default:
+		str_format(aBuf, sizeof(aBuf), "%s %d", s_apCommandNames[pCmd->m_Cmd], pCmd->m_aArgs[0]);
+	}
+	io_write(m_LogFile, aBuf, str_length(aBuf));
+	io_write_newline(m_LogFile);
+}
+
+void CGraphics_Null::UpdateRasterClip()
+{
+	// clip rectangles are given in screen pixels
+	if(m_aRasterClipArgs[0])
+	{
+		m_aRasterClip[0] = clamp(m_aRasterClipArgs[1]*m_RasterWidth/m_ScreenWidth, 0, m_RasterWidth);
+		m_aRasterClip[1] = clamp(m_aRasterClipArgs[2]*m_RasterHeight/m_ScreenHeight, 0, m_RasterHeight);
+		m_aRasterClip[2] = clamp((m_aRasterClipArgs[1]+m_aRasterClipArgs[3])*m_RasterWidth/m_ScreenWidth, 0, m_RasterWidth);
+		m_aRasterClip[3] = clamp((m_aRasterClipArgs[2]+m_aRasterClipArgs[4])*m_RasterHeight/m_ScreenHeight, 0, m_RasterHeight);
+	}
+	else
+	{
+		m_aRasterClip[0] = m_aRasterClip[1] = 0;
+		m_aRasterClip[2] = m_RasterWidth;
+		m_aRasterClip[3] = m_RasterHeight;
+	}
+}
+
+void CGraphics_Null::RasterPixel(int x, int y, const float *pColor, float u, float v)
+{
+	float r = pColor[0], g = pColor[1], b = pColor[2], a = pColor[3];
+
+	if(m_RasterTexture >= 0 && m_aTextures[m_RasterTexture].m_pData)
+	{
+		const CTexture *pTex = &m_aTextures[m_RasterTexture];
+		int tx = (int)floorf(u*pTex->m_Width);
+		int ty = (int)floorf(v*pTex->m_Height);
+		if(m_RasterWrap == WRAP_CLAMP)
+		{
+			tx = clamp(tx, 0, pTex->m_Width-1);
+			ty = clamp(ty, 0, pTex->m_Height-1);
+		}
+		else
+		{
+			tx = ((tx % pTex->m_Width) + pTex->m_Width) % pTex->m_Width;
+			ty = ((ty % pTex->m_Height) + pTex->m_Height) % pTex->m_Height;
+		}
+		const unsigned char *pTexel = &pTex->m_pData[(ty*pTex->m_Width + tx)*4];
+		r *= pTexel[0]/255.0f;
+		g *= pTexel[1]/255.0f;
+		b *= pTexel[2]/255.0f;
+		a *= pTexel[3]/255.0f;
+	}
+
+	unsigned char *pDst = &m_pRasterPixels[(y*m_RasterWidth + x)*4];
+	float aDst[3] = {pDst[0]/255.0f, pDst[1]/255.0f, pDst[2]/255.0f};
+	if(m_RasterBlend == BLEND_NORMAL)
+	{
+		r = r*a + aDst[0]*(1-a);
+		g = g*a + aDst[1]*(1-a);
+		b = b*a + aDst[2]*(1-a);
+	}
+	else if(m_RasterBlend == BLEND_ADDITIVE)
+	{
+		r = r*a + aDst[0];
+		g = g*a + aDst[1];
+		b = b*a + aDst[2];
+	}
+
+	pDst[0] = (unsigned char)(clamp(r, 0.0f, 1.0f)*255.0f);
+	pDst[1] = (unsigned char)(clamp(g, 0.0f, 1.0f)*255.0f);
+	pDst[2] = (unsigned char)(clamp(b, 0.0f, 1.0f)*255.0f);
+	pDst[3] = 255;
+}
+
+// a pixel center on an edge is only drawn by the triangle that has it as its top
+// or left edge, like the GS does, so two triangles sharing an edge don't both draw it
+static bool TopLeftEdge(float dx, float dy)
+{
+	return dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+}
+
+void CGraphics_Null::RasterTriangle(const CVertex *pA, const CVertex *pB, const CVertex *pC)
+{
+	float Area = (pB->m_X-pA->m_X)*(pC->m_Y-pA->m_Y) - (pB->m_Y-pA->m_Y)*(pC->m_X-pA->m_X);
+	if(Area == 0.0f)
+		return;
+	if(Area < 0.0f)
+	{
+		// the same triangle wound the other way around
+		const CVertex *pTemp = pB;
+		pB = pC;
+		pC = pTemp;
+		Area = -Area;
+	}
+	const bool aTopLeft[3] = {
+		TopLeftEdge(pC->m_X-pB->m_X, pC->m_Y-pB->m_Y),
+		TopLeftEdge(pA->m_X-pC->m_X, pA->m_Y-pC->m_Y),
+		TopLeftEdge(pB->m_X-pA->m_X, pB->m_Y-pA->m_Y)};
+
+	int x0 = max((int)floorf(min(pA->m_X, min(pB->m_X, pC->m_X))), m_aRasterClip[0]);
+	int y0 = max((int)floorf(min(pA->m_Y, min(pB->m_Y, pC->m_Y))), m_aRasterClip[1]);
+	int x1 = min((int)ceilf(max(pA->m_X, max(pB->m_X, pC->m_X))), m_aRasterClip[2]);
+	int y1 = min((int)ceilf(max(pA->m_Y, max(pB->m_Y, pC->m_Y))), m_aRasterClip[3]);
+
+	for(int y = y0; y < y1; y++)
+		for(int x = x0; x < x1; x++)
+		{
+			// barycentric weights at the pixel center
+			float px = x+0.5f, py = y+0.5f;
+			float e0 = (pC->m_X-pB->m_X)*(py-pB->m_Y) - (pC->m_Y-pB->m_Y)*(px-pB->m_X);
+			float e1 = (pA->m_X-pC->m_X)*(py-pC->m_Y) - (pA->m_Y-pC->m_Y)*(px-pC->m_X);
+			float e2 = (pB->m_X-pA->m_X)*(py-pA->m_Y) - (pB->m_Y-pA->m_Y)*(px-pA->m_X);
+			if(e0 < 0 || e1 < 0 || e2 < 0 || (e0 == 0 && !aTopLeft[0]) || (e1 == 0 && !aTopLeft[1]) || (e2 == 0 && !aTopLeft[2]))
+				continue;
+			// relative to the first vertex, what is the same on all three stays exact
+			float w1 = e1/Area, w2 = e2/Area;
+			float aColor[4];
+			for(int c = 0; c < 4; c++)
+				aColor[c] = pA->m_aColor[c] + (pB->m_aColor[c]-pA->m_aColor[c])*w1 + (pC->m_aColor[c]-pA->m_aColor[c])*w2;
+			RasterPixel(x, y, aColor, pA->m_U + (pB->m_U-pA->m_U)*w1 + (pC->m_U-pA->m_U)*w2,
+				pA->m_V + (pB->m_V-pA->m_V)*w1 + (pC->m_V-pA->m_V)*w2);
+		}
+}
+
+void CGraphics_Null::RasterSprite(const CVertex *pTL, const CVertex *pBR)
+{
+	// the pixel centers inside, with the same fill rule as the triangles
+	int x0 = max((int)ceilf(pTL->m_X-0.5f), m_aRasterClip[0]);
+	int y0 = max((int)ceilf(pTL->m_Y-0.5f), m_aRasterClip[1]);
+	int x1 = min((int)ceilf(pBR->m_X-0.5f), m_aRasterClip[2]);
+	int y1 = min((int)ceilf(pBR->m_Y-0.5f), m_aRasterClip[3]);
+
+	// flat shaded, u along x and v along y
+	const float ScaleU = (pBR->m_U-pTL->m_U)/(pBR->m_X-pTL->m_X);
+	const float ScaleV = (pBR->m_V-pTL->m_V)/(pBR->m_Y-pTL->m_Y);
+	for(int y = y0; y < y1; y++)
+		for(int x = x0; x < x1; x++)
+			RasterPixel(x, y, pBR->m_aColor, pTL->m_U + (x+0.5f-pTL->m_X)*ScaleU, pTL->m_V + (y+0.5f-pTL->m_Y)*ScaleV);
+}
+
+void CGraphics_Null::RasterLine(const CVertex *pA, const CVertex *pB)
+{
+	float dx = pB->m_X-pA->m_X, dy = pB->m_Y-pA->m_Y;
+	int Steps = max(1, (int)max(absolute(dx), absolute(dy)));
+	for(int i = 0; i <= Steps; i++)
+	{
+		float t = i/(float)Steps;
+		int x = (int)(pA->m_X + dx*t);
+		int y = (int)(pA->m_Y + dy*t);
+		if(x < m_aRasterClip[0] || x >= m_aRasterClip[2] || y < m_aRasterClip[1] || y >= m_aRasterClip[3])
+			continue;
+
+		float aColor[4];
+		for(int c = 0; c < 4; c++)
+			aColor[c] = pA->m_aColor[c] + (pB->m_aColor[c]-pA->m_aColor[c])*t;
+		RasterPixel(x, y, aColor, pA->m_U + (pB->m_U-pA->m_U)*t, pA->m_V + (pB->m_V-pA->m_V)*t);
+	}
+}
+
+void CGraphics_Null::RunBuffer(int Buffer)
+{
+	CCommandList *pList = m_apCommandLists[Buffer];
+
+	for(int i = 0; i < pList->m_NumCommands; i++)
+	{
+		const CCommand *pCmd = &pList->m_aCommands[i];
+		if(m_LogFile)
+		{
+			char aBuf[32];
+			str_format(aBuf, sizeof(aBuf), "%d ", pList->m_Frame);
+			io_write(m_LogFile, aBuf, str_length(aBuf));
+			LogCommand(pCmd);
+		}
+
+		switch(pCmd->m_Cmd)
+		{
+		case CMD_CLEAR:
+			if(m_pFrameBuffer)
+			{
+				unsigned char aColor[4] = {
+					(unsigned char)(pCmd->m_aValues[0]*255.0f),
+					(unsigned char)(pCmd->m_aValues[1]*255.0f),
+					(unsigned char)(pCmd->m_aValues[2]*255.0f), 255};
+				for(int p = 0; p < m_ScreenWidth*m_ScreenHeight; p++)
+					mem_copy(&m_pFrameBuffer[p*4], aColor, 4);
+			}
+			break;
+		case CMD_CLIP:
+			mem_copy(m_aRasterClipArgs, pCmd->m_aArgs, sizeof(m_aRasterClipArgs));
+			UpdateRasterClip();
+			break;
+		case CMD_TARGET:
+			if(pCmd->m_aArgs[0] == -1 || !m_aTextures[pCmd->m_aArgs[0]].m_pData)
+			{
+				// without pixels of its own the target is not drawn at all
+				m_pRasterPixels = pCmd->m_aArgs[0] == -1 ? m_pFrameBuffer : 0;
+				m_RasterWidth = m_ScreenWidth;
+				m_RasterHeight = m_ScreenHeight;
+			}
+			else
+			{
+				CTexture *pTarget = &m_aTextures[pCmd->m_aArgs[0]];
+				m_pRasterPixels = pTarget->m_pData;
+				m_RasterWidth = pTarget->m_Width;
+				m_RasterHeight = pTarget->m_Height;
+				unsigned char aColor[4] = {
+					(unsigned char)(pCmd->m_aValues[0]*255.0f),
+					(unsigned char)(pCmd->m_aValues[1]*255.0f),
+					(unsigned char)(pCmd->m_aValues[2]*255.0f), 255};
+				for(int p = 0; p < m_RasterWidth*m_RasterHeight; p++)
+					mem_copy(&m_pRasterPixels[p*4], aColor, 4);
+			}
+			UpdateRasterClip();
+			break;
+		case CMD_BLEND: m_RasterBlend = pCmd->m_aArgs[0]; break;
+		case CMD_WRAP: m_RasterWrap = pCmd->m_aArgs[0]; break;
+		case CMD_TEXTURE: m_RasterTexture = pCmd->m_aArgs[0]; break;
+		case CMD_SCREEN: mem_copy(m_aRasterScreen, pCmd->m_aValues, sizeof(m_aRasterScreen)); break;
+		case CMD_QUADS:
+		case CMD_LINES:
+			if(m_pRasterPixels)
+			{
+				// from the mapped screen to pixels
+				const float ScaleX = m_RasterWidth/(m_aRasterScreen[2]-m_aRasterScreen[0]);
+				const float ScaleY = m_RasterHeight/(m_aRasterScreen[3]-m_aRasterScreen[1]);
+				const int VertexPrim = pCmd->m_Cmd == CMD_QUADS ? 4 : 2;
+				static const int s_aCorners[] = {0, 1, 2, 3};
+				for(int v = 0; v + VertexPrim <= pCmd->m_NumVertices; v += VertexPrim)
+				{
+					CVertex aPrim[4];
+					for(int j = 0; j < VertexPrim; j++)
+					{
+						aPrim[j] = pList->m_aVertices[pCmd->m_FirstVertex + v + j];
+						aPrim[j].m_X = (aPrim[j].m_X-m_aRasterScreen[0])*ScaleX;
+						aPrim[j].m_Y = (aPrim[j].m_Y-m_aRasterScreen[1])*ScaleY;
+					}
+					if(VertexPrim == 4 && pCmd->m_aArgs[0] && CGsTransform::IsSprite((const CGsVertex *)aPrim, s_aCorners))
+						RasterSprite(&aPrim[0], &aPrim[2]);
+					else if(VertexPrim == 4)
+					{
+						RasterTriangle(&aPrim[0], &aPrim[1], &aPrim[2]);
+						RasterTriangle(&aPrim[0], &aPrim[2], &aPrim[3]);
+					}
+					else
+						RasterLine(&aPrim[0], &aPrim[1]);
+				}
+			}
+			break;
+		}
+	}
+
+	if(pList->m_Swap)
+	{
+		if(m_LogFile)
+		{
+			char aBuf[32];
+			str_format(aBuf, sizeof(aBuf), "%d swap", pList->m_Frame);
+			io_write(m_LogFile, aBuf, str_length(aBuf));
+			io_write_newline(m_LogFile);
+		}
+		if(m_DoScreenshot)
+		{
+			WriteScreenshot();
+			m_DoScreenshot = false;
+		}
+	}
+
+	// everything before the signals has been replayed
+	for(int i = 0; i < pList->m_NumSignals; i++)
+		pList->m_apSignals[i]->signal();
+
+	ResetList(pList);
+}
+
+void CGraphics_Null::WriteScreenshot()
+{
+	if(!m_pFrameBuffer)
+	{
+		dbg_msg("graphics/null", "screenshots need gfx_headless_raster 1");
+		return;
+	}
+
+	char aWholePath[1024];
+	png_t Png; // ignore_convention
+
+	IOHANDLE File = m_pStorage->OpenFile(m_aScreenshotName, IOFLAG_WRITE, IStorage::TYPE_SAVE, aWholePath, sizeof(aWholePath));
+	if(File)
+		io_close(File);
+
+	png_open_file_write(&Png, aWholePath); // ignore_convention
+	png_set_data(&Png, m_ScreenWidth, m_ScreenHeight, 8, PNG_TRUECOLOR_ALPHA, m_pFrameBuffer); // ignore_convention
+	png_close_file(&Png); // ignore_convention
+
+	dbg_msg("graphics/null", "saved screenshot to '%s'", aWholePath);
+}
+
+void CGraphics_Null::ClipEnable(int x, int y, int w, int h)
+{
+	CCommand *pCmd = AddCommand(CMD_CLIP);
+	pCmd->m_aArgs[0] = 1;
+	pCmd->m_aArgs[1] = x;
+	pCmd->m_aArgs[2] = y;
+	pCmd->m_aArgs[3] = w;
+	pCmd->m_aArgs[4] = h;
+	m_Stats.m_ClipChanges++;
+}
+
+void CGraphics_Null::ClipDisable()
+{
+	AddCommand(CMD_CLIP);
+	m_Stats.m_ClipChanges++;
+}
+
+void CGraphics_Null::BlendNone()
+{
+	AddCommand(CMD_BLEND)->m_aArgs[0] = BLEND_NONE;
+	if(m_BlendMode != BLEND_NONE)
+		m_Stats.m_StateChanges++;
+	m_BlendMode = BLEND_NONE;
+}
+
+void CGraphics_Null::BlendNormal()
+{
+	AddCommand(CMD_BLEND)->m_aArgs[0] = BLEND_NORMAL;
+	if(m_BlendMode != BLEND_NORMAL)
+		m_Stats.m_StateChanges++;
+	m_BlendMode = BLEND_NORMAL;
+}
+
+void CGraphics_Null::BlendAdditive()
+{
+	AddCommand(CMD_BLEND)->m_aArgs[0] = BLEND_ADDITIVE;
+	if(m_BlendMode != BLEND_ADDITIVE)
+		m_Stats.m_StateChanges++;
+	m_BlendMode = BLEND_ADDITIVE;
+}
+
+void CGraphics_Null::WrapNormal()
+{
+	AddCommand(CMD_WRAP)->m_aArgs[0] = WRAP_REPEAT;
+	if(m_WrapMode != WRAP_REPEAT)
+		m_Stats.m_StateChanges++;
+	m_WrapMode = WRAP_REPEAT;
+}
+
+void CGraphics_Null::WrapClamp()
+{
+	AddCommand(CMD_WRAP)->m_aArgs[0] = WRAP_CLAMP;
+	if(m_WrapMode != WRAP_CLAMP)
+		m_Stats.m_StateChanges++;
+	m_WrapMode = WRAP_CLAMP;
+}
+
+void CGraphics_Null::MapScreen(float TopLeftX, float TopLeftY, float BottomRightX, float BottomRightY)
+{
+	m_ScreenX0 = TopLeftX;
+	m_ScreenY0 = TopLeftY;
+	m_ScreenX1 = BottomRightX;
+	m_ScreenY1 = BottomRightY;
+
+	CCommand *pCmd = AddCommand(CMD_SCREEN);
+	pCmd->m_aValues[0] = TopLeftX;
+	pCmd->m_aValues[1] = TopLeftY;
+	pCmd->m_aValues[2] = BottomRightX;
+	pCmd->m_aValues[3] = BottomRightY;
+}
+
+void CGraphics_Null::GetScreen(float *pTopLeftX, float *pTopLeftY, float *pBottomRightX, float *pBottomRightY)
+{
+	*pTopLeftX = m_ScreenX0;
+	*pTopLeftY = m_ScreenY0;
+	*pBottomRightX = m_ScreenX1;
+	*pBottomRightY = m_ScreenY1;
+}
+
+void CGraphics_Null::LinesBegin()
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->LinesBegin twice");
+	m_Drawing = DRAWING_LINES;
+	m_CommandStart = m_pList->m_NumVertices;
+	SetColor(1,1,1,1);
+}
+
+void CGraphics_Null::LinesEnd()
+{
+	dbg_assert(m_Drawing == DRAWING_LINES, "called Graphics()->LinesEnd without begin");
+	EndDraw(CMD_LINES);
+	m_Drawing = 0;
+}
+
+void CGraphics_Null::LinesDraw(const CLineItem *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_LINES, "called Graphics()->LinesDraw without begin");
+
+	for(int i = 0; i < Num; i++)
+	{
+		CVertex *pVertices = AllocVertices(2);
+		pVertices[0].m_X = pArray[i].m_X0;
+		pVertices[0].m_Y = pArray[i].m_Y0;
+		pVertices[0].m_U = m_aTexU[0];
+		pVertices[0].m_V = m_aTexV[0];
+		mem_copy(pVertices[0].m_aColor, m_aColor[0], sizeof(pVertices[0].m_aColor));
+
+		pVertices[1].m_X = pArray[i].m_X1;
+		pVertices[1].m_Y = pArray[i].m_Y1;
+		pVertices[1].m_U = m_aTexU[1];
+		pVertices[1].m_V = m_aTexV[1];
+		mem_copy(pVertices[1].m_aColor, m_aColor[1], sizeof(pVertices[1].m_aColor));
+	}
+}
+
+int CGraphics_Null::UnloadTexture(int Index)
+{
+	if(Index == m_InvalidTexture || Index < 0)
+		return 0;
+
+	// recorded draws might still use it
+	Flush();
+	WaitForIdle();
+
+	if(m_aTextures[Index].m_pData)
+		_mem_free(m_aTextures[Index].m_pData);
+	m_aTextures[Index].m_pData = 0;
+	m_aTextures[Index].m_RenderTarget = false;
+
+	m_aTextures[Index].m_Next = m_FirstFreeTexture;
+	m_TextureMemoryUsage -= m_aTextures[Index].m_MemSize;
+	m_FirstFreeTexture = Index;
+	return 0;
+}
+
+int CGraphics_Null::LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData)
+{
+	CTexture *pTex = &m_aTextures[TextureID];
+	m_Stats.m_TextureUploads++;
+	m_Stats.m_UploadBytes += Width*Height*4;
+	if(!pTex->m_pData)
+		return 0;
+
+	// the frame before might still be drawn from it
+	WaitForIdle();
+
+	const unsigned char *pSrc = (const unsigned char *)pData;
+	const int PixelSize = Format == CImageInfo::FORMAT_RGBA ? 4 : Format == CImageInfo::FORMAT_RGB ? 3 : 1;
+	for(int ty = 0; ty < Height; ty++)
+		for(int tx = 0; tx < Width; tx++)
+		{
+			if(x+tx >= pTex->m_Width || y+ty >= pTex->m_Height)
+				continue;
+			const unsigned char *pPixel = &pSrc[(ty*Width + tx)*PixelSize];
+			unsigned char *pDst = &pTex->m_pData[((y+ty)*pTex->m_Width + x+tx)*4];
+			if(PixelSize == 1)
+			{
+				pDst[0] = pDst[1] = pDst[2] = 255;
+				pDst[3] = pPixel[0];
+			}
+			else
+			{
+				pDst[0] = pPixel[0];
+				pDst[1] = pPixel[1];
+				pDst[2] = pPixel[2];
+				pDst[3] = PixelSize == 4 ? pPixel[3] : 255;
+			}
+		}
+	return 0;
+}
+
+int CGraphics_Null::LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
+{
+	// don't waste memory on texture if we are stress testing
+	if(g_Config.m_DbgStress)
+		return m_InvalidTexture;
+
+	// grab texture
+	int Tex = m_FirstFreeTexture;
+	m_FirstFreeTexture = m_aTextures[Tex].m_Next;
+	m_aTextures[Tex].m_Next = -1;
+
+	CTexture *pTex = &m_aTextures[Tex];
+	pTex->m_Width = Width;
+	pTex->m_Height = Height;
+	pTex->m_MemSize = Width*Height*4;
+	pTex->m_pData = 0;
+	pTex->m_RenderTarget = false;
+	if(m_pFrameBuffer)
+	{
+		pTex->m_pData = (unsigned char *)mem_alloc(Width*Height*4, 1);
+		LoadTextureRawSub(Tex, 0, 0, Width, Height, Format, pData);
+	}
+	else
+	{
+		m_Stats.m_TextureUploads++;
+		m_Stats.m_UploadBytes += pTex->m_MemSize;
+	}
+
+	m_TextureMemoryUsage += pTex->m_MemSize;
+	return Tex;
+}
+
+int CGraphics_Null::CreateRenderTarget(int Width, int Height)
+{
+	// grab texture
+	int Tex = m_FirstFreeTexture;
+	m_FirstFreeTexture = m_aTextures[Tex].m_Next;
+	m_aTextures[Tex].m_Next = -1;
+
+	CTexture *pTex = &m_aTextures[Tex];
+	pTex->m_Width = Width;
+	pTex->m_Height = Height;
+	pTex->m_MemSize = Width*Height*4;
+	pTex->m_pData = 0;
+	pTex->m_RenderTarget = true;
+	pTex->m_TargetDrawn = false;
+	if(m_pFrameBuffer)
+	{
+		pTex->m_pData = (unsigned char *)mem_alloc(Width*Height*4, 1);
+		mem_zero(pTex->m_pData, Width*Height*4);
+	}
+
+	m_TextureMemoryUsage += pTex->m_MemSize;
+	return Tex;
+}
+
+void CGraphics_Null::RenderTargetBegin(int TextureID)
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->RenderTargetBegin within begin");
+	dbg_assert(TextureID >= 0 && m_aTextures[TextureID].m_RenderTarget, "not a render target");
+
+	CTexture *pTarget = &m_aTextures[TextureID];
+	pTarget->m_TargetDrawn = true;
+	mem_copy(pTarget->m_aTargetClear, m_aClearColor, sizeof(m_aClearColor));
+
+	CCommand *pCmd = AddCommand(CMD_TARGET);
+	pCmd->m_aArgs[0] = TextureID;
+	mem_copy(pCmd->m_aValues, m_aClearColor, sizeof(m_aClearColor));
+	m_Stats.m_Clears++;
+}
+
+void CGraphics_Null::RenderTargetEnd()
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->RenderTargetEnd within begin");
+	AddCommand(CMD_TARGET)->m_aArgs[0] = -1;
+}
+
+bool CGraphics_Null::RenderTargetValid(int TextureID)
+{
+	// textures load right away here, only the clear color can change
+	const CTexture *pTarget = &m_aTextures[TextureID];
+	return pTarget->m_RenderTarget && pTarget->m_TargetDrawn &&
+		mem_comp(pTarget->m_aTargetClear, m_aClearColor, sizeof(m_aClearColor)) == 0;
+}
+
+int CGraphics_Null::LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags)
+{
+	int l = str_length(pFilename);
+	int ID;
+	CImageInfo Img;
+
+	if(l < 3)
+		return m_InvalidTexture;
+	if(LoadPNG(&Img, pFilename, StorageType))
+	{
+		if (StoreFormat == CImageInfo::FORMAT_AUTO)
+			StoreFormat = Img.m_Format;
+
+		ID = LoadTextureRaw(Img.m_Width, Img.m_Height, Img.m_Format, Img.m_pData, StoreFormat, Flags);
+		_mem_free(Img.m_pData);
+		if(ID != m_InvalidTexture && g_Config.m_Debug)
+			dbg_msg("graphics/texture", "loaded %s", pFilename);
+		return ID;
+	}
+
+	return m_InvalidTexture;
+}
+
+int CGraphics_Null::LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType)
+{
+	char aCompleteFilename[512];
+	unsigned char *pBuffer;
+	png_t Png; // ignore_convention
+
+	// open file for reading
+	png_init(0,0); // ignore_convention
+
+	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
+	if(File)
+		io_close(File);
+	else
+	{
+		dbg_msg("game/png", "failed to open file. filename='%s'", pFilename);
+		return 0;
+	}
+
+	int Error = png_open_file(&Png, aCompleteFilename); // ignore_convention
+	if(Error != PNG_NO_ERROR)
+	{
+		dbg_msg("game/png", "failed to open file. filename='%s'", aCompleteFilename);
+		if(Error != PNG_FILE_ERROR)
+			png_close_file(&Png); // ignore_convention
+		return 0;
+	}
+
+	if(Png.depth != 8 || (Png.color_type != PNG_TRUECOLOR && Png.color_type != PNG_TRUECOLOR_ALPHA)) // ignore_convention
+	{
+		dbg_msg("game/png", "invalid format. filename='%s'", aCompleteFilename);
+		png_close_file(&Png); // ignore_convention
+		return 0;
+	}
+
+	pBuffer = (unsigned char *)mem_alloc(Png.width * Png.height * Png.bpp, 1); // ignore_convention
+	png_get_data(&Png, pBuffer); // ignore_convention
+	png_close_file(&Png); // ignore_convention
+
+	pImg->m_Width = Png.width; // ignore_convention
+	pImg->m_Height = Png.height; // ignore_convention
+	if(Png.color_type == PNG_TRUECOLOR) // ignore_convention
+		pImg->m_Format = CImageInfo::FORMAT_RGB;
+	else if(Png.color_type == PNG_TRUECOLOR_ALPHA) // ignore_convention
+		pImg->m_Format = CImageInfo::FORMAT_RGBA;
+	pImg->m_pData = pBuffer;
+	return 1;
+}
+
+void CGraphics_Null::TextureSet(int TextureID)
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->TextureSet within begin");
+
+	AddCommand(CMD_TEXTURE)->m_aArgs[0] = TextureID;
+	if(m_Texture != TextureID)
+		m_Stats.m_TextureBinds++;
+	m_Texture = TextureID;
+}
+
+void CGraphics_Null::Clear(float r, float g, float b)
+{
+	CCommand *pCmd = AddCommand(CMD_CLEAR);
+	pCmd->m_aValues[0] = r;
+	pCmd->m_aValues[1] = g;
+	pCmd->m_aValues[2] = b;
+	m_Stats.m_Clears++;
+
+	// render targets start out in it
+	m_aClearColor[0] = r;
+	m_aClearColor[1] = g;
+	m_aClearColor[2] = b;
+}
+
+void CGraphics_Null::QuadsBegin()
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->QuadsBegin twice");
+	m_Drawing = DRAWING_QUADS;
+	m_CommandStart = m_pList->m_NumVertices;
+
+	QuadsSetSubset(0,0,1,1);
+	QuadsSetRotation(0);
+	SetColor(1,1,1,1);
+}
+
+void CGraphics_Null::QuadsEnd()
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsEnd without begin");
+	EndDraw(CMD_QUADS);
+	m_Drawing = 0;
+}
+
+void CGraphics_Null::QuadsSetRotation(float Angle)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsSetRotation without begin");
+	m_Rotation = Angle;
+}
+
+void CGraphics_Null::SetColorVertex(const CColorVertex *pArray, int Num)
+{
+	dbg_assert(m_Drawing != 0, "called Graphics()->SetColorVertex without begin");
+
+	for(int i = 0; i < Num; ++i)
+	{
+		m_aColor[pArray[i].m_Index][0] = pArray[i].m_R;
+		m_aColor[pArray[i].m_Index][1] = pArray[i].m_G;
+		m_aColor[pArray[i].m_Index][2] = pArray[i].m_B;
+		m_aColor[pArray[i].m_Index][3] = pArray[i].m_A;
+	}
+}
+
+void CGraphics_Null::SetColor(float r, float g, float b, float a)
+{
+	dbg_assert(m_Drawing != 0, "called Graphics()->SetColor without begin");
+	CColorVertex Array[4] = {
+		CColorVertex(0, r, g, b, a),
+		CColorVertex(1, r, g, b, a),
+		CColorVertex(2, r, g, b, a),
+		CColorVertex(3, r, g, b, a)};
+	SetColorVertex(Array, 4);
+}
+
+void CGraphics_Null::QuadsSetSubset(float TlU, float TlV, float BrU, float BrV)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsSetSubset without begin");
+
+	QuadsSetSubsetFree(TlU, TlV, BrU, TlV, BrU, BrV, TlU, BrV);
+}
+
+void CGraphics_Null::QuadsSetSubsetFree(
+	float x0, float y0, float x1, float y1,
+	float x2, float y2, float x3, float y3)
+{
+	m_aTexU[0] = x0; m_aTexV[0] = y0;
+	m_aTexU[1] = x1; m_aTexV[1] = y1;
+	m_aTexU[2] = x2; m_aTexV[2] = y2;
+	m_aTexU[3] = x3; m_aTexV[3] = y3;
+}
+
+void CGraphics_Null::QuadsDraw(CQuadItem *pArray, int Num)
+{
+	for(int i = 0; i < Num; ++i)
+	{
+		pArray[i].m_X -= pArray[i].m_Width/2;
+		pArray[i].m_Y -= pArray[i].m_Height/2;
+	}
+
+	QuadsDrawTL(pArray, Num);
+}
+
+void CGraphics_Null::QuadsDrawTL(const CQuadItem *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawTL without begin");
+
+	const float c = cosf(m_Rotation);
+	const float s = sinf(m_Rotation);
+	for(int i = 0; i < Num; i++)
+	{
+		// corners go around, top left, top right, bottom right, bottom left
+		CVertex *pVertices = AllocVertices(4);
+		for(int j = 0; j < 4; j++)
+		{
+			float x = (j == 1 || j == 2) ? pArray[i].m_Width : 0.0f;
+			float y = j >= 2 ? pArray[i].m_Height : 0.0f;
+			if(m_Rotation != 0)
+			{
+				float cx = x - pArray[i].m_Width/2, cy = y - pArray[i].m_Height/2;
+				x = cx * c - cy * s + pArray[i].m_Width/2;
+				y = cx * s + cy * c + pArray[i].m_Height/2;
+			}
+			pVertices[j].m_X = pArray[i].m_X + x;
+			pVertices[j].m_Y = pArray[i].m_Y + y;
+			pVertices[j].m_U = m_aTexU[j];
+			pVertices[j].m_V = m_aTexV[j];
+			mem_copy(pVertices[j].m_aColor, m_aColor[j], sizeof(pVertices[j].m_aColor));
+		}
+	}
+}
+
+void CGraphics_Null::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawFreeform without begin");
+
+	// freeform corners are top left, top right, bottom left, bottom right
+	static const int s_aOrder[] = {0, 1, 3, 2};
+	for(int i = 0; i < Num; i++)
+	{
+		const float aX[4] = {pArray[i].m_X0, pArray[i].m_X1, pArray[i].m_X2, pArray[i].m_X3};
+		const float aY[4] = {pArray[i].m_Y0, pArray[i].m_Y1, pArray[i].m_Y2, pArray[i].m_Y3};
+		CVertex *pVertices = AllocVertices(4);
+		for(int j = 0; j < 4; j++)
+		{
+			int Corner = s_aOrder[j];
+			pVertices[j].m_X = aX[Corner];
+			pVertices[j].m_Y = aY[Corner];
+			pVertices[j].m_U = m_aTexU[Corner];
+			pVertices[j].m_V = m_aTexV[Corner];
+			mem_copy(pVertices[j].m_aColor, m_aColor[Corner], sizeof(pVertices[j].m_aColor));
+		}
+	}
+}
+
+void CGraphics_Null::QuadsDrawTexturedTL(const CTexturedQuadItem *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawTexturedTL without begin");
+
+	for(int i = 0; i < Num; i++)
+	{
+		const CTexturedQuadItem *pItem = &pArray[i];
+		CVertex *pVertices = AllocVertices(4);
+		for(int j = 0; j < 4; j++)
+		{
+			pVertices[j].m_X = pItem->m_X + (j == 1 || j == 2 ? pItem->m_Width : 0.0f);
+			pVertices[j].m_Y = pItem->m_Y + (j >= 2 ? pItem->m_Height : 0.0f);
+			pVertices[j].m_U = pItem->m_aU[j];
+			pVertices[j].m_V = pItem->m_aV[j];
+			mem_copy(pVertices[j].m_aColor, m_aColor[j], sizeof(pVertices[j].m_aColor));
+		}
+	}
+}
+
+void CGraphics_Null::QuadsDrawColoredFreeform(const CColoredFreeformItem *pArray, int Num)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawColoredFreeform without begin");
+
+	static const int s_aOrder[] = {0, 1, 3, 2};
+	for(int i = 0; i < Num; i++)
+	{
+		const CColoredFreeformItem *pItem = &pArray[i];
+		CVertex *pVertices = AllocVertices(4);
+		for(int j = 0; j < 4; j++)
+		{
+			int Point = s_aOrder[j];
+			pVertices[j].m_X = pItem->m_aX[Point];
+			pVertices[j].m_Y = pItem->m_aY[Point];
+			pVertices[j].m_U = pItem->m_aU[Point];
+			pVertices[j].m_V = pItem->m_aV[Point];
+			mem_copy(pVertices[j].m_aColor, pItem->m_aColors[Point], sizeof(pVertices[j].m_aColor));
+		}
+	}
+}
+
+void CGraphics_Null::QuadsText(float x, float y, float Size, const char *pText)
+{
+	float StartX = x;
+
+	while(*pText)
+	{
+		char c = *pText;
+		pText++;
+
+		if(c == '\n')
+		{
+			x = StartX;
+			y += Size;
+		}
+		else
+		{
+			QuadsSetSubset(
+				(c%16)/16.0f,
+				(c/16)/16.0f,
+				(c%16)/16.0f+1.0f/16.0f,
+				(c/16)/16.0f+1.0f/16.0f);
+
+			CQuadItem QuadItem(x, y, Size, Size);
+			QuadsDrawTL(&QuadItem, 1);
+			x += Size/2;
+		}
+	}
+}
+
+int CGraphics_Null::Init()
+{
+	m_pStorage = Kernel()->RequestInterface<IStorage>();
+
+	// a video restart comes through here again
+	m_RenderThread.StopProcessor();
+
+	m_ScreenWidth = g_Config.m_GfxScreenWidth = DEFAULT_WIDTH;
+	m_ScreenHeight = g_Config.m_GfxScreenHeight = DEFAULT_HEIGHT;
+
+	const int NumLists = g_Config.m_GfxThreadedOld ? NUM_COMMAND_LISTS : 1;
+	for(int i = 0; i < NumLists; i++)
+	{
+		if(!m_apCommandLists[i])
+			m_apCommandLists[i] = (CCommandList *)mem_alloc(sizeof(CCommandList), 1);
+		ResetList(m_apCommandLists[i]);
+	}
+	m_CurrentList = 0;
+	m_pList = m_apCommandLists[0];
+	m_CommandStart = 0;
+
+	if(g_Config.m_GfxHeadlessRaster && !m_pFrameBuffer)
+	{
+		m_pFrameBuffer = (unsigned char *)mem_alloc(m_ScreenWidth*m_ScreenHeight*4, 1);
+		mem_zero(m_pFrameBuffer, m_ScreenWidth*m_ScreenHeight*4);
+	}
+	m_pRasterPixels = m_pFrameBuffer;
+	m_RasterWidth = m_ScreenWidth;
+	m_RasterHeight = m_ScreenHeight;
+	m_aRasterClipArgs[0] = 0;
+	UpdateRasterClip();
+
+	if(g_Config.m_GfxHeadlessLog[0] && !m_LogFile)
+	{
+		m_LogFile = m_pStorage->OpenFile(g_Config.m_GfxHeadlessLog, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!m_LogFile)
+			dbg_msg("graphics/null", "failed to open '%s' for the command log", g_Config.m_GfxHeadlessLog);
+	}
+
+	// init textures
+	m_FirstFreeTexture = 0;
+	for(int i = 0; i < MAX_TEXTURES; i++)
+	{
+		m_aTextures[i].m_Next = i+1;
+		m_aTextures[i].m_pData = 0;
+	}
+	m_aTextures[MAX_TEXTURES-1].m_Next = -1;
+
+	// create null texture, will get id=0
+	static const unsigned char aNullTextureData[] = {
+		0xff,0x00,0x00,0xff, 0xff,0x00,0x00,0xff, 0x00,0xff,0x00,0xff, 0x00,0xff,0x00,0xff,
+		0xff,0x00,0x00,0xff, 0xff,0x00,0x00,0xff, 0x00,0xff,0x00,0xff, 0x00,0xff,0x00,0xff,
+		0x00,0x00,0xff,0xff, 0x00,0x00,0xff,0xff, 0xff,0xff,0x00,0xff, 0xff,0xff,0x00,0xff,
+		0x00,0x00,0xff,0xff, 0x00,0x00,0xff,0xff, 0xff,0xff,0x00,0xff, 0xff,0xff,0x00,0xff,
+	};
+
+	m_InvalidTexture = LoadTextureRaw(4,4,CImageInfo::FORMAT_RGBA,aNullTextureData,CImageInfo::FORMAT_RGBA,TEXLOAD_NORESAMPLE);
+
+	m_RenderThread.StartProcessor(this, g_Config.m_GfxThreadedOld);
+
+	dbg_msg("graphics/null", "headless %dx%d, raster %s, log %s", m_ScreenWidth, m_ScreenHeight,
+		m_pFrameBuffer ? "on" : "off", m_LogFile ? g_Config.m_GfxHeadlessLog : "off");
+	return 0;
+}
+
+void CGraphics_Null::Shutdown()
+{
+	Flush();
+	m_RenderThread.StopProcessor();
+
+	dbg_msg("graphics/null", "%d frames, %d draw calls, %d quads (%d sprites), %d lines, %d clears",
+		m_Totals.m_Frames, m_Totals.m_DrawCalls, m_Totals.m_Quads, m_Totals.m_Sprites, m_Totals.m_Lines, m_Totals.m_Clears);
+	dbg_msg("graphics/null", "%d texture binds, %d state changes, %d clip changes, %d texture uploads (%d KB)",
+		m_Totals.m_TextureBinds, m_Totals.m_StateChanges, m_Totals.m_ClipChanges, m_Totals.m_TextureUploads, m_Totals.m_UploadBytes/1024);
+
+	if(m_LogFile)
+		io_close(m_LogFile);
+	m_LogFile = 0;
+
+	for(int i = 0; i < MAX_TEXTURES; i++)
+		if(m_aTextures[i].m_pData)
+		{
+			_mem_free(m_aTextures[i].m_pData);
+			m_aTextures[i].m_pData = 0;
+		}
+
+	if(m_pFrameBuffer)
+		_mem_free(m_pFrameBuffer);
+	m_pFrameBuffer = 0;
+	m_pRasterPixels = 0;
+
+	for(int i = 0; i < NUM_COMMAND_LISTS; i++)
+	{
+		if(m_apCommandLists[i])
+			_mem_free(m_apCommandLists[i]);
+		m_apCommandLists[i] = 0;
+	}
+}
+
+void CGraphics_Null::TakeScreenshot(const char *pFilename)
+{
+	char aDate[20];
+	str_timestamp(aDate, sizeof(aDate));
+	str_format(m_aScreenshotName, sizeof(m_aScreenshotName), "screenshots/%s_%s.png", pFilename ? pFilename : "screenshot", aDate);
+	m_DoScreenshot = true;
+}
+
+void CGraphics_Null::TakeCustomScreenshot(const char *pFilename)
+{
+	str_copy(m_aScreenshotName, pFilename, sizeof(m_aScreenshotName));
+	m_DoScreenshot = true;
+}
+
+void CGraphics_Null::Swap()
+{
+	m_Stats.m_Frames = 1;
+	m_LastStats.m_DrawCalls = m_Stats.m_DrawCalls;
+	m_LastStats.m_Batches = m_Stats.m_DrawCalls;
+	m_LastStats.m_StateChanges = m_Stats.m_TextureBinds + m_Stats.m_StateChanges + m_Stats.m_ClipChanges;
+	m_LastStats.m_Vertices = m_Stats.m_Quads*4 + m_Stats.m_Lines*2;
+	m_LastStats.m_Sprites = m_Stats.m_Sprites;
+	m_LastStats.m_TextureUploads = m_Stats.m_TextureUploads;
+	m_LastStats.m_UploadBytes = m_Stats.m_UploadBytes;
+	m_LastStats.m_Evictions = 0;
+
+	m_Totals.m_Frames += m_Stats.m_Frames;
+	m_Totals.m_Quads += m_Stats.m_Quads;
+	m_Totals.m_Sprites += m_Stats.m_Sprites;
+	m_Totals.m_Lines += m_Stats.m_Lines;
+	m_Totals.m_DrawCalls += m_Stats.m_DrawCalls;
+	m_Totals.m_TextureBinds += m_Stats.m_TextureBinds;
+	m_Totals.m_StateChanges += m_Stats.m_StateChanges;
+	m_Totals.m_ClipChanges += m_Stats.m_ClipChanges;
+	m_Totals.m_Clears += m_Stats.m_Clears;
+	m_Totals.m_TextureUploads += m_Stats.m_TextureUploads;
+	m_Totals.m_UploadBytes += m_Stats.m_UploadBytes;
+	mem_zero(&m_Stats, sizeof(m_Stats));
+
+	m_pList->m_Swap = true;
+	Flush();
+	m_Frame++;
+}
+
+int CGraphics_Null::GetVideoModes(CVideoMode *pModes, int MaxModes)
+{
+	pModes[0].m_Width = DEFAULT_WIDTH;
+	pModes[0].m_Height = DEFAULT_HEIGHT;
+	pModes[0].m_Red = 8;
+	pModes[0].m_Green = 8;
+	pModes[0].m_Blue = 8;
+	return 1;
+}
+
+// syncronization
+void CGraphics_Null::InsertSignal(semaphore *pSemaphore)
+{
+	if(m_pList->m_NumSignals == MAX_SIGNALS)
+		Flush();
+	m_pList->m_apSignals[m_pList->m_NumSignals++] = pSemaphore;
+}
+
+bool CGraphics_Null::IsIdle()
+{
+	return m_RenderThread.IsIdle();
+}
+
+void CGraphics_Null::WaitForIdle()
+{
+	m_RenderThread.WaitForIdle();
+}
+
+extern IEngineGraphics *CreateEngineGraphicsNull() { return new CGraphics_Null(); }
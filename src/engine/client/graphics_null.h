@@ -0,0 +1,267 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_GRAPHICS_NULL_H
+#define ENGINE_CLIENT_GRAPHICS_NULL_H
+
+#include <engine/graphics.h>
+
+#include "render_thread.h"
+
+/*
+	Class: CGraphics_Null
+		Graphics backend without any video hardware, selected with
+		gfx_headless.
+
+		Every call is recorded into a command list together with the
+		vertices it produced. At the end of a frame the list is replayed,
+		on the render thread when gfx_threaded_old is set. The replay
+		appends the list to the file in gfx_headless_log and, with
+		gfx_headless_raster, draws it into a software frame buffer that
+		TakeScreenshot writes out as a PNG. Render targets are drawn into
+		the pixels of their texture the same way. The per frame counters show up
+		in RenderStats and the totals are printed on shutdown.
+*/
+class CGraphics_Null : public IEngineGraphics, public CRenderThread::ICommandProcessor
+{
+protected:
+	// counters of the recorded calls, per frame and over the whole run
+	struct CHeadlessStats
+	{
+		int m_Frames;
+		int m_Quads;
+		int m_Sprites; // quads the gsKit backend would send as sprites
+		int m_Lines;
+		int m_DrawCalls; // QuadsEnd/LinesEnd with geometry
+		int m_TextureBinds;
+		int m_StateChanges; // blend and wrap switches
+		int m_ClipChanges;
+		int m_Clears;
+		int m_TextureUploads;
+		int m_UploadBytes;
+	};
+
+	class IStorage *m_pStorage;
+
+	enum
+	{
+		DEFAULT_WIDTH = 640,
+		DEFAULT_HEIGHT = 448,
+
+		MAX_VERTICES = 32*1024,
+		MAX_COMMANDS = 8*1024,
+		MAX_SIGNALS = 16,
+		MAX_TEXTURES = 1024*4,
+		NUM_COMMAND_LISTS = 2,
+
+		DRAWING_QUADS=1,
+		DRAWING_LINES=2,
+
+		BLEND_NONE=0,
+		BLEND_NORMAL,
+		BLEND_ADDITIVE,
+
+		WRAP_REPEAT=0,
+		WRAP_CLAMP,
+
+		CMD_CLEAR=0,
+		CMD_CLIP,
+		CMD_BLEND,
+		CMD_WRAP,
+		CMD_TEXTURE,
+		CMD_SCREEN,
+		CMD_QUADS,
+		CMD_LINES,
+		CMD_TARGET,
+	};
+
+	// the layout of CGsVertex, so the sprite test of the gsKit backend applies as is
+	struct CVertex
+	{
+		float m_X, m_Y;
+		float m_U, m_V;
+		float m_aColor[4];
+	};
+
+	// one recorded call, draws refer to their vertices in the same list
+	struct CCommand
+	{
+		int m_Cmd;
+		int m_aArgs[5];
+		float m_aValues[4];
+		int m_FirstVertex;
+		int m_NumVertices;
+	};
+
+	struct CCommandList
+	{
+		CVertex m_aVertices[MAX_VERTICES];
+		CCommand m_aCommands[MAX_COMMANDS];
+		int m_NumVertices;
+		int m_NumCommands;
+		int m_Frame;
+		bool m_Swap;
+		semaphore *m_apSignals[MAX_SIGNALS];
+		int m_NumSignals;
+	};
+
+	struct CTexture
+	{
+		int m_Width, m_Height;
+		unsigned char *m_pData; // RGBA, only kept with gfx_headless_raster
+		int m_MemSize;
+		int m_Next;
+
+		bool m_RenderTarget;
+		bool m_TargetDrawn;
+		float m_aTargetClear[3];
+	};
+
+	// front end
+	CCommandList *m_apCommandLists[NUM_COMMAND_LISTS];
+	int m_CurrentList;
+	CCommandList *m_pList;
+	CRenderThread m_RenderThread;
+
+	int m_Drawing;
+	int m_CommandStart;
+	float m_Rotation;
+	float m_aColor[4][4];
+	float m_aTexU[4], m_aTexV[4];
+
+	int m_Texture;
+	int m_BlendMode;
+	int m_WrapMode;
+	float m_ScreenX0, m_ScreenY0, m_ScreenX1, m_ScreenY1;
+
+	CTexture m_aTextures[MAX_TEXTURES];
+	int m_FirstFreeTexture;
+	int m_TextureMemoryUsage;
+	int m_InvalidTexture;
+	float m_aClearColor[3];
+
+	CHeadlessStats m_Stats;
+	CHeadlessStats m_Totals;
+	CRenderStats m_LastStats;
+	int m_Frame;
+
+	char m_aScreenshotName[512];
+	volatile bool m_DoScreenshot;
+
+	// back end, only touched while a list is replayed
+	IOHANDLE m_LogFile;
+	unsigned char *m_pFrameBuffer;
+	unsigned char *m_pRasterPixels; // the frame buffer or a render target
+	int m_RasterWidth, m_RasterHeight;
+	int m_aRasterClipArgs[5];
+	int m_RasterTexture;
+	int m_RasterBlend;
+	int m_RasterWrap;
+	int m_aRasterClip[4];
+	float m_aRasterScreen[4];
+
+	CCommand *AddCommand(int Cmd);
+	CVertex *AllocVertices(int Num);
+	void EndDraw(int Cmd);
+	void ResetList(CCommandList *pList);
+	void Flush();
+
+	void LogCommand(const CCommand *pCmd);
+	void UpdateRasterClip();
+	void RasterTriangle(const CVertex *pA, const CVertex *pB, const CVertex *pC);
+	void RasterSprite(const CVertex *pTL, const CVertex *pBR);
+	void RasterLine(const CVertex *pA, const CVertex *pB);
+	void RasterPixel(int x, int y, const float *pColor, float u, float v);
+	void WriteScreenshot();
+
+public:
+	CGraphics_Null();
+
+	virtual void ClipEnable(int x, int y, int w, int h);
+	virtual void ClipDisable();
+
+	virtual void BlendNone();
+	virtual void BlendNormal();
+	virtual void BlendAdditive();
+
+	virtual void WrapNormal();
+	virtual void WrapClamp();
+
+	virtual int MemoryUsage() const { return m_TextureMemoryUsage; }
+	virtual const CRenderStats &RenderStats() const { return m_LastStats; }
+
+	virtual void MapScreen(float TopLeftX, float TopLeftY, float BottomRightX, float BottomRightY);
+	virtual void GetScreen(float *pTopLeftX, float *pTopLeftY, float *pBottomRightX, float *pBottomRightY);
+
+	virtual void LinesBegin();
+	virtual void LinesEnd();
+	virtual void LinesDraw(const CLineItem *pArray, int Num);
+
+	virtual int UnloadTexture(int Index);
+	virtual int LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags);
+	virtual int LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData);
+	virtual int BuildTextureAtlas(const int *pTextures, int Num) { return 0; }
+
+	virtual int CreateRenderTarget(int Width, int Height);
+	virtual void RenderTargetBegin(int TextureID);
+	virtual void RenderTargetEnd();
+	virtual bool RenderTargetValid(int TextureID);
+
+	virtual int LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags);
+	virtual int LoadTextureAsync(const char *pFilename, int StorageType, int StoreFormat, int Flags, int Priority) { return LoadTexture(pFilename, StorageType, StoreFormat, Flags); }
+	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType);
+
+	virtual void TextureSet(int TextureID);
+
+	virtual void Clear(float r, float g, float b);
+
+	virtual void QuadsBegin();
+	virtual void QuadsEnd();
+	virtual void QuadsSetRotation(float Angle);
+
+	virtual void SetColorVertex(const CColorVertex *pArray, int Num);
+	virtual void SetColor(float r, float g, float b, float a);
+
+	virtual void QuadsSetSubset(float TlU, float TlV, float BrU, float BrV);
+	virtual void QuadsSetSubsetFree(
+		float x0, float y0, float x1, float y1,
+		float x2, float y2, float x3, float y3);
+
+	virtual void QuadsDraw(CQuadItem *pArray, int Num);
+	virtual void QuadsDrawTL(const CQuadItem *pArray, int Num);
+	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
+	virtual void QuadsDrawTexturedTL(const CTexturedQuadItem *pArray, int Num);
+	virtual void QuadsDrawColoredFreeform(const CColoredFreeformItem *pArray, int Num);
+	virtual void QuadsText(float x, float y, float Size, const char *pText);
+
+	virtual int Init();
+	virtual void Shutdown();
+
+	virtual void Minimize() {}
+	virtual void Maximize() {}
+
+	virtual int WindowActive() { return 1; }
+	virtual int WindowOpen() { return 1; }
+
+	virtual void NotifyWindow() {}
+
+	virtual void TakeScreenshot(const char *pFilename);
+	virtual void TakeCustomScreenshot(const char *pFilename);
+	virtual void Swap();
+	// the recorded frames always have the full size
+	virtual bool SetHalfHeight(bool Half) { return !Half; }
+	// nothing is shown, so there is nothing to pace
+	virtual void LastFrameTiming(CFrameTiming *pTiming) { pTiming->m_Frame = -1; pTiming->m_ReadyTime = pTiming->m_FlipTime = 0; }
+	virtual int FrameNumber() { return m_Frame; }
+
+	virtual int GetVideoModes(CVideoMode *pModes, int MaxModes);
+
+	// syncronization
+	virtual void InsertSignal(semaphore *pSemaphore);
+	virtual bool IsIdle();
+	virtual void WaitForIdle();
+
+	// render thread
+	virtual void RunBuffer(int Buffer);
+};
+
+#endif
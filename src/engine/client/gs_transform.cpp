@@ -0,0 +1,236 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "gif_packet.h"
+#include "gs_transform.h"
+
+#if defined(__SSE2__) && !defined(_EE)
+	#include <emmintrin.h>
+#endif
+
+CGsTransform::CGsTransform()
+{
+	for(int i = 0; i < 4; i++)
+	{
+		m_aPosScale[i] = 1.0f;
+		m_aPosOffset[i] = 0.0f;
+		m_aColorScale[i] = 1.0f;
+		m_aColorOffset[i] = 0.0f;
+	}
+}
+
+void CGsTransform::SetScreen(float X0, float Y0, float X1, float Y1, int Width, int Height, int OffsetX, int OffsetY)
+{
+	m_aPosScale[0] = Width/(X1-X0);
+	m_aPosScale[1] = Height/(Y1-Y0);
+	m_aPosOffset[0] = OffsetX/16.0f - X0*m_aPosScale[0];
+	m_aPosOffset[1] = OffsetY/16.0f - Y0*m_aPosScale[1];
+}
+
+void CGsTransform::SetTexture(int Width, int Height)
+{
+	m_aPosScale[2] = (float)Width;
+	m_aPosScale[3] = (float)Height;
+	m_aPosOffset[2] = 0.0f;
+	m_aPosOffset[3] = 0.0f;
+
+	if(Width && Height)
+	{
+		// textures are modulated, 128 is full intensity
+		for(int i = 0; i < 4; i++)
+		{
+			m_aColorScale[i] = 128.0f;
+			m_aColorOffset[i] = 0.0f;
+		}
+	}
+	else
+	{
+		for(int i = 0; i < 3; i++)
+		{
+			m_aColorScale[i] = 255.0f;
+			m_aColorOffset[i] = 0.0f;
+		}
+		m_aColorScale[3] = -128.0f;
+		m_aColorOffset[3] = 128.0f;
+	}
+}
+
+bool CGsTransform::IsSprite(const CGsVertex *pQuad, const int *pCorners)
+{
+	const CGsVertex &TL = pQuad[pCorners[0]];
+	const CGsVertex &TR = pQuad[pCorners[1]];
+	const CGsVertex &BR = pQuad[pCorners[2]];
+	const CGsVertex &BL = pQuad[pCorners[3]];
+
+	// an unrotated rectangle with the top left corner first
+	if(TL.m_Y != TR.m_Y || TR.m_X != BR.m_X || BR.m_Y != BL.m_Y || BL.m_X != TL.m_X)
+		return false;
+	if(!(TL.m_X < BR.m_X && TL.m_Y < BR.m_Y))
+		return false;
+
+	// the texture may be mirrored but not turned, the sprite interpolates u along x and v along y
+	if(TL.m_V != TR.m_V || TR.m_U != BR.m_U || BR.m_V != BL.m_V || BL.m_U != TL.m_U)
+		return false;
+
+	// sprites are flat shaded
+	for(int i = 1; i < 4; i++)
+	{
+		const CGsVertex &c = pQuad[pCorners[i]];
+		if(c.m_R != TL.m_R || c.m_G != TL.m_G || c.m_B != TL.m_B || c.m_A != TL.m_A)
+			return false;
+	}
+	return true;
+}
+
+void CGsTransform::TransformRef(const CGsVertex *pIn, int Num, bool Textured, uint64_t *pOut) const
+{
+	for(int i = 0; i < Num; i++, pIn++)
+	{
+		const float *pPosTex = &pIn->m_X;
+		const float *pColor = &pIn->m_R;
+		int aPosTex[4];
+		int aColor[4];
+
+		for(int c = 0; c < 4; c++)
+		{
+			float v = pPosTex[c]*m_aPosScale[c];
+			v = v + m_aPosOffset[c];
+			aPosTex[c] = (int)(v*16.0f);
+
+			v = pColor[c]*m_aColorScale[c];
+			v = v + m_aColorOffset[c];
+			aColor[c] = (int)v;
+		}
+
+		*pOut++ = CGifPacket::RegRGBAQ(aColor[0], aColor[1], aColor[2], aColor[3]);
+		if(Textured)
+			*pOut++ = CGifPacket::RegUV(aPosTex[2], aPosTex[3]);
+		*pOut++ = CGifPacket::RegXYZ2(aPosTex[0], aPosTex[1], 0);
+	}
+}
+
+#if defined(_EE)
+
+// VU0 macro mode does the float math for 4 components at once, MMI packs
+// the 32 bit lanes down to halfwords (XYZ2, UV) and bytes (RGBAQ)
+void CGsTransform::TransformSimd(const CGsVertex *pIn, int Num, bool Textured, uint64_t *pOut) const
+{
+	float aConst[16] __attribute__((aligned(16)));
+	for(int i = 0; i < 4; i++)
+	{
+		aConst[i] = m_aPosScale[i];
+		aConst[4+i] = m_aPosOffset[i];
+		aConst[8+i] = m_aColorScale[i];
+		aConst[12+i] = m_aColorOffset[i];
+	}
+
+	__asm__ __volatile__(
+		"lqc2		$vf3, 0x00(%0)\n"
+		"lqc2		$vf4, 0x10(%0)\n"
+		"lqc2		$vf5, 0x20(%0)\n"
+		"lqc2		$vf6, 0x30(%0)\n"
+		: : "r"(aConst) : "memory");
+
+	if(Textured)
+	{
+		for(int i = 0; i < Num; i++, pIn++, pOut += 3)
+		{
+			__asm__ __volatile__(
+				"lqc2		$vf1, 0x00(%1)\n"
+				"lqc2		$vf2, 0x10(%1)\n"
+				"vmul.xyzw	$vf1, $vf1, $vf3\n"
+				"vmul.xyzw	$vf2, $vf2, $vf5\n"
+				"vadd.xyzw	$vf1, $vf1, $vf4\n"
+				"vadd.xyzw	$vf2, $vf2, $vf6\n"
+				"vftoi4.xyzw	$vf1, $vf1\n"
+				"vftoi0.xyzw	$vf2, $vf2\n"
+				"qmfc2		$8, $vf1\n"
+				"qmfc2		$9, $vf2\n"
+				"ppach		$8, $0, $8\n"		// x | y<<16 | u<<32 | v<<48
+				"ppach		$9, $0, $9\n"
+				"ppacb		$9, $0, $9\n"		// r | g<<8 | b<<16 | a<<24
+				"lui		$11, 0x3fff\n"
+				"ori		$11, $11, 0x3fff\n"
+				"dsll32		$10, $8, 0\n"
+				"dsrl32		$10, $10, 0\n"		// xyz2, z = 0
+				"dsrl32		$8, $8, 0\n"
+				"and		$8, $8, $11\n"		// uv
+				"dsll32		$9, $9, 0\n"
+				"dsrl32		$9, $9, 0\n"		// rgbaq, q = 0
+				"sd		$9, 0x00(%0)\n"
+				"sd		$8, 0x08(%0)\n"
+				"sd		$10, 0x10(%0)\n"
+				: : "r"(pOut), "r"(pIn) : "$8", "$9", "$10", "$11", "memory");
+		}
+	}
+	else
+	{
+		for(int i = 0; i < Num; i++, pIn++, pOut += 2)
+		{
+			__asm__ __volatile__(
+				"lqc2		$vf1, 0x00(%1)\n"
+				"lqc2		$vf2, 0x10(%1)\n"
+				"vmul.xyzw	$vf1, $vf1, $vf3\n"
+				"vmul.xyzw	$vf2, $vf2, $vf5\n"
+				"vadd.xyzw	$vf1, $vf1, $vf4\n"
+				"vadd.xyzw	$vf2, $vf2, $vf6\n"
+				"vftoi4.xyzw	$vf1, $vf1\n"
+				"vftoi0.xyzw	$vf2, $vf2\n"
+				"qmfc2		$8, $vf1\n"
+				"qmfc2		$9, $vf2\n"
+				"ppach		$8, $0, $8\n"
+				"ppach		$9, $0, $9\n"
+				"ppacb		$9, $0, $9\n"
+				"dsll32		$8, $8, 0\n"
+				"dsrl32		$8, $8, 0\n"
+				"dsll32		$9, $9, 0\n"
+				"dsrl32		$9, $9, 0\n"
+				"sd		$9, 0x00(%0)\n"
+				"sd		$8, 0x08(%0)\n"
+				: : "r"(pOut), "r"(pIn) : "$8", "$9", "memory");
+		}
+	}
+}
+
+#elif defined(__SSE2__)
+
+void CGsTransform::TransformSimd(const CGsVertex *pIn, int Num, bool Textured, uint64_t *pOut) const
+{
+	const __m128 PosScale = _mm_loadu_ps(m_aPosScale);
+	const __m128 PosOffset = _mm_loadu_ps(m_aPosOffset);
+	const __m128 ColorScale = _mm_loadu_ps(m_aColorScale);
+	const __m128 ColorOffset = _mm_loadu_ps(m_aColorOffset);
+	const __m128 Fixed = _mm_set1_ps(16.0f);
+	const __m128i HalfMask = _mm_set1_epi32(0xffff);
+	const __m128i ByteMask = _mm_set1_epi32(0xff);
+
+	for(int i = 0; i < Num; i++, pIn++)
+	{
+		__m128 PosTex = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&pIn->m_X), PosScale), PosOffset);
+		__m128 Color = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&pIn->m_R), ColorScale), ColorOffset);
+		__m128i P = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(PosTex, Fixed)), HalfMask);
+		__m128i C = _mm_and_si128(_mm_cvttps_epi32(Color), ByteMask);
+
+		// merge neighbouring lanes: x|y<<16, u|v<<16 and r|g<<8, b|a<<8
+		P = _mm_or_si128(P, _mm_srli_epi64(P, 16));
+		C = _mm_or_si128(C, _mm_srli_epi64(C, 24));
+		unsigned aP[4], aC[4];
+		_mm_storeu_si128((__m128i *)aP, P);
+		_mm_storeu_si128((__m128i *)aC, C);
+
+		*pOut++ = (uint64_t)((aC[0]&0xffff) | (aC[2]<<16));
+		if(Textured)
+			*pOut++ = (uint64_t)(aP[2]&0x3fff3fff);
+		*pOut++ = (uint64_t)aP[0];
+	}
+}
+
+#else
+
+void CGsTransform::TransformSimd(const CGsVertex *pIn, int Num, bool Textured, uint64_t *pOut) const
+{
+	TransformRef(pIn, Num, Textured, pOut);
+}
+
+#endif
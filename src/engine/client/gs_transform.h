@@ -0,0 +1,67 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_GS_TRANSFORM_H
+#define ENGINE_CLIENT_GS_TRANSFORM_H
+
+#include <stdint.h>
+
+#if defined(_EE) || defined(__SSE2__)
+	#define CONF_GS_TRANSFORM_SIMD 1
+#endif
+
+// input layout of the transform kernels, matches CGraphics_PS2_gsKit::CVertex
+// position and texture coordinates share the first quadword, the color the second
+struct CGsVertex
+{
+	float m_X, m_Y, m_U, m_V;
+	float m_R, m_G, m_B, m_A;
+};
+
+/*
+	Class: CGsTransform
+		Turns batches of vertices into GS register words (RGBAQ, UV, XYZ2)
+		the way a REGLIST GIF block expects them.
+
+		Every component goes through the same steps: v*Scale + Offset, then
+		truncation to an integer (12.4 fixed point for XYZ2 and UV). The
+		scalar reference and the SIMD kernel do exactly these operations in
+		this order so their output is bit identical.
+*/
+class CGsTransform
+{
+public:
+	// x, y, u, v
+	float m_aPosScale[4];
+	float m_aPosOffset[4];
+
+	// r, g, b, a
+	float m_aColorScale[4];
+	float m_aColorOffset[4];
+
+	CGsTransform();
+
+	// maps the ortho rectangle onto the GS drawing area, Offset is the primitive
+	// coordinate offset in 12.4 fixed point (gsGlobal->OffsetX/Y)
+	void SetScreen(float X0, float Y0, float X1, float Y1, int Width, int Height, int OffsetX, int OffsetY);
+
+	// Width/Height of 0 selects untextured color packing
+	void SetTexture(int Width, int Height);
+
+	// Textured writes RGBAQ, UV, XYZ2 per vertex, otherwise RGBAQ, XYZ2
+	void TransformRef(const CGsVertex *pIn, int Num, bool Textured, uint64_t *pOut) const;
+	void TransformSimd(const CGsVertex *pIn, int Num, bool Textured, uint64_t *pOut) const;
+	void Transform(const CGsVertex *pIn, int Num, bool Textured, uint64_t *pOut) const
+	{
+#if defined(CONF_GS_TRANSFORM_SIMD)
+		TransformSimd(pIn, Num, Textured, pOut);
+#else
+		TransformRef(pIn, Num, Textured, pOut);
+#endif
+	}
+
+	// whether the quad can go out as a two vertex sprite, pCorners gives where
+	// its top left, top right, bottom right and bottom left corner are stored
+	static bool IsSprite(const CGsVertex *pQuad, const int *pCorners);
+};
+
+#endif
@@ -0,0 +1,34 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/input.h>
+
+/*
+	Class: CInput_Null
+		Input without a pad, for the host build. No key is ever down
+		and no event is ever added, demos and benchmarks don't need any.
+*/
+class CInput_Null : public IEngineInput
+{
+public:
+	CInput_Null()
+	{
+		mem_zero(m_aInputCount, sizeof(m_aInputCount));
+		mem_zero(m_aInputState, sizeof(m_aInputState));
+		m_InputCurrent = 0;
+		m_InputDispatched = false;
+		m_NumEvents = 0;
+	}
+
+	virtual void Init() {}
+	virtual int Update() { return 0; }
+	virtual int VideoRestartNeeded() { return 0; }
+
+	virtual void MouseModeRelative() {}
+	virtual void MouseModeAbsolute() {}
+	virtual int MouseDoubleClick() { return 0; }
+	virtual void MouseRelative(float *x, float *y) { *x = 0.0f; *y = 0.0f; }
+};
+
+IEngineInput *CreateEngineInputNull() { return new CInput_Null; }
@@ -0,0 +1,210 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <math.h> // cosf, sinf
+
+#include "quad_emit.h"
+
+#if defined(CONF_QUAD_EMIT_SIMD)
+	#include <emmintrin.h>
+#endif
+
+CQuadEmitter::CQuadEmitter()
+{
+	static const float s_aTex[8] = {0, 0, 1, 0, 1, 1, 0, 1};
+	static const float s_aColors[16] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+	Setup(false, s_aTex, s_aColors);
+}
+
+void CQuadEmitter::Setup(bool Triangles, const float *pTex, const float *pColors)
+{
+	static const int s_aQuadCorners[] = {0, 1, 2, 3};
+	static const int s_aTriangleCorners[] = {0, 1, 2, 0, 2, 3};
+	static const int s_aFreeformQuad[] = {0, 1, 3, 2};
+	static const int s_aFreeformTriangles[] = {0, 1, 3, 0, 3, 2};
+	const int *pCorners = Triangles ? s_aTriangleCorners : s_aQuadCorners;
+	const int *pFreeform = Triangles ? s_aFreeformTriangles : s_aFreeformQuad;
+	m_QuadVertices = Triangles ? 6 : 4;
+
+	for(int i = 0; i < m_QuadVertices; i++)
+	{
+		int c = pCorners[i];
+		CGsVertex *pRect = &m_aRect[i];
+		pRect->m_X = pRect->m_Y = 0.0f;
+		pRect->m_U = pTex[c*2];
+		pRect->m_V = pTex[c*2+1];
+		pRect->m_R = pColors[c*4];
+		pRect->m_G = pColors[c*4+1];
+		pRect->m_B = pColors[c*4+2];
+		pRect->m_A = pColors[c*4+3];
+
+		m_aRectSelect[i][0] = (c == 1 || c == 2) ? 1.0f : 0.0f;
+		m_aRectSelect[i][1] = c >= 2 ? 1.0f : 0.0f;
+		m_aRectSelect[i][2] = m_aRectSelect[i][0] - 0.5f;
+		m_aRectSelect[i][3] = m_aRectSelect[i][1] - 0.5f;
+
+		// a freeform point uses the texture coordinates and color of the same index
+		int p = pFreeform[i];
+		CGsVertex *pFree = &m_aFreeform[i];
+		pFree->m_X = pFree->m_Y = 0.0f;
+		pFree->m_U = pTex[p*2];
+		pFree->m_V = pTex[p*2+1];
+		pFree->m_R = pColors[p*4];
+		pFree->m_G = pColors[p*4+1];
+		pFree->m_B = pColors[p*4+2];
+		pFree->m_A = pColors[p*4+3];
+		m_aFreeformPoint[i] = p;
+	}
+}
+
+void CQuadEmitter::RectsRef(const float *pRects, int Num, CGsVertex *pOut) const
+{
+	for(int q = 0; q < Num; q++, pRects += 4)
+	{
+		for(int i = 0; i < m_QuadVertices; i++, pOut++)
+		{
+			*pOut = m_aRect[i];
+			pOut->m_X = pRects[0] + m_aRectSelect[i][0]*pRects[2];
+			pOut->m_Y = pRects[1] + m_aRectSelect[i][1]*pRects[3];
+		}
+	}
+}
+
+void CQuadEmitter::RotatedRef(const float *pRects, int Num, float Angle, CGsVertex *pOut) const
+{
+	const float c = cosf(Angle);
+	const float s = sinf(Angle);
+
+	for(int q = 0; q < Num; q++, pRects += 4)
+	{
+		float CenterX = pRects[0] + 0.5f*pRects[2];
+		float CenterY = pRects[1] + 0.5f*pRects[3];
+		for(int i = 0; i < m_QuadVertices; i++, pOut++)
+		{
+			float dx = m_aRectSelect[i][2]*pRects[2];
+			float dy = m_aRectSelect[i][3]*pRects[3];
+			*pOut = m_aRect[i];
+			pOut->m_X = CenterX + (dx*c + dy*-s);
+			pOut->m_Y = CenterY + (dx*s + dy*c);
+		}
+	}
+}
+
+void CQuadEmitter::FreeformRef(const float *pPoints, int Num, CGsVertex *pOut) const
+{
+	for(int q = 0; q < Num; q++, pPoints += 8)
+	{
+		for(int i = 0; i < m_QuadVertices; i++, pOut++)
+		{
+			*pOut = m_aFreeform[i];
+			pOut->m_X = pPoints[m_aFreeformPoint[i]*2];
+			pOut->m_Y = pPoints[m_aFreeformPoint[i]*2+1];
+		}
+	}
+}
+
+#if defined(CONF_QUAD_EMIT_SIMD)
+
+// a vertex is two quadwords, x y u v and r g b a. the template already
+// holds u v and the color, the kernels only add x and y to the first one
+void CQuadEmitter::RectsSimd(const float *pRects, int Num, CGsVertex *pOut) const
+{
+	const __m128 Zero = _mm_setzero_ps();
+	__m128 aTex[MAX_QUAD_VERTICES], aColor[MAX_QUAD_VERTICES], aSelect[MAX_QUAD_VERTICES];
+	for(int i = 0; i < m_QuadVertices; i++)
+	{
+		aTex[i] = _mm_load_ps(&m_aRect[i].m_X);
+		aColor[i] = _mm_load_ps(&m_aRect[i].m_R);
+		aSelect[i] = _mm_movelh_ps(_mm_load_ps(m_aRectSelect[i]), Zero);
+	}
+
+	for(int q = 0; q < Num; q++, pRects += 4)
+	{
+		__m128 Rect = _mm_loadu_ps(pRects);
+		__m128 Pos = _mm_movelh_ps(Rect, Zero); // x y 0 0
+		__m128 Size = _mm_movehl_ps(Zero, Rect); // w h 0 0
+		for(int i = 0; i < m_QuadVertices; i++, pOut++)
+		{
+			_mm_store_ps(&pOut->m_X, _mm_add_ps(_mm_add_ps(Pos, _mm_mul_ps(aSelect[i], Size)), aTex[i]));
+			_mm_store_ps(&pOut->m_R, aColor[i]);
+		}
+	}
+}
+
+void CQuadEmitter::RotatedSimd(const float *pRects, int Num, float Angle, CGsVertex *pOut) const
+{
+	const float c = cosf(Angle);
+	const float s = sinf(Angle);
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 Half = _mm_set1_ps(0.5f);
+	const __m128 RotX = _mm_setr_ps(c, s, 0.0f, 0.0f);
+	const __m128 RotY = _mm_setr_ps(-s, c, 0.0f, 0.0f);
+	__m128 aTex[MAX_QUAD_VERTICES], aColor[MAX_QUAD_VERTICES], aOffset[MAX_QUAD_VERTICES];
+	for(int i = 0; i < m_QuadVertices; i++)
+	{
+		aTex[i] = _mm_load_ps(&m_aRect[i].m_X);
+		aColor[i] = _mm_load_ps(&m_aRect[i].m_R);
+		aOffset[i] = _mm_movehl_ps(Zero, _mm_load_ps(m_aRectSelect[i]));
+	}
+
+	for(int q = 0; q < Num; q++, pRects += 4)
+	{
+		__m128 Rect = _mm_loadu_ps(pRects);
+		__m128 Size = _mm_movehl_ps(Zero, Rect);
+		__m128 Center = _mm_add_ps(_mm_movelh_ps(Rect, Zero), _mm_mul_ps(Half, Size));
+		for(int i = 0; i < m_QuadVertices; i++, pOut++)
+		{
+			__m128 d = _mm_mul_ps(aOffset[i], Size); // dx dy 0 0
+			__m128 dx = _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 dy = _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 Turned = _mm_add_ps(_mm_mul_ps(dx, RotX), _mm_mul_ps(dy, RotY));
+			_mm_store_ps(&pOut->m_X, _mm_add_ps(_mm_add_ps(Center, Turned), aTex[i]));
+			_mm_store_ps(&pOut->m_R, aColor[i]);
+		}
+	}
+}
+
+void CQuadEmitter::FreeformSimd(const float *pPoints, int Num, CGsVertex *pOut) const
+{
+	const __m128 Zero = _mm_setzero_ps();
+	__m128 aTex[MAX_QUAD_VERTICES], aColor[MAX_QUAD_VERTICES];
+	for(int i = 0; i < m_QuadVertices; i++)
+	{
+		aTex[i] = _mm_load_ps(&m_aFreeform[i].m_X);
+		aColor[i] = _mm_load_ps(&m_aFreeform[i].m_R);
+	}
+
+	for(int q = 0; q < Num; q++, pPoints += 8)
+	{
+		__m128 Front = _mm_loadu_ps(pPoints);
+		__m128 Back = _mm_loadu_ps(pPoints+4);
+		__m128 aPoint[4] = {
+			_mm_movelh_ps(Front, Zero), _mm_movehl_ps(Zero, Front),
+			_mm_movelh_ps(Back, Zero), _mm_movehl_ps(Zero, Back)};
+		for(int i = 0; i < m_QuadVertices; i++, pOut++)
+		{
+			_mm_store_ps(&pOut->m_X, _mm_add_ps(aPoint[m_aFreeformPoint[i]], aTex[i]));
+			_mm_store_ps(&pOut->m_R, aColor[i]);
+		}
+	}
+}
+
+#else
+
+void CQuadEmitter::RectsSimd(const float *pRects, int Num, CGsVertex *pOut) const
+{
+	RectsRef(pRects, Num, pOut);
+}
+
+void CQuadEmitter::RotatedSimd(const float *pRects, int Num, float Angle, CGsVertex *pOut) const
+{
+	RotatedRef(pRects, Num, Angle, pOut);
+}
+
+void CQuadEmitter::FreeformSimd(const float *pPoints, int Num, CGsVertex *pOut) const
+{
+	FreeformRef(pPoints, Num, pOut);
+}
+
+#endif
@@ -0,0 +1,81 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_QUAD_EMIT_H
+#define ENGINE_CLIENT_QUAD_EMIT_H
+
+#include "gs_transform.h"
+
+#if defined(__SSE2__) && !defined(_EE)
+	#define CONF_QUAD_EMIT_SIMD 1
+#endif
+
+/*
+	Class: CQuadEmitter
+		Writes whole arrays of quads into the vertex buffer of the gsKit
+		backend.
+
+		Everything that is the same for all quads of a call, texture
+		coordinates and colors of the four corners as well as the corner
+		layout, is baked into one template vertex per output vertex by
+		Setup. The kernels then only add the positions. Quads are stored
+		either as 4 corners (top left, top right, bottom right, bottom
+		left) or as the two triangles 0,1,2 and 0,2,3 of those corners.
+
+		The SIMD kernels handle one vertex per 128 bit operation and give
+		the same results as the scalar reference. They store whole
+		quadwords, so the output has to be 16 byte aligned.
+*/
+class CQuadEmitter
+{
+public:
+	enum
+	{
+		MAX_QUAD_VERTICES = 6,
+	};
+
+private:
+	// per output vertex: texture coordinates and color of its corner
+	CGsVertex m_aRect[MAX_QUAD_VERTICES] __attribute__((aligned(16)));
+	CGsVertex m_aFreeform[MAX_QUAD_VERTICES] __attribute__((aligned(16)));
+
+	// per output vertex: how much of the width and height is added, the
+	// second pair is the offset from the center used for rotation
+	float m_aRectSelect[MAX_QUAD_VERTICES][4] __attribute__((aligned(16)));
+
+	// freeform quads take their corners in the order 0,1,3,2
+	int m_aFreeformPoint[MAX_QUAD_VERTICES];
+
+	int m_QuadVertices;
+
+public:
+	CQuadEmitter();
+
+	// pTex holds u,v and pColors r,g,b,a of the four corners. Triangles
+	// selects 6 vertices per quad, otherwise 4
+	void Setup(bool Triangles, const float *pTex, const float *pColors);
+	int QuadVertices() const { return m_QuadVertices; }
+
+	// pRects holds x, y, width, height per quad
+	void RectsRef(const float *pRects, int Num, CGsVertex *pOut) const;
+	void RectsSimd(const float *pRects, int Num, CGsVertex *pOut) const;
+
+	// like Rects, every quad is turned by Angle around its center
+	void RotatedRef(const float *pRects, int Num, float Angle, CGsVertex *pOut) const;
+	void RotatedSimd(const float *pRects, int Num, float Angle, CGsVertex *pOut) const;
+
+	// pPoints holds x0, y0 ... x3, y3 per quad
+	void FreeformRef(const float *pPoints, int Num, CGsVertex *pOut) const;
+	void FreeformSimd(const float *pPoints, int Num, CGsVertex *pOut) const;
+
+#if defined(CONF_QUAD_EMIT_SIMD)
+	void Rects(const float *pRects, int Num, CGsVertex *pOut) const { RectsSimd(pRects, Num, pOut); }
+	void Rotated(const float *pRects, int Num, float Angle, CGsVertex *pOut) const { RotatedSimd(pRects, Num, Angle, pOut); }
+#else
+	void Rects(const float *pRects, int Num, CGsVertex *pOut) const { RectsRef(pRects, Num, pOut); }
+	void Rotated(const float *pRects, int Num, float Angle, CGsVertex *pOut) const { RotatedRef(pRects, Num, Angle, pOut); }
+#endif
+	// the SIMD version measured slower than the reference in quad_emit_bench
+	void Freeform(const float *pPoints, int Num, CGsVertex *pOut) const { FreeformRef(pPoints, Num, pOut); }
+};
+
+#endif
@@ -0,0 +1,87 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#if defined(_EE)
+#include <kernel.h>
+#endif
+
+#include "render_thread.h"
+
+enum
+{
+	// one below the main thread's, so recording the next frame is never held
+	// up by the replay. The EE kernel doesn't time slice, the replay runs
+	// whenever the main thread sleeps or waits for it
+	RENDER_THREAD_PRIORITY = 81,
+};
+
+CRenderThread::CRenderThread()
+{
+	m_pProcessor = 0;
+	m_pThread = 0;
+	m_Buffer = -1;
+	m_Shutdown = false;
+}
+
+void CRenderThread::ThreadFunc(void *pUser)
+{
+	CRenderThread *pThis = (CRenderThread *)pUser;
+
+#if defined(_EE)
+	ChangeThreadPriority(GetThreadId(), RENDER_THREAD_PRIORITY);
+#endif
+
+	while(!pThis->m_Shutdown)
+	{
+		pThis->m_Activity.wait();
+		if(pThis->m_Buffer != -1)
+		{
+			pThis->m_pProcessor->RunBuffer(pThis->m_Buffer);
+			sync_barrier();
+			pThis->m_Buffer = -1;
+			pThis->m_BufferDone.signal();
+		}
+	}
+}
+
+void CRenderThread::StartProcessor(ICommandProcessor *pProcessor, bool Threaded)
+{
+	m_pProcessor = pProcessor;
+	m_Shutdown = false;
+	if(Threaded)
+		m_pThread = thread_init(ThreadFunc, this);
+}
+
+void CRenderThread::StopProcessor()
+{
+	if(!m_pThread)
+		return;
+
+	WaitForIdle();
+	m_Shutdown = true;
+	m_Activity.signal();
+	thread_wait(m_pThread);
+	m_pThread = 0;
+}
+
+void CRenderThread::RunBuffer(int Buffer)
+{
+	if(!m_pThread)
+	{
+		m_pProcessor->RunBuffer(Buffer);
+		return;
+	}
+
+	WaitForIdle();
+	m_Buffer = Buffer;
+	sync_barrier();
+	m_Activity.signal();
+}
+
+void CRenderThread::WaitForIdle()
+{
+	// the semaphore can hold a signal from a wait that was skipped, so check again
+	while(m_Buffer != -1)
+		m_BufferDone.wait();
+}
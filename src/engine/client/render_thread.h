@@ -0,0 +1,53 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_RENDER_THREAD_H
+#define ENGINE_CLIENT_RENDER_THREAD_H
+
+#include <base/tl/threading.h>
+
+/*
+	Class: CRenderThread
+		Hands recorded command buffers from the front end to a command
+		processor that runs them on a thread of its own.
+
+		Only one buffer is in flight at a time. RunBuffer waits until the
+		previous one is done before it hands over the next, so a front end
+		with two buffers can record into one while the other is processed.
+		Without a thread the buffers are run right away on the caller's
+		thread. Nothing in here knows about the GS, any processor works.
+
+		On the EE the thread runs below the main thread, so a processor
+		should block rather than spin while it waits for the hardware.
+*/
+class CRenderThread
+{
+public:
+	class ICommandProcessor
+	{
+	public:
+		virtual ~ICommandProcessor() {}
+		virtual void RunBuffer(int Buffer) = 0;
+	};
+
+	CRenderThread();
+
+	void StartProcessor(ICommandProcessor *pProcessor, bool Threaded);
+	void StopProcessor();
+
+	void RunBuffer(int Buffer);
+	bool IsIdle() const { return m_Buffer == -1; }
+	void WaitForIdle();
+	bool Threaded() const { return m_pThread != 0; }
+
+private:
+	ICommandProcessor *m_pProcessor;
+	void *m_pThread;
+	semaphore m_Activity;
+	semaphore m_BufferDone;
+	volatile int m_Buffer;
+	volatile bool m_Shutdown;
+
+	static void ThreadFunc(void *pUser);
+};
+
+#endif
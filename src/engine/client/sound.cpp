@@ -6,24 +6,39 @@
 #include <engine/graphics.h>
 #include <engine/storage.h>
 
+#include <engine/shared/adpcm.h>
 #include <engine/shared/config.h>
+#include <engine/shared/mixer.h>
 
 #include <audsrv.h>
 #include <kernel.h>
 
 #include "sound.h"
+#include "sound_stream.h"
 
 extern "C" { // wavpack
 	#include <engine/external/wavpack/wavpack.h>
 	#include <opusfile.h>
 }
 #include <math.h>
+#include <zlib.h>
 
 enum
 {
 	NUM_SAMPLES = 512,
 	NUM_VOICES = 256,
 	NUM_CHANNELS = 16,
+
+	// SPU2 voices audsrv plays ADPCM samples on
+	NUM_HW_CHANNELS = 24,
+	// audsrv volume below which a sound isn't worth a channel
+	AUDIBLE_VOLUME = 2,
+
+	// frames the mixer thread hands to audsrv at a time
+	MIX_FRAMES = 512,
+
+	// the decoder shares the main thread's priority, below the mixer's
+	STREAM_THREAD_PRIORITY = 80,
 };
 
 struct CSample
@@ -36,6 +51,7 @@ struct CSample
 	int m_LoopEnd;
 	int m_PausedAt;
 	bool m_IsADPCM;
+	CSoundStream *m_pStream; // decoded while it plays, m_pData is 0 then
 };
 
 struct CChannel
@@ -50,11 +66,17 @@ struct CVoice
 	CChannel *m_pChannel;
 	int m_Age; // increases when reused
 	int m_Tick;
+	int64 m_Time; // when m_Tick was last moved forward
 	int m_Vol; // 0 - 255
 	int m_Flags;
 	int m_X, m_Y;
 	float m_Falloff; // [0.0, 1.0]
 
+	int m_HwChannel; // audsrv channel it plays on, -1 when it has none
+	int m_HwVol; // volume and pan the channel was last set to
+	int m_HwPan;
+	bool m_New; // played since the last update
+
 	int m_Shape;
 	union
 	{
@@ -66,6 +88,7 @@ struct CVoice
 static CSample m_aSamples[NUM_SAMPLES] = { {0} };
 static CVoice m_aVoices[NUM_VOICES] = { {0} };
 static CChannel m_aChannels[NUM_CHANNELS] = { {255, 0} };
+static int m_aHwVoices[NUM_HW_CHANNELS]; // voice on each audsrv channel, -1 when free
 
 static LOCK m_SoundLock = 0;
 
@@ -78,6 +101,21 @@ static volatile int m_SoundVolume = 100;
 static int m_NextVoice = 0;
 static unsigned m_MaxFrames = 0;
 
+static ISound::CSoundStats m_Stats;
+static ISound::CSoundStats m_FrameStats;
+
+// the EE mixes all voices when m_MixAll is set, else only the streams
+static CMixer *m_pMixer = 0;
+static bool m_MixAll = false;
+static void *m_pMixThread = 0;
+static volatile bool m_MixShutdown = false;
+
+// decodes the streams, m_StreamLock keeps them from being unloaded meanwhile
+static LOCK m_StreamLock = 0;
+static semaphore m_StreamActivity;
+static void *m_pStreamThread = 0;
+static volatile bool m_StreamShutdown = false;
+
 const int DefaultDistance = 1500;
 
 static int IntAbs(int i)
@@ -87,6 +125,240 @@ static int IntAbs(int i)
 	return i;
 }
 
+// the left and right volume (0 - 255) the voice should have now
+static void VoiceVolume(const CVoice *pVoice, int *pLeft, int *pRight)
+{
+	int Rvol = (int)(pVoice->m_pChannel->m_Vol*(pVoice->m_Vol/255.0f));
+	int Lvol = Rvol;
+
+	// volume calculation
+	if(pVoice->m_Flags&ISound::FLAG_POS && pVoice->m_pChannel->m_Pan)
+	{
+		// TODO: we should respect the channel panning value
+		int dx = pVoice->m_X - m_CenterX;
+		int dy = pVoice->m_Y - m_CenterY;
+		//
+		int p = IntAbs(dx);
+		float FalloffX = 0.0f;
+		float FalloffY = 0.0f;
+
+		int RangeX = 0; // for panning
+		bool InVoiceField = false;
+
+		switch(pVoice->m_Shape)
+		{
+		case ISound::SHAPE_CIRCLE:
+			{
+				float r = pVoice->m_Circle.m_Radius;
+				RangeX = r;
+
+				int Dist = (int)sqrtf((float)dx*dx+dy*dy); // nasty float
+				if(Dist < r)
+				{
+					InVoiceField = true;
+
+					// falloff
+					int FalloffDistance = r*pVoice->m_Falloff;
+					if(Dist > FalloffDistance)
+						FalloffX = FalloffY = (r-Dist)/(r-FalloffDistance);
+					else
+						FalloffX = FalloffY = 1.0f;
+				}
+				break;
+			}
+
+		case ISound::SHAPE_RECTANGLE:
+			{
+				RangeX = pVoice->m_Rectangle.m_Width/2.0f;
+
+				int AbsX = IntAbs(dx);
+				int AbsY = IntAbs(dy);
+				int w = pVoice->m_Rectangle.m_Width/2.0f;
+				int h = pVoice->m_Rectangle.m_Height/2.0f;
+				if(AbsX < w && AbsY < h)
+				{
+					InVoiceField = true;
+
+					// falloff
+					int fx = pVoice->m_Falloff * w;
+					int fy = pVoice->m_Falloff * h;
+					FalloffX = AbsX > fx ? (float)(w-AbsX)/(w-fx) : 1.0f;
+					FalloffY = AbsY > fy ? (float)(h-AbsY)/(h-fy) : 1.0f;
+				}
+				break;
+			}
+		};
+
+		if(InVoiceField)
+		{
+			// panning
+			if(!(pVoice->m_Flags&ISound::FLAG_NO_PANNING) && RangeX > 0)
+			{
+				if(dx > 0)
+					Lvol = (max(RangeX-p, 0)*Lvol)/RangeX;
+				else
+					Rvol = (max(RangeX-p, 0)*Rvol)/RangeX;
+			}
+
+			Lvol *= FalloffX*FalloffY;
+			Rvol *= FalloffX*FalloffY;
+		}
+		else
+		{
+			Lvol = 0;
+			Rvol = 0;
+		}
+	}
+
+	// events that stand for several sounds can be louder, up to full volume
+	*pLeft = min(Lvol, 255) * m_SoundVolume / 100;
+	*pRight = min(Rvol, 255) * m_SoundVolume / 100;
+}
+
+// audsrv takes a volume (0 - 100) and a pan (-100 - 100)
+static void AudsrvVolume(int Left, int Right, int *pVol, int *pPan)
+{
+	*pVol = (Left+Right)/2 * 100 / 255;
+	*pPan = (Right-Left) * 100 / 255;
+}
+
+// louder voices, and of two as loud the one with more left to play, are kept
+static int VoicePriority(const CVoice *pVoice, int Vol)
+{
+	int NumFrames = max(pVoice->m_pSample->m_NumFrames, 1);
+	return Vol*256 + 255 - clamp(pVoice->m_Tick*255/NumFrames, 0, 255);
+}
+
+static void StopChannel(int Channel)
+{
+	CVoice *pVoice = &m_aVoices[m_aHwVoices[Channel]];
+	audsrv_adpcm_set_volume_and_pan(Channel, 0, 0);
+	pVoice->m_HwChannel = -1;
+	m_aHwVoices[Channel] = -1;
+}
+
+// gives the voice a free channel or the one of the least important voice
+// that is quieter than it, false when there is none
+static bool StartChannel(int VoiceID, int Vol, int Pan)
+{
+	CVoice *pVoice = &m_aVoices[VoiceID];
+	const int Priority = VoicePriority(pVoice, Vol);
+
+	int Channel = -1;
+	int LowestPriority = Priority;
+	for(int c = 0; c < NUM_HW_CHANNELS; c++)
+	{
+		if(m_aHwVoices[c] < 0)
+		{
+			Channel = c;
+			break;
+		}
+
+		const CVoice *pOther = &m_aVoices[m_aHwVoices[c]];
+		int OtherPriority = VoicePriority(pOther, pOther->m_HwVol);
+		if(OtherPriority < LowestPriority)
+		{
+			LowestPriority = OtherPriority;
+			Channel = c;
+		}
+	}
+
+	if(Channel < 0)
+	{
+		m_FrameStats.m_Dropped++;
+		return false;
+	}
+
+	if(m_aHwVoices[Channel] >= 0)
+	{
+		StopChannel(Channel);
+		m_FrameStats.m_Stolen++;
+	}
+
+	if(audsrv_ch_play_adpcm(Channel, (audsrv_adpcm_t*)pVoice->m_pSample->m_pData) < 0)
+	{
+		m_FrameStats.m_Dropped++;
+		return false;
+	}
+	audsrv_adpcm_set_volume_and_pan(Channel, Vol, Pan);
+
+	m_aHwVoices[Channel] = VoiceID;
+	pVoice->m_HwChannel = Channel;
+	pVoice->m_HwVol = Vol;
+	pVoice->m_HwPan = Pan;
+	m_FrameStats.m_Played++;
+	return true;
+}
+
+// frees the slot, handles to it stop working
+static void ReleaseVoice(CVoice *pVoice)
+{
+	if(m_pMixer)
+		m_pMixer->Stop(pVoice - m_aVoices);
+	if(pVoice->m_pSample && pVoice->m_pSample->m_pStream)
+		pVoice->m_pSample->m_pStream->Stop();
+	if(pVoice->m_HwChannel >= 0)
+		StopChannel(pVoice->m_HwChannel);
+	pVoice->m_pSample = 0;
+	pVoice->m_Age++;
+}
+
+static void MixThread(void *pUser)
+{
+	static short s_aBuffer[MIX_FRAMES*2] __attribute__((aligned(16)));
+
+	while(!m_MixShutdown)
+	{
+		// blocks until the IOP ring has room, which paces the thread
+		audsrv_wait_audio(sizeof(s_aBuffer));
+
+		lock_wait(m_SoundLock);
+		m_pMixer->Mix(s_aBuffer, MIX_FRAMES);
+		lock_unlock(m_SoundLock);
+
+		audsrv_play_audio((char *)s_aBuffer, sizeof(s_aBuffer));
+	}
+}
+
+// decodes a block of the next stream with room, false when all are full
+static bool DecodeStreamBlock()
+{
+	static int s_Next = 0;
+	bool Decoded = false;
+	lock_wait(m_StreamLock);
+	for(int i = 0; i < NUM_SAMPLES && !Decoded; i++)
+	{
+		// start after the last one so every stream gets its turn
+		CSoundStream *pStream = m_aSamples[(s_Next+i)%NUM_SAMPLES].m_pStream;
+		if(pStream && pStream->Decode())
+		{
+			s_Next = (s_Next+i+1)%NUM_SAMPLES;
+			Decoded = true;
+		}
+	}
+	lock_unlock(m_StreamLock);
+	return Decoded;
+}
+
+static void StreamThread(void *pUser)
+{
+#if defined(_EE)
+	// threads start at the mixer's priority, which would block it and the
+	// render thread for as long as the rings take to fill
+	ChangeThreadPriority(GetThreadId(), STREAM_THREAD_PRIORITY);
+#endif
+
+	while(!m_StreamShutdown)
+	{
+		m_StreamActivity.wait();
+
+		// one block at a time, the kernel doesn't time slice so the main
+		// thread gets its turn in between
+		while(!m_StreamShutdown && DecodeStreamBlock())
+			thread_yield();
+	}
+}
+
 
 int CSound::Init()
 {
@@ -95,6 +367,13 @@ int CSound::Init()
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 
 	m_SoundLock = lock_create();
+	m_StreamLock = lock_create();
+	m_Cache.Init(m_pStorage);
+
+	for(int i = 0; i < NUM_VOICES; i++)
+		m_aVoices[i].m_HwChannel = -1;
+	for(int c = 0; c < NUM_HW_CHANNELS; c++)
+		m_aHwVoices[c] = -1;
 
 	if(!g_Config.m_SndEnable)
 		return 0;
@@ -105,13 +384,37 @@ int CSound::Init()
 		return -1;
 	}
 
-	if (audsrv_adpcm_init())
+	m_MixingRate = g_Config.m_SndRate;
+	m_MixAll = g_Config.m_SndMixer != 0;
+
+	if(!m_MixAll && audsrv_adpcm_init())
 	{
 		dbg_msg("client/sound", "unable to init PS2 audsrv adpcm");
 		return -1;
 	}
 
-	m_MixingRate = g_Config.m_SndRate;
+	// streams are mixed on the EE next to the SPU voices
+	if(m_MixAll || g_Config.m_SndStreamSize)
+	{
+		audsrv_fmt_t Format;
+		Format.bits = 16;
+		Format.freq = m_MixingRate;
+		Format.channels = 2;
+		if(audsrv_set_format(&Format))
+		{
+			dbg_msg("client/sound", "unable to set PS2 audsrv format");
+			return -1;
+		}
+		audsrv_set_volume(MAX_VOLUME);
+
+		m_pMixer = new CMixer;
+		m_pMixer->Init(m_MixingRate);
+		m_MixShutdown = false;
+		m_pMixThread = thread_init(MixThread, 0);
+
+		m_StreamShutdown = false;
+		m_pStreamThread = thread_init(StreamThread, 0);
+	}
 
 	dbg_msg("client/sound", "sound init successful");
 
@@ -135,12 +438,129 @@ int CSound::Update()
 		lock_unlock(m_SoundLock);
 	}
 
+	if(!m_SoundEnabled)
+		return 0;
+
+	lock_wait(m_SoundLock);
+	const int64 Now = time_get();
+	const int64 Freq = time_freq();
+	int ActiveVoices = 0;
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		CVoice *pVoice = &m_aVoices[i];
+		if(!pVoice->m_pSample)
+			continue;
+
+		CSample *pSample = pVoice->m_pSample;
+		if(m_MixAll || pSample->m_pStream)
+		{
+			// the mixer loops and stops the voices itself
+			if(!m_pMixer->IsPlaying(i))
+			{
+				ReleaseVoice(pVoice);
+				continue;
+			}
+
+			int Left, Right;
+			VoiceVolume(pVoice, &Left, &Right);
+			m_pMixer->SetVolume(i, Left, Right);
+			pVoice->m_Tick = pSample->m_pStream ? pSample->m_pStream->Position() : m_pMixer->Position(i);
+			pVoice->m_New = false;
+			ActiveVoices++;
+			continue;
+		}
+
+		// follow the position of the sample, the SPU doesn't report it
+		int Frames = (Now-pVoice->m_Time)*pSample->m_Rate/Freq;
+		pVoice->m_Tick += Frames;
+		pVoice->m_Time += Frames*Freq/pSample->m_Rate;
+
+		if(pVoice->m_Tick >= pSample->m_NumFrames)
+		{
+			if(!(pVoice->m_Flags&FLAG_LOOP) || pSample->m_NumFrames <= 0)
+			{
+				// done playing, the channel is free without telling the IOP
+				if(pVoice->m_HwChannel >= 0)
+					m_aHwVoices[pVoice->m_HwChannel] = -1;
+				pVoice->m_HwChannel = -1;
+				pVoice->m_pSample = 0;
+				pVoice->m_Age++;
+				continue;
+			}
+
+			// the samples are uploaded without loop, start them over
+			pVoice->m_Tick %= pSample->m_NumFrames;
+			if(pVoice->m_HwChannel >= 0)
+				audsrv_ch_play_adpcm(pVoice->m_HwChannel, (audsrv_adpcm_t*)pSample->m_pData);
+		}
+
+		ActiveVoices++;
+
+		int Left, Right, Vol, Pan;
+		VoiceVolume(pVoice, &Left, &Right);
+		AudsrvVolume(Left, Right, &Vol, &Pan);
+		if(pVoice->m_HwChannel >= 0)
+		{
+			if(Vol < AUDIBLE_VOLUME)
+				StopChannel(pVoice->m_HwChannel);
+			else if(Vol != pVoice->m_HwVol || Pan != pVoice->m_HwPan)
+			{
+				audsrv_adpcm_set_volume_and_pan(pVoice->m_HwChannel, Vol, Pan);
+				pVoice->m_HwVol = Vol;
+				pVoice->m_HwPan = Pan;
+			}
+		}
+		else if(Vol >= AUDIBLE_VOLUME && (pVoice->m_New || pVoice->m_Flags&FLAG_LOOP))
+		{
+			// moved into hearing range, or got its shape after it was played
+			if(StartChannel(i, Vol, Pan) && pVoice->m_Flags&FLAG_LOOP)
+				pVoice->m_Tick = 0;
+		}
+		pVoice->m_New = false;
+	}
+
+	int ActiveChannels = 0;
+	for(int c = 0; c < NUM_HW_CHANNELS; c++)
+		if(m_aHwVoices[c] >= 0)
+			ActiveChannels++;
+	if(m_pMixer)
+		ActiveChannels += m_pMixer->NumMixed();
+
+	m_Stats = m_FrameStats;
+	m_Stats.m_ActiveVoices = ActiveVoices;
+	m_Stats.m_ActiveChannels = ActiveChannels;
+	mem_zero(&m_FrameStats, sizeof(m_FrameStats));
+	lock_unlock(m_SoundLock);
+
 	return 0;
 }
 
+const ISound::CSoundStats &CSound::SoundStats() const
+{
+	return m_Stats;
+}
+
 int CSound::Shutdown()
 {
+	if(m_pStreamThread)
+	{
+		m_StreamShutdown = true;
+		m_StreamActivity.signal();
+		thread_wait(m_pStreamThread);
+		m_pStreamThread = 0;
+	}
+	if(m_pMixThread)
+	{
+		m_MixShutdown = true;
+		thread_wait(m_pMixThread);
+		m_pMixThread = 0;
+		audsrv_stop_audio();
+	}
+	delete m_pMixer;
+	m_pMixer = 0;
+
 	audsrv_quit();
+	lock_destroy(m_StreamLock);
 	lock_destroy(m_SoundLock);
 	return 0;
 }
@@ -150,7 +570,7 @@ int CSound::AllocID()
 	// TODO: linear search, get rid of it
 	for(unsigned SampleID = 0; SampleID < NUM_SAMPLES; SampleID++)
 	{
-		if(m_aSamples[SampleID].m_pData == 0x0)
+		if(m_aSamples[SampleID].m_pData == 0x0 && !m_aSamples[SampleID].m_pStream)
 			return SampleID;
 	}
 
@@ -159,12 +579,15 @@ int CSound::AllocID()
 
 void CSound::RateConvert(int SampleID)
 {
+	if(SampleID < 0)
+		return;
+
 	CSample *pSample = &m_aSamples[SampleID];
 	int NumFrames = 0;
 	short *pNewData = 0;
 
 	// make sure that we need to convert this sound
-	if(!pSample->m_pData || pSample->m_Rate == m_MixingRate)
+	if(!pSample->m_pData || pSample->m_IsADPCM || pSample->m_Rate == m_MixingRate)
 		return;
 
 	// allocate new data
@@ -233,6 +656,8 @@ int CSound::DecodeOpus(int SampleID, const void *pData, unsigned DataSize)
 		pSample->m_LoopStart = -1;
 		pSample->m_LoopEnd = -1;
 		pSample->m_PausedAt = 0;
+
+		op_free(OpusFile);
 	}
 	else
 	{
@@ -250,6 +675,24 @@ int CSound::DecodeADPCM(int SampleID, void *pData, unsigned DataSize)
 
 	CSample *pSample = &m_aSamples[SampleID];
 
+	if(m_MixAll)
+	{
+		// the mixer wants the samples themselves
+		bool Loop;
+		pSample->m_pData = CAdpcmDecoder::Decode((const unsigned char *)pData, DataSize, &pSample->m_NumFrames, &pSample->m_Rate, &Loop);
+		if(!pSample->m_pData)
+		{
+			dbg_msg("sound/adpcm", "failed to decode ADPCM");
+			return -1;
+		}
+		pSample->m_IsADPCM = false;
+		pSample->m_Channels = 1;
+		pSample->m_LoopStart = Loop ? 0 : -1;
+		pSample->m_LoopEnd = Loop ? pSample->m_NumFrames : -1;
+		pSample->m_PausedAt = 0;
+		return SampleID;
+	}
+
 	audsrv_adpcm_t* sample = (audsrv_adpcm_t*)mem_alloc(sizeof(audsrv_adpcm_t), 1);
 	mem_zero(sample, sizeof(audsrv_adpcm_t));
 
@@ -261,10 +704,93 @@ int CSound::DecodeADPCM(int SampleID, void *pData, unsigned DataSize)
 
 	pSample->m_pData = (short*)sample;
 	pSample->m_IsADPCM = true;
+	pSample->m_Channels = 1;
+	pSample->m_NumFrames = 0;
+	pSample->m_Rate = CAdpcmEncoder::SPU_RATE;
+	pSample->m_LoopStart = -1;
+	pSample->m_LoopEnd = -1;
+	pSample->m_PausedAt = 0;
+
+	// length and rate from the APCM header, the pitch is in 4096ths of the SPU rate
+	const unsigned char *pHeader = (const unsigned char *)pData;
+	if(DataSize >= CAdpcmEncoder::HEADER_SIZE && mem_comp(pHeader, "APCM", 4) == 0)
+	{
+		int Pitch = pHeader[8] | (pHeader[9]<<8) | (pHeader[10]<<16) | (pHeader[11]<<24);
+		pSample->m_NumFrames = pHeader[12] | (pHeader[13]<<8) | (pHeader[14]<<16) | (pHeader[15]<<24);
+		pSample->m_Rate = max(Pitch*CAdpcmEncoder::SPU_RATE/4096, 1);
+		pSample->m_LoopStart = pHeader[6] ? 0 : -1;
+		pSample->m_LoopEnd = pHeader[6] ? pSample->m_NumFrames : -1;
+	}
 
 	return SampleID;
 }
 
+int CSound::ConvertOpus(int SampleID, const void *pData, unsigned DataSize)
+{
+	if(SampleID == -1 || SampleID >= NUM_SAMPLES)
+		return -1;
+
+	unsigned Crc = crc32(0, (const unsigned char *)pData, DataSize); // ignore_convention
+	int Size = 0;
+	unsigned char *pADPCM = g_Config.m_SndCache ? m_Cache.Load(Crc, &Size) : 0;
+	if(!pADPCM)
+	{
+		if(DecodeOpus(SampleID, pData, DataSize) < 0)
+			return -1;
+
+		// no rate conversion, the pitch in the header lets the SPU do it
+		CSample *pSample = &m_aSamples[SampleID];
+		pADPCM = (unsigned char *)mem_alloc(CAdpcmEncoder::EncodedSize(pSample->m_NumFrames, false), 1);
+		Size = CAdpcmEncoder::Encode(pSample->m_pData, pSample->m_NumFrames, pSample->m_Channels, pSample->m_Rate, false, pADPCM);
+		_mem_free(pSample->m_pData);
+		pSample->m_pData = 0;
+
+		if(g_Config.m_SndCache)
+			m_Cache.Save(Crc, pADPCM, Size);
+	}
+
+	// flush cache, otherwise it will load garbage
+	FlushCache(0);
+
+	SampleID = DecodeADPCM(SampleID, pADPCM, Size);
+	_mem_free(pADPCM);
+	return SampleID;
+}
+
+bool CSound::UseStream(unsigned DataSize)
+{
+	// the mixer is there when sound is on and streams aren't turned off
+	return m_pMixer && g_Config.m_SndStreamSize && DataSize > (unsigned)g_Config.m_SndStreamSize*1024;
+}
+
+int CSound::LoadStream(int SampleID, const void *pData, unsigned DataSize)
+{
+	if(SampleID == -1 || SampleID >= NUM_SAMPLES)
+		return -1;
+
+	CSoundStream *pStream = new CSoundStream;
+	if(!pStream->Load(pData, DataSize, &m_StreamActivity))
+	{
+		delete pStream;
+		return -1;
+	}
+
+	CSample *pSample = &m_aSamples[SampleID];
+	pSample->m_pData = 0;
+	pSample->m_IsADPCM = false;
+	pSample->m_Channels = pStream->Channels();
+	pSample->m_NumFrames = pStream->NumFrames();
+	pSample->m_Rate = CSoundStream::RATE;
+	pSample->m_LoopStart = -1;
+	pSample->m_LoopEnd = -1;
+	pSample->m_PausedAt = 0;
+
+	lock_wait(m_StreamLock);
+	pSample->m_pStream = pStream;
+	lock_unlock(m_StreamLock);
+	return SampleID;
+}
+
 int CSound::LoadOpus(const char *pFilename)
 {
 	// don't waste memory on sound when we are stress testing
@@ -302,7 +828,12 @@ int CSound::LoadOpus(const char *pFilename)
 	char *pData = new char[DataSize];
 	io_read(ms_File, pData, DataSize);
 
-	SampleID = DecodeOpus(SampleID, pData, DataSize);
+	if(UseStream(DataSize))
+		SampleID = LoadStream(SampleID, pData, DataSize);
+	else if(m_MixAll)
+		SampleID = DecodeOpus(SampleID, pData, DataSize);
+	else
+		SampleID = ConvertOpus(SampleID, pData, DataSize);
 
 	delete[] pData;
 	io_close(ms_File);
@@ -385,6 +916,13 @@ int CSound::LoadOpusFromMem(void *pData, unsigned DataSize, bool FromEditor = fa
 	if(SampleID < 0)
 		return -1;
 
+	if(m_SoundEnabled && UseStream(DataSize))
+		return LoadStream(SampleID, pData, DataSize);
+
+	// the editor and the mixer keep the samples as they are
+	if(m_SoundEnabled && !m_MixAll)
+		return ConvertOpus(SampleID, pData, DataSize);
+
 	SampleID = DecodeOpus(SampleID, pData, DataSize);
 
 	RateConvert(SampleID);
@@ -426,6 +964,15 @@ void CSound::UnloadSample(int SampleID)
 	_mem_free(m_aSamples[SampleID].m_pData);
 
 	m_aSamples[SampleID].m_pData = 0x0;
+
+	if(m_aSamples[SampleID].m_pStream)
+	{
+		// wait for the decoder thread to let go of it
+		lock_wait(m_StreamLock);
+		delete m_aSamples[SampleID].m_pStream;
+		m_aSamples[SampleID].m_pStream = 0;
+		lock_unlock(m_StreamLock);
+	}
 }
 
 float CSound::GetSampleDuration(int SampleID)
@@ -514,6 +1061,8 @@ void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float offset)
 				if( !(IsLooping && (min(m_aVoices[VoiceID].m_Tick, Tick) + m_aVoices[VoiceID].m_pSample->m_NumFrames - max(m_aVoices[VoiceID].m_Tick, Tick)) <= Threshold))
 				{
 					m_aVoices[VoiceID].m_Tick = Tick;
+					if(m_MixAll || m_aVoices[VoiceID].m_pSample->m_pStream)
+						m_pMixer->Seek(VoiceID, Tick);
 				}
 			}
 		}
@@ -556,14 +1105,27 @@ void CSound::SetChannel(int ChannelID, float Vol, float Pan)
 	m_aChannels[ChannelID].m_Pan = (int)(Pan*255.0f); // TODO: this is only on and off right now
 }
 
-ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags, float x, float y)
+ISound::CVoiceHandle CSound::PlayLocked(int ChannelID, int SampleID, int Flags, float x, float y, float Volume)
 {
+	if(!m_SoundEnabled || SampleID < 0 || SampleID >= NUM_SAMPLES)
+		return CreateVoiceHandle(-1, -1);
+
+	// the mixer plays pcm and streams, the SPU adpcm
+	CSample *pSample = &m_aSamples[SampleID];
+	if(pSample->m_pStream)
+	{
+		// a stream has one position, an earlier voice of it ends
+		for(int i = 0; i < NUM_VOICES; i++)
+			if(m_aVoices[i].m_pSample == pSample)
+				ReleaseVoice(&m_aVoices[i]);
+	}
+	else if(!pSample->m_pData || pSample->m_IsADPCM == m_MixAll)
+		return CreateVoiceHandle(-1, -1);
+
 	int VoiceID = -1;
 	int Age = -1;
 	int i;
 
-	lock_wait(m_SoundLock);
-
 	// search for voice
 	for(i = 0; i < NUM_VOICES; i++)
 	{
@@ -576,106 +1138,99 @@ ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags, float
 		}
 	}
 
-	// voice found, use it
-	/*
-	if(VoiceID != -1)
+	// all taken, reuse the least important one
+	if(VoiceID == -1)
 	{
-		m_aVoices[VoiceID].m_pSample = &m_aSamples[SampleID];
-		m_aVoices[VoiceID].m_pChannel = &m_aChannels[ChannelID];
-		if(Flags & FLAG_LOOP)
-			m_aVoices[VoiceID].m_Tick = m_aSamples[SampleID].m_PausedAt;
-		else
-			m_aVoices[VoiceID].m_Tick = 0;
-		m_aVoices[VoiceID].m_Vol = 255;
-		m_aVoices[VoiceID].m_Flags = Flags;
-		m_aVoices[VoiceID].m_X = (int)x;
-		m_aVoices[VoiceID].m_Y = (int)y;
-		m_aVoices[VoiceID].m_Falloff = 0.0f;
-		m_aVoices[VoiceID].m_Shape = ISound::SHAPE_CIRCLE;
-		m_aVoices[VoiceID].m_Circle.m_Radius = DefaultDistance;
-		Age = m_aVoices[VoiceID].m_Age;
-	}
-	*/
-
-	CChannel* pChannel = &m_aChannels[ChannelID];
-	CSample* pSample = &m_aSamples[SampleID];
-
-	int Rvol = (int)(pChannel->m_Vol*(255/255.0f));
-	int Lvol = (int)(pChannel->m_Vol*(255/255.0f));
-
-	// volume calculation
-	if(Flags&ISound::FLAG_POS && pChannel->m_Pan)
-	{
-		// TODO: we should respect the channel panning value
-		int dx = x - m_CenterX;
-		int dy = y - m_CenterY;
-		//
-		int p = IntAbs(dx);
-		float FalloffX = 0.0f;
-		float FalloffY = 0.0f;
-
-		int RangeX = 0; // for panning
-		bool InVoiceField = false;
-
-		// circle
+		int LowestPriority = 0;
+		for(i = 0; i < NUM_VOICES; i++)
 		{
-			float r = DefaultDistance;
-			RangeX = r;
-
-			int Dist = (int)sqrtf((float)dx*dx+dy*dy); // nasty float
-			if(Dist < r)
+			int Left, Right, Vol, Pan;
+			VoiceVolume(&m_aVoices[i], &Left, &Right);
+			AudsrvVolume(Left, Right, &Vol, &Pan);
+			int Priority = VoicePriority(&m_aVoices[i], Vol);
+			if(VoiceID == -1 || Priority < LowestPriority)
 			{
-				InVoiceField = true;
-
-				// falloff
-				int FalloffDistance = 0.0f; // r*v->m_Falloff
-				if(Dist > FalloffDistance)
-					FalloffX = FalloffY = (r-Dist)/(r-FalloffDistance);
-				else
-					FalloffX = FalloffY = 1.0f;
+				VoiceID = i;
+				LowestPriority = Priority;
 			}
-			else
-				InVoiceField = false;
 		}
+		ReleaseVoice(&m_aVoices[VoiceID]);
+		m_FrameStats.m_Stolen++;
+	}
 
-		if(InVoiceField)
+	// voice found, use it
+	CVoice *pVoice = &m_aVoices[VoiceID];
+	pVoice->m_pSample = pSample;
+	pVoice->m_pChannel = &m_aChannels[ChannelID];
+	if(Flags & FLAG_LOOP)
+		pVoice->m_Tick = m_aSamples[SampleID].m_PausedAt;
+	else
+		pVoice->m_Tick = 0;
+	pVoice->m_Time = time_get();
+	pVoice->m_Vol = (int)(clamp(Volume, 0.0f, 2.0f)*255.0f);
+	pVoice->m_Flags = Flags;
+	pVoice->m_X = (int)x;
+	pVoice->m_Y = (int)y;
+	pVoice->m_Falloff = 0.0f;
+	pVoice->m_Shape = ISound::SHAPE_CIRCLE;
+	pVoice->m_Circle.m_Radius = DefaultDistance;
+	pVoice->m_HwChannel = -1;
+	pVoice->m_New = true;
+	Age = pVoice->m_Age;
+
+	int Left, Right, Vol, Pan;
+	VoiceVolume(pVoice, &Left, &Right);
+	AudsrvVolume(Left, Right, &Vol, &Pan);
+	if(pSample->m_pStream)
+	{
+		if(!m_pMixer->PlayStream(VoiceID, pSample->m_pStream, pSample->m_Channels, pSample->m_Rate))
 		{
-			// panning
-			if(!(Flags&ISound::FLAG_NO_PANNING))
-			{
-				if(dx > 0)
-					Lvol = ((RangeX-p)*Lvol)/RangeX;
-				else
-					Rvol = ((RangeX-p)*Rvol)/RangeX;
-			}
-
-			{
-				Lvol *= FalloffX;
-				Rvol *= FalloffY;
-			}
+			ReleaseVoice(pVoice);
+			m_FrameStats.m_Dropped++;
+			return CreateVoiceHandle(-1, -1);
 		}
+		pSample->m_pStream->Start(pVoice->m_Tick, Flags&FLAG_LOOP);
+		m_pMixer->SetVolume(VoiceID, Left, Right);
+		m_FrameStats.m_Played++;
+	}
+	else if(m_MixAll)
+	{
+		// quiet voices stay in the mixer, they only move forward
+		m_pMixer->Play(VoiceID, pSample->m_pData, pSample->m_NumFrames, pSample->m_Channels, pSample->m_Rate, Flags&FLAG_LOOP, pVoice->m_Tick);
+		m_pMixer->SetVolume(VoiceID, Left, Right);
+		if(Vol >= AUDIBLE_VOLUME)
+			m_FrameStats.m_Played++;
 		else
-		{
-			Lvol = 0;
-			Rvol = 0;
-		}
+			m_FrameStats.m_Culled++;
 	}
-
-	if (Lvol || Rvol)
+	// sounds nobody hears don't go to the IOP
+	else if(Vol >= AUDIBLE_VOLUME)
 	{
-		int channel = audsrv_ch_play_adpcm(-1, (audsrv_adpcm_t*)pSample->m_pData);
-		if (channel >= 0)
-		{
-			int vol = (int)((Lvol+Rvol)/2 / 255.f * 100);
-			int pan = (int)((Rvol-Lvol) / 255.f * 100);
-			audsrv_adpcm_set_volume_and_pan(channel, vol, pan);
-		}
+		if(StartChannel(VoiceID, Vol, Pan))
+			pVoice->m_Tick = 0;
 	}
+	else
+		m_FrameStats.m_Culled++;
 
-	lock_unlock(m_SoundLock);
 	return CreateVoiceHandle(VoiceID, Age);
 }
 
+ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags, float x, float y)
+{
+	lock_wait(m_SoundLock);
+	CVoiceHandle Voice = PlayLocked(ChannelID, SampleID, Flags, x, y, 1.0f);
+	lock_unlock(m_SoundLock);
+	return Voice;
+}
+
+void CSound::PlayEvents(const CSoundEvent *pEvents, int Num)
+{
+	lock_wait(m_SoundLock);
+	for(int i = 0; i < Num; i++)
+		PlayLocked(pEvents[i].m_Channel, pEvents[i].m_SampleID, pEvents[i].m_Flags, pEvents[i].m_X, pEvents[i].m_Y, pEvents[i].m_Volume);
+	lock_unlock(m_SoundLock);
+}
+
 ISound::CVoiceHandle CSound::PlayAt(int ChannelID, int SampleID, int Flags, float x, float y)
 {
 	return Play(ChannelID, SampleID, Flags|ISound::FLAG_POS, x, y);
@@ -699,7 +1254,7 @@ void CSound::Stop(int SampleID)
 				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
 			else
 				m_aVoices[i].m_pSample->m_PausedAt = 0;
-			m_aVoices[i].m_pSample = 0;
+			ReleaseVoice(&m_aVoices[i]);
 		}
 	}
 	lock_unlock(m_SoundLock);
@@ -717,8 +1272,8 @@ void CSound::StopAll()
 				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
 			else
 				m_aVoices[i].m_pSample->m_PausedAt = 0;
+			ReleaseVoice(&m_aVoices[i]);
 		}
-		m_aVoices[i].m_pSample = 0;
 	}
 	lock_unlock(m_SoundLock);
 }
@@ -735,8 +1290,8 @@ void CSound::StopVoice(CVoiceHandle Voice)
 
 	lock_wait(m_SoundLock);
 	{
-		m_aVoices[VoiceID].m_pSample = 0;
-		m_aVoices[VoiceID].m_Age++;
+		if(m_aVoices[VoiceID].m_pSample)
+			ReleaseVoice(&m_aVoices[VoiceID]);
 	}
 	lock_unlock(m_SoundLock);
 }
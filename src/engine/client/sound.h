@@ -5,9 +5,12 @@
 
 #include <engine/sound.h>
 
+#include "sound_cache.h"
+
 class CSound : public IEngineSound
 {
 	int m_SoundEnabled;
+	CSoundCache m_Cache;
 
 public:
 	IEngineGraphics *m_pGraphics;
@@ -16,6 +19,7 @@ public:
 	virtual int Init();
 
 	int Update();
+	virtual const CSoundStats &SoundStats() const;
 	int Shutdown();
 	int AllocID();
 
@@ -25,6 +29,9 @@ public:
 	static IOHANDLE ms_File;
 	static int DecodeADPCM(int SampleID, void *pData, unsigned DataSize);
 	static int DecodeOpus(int SampleID, const void *pData, unsigned DataSize);
+	int ConvertOpus(int SampleID, const void *pData, unsigned DataSize);
+	bool UseStream(unsigned DataSize);
+	int LoadStream(int SampleID, const void *pData, unsigned DataSize);
 
 	virtual bool IsSoundEnabled() { return m_SoundEnabled != 0; }
 
@@ -47,9 +54,11 @@ public:
 	virtual void SetVoiceCircle(CVoiceHandle Voice, float Radius);
 	virtual void SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height);
 
+	CVoiceHandle PlayLocked(int ChannelID, int SampleID, int Flags, float x, float y, float Volume);
 	CVoiceHandle Play(int ChannelID, int SampleID, int Flags, float x, float y);
 	virtual CVoiceHandle PlayAt(int ChannelID, int SampleID, int Flags, float x, float y);
 	virtual CVoiceHandle Play(int ChannelID, int SampleID, int Flags);
+	virtual void PlayEvents(const CSoundEvent *pEvents, int Num);
 	virtual void Stop(int SampleID);
 	virtual void StopAll();
 	virtual void StopVoice(CVoiceHandle Voice);
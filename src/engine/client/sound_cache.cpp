@@ -0,0 +1,68 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/storage.h>
+#include <engine/shared/adpcm.h>
+
+#include "sound_cache.h"
+
+void CSoundCache::GetPath(unsigned SourceCrc, char *pBuffer, int BufferSize)
+{
+	// short enough for memory card file names
+	str_format(pBuffer, BufferSize, "gssnd/%08x.gsn", SourceCrc);
+}
+
+unsigned char *CSoundCache::Load(unsigned SourceCrc, int *pDataSize)
+{
+	char aPath[64];
+	GetPath(SourceCrc, aPath, sizeof(aPath));
+	IOHANDLE File = m_pStorage->OpenFile(aPath, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return 0;
+
+	CHeader Header;
+	if(io_read(File, &Header, sizeof(Header)) != sizeof(Header) ||
+		mem_comp(Header.m_aID, "GSND", 4) != 0 || Header.m_Version != VERSION ||
+		Header.m_SourceCrc != SourceCrc ||
+		Header.m_DataSize <= CAdpcmEncoder::HEADER_SIZE ||
+		(Header.m_DataSize-CAdpcmEncoder::HEADER_SIZE)%CAdpcmEncoder::BLOCK_SIZE != 0)
+	{
+		io_close(File);
+		return 0;
+	}
+
+	unsigned char *pData = (unsigned char *)mem_alloc(Header.m_DataSize, 1);
+	bool Valid = io_read(File, pData, Header.m_DataSize) == (unsigned)Header.m_DataSize;
+	io_close(File);
+
+	if(!Valid || mem_comp(pData, "APCM", 4) != 0)
+	{
+		// cut short, it gets written again
+		_mem_free(pData);
+		return 0;
+	}
+
+	*pDataSize = Header.m_DataSize;
+	return pData;
+}
+
+void CSoundCache::Save(unsigned SourceCrc, const unsigned char *pData, int DataSize)
+{
+	CHeader Header;
+	mem_zero(&Header, sizeof(Header));
+	mem_copy(Header.m_aID, "GSND", 4);
+	Header.m_Version = VERSION;
+	Header.m_SourceCrc = SourceCrc;
+	Header.m_DataSize = DataSize;
+
+	char aPath[64];
+	GetPath(SourceCrc, aPath, sizeof(aPath));
+	IOHANDLE File = m_pStorage->OpenFile(aPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+
+	io_write(File, &Header, sizeof(Header));
+	io_write(File, pData, DataSize);
+	io_close(File);
+}
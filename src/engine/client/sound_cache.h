@@ -0,0 +1,47 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_SOUND_CACHE_H
+#define ENGINE_CLIENT_SOUND_CACHE_H
+
+/*
+	Class: CSoundCache
+		Keeps opus samples converted to SPU2 ADPCM in the save storage so
+		a sample that was heard before does not have to be decoded and
+		encoded again.
+
+		Entries are found by the crc of the opus data. An entry holds the
+		APCM blob, header and loop flags included, exactly as it is
+		passed to audsrv_load_adpcm.
+*/
+class CSoundCache
+{
+	enum
+	{
+		VERSION = 1,
+	};
+
+	struct CHeader
+	{
+		char m_aID[4];
+		int m_Version;
+
+		// the key, compared again in case two of them share a file name
+		unsigned m_SourceCrc;
+
+		int m_DataSize;
+	};
+
+	class IStorage *m_pStorage;
+
+	static void GetPath(unsigned SourceCrc, char *pBuffer, int BufferSize);
+
+public:
+	CSoundCache() { m_pStorage = 0; }
+	void Init(class IStorage *pStorage) { m_pStorage = pStorage; }
+
+	// the blob is allocated with mem_alloc, 0 when there is no entry
+	unsigned char *Load(unsigned SourceCrc, int *pDataSize);
+	void Save(unsigned SourceCrc, const unsigned char *pData, int DataSize);
+};
+
+#endif
@@ -0,0 +1,53 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/sound.h>
+
+/*
+	Class: CSound_Null
+		Sound without audsrv, for the host build. Nothing is loaded or
+		played, every sample is invalid and every voice handle too.
+*/
+class CSound_Null : public IEngineSound
+{
+	CSoundStats m_Stats;
+
+public:
+	CSound_Null() { mem_zero(&m_Stats, sizeof(m_Stats)); }
+
+	virtual int Init() { return 0; }
+	virtual int Update() { return 0; }
+	virtual int Shutdown() { return 0; }
+
+	virtual bool IsSoundEnabled() { return false; }
+	virtual const CSoundStats &SoundStats() const { return m_Stats; }
+
+	virtual int LoadWV(const char *pFilename) { return -1; }
+	virtual int LoadOpus(const char *pFilename) { return -1; }
+	virtual int LoadWVFromMem(void *pData, unsigned DataSize, bool FromEditor) { return -1; }
+	virtual int LoadOpusFromMem(void *pData, unsigned DataSize, bool FromEditor) { return -1; }
+	virtual void UnloadSample(int SampleID) {}
+
+	virtual float GetSampleDuration(int SampleID) { return 0.0f; }
+
+	virtual void SetChannel(int ChannelID, float Volume, float Panning) {}
+	virtual void SetListenerPos(float x, float y) {}
+
+	virtual void SetVoiceVolume(CVoiceHandle Voice, float Volume) {}
+	virtual void SetVoiceFalloff(CVoiceHandle Voice, float Falloff) {}
+	virtual void SetVoiceLocation(CVoiceHandle Voice, float x, float y) {}
+	virtual void SetVoiceTimeOffset(CVoiceHandle Voice, float offset) {}
+
+	virtual void SetVoiceCircle(CVoiceHandle Voice, float Radius) {}
+	virtual void SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height) {}
+
+	virtual CVoiceHandle PlayAt(int ChannelID, int SampleID, int Flags, float x, float y) { return CVoiceHandle(); }
+	virtual CVoiceHandle Play(int ChannelID, int SampleID, int Flags) { return CVoiceHandle(); }
+	virtual void PlayEvents(const CSoundEvent *pEvents, int Num) {}
+	virtual void Stop(int SampleID) {}
+	virtual void StopAll() {}
+	virtual void StopVoice(CVoiceHandle Voice) {}
+};
+
+IEngineSound *CreateEngineSoundNull() { return new CSound_Null; }
@@ -0,0 +1,235 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "sound_stream.h"
+
+extern "C" {
+	#include <opusfile.h>
+}
+
+CSoundStream::CSoundStream()
+{
+	m_pData = 0;
+	m_pFile = 0;
+	m_Channels = 0;
+	m_NumFrames = 0;
+	m_pPreload = 0;
+	m_PreloadFrames = 0;
+	m_pBlock = 0;
+	m_DecodePos = 0;
+
+	m_Lock = lock_create();
+	m_pRing = 0;
+	m_ReadPos = 0;
+	m_WritePos = 0;
+	m_Position = 0;
+	m_SeekFrame = -1;
+	m_Generation = 0;
+	m_Loop = false;
+	m_Playing = false;
+	m_DecodeEnded = true;
+
+	m_pActivity = 0;
+}
+
+CSoundStream::~CSoundStream()
+{
+	if(m_pFile)
+		op_free(m_pFile);
+	_mem_free(m_pData);
+	_mem_free(m_pPreload);
+	_mem_free(m_pBlock);
+	_mem_free(m_pRing);
+	lock_destroy(m_Lock);
+}
+
+bool CSoundStream::Load(const void *pData, unsigned DataSize, semaphore *pActivity)
+{
+	m_pData = (unsigned char *)mem_alloc(DataSize, 1);
+	mem_copy(m_pData, pData, DataSize);
+
+	m_pFile = op_open_memory(m_pData, DataSize, NULL);
+	if(!m_pFile)
+	{
+		dbg_msg("sound/stream", "failed to open opus stream");
+		return false;
+	}
+
+	m_Channels = op_channel_count(m_pFile, -1);
+	if(m_Channels < 1 || m_Channels > 2)
+	{
+		dbg_msg("sound/stream", "file is not mono or stereo.");
+		return false;
+	}
+	m_NumFrames = max((int)op_pcm_total(m_pFile, -1), 0);
+
+	m_pPreload = (short *)mem_alloc(BLOCK_FRAMES*m_Channels*sizeof(short), 1);
+	m_pBlock = (short *)mem_alloc(BLOCK_FRAMES*m_Channels*sizeof(short), 1);
+	m_pRing = (short *)mem_alloc(RING_FRAMES*m_Channels*sizeof(short), 1);
+	m_PreloadFrames = DecodeBlock(m_pPreload, BLOCK_FRAMES, false);
+
+	m_pActivity = pActivity;
+	return true;
+}
+
+int CSoundStream::DecodeBlock(short *pOut, int NumFrames, bool Loop)
+{
+	int Frames = 0;
+	bool Wrapped = false;
+	while(Frames < NumFrames)
+	{
+		int Read = op_read(m_pFile, pOut + Frames*m_Channels, (NumFrames-Frames)*m_Channels, NULL);
+		if(Read > 0)
+		{
+			Frames += Read;
+			m_DecodePos += Read;
+			continue;
+		}
+
+		// the end, or something opus can't decode. wrap once, an empty
+		// or broken file would have the decoder spin otherwise
+		if(!Loop || Wrapped || op_pcm_seek(m_pFile, 0) != 0)
+			break;
+		Wrapped = true;
+		m_DecodePos = 0;
+	}
+	return Frames;
+}
+
+void CSoundStream::Restart(int Frame)
+{
+	m_Generation++;
+	m_ReadPos = 0;
+	m_WritePos = 0;
+	m_DecodeEnded = false;
+
+	if(m_Loop && m_NumFrames > 0)
+		Frame %= m_NumFrames;
+	Frame = clamp(Frame, 0, m_NumFrames);
+	m_Position = Frame;
+
+	// what the preload has doesn't wait for the decoder
+	if(Frame < m_PreloadFrames)
+	{
+		m_WritePos = m_PreloadFrames-Frame;
+		mem_copy(m_pRing, m_pPreload + Frame*m_Channels, m_WritePos*m_Channels*sizeof(short));
+		Frame = m_PreloadFrames;
+	}
+
+	if(Frame >= m_NumFrames)
+	{
+		if(m_Loop)
+			Frame = 0;
+		else
+			m_DecodeEnded = true;
+	}
+	m_SeekFrame = m_DecodeEnded ? -1 : Frame;
+}
+
+void CSoundStream::Start(int Frame, bool Loop)
+{
+	lock_wait(m_Lock);
+	m_Loop = Loop;
+	m_Playing = true;
+	Restart(Frame);
+	lock_unlock(m_Lock);
+	m_pActivity->signal();
+}
+
+void CSoundStream::Stop()
+{
+	lock_wait(m_Lock);
+	m_Playing = false;
+	m_Generation++;
+	lock_unlock(m_Lock);
+}
+
+void CSoundStream::Seek(int Frame)
+{
+	lock_wait(m_Lock);
+	Restart(Frame);
+	lock_unlock(m_Lock);
+	m_pActivity->signal();
+}
+
+int CSoundStream::Position()
+{
+	lock_wait(m_Lock);
+	int Position = m_Position;
+	lock_unlock(m_Lock);
+	return Position;
+}
+
+bool CSoundStream::Ended() const
+{
+	lock_wait(m_Lock);
+	bool Ended = m_DecodeEnded && m_ReadPos == m_WritePos;
+	lock_unlock(m_Lock);
+	return Ended;
+}
+
+bool CSoundStream::Decode()
+{
+	lock_wait(m_Lock);
+	const int Generation = m_Generation;
+	const int SeekFrame = m_SeekFrame;
+	const bool Loop = m_Loop;
+	const bool Room = m_Playing && !m_DecodeEnded &&
+		(SeekFrame >= 0 || m_WritePos-m_ReadPos <= (unsigned)(RING_FRAMES-BLOCK_FRAMES));
+	if(Room)
+		m_SeekFrame = -1;
+	lock_unlock(m_Lock);
+
+	if(!Room)
+		return false;
+
+	// the slow part, without the lock so the mixer keeps reading
+	if(SeekFrame >= 0 && SeekFrame != m_DecodePos)
+	{
+		op_pcm_seek(m_pFile, SeekFrame);
+		m_DecodePos = SeekFrame;
+	}
+	int Frames = DecodeBlock(m_pBlock, BLOCK_FRAMES, Loop);
+
+	lock_wait(m_Lock);
+	if(Generation == m_Generation)
+	{
+		// in two parts when it wraps around the ring
+		int Start = m_WritePos%RING_FRAMES;
+		int First = min(Frames, RING_FRAMES-Start);
+		mem_copy(m_pRing + Start*m_Channels, m_pBlock, First*m_Channels*sizeof(short));
+		mem_copy(m_pRing, m_pBlock + First*m_Channels, (Frames-First)*m_Channels*sizeof(short));
+		m_WritePos += Frames;
+		if(Frames < BLOCK_FRAMES)
+			m_DecodeEnded = true;
+	}
+	lock_unlock(m_Lock);
+	return true;
+}
+
+int CSoundStream::Read(short *pOut, int NumFrames)
+{
+	lock_wait(m_Lock);
+	int Frames = min(NumFrames, (int)(m_WritePos-m_ReadPos));
+	int Start = m_ReadPos%RING_FRAMES;
+	int First = min(Frames, RING_FRAMES-Start);
+	mem_copy(pOut, m_pRing + Start*m_Channels, First*m_Channels*sizeof(short));
+	mem_copy(pOut + First*m_Channels, m_pRing, (Frames-First)*m_Channels*sizeof(short));
+	m_ReadPos += Frames;
+
+	m_Position += Frames;
+	if(m_Loop && m_NumFrames > 0)
+		m_Position %= m_NumFrames;
+	else
+		m_Position = min(m_Position, m_NumFrames);
+
+	// room for a block, have the decoder thread fill it
+	bool Wake = m_Playing && !m_DecodeEnded && m_WritePos-m_ReadPos <= (unsigned)(RING_FRAMES-BLOCK_FRAMES);
+	lock_unlock(m_Lock);
+
+	if(Wake)
+		m_pActivity->signal();
+	return Frames;
+}
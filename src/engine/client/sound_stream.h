@@ -0,0 +1,91 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_SOUND_STREAM_H
+#define ENGINE_CLIENT_SOUND_STREAM_H
+
+#include <base/system.h>
+#include <base/tl/threading.h>
+
+#include <engine/shared/mixer.h>
+
+struct OggOpusFile;
+
+/*
+	Class: CSoundStream
+		An opus sample that is decoded while it plays, for map sounds
+		and music too long to keep as PCM or ADPCM.
+
+		It keeps the opus data, the first block decoded so it starts
+		right away, and a ring of a few blocks the mixer reads from.
+		Decode is called by the decoder thread whenever the activity
+		semaphore is signalled, it fills the ring one block at a time
+		and never blocks the mixer for longer than a copy. Memory does
+		not depend on the length of the sound, only on its opus size.
+
+		Start and Seek throw away what is in the ring, blocks that were
+		being decoded at that moment are dropped by their generation.
+*/
+class CSoundStream : public CMixer::IStream
+{
+public:
+	enum
+	{
+		RATE = 48000, // opus always decodes to this
+		BLOCK_FRAMES = 4096,
+		RING_FRAMES = BLOCK_FRAMES*4,
+	};
+
+private:
+	// a copy, the map the data came from gets unloaded
+	unsigned char *m_pData;
+	OggOpusFile *m_pFile; // only touched by Decode once loaded
+	int m_Channels;
+	int m_NumFrames;
+
+	short *m_pPreload;
+	int m_PreloadFrames;
+	short *m_pBlock;
+	int m_DecodePos; // frame the decoder is at
+
+	// everything below is guarded by m_Lock
+	LOCK m_Lock;
+	short *m_pRing;
+	unsigned m_ReadPos; // frames read and written since the last start
+	unsigned m_WritePos;
+	int m_Position; // frame the next read returns
+	int m_SeekFrame; // where the decoder has to go, -1 when it is right
+	int m_Generation;
+	bool m_Loop;
+	bool m_Playing;
+	bool m_DecodeEnded;
+
+	semaphore *m_pActivity;
+
+	void Restart(int Frame);
+	// the next frames of the sound, looped when wanted, fewer at the end
+	int DecodeBlock(short *pOut, int NumFrames, bool Loop);
+
+public:
+	CSoundStream();
+	virtual ~CSoundStream();
+
+	// opens the data and decodes the first block, false when it isn't opus
+	bool Load(const void *pData, unsigned DataSize, semaphore *pActivity);
+
+	int Channels() const { return m_Channels; }
+	int NumFrames() const { return m_NumFrames; }
+	int Position();
+
+	void Start(int Frame, bool Loop);
+	void Stop();
+
+	// decodes a block when the ring has room, true when it did
+	bool Decode();
+
+	// CMixer::IStream, called by the mixer
+	virtual int Read(short *pOut, int NumFrames);
+	virtual void Seek(int Frame);
+	virtual bool Ended() const;
+};
+
+#endif
@@ -9,6 +9,7 @@
 #include <engine/client.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
+#include <engine/shared/config.h>
 
 #ifdef CONF_FAMILY_WINDOWS
 	#include <windows.h>
@@ -39,7 +40,7 @@ class BMFont
 		uint8_t outline;
 		char* fontName;
 	} info;
-	static_assert(sizeof(InfoBlock) == 18, "InfoBlock size is not 18");
+	static_assert(sizeof(InfoBlock) == 14 + sizeof(char*), "InfoBlock size is not 14 and a pointer");
 
 	struct CommonBlock
 	{
@@ -81,9 +82,23 @@ class BMFont
 	static_assert(sizeof(KerningPairsBlock) == 10, "KerningPairsBlock size is not 10");
 #pragma pack(pop)
 
+	// a kerning pair is stored as ((first<<8)|second)+1, 0 marks a free slot
+	struct CKerning
+	{
+		int m_Pair;
+		int m_Amount;
+	};
+
 	std::unordered_map<int, char*> pages;
-	std::unordered_map<uint8_t, CharBlock> chars;
-	std::vector<KerningPairsBlock> kernings;
+
+	// text is looked up one byte at a time, so only the first 256 glyphs
+	// can ever be drawn
+	CharBlock m_aChars[256];
+	bool m_aCharValid[256];
+
+	// open addressing, the size is a power of two and at most half full
+	std::vector<CKerning> m_aKernings;
+	unsigned m_KerningMask;
 	int m_TextureID;
 	int m_Width;
 	int m_Height;
@@ -92,6 +107,36 @@ class BMFont
 	IStorage *m_pStorage;
 	IGraphics *Graphics() { return m_pGraphics; }
 
+	static unsigned KerningSlot(int Pair)
+	{
+		unsigned Hash = Pair*2654435761u;
+		return Hash^(Hash>>16);
+	}
+
+	void BuildKernings(const std::vector<KerningPairsBlock> &Pairs)
+	{
+		unsigned Size = 8;
+		while(Size < Pairs.size()*2)
+			Size <<= 1;
+
+		CKerning Free = {0, 0};
+		m_aKernings.assign(Size, Free);
+		m_KerningMask = Size-1;
+
+		for(unsigned i = 0; i < Pairs.size(); i++)
+		{
+			if(Pairs[i].first >= 256 || Pairs[i].second >= 256)
+				continue;
+
+			int Pair = ((Pairs[i].first<<8)|Pairs[i].second)+1;
+			unsigned Slot = KerningSlot(Pair)&m_KerningMask;
+			while(m_aKernings[Slot].m_Pair && m_aKernings[Slot].m_Pair != Pair)
+				Slot = (Slot+1)&m_KerningMask;
+			m_aKernings[Slot].m_Pair = Pair;
+			m_aKernings[Slot].m_Amount = Pairs[i].amount;
+		}
+	}
+
 	bool LoadPng(const std::string& png)
 	{
 		dbg_msg("bmfont", "Loading texture...");
@@ -119,13 +164,28 @@ class BMFont
 
 public:
 	std::unordered_map<int, char*>& Pages() {return pages;}
-	std::unordered_map<uint8_t, CharBlock>& Chars() {return chars;}
-	std::vector<KerningPairsBlock>& Kernings() {return kernings;}
+	const CharBlock *Char(uint8_t c) const { return m_aCharValid[c] ? &m_aChars[c] : 0; }
 	const int Texture() const {return m_TextureID;}
 
+	int Kerning(uint8_t First, uint8_t Second) const
+	{
+		if(m_aKernings.empty())
+			return 0;
+
+		int Pair = ((First<<8)|Second)+1;
+		for(unsigned Slot = KerningSlot(Pair)&m_KerningMask; m_aKernings[Slot].m_Pair; Slot = (Slot+1)&m_KerningMask)
+		{
+			if(m_aKernings[Slot].m_Pair == Pair)
+				return m_aKernings[Slot].m_Amount;
+		}
+		return 0;
+	}
+
 	BMFont(IGraphics* Graphics, IStorage* Storage) : m_pGraphics(Graphics), m_pStorage(Storage)
 	{
 		info.fontName = 0;
+		mem_zero(m_aCharValid, sizeof(m_aCharValid));
+		m_KerningMask = 0;
 	}
 
 	~BMFont()
@@ -258,7 +318,11 @@ public:
 		{
 			BMFont::CharBlock block;
 			io_read(f, &block, sizeof(BMFont::CharBlock));
-			chars[block.id] = block;
+			if(block.id < 256)
+			{
+				m_aChars[block.id] = block;
+				m_aCharValid[block.id] = true;
+			}
 		}
 
 		// Block 5 (optional): Kernings
@@ -284,40 +348,96 @@ public:
 		}
 
 		int kernCount = blockSize / sizeof(BMFont::KerningPairsBlock);
+		std::vector<KerningPairsBlock> kernings(kernCount);
 		for (int i=0; i<kernCount; i++)
-		{
-			BMFont::KerningPairsBlock block;
-			io_read(f, &block, sizeof(BMFont::KerningPairsBlock));
-			kernings.push_back(block);
-		}
+			io_read(f, &kernings[i], sizeof(BMFont::KerningPairsBlock));
+		BuildKernings(kernings);
 
 		io_close(f);
 		return LoadPng(png);
 	}
 
-	void RenderChar(uint8_t c, float x, float y, float scale, float size, bool outline)
+	// the quad of a glyph drawn with its pen position at x, y
+	void GlyphQuad(const CharBlock *pChar, float x, float y, float scale, float size, IGraphics::CTexturedQuadItem *pQuad) const
 	{
-		if (!chars.count(c))
-			return;
-
-		Graphics()->QuadsSetSubset(
-			chars[c].x / (float)m_Width,
-			chars[c].y / (float)m_Height,
-			(chars[c].x + chars[c].width) / (float)m_Width,
-			(chars[c].y + chars[c].height) / (float)m_Height);
-
-		IGraphics::CQuadItem QuadItem(
-			x + (chars[c].xoffset*size*scale/10),
-			y + (chars[c].yoffset*size*scale/10),
-			chars[c].width*size*scale/10,
-			chars[c].height*size*scale/10);
-		Graphics()->QuadsDrawTL(&QuadItem, 1);
+		float u0 = pChar->x / (float)m_Width;
+		float v0 = pChar->y / (float)m_Height;
+		float u1 = (pChar->x + pChar->width) / (float)m_Width;
+		float v1 = (pChar->y + pChar->height) / (float)m_Height;
+
+		pQuad->m_X = x + (pChar->xoffset*size*scale/10);
+		pQuad->m_Y = y + (pChar->yoffset*size*scale/10);
+		pQuad->m_Width = pChar->width*size*scale/10;
+		pQuad->m_Height = pChar->height*size*scale/10;
+		pQuad->m_aU[0] = u0; pQuad->m_aU[1] = u1; pQuad->m_aU[2] = u1; pQuad->m_aU[3] = u0;
+		pQuad->m_aV[0] = v0; pQuad->m_aV[1] = v0; pQuad->m_aV[2] = v1; pQuad->m_aV[3] = v1;
 	}
 };
 
 
 class CTextRender : public IEngineTextRender
 {
+	enum
+	{
+		MAX_LAYOUTS = 256,
+		MAX_LAYOUT_QUADS = 4096,
+		MAX_LAYOUT_LENGTH = 128,
+		LAYOUT_HASH_SIZE = 512,
+		MAX_DRAW_QUADS = 64,
+	};
+
+	// the cursor snapped to screen pixels, see SnapCursor
+	struct CTextSnap
+	{
+		float m_FakeToScreenX;
+		float m_FakeToScreenY;
+		float m_CursorX;
+		float m_CursorY;
+		int m_ActualSize;
+		float m_Size;
+	};
+
+	// everything the layout of a string depends on besides its text.
+	// Only 4 byte fields so it can be compared with mem_comp
+	struct CLayoutKey
+	{
+		BMFont *m_pFont;
+		int m_ActualSize;
+		float m_FakeToScreenX;
+		float m_FakeToScreenY;
+		float m_StartOffset;
+		float m_LineWidth;
+		int m_MaxLines;
+		int m_Flags;
+		int m_LineCount;
+		int m_Length;
+	};
+
+	/*
+		Struct: CTextLayout
+			A laid out string. Its glyph quads are kept in m_aLayoutQuads,
+			first the outlines and then the glyphs, with positions relative
+			to the snapped cursor so the same entry draws the string
+			anywhere on the screen.
+	*/
+	struct CTextLayout
+	{
+		CLayoutKey m_Key;
+		unsigned m_Hash;
+		char m_aText[MAX_LAYOUT_LENGTH];
+		int m_Next;
+
+		int m_FirstQuad;
+		int m_NumGlyphs;
+
+		// the cursor after the text, relative like the quads
+		float m_EndX;
+		float m_EndY;
+		int m_EndLineCount;
+		int m_CharCount;
+		bool m_GotNewLine;
+	};
+
 	IGraphics *m_pGraphics;
 	IStorage *m_pStorage;
 	IGraphics *Graphics() { return m_pGraphics; }
@@ -348,6 +468,272 @@ class CTextRender : public IEngineTextRender
 
 	BMFont *m_pDefaultFont;
 
+	// layout cache, entries and quads are handed out in order and all
+	// of them are dropped once either runs out
+	CTextLayout m_aLayouts[MAX_LAYOUTS];
+	int m_aLayoutHash[LAYOUT_HASH_SIZE];
+	int m_NumLayouts;
+	IGraphics::CTexturedQuadItem m_aLayoutQuads[MAX_LAYOUT_QUADS];
+	int m_NumLayoutQuads;
+
+	std::vector<IGraphics::CTexturedQuadItem> m_aOutlineQuads;
+	std::vector<IGraphics::CTexturedQuadItem> m_aGlyphQuads;
+	IGraphics::CTexturedQuadItem m_aDrawQuads[MAX_DRAW_QUADS];
+
+	void ClearLayouts()
+	{
+		for(int i = 0; i < LAYOUT_HASH_SIZE; i++)
+			m_aLayoutHash[i] = -1;
+		m_NumLayouts = 0;
+		m_NumLayoutQuads = 0;
+	}
+
+	// to correct coords, convert to screen coords, round, and convert back
+	void SnapCursor(const CTextCursor *pCursor, CTextSnap *pSnap)
+	{
+		float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+		Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
+		pSnap->m_FakeToScreenX = (Graphics()->ScreenWidth()/(ScreenX1-ScreenX0));
+		pSnap->m_FakeToScreenY = (Graphics()->ScreenHeight()/(ScreenY1-ScreenY0));
+		pSnap->m_CursorX = (int)(pCursor->m_X * pSnap->m_FakeToScreenX) / pSnap->m_FakeToScreenX;
+		pSnap->m_CursorY = (int)(pCursor->m_Y * pSnap->m_FakeToScreenY) / pSnap->m_FakeToScreenY;
+
+		// same with size
+		pSnap->m_ActualSize = (int)(pCursor->m_FontSize * pSnap->m_FakeToScreenY);
+		pSnap->m_Size = pSnap->m_ActualSize / pSnap->m_FakeToScreenY;
+	}
+
+	void MeasureText(CTextCursor *pCursor, const char *pText, int Length)
+	{
+		CTextSnap Snap;
+		SnapCursor(pCursor, &Snap);
+		LayoutText(pCursor, pText, Length, &Snap, 0, 0);
+	}
+
+	// Moves the cursor over the text and, when pOutlines is set, adds the
+	// glyph quads relative to the snapped cursor. The start of the line is
+	// taken relative to the snapped cursor as well, that way the result
+	// only depends on what is in CLayoutKey and not on the position.
+	// Returns whether a line was wrapped.
+	bool LayoutText(CTextCursor *pCursor, const char *pText, int Length, const CTextSnap *pSnap,
+		std::vector<IGraphics::CTexturedQuadItem> *pOutlines, std::vector<IGraphics::CTexturedQuadItem> *pGlyphs)
+	{
+		//BMFont *pFont = pCursor->m_pFont;
+		BMFont *pFont = m_pDefaultFont;
+
+		const float FakeToScreenX = pSnap->m_FakeToScreenX;
+		const float FakeToScreenY = pSnap->m_FakeToScreenY;
+		const float Size = pSnap->m_Size;
+		const float StartX = pSnap->m_CursorX - (pCursor->m_X - pCursor->m_StartX);
+
+		int GotNewLine = 0;
+		float DrawX = pSnap->m_CursorX;
+		float DrawY = pSnap->m_CursorY;
+		int LineCount = pCursor->m_LineCount;
+		int Previous = -1;
+
+		//float Scale = 1/pSizeData->m_FontSize;
+		float DefaultScale = 0.75f;
+		float OutlineScale = DefaultScale*1.3f;
+		float OutlineOffset = DefaultScale*Size/4.f;
+
+		const char *pCurrent = pText;
+		const char *pEnd = pCurrent+Length;
+
+		while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
+		{
+			int NewLine = 0;
+			const char *pBatchEnd = pEnd;
+			if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
+			{
+				int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
+				CTextCursor Compare = *pCursor;
+				Compare.m_StartX = StartX;
+				Compare.m_X = DrawX;
+				Compare.m_Y = DrawY;
+				Compare.m_Flags &= ~TEXTFLAG_RENDER;
+				Compare.m_LineWidth = -1;
+				MeasureText(&Compare, pCurrent, Wlen);
+
+				if(Compare.m_X-DrawX > pCursor->m_LineWidth)
+				{
+					// word can't be fitted in one line, cut it
+					CTextCursor Cutter = *pCursor;
+					Cutter.m_CharCount = 0;
+					Cutter.m_StartX = StartX;
+					Cutter.m_X = DrawX;
+					Cutter.m_Y = DrawY;
+					Cutter.m_Flags &= ~TEXTFLAG_RENDER;
+					Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
+
+					MeasureText(&Cutter, (const char *)pCurrent, Wlen);
+					Wlen = Cutter.m_CharCount;
+					NewLine = 1;
+
+					if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
+						Wlen = 0;
+				}
+				else if(Compare.m_X-StartX > pCursor->m_LineWidth)
+				{
+					NewLine = 1;
+					Wlen = 0;
+				}
+
+				pBatchEnd = pCurrent + Wlen;
+			}
+
+			const char *pTmp = pCurrent;
+			int NextCharacter = str_utf8_decode(&pTmp);
+			while(pCurrent < pBatchEnd)
+			{
+				uint8_t Character = (uint8_t)NextCharacter;
+				pCurrent = pTmp;
+				NextCharacter = str_utf8_decode(&pTmp);
+
+				if(Character == '\n')
+				{
+					DrawX = StartX;
+					DrawY += Size;
+					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+					Previous = -1;
+					++LineCount;
+					if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
+						break;
+					continue;
+				}
+
+				const auto *pChar = pFont->Char(Character);
+				if(!pChar)
+					continue;
+
+				if(Previous >= 0)
+					DrawX += pFont->Kerning(Previous, Character) * DefaultScale / 10.f * Size;
+				Previous = Character;
+
+				float Advance = pChar->xadvance * DefaultScale / 10.f;
+				if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-StartX > pCursor->m_LineWidth)
+				{
+					// we hit the end of the line, no more to render or count
+					pCurrent = pEnd;
+					break;
+				}
+
+				if(pOutlines)
+				{
+					IGraphics::CTexturedQuadItem Quad;
+					float x = DrawX-pSnap->m_CursorX;
+					float y = DrawY-pSnap->m_CursorY;
+					pFont->GlyphQuad(pChar, x-OutlineOffset, y-OutlineOffset, OutlineScale, Size, &Quad);
+					pOutlines->push_back(Quad);
+					pFont->GlyphQuad(pChar, x, y, DefaultScale, Size, &Quad);
+					pGlyphs->push_back(Quad);
+				}
+
+				DrawX += Advance*Size;
+				pCursor->m_CharCount++;
+			}
+
+			if(NewLine)
+			{
+				DrawX = StartX;
+				DrawY += Size;
+				GotNewLine = 1;
+				DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+				DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+				Previous = -1;
+				++LineCount;
+			}
+		}
+
+		pCursor->m_X = DrawX;
+		pCursor->m_LineCount = LineCount;
+
+		if(GotNewLine)
+			pCursor->m_Y = DrawY;
+		return GotNewLine;
+	}
+
+	const CTextLayout *FindLayout(const CLayoutKey *pKey, unsigned Hash, const char *pText)
+	{
+		for(int i = m_aLayoutHash[Hash%LAYOUT_HASH_SIZE]; i >= 0; i = m_aLayouts[i].m_Next)
+		{
+			const CTextLayout *pLayout = &m_aLayouts[i];
+			if(pLayout->m_Hash == Hash && mem_comp(&pLayout->m_Key, pKey, sizeof(*pKey)) == 0 &&
+				mem_comp(pLayout->m_aText, pText, pKey->m_Length) == 0)
+				return pLayout;
+		}
+		return 0;
+	}
+
+	const CTextLayout *AddLayout(const CTextCursor *pCursor, const CLayoutKey *pKey, unsigned Hash, const char *pText, const CTextSnap *pSnap)
+	{
+		CTextCursor Cursor = *pCursor;
+		Cursor.m_CharCount = 0;
+		m_aOutlineQuads.clear();
+		m_aGlyphQuads.clear();
+		bool GotNewLine = LayoutText(&Cursor, pText, pKey->m_Length, pSnap, &m_aOutlineQuads, &m_aGlyphQuads);
+
+		int NumGlyphs = m_aGlyphQuads.size();
+		if(m_NumLayouts == MAX_LAYOUTS || m_NumLayoutQuads + NumGlyphs*2 > MAX_LAYOUT_QUADS)
+			ClearLayouts();
+
+		CTextLayout *pLayout = &m_aLayouts[m_NumLayouts];
+		pLayout->m_Key = *pKey;
+		pLayout->m_Hash = Hash;
+		mem_copy(pLayout->m_aText, pText, pKey->m_Length);
+		pLayout->m_Next = m_aLayoutHash[Hash%LAYOUT_HASH_SIZE];
+		m_aLayoutHash[Hash%LAYOUT_HASH_SIZE] = m_NumLayouts++;
+
+		pLayout->m_FirstQuad = m_NumLayoutQuads;
+		pLayout->m_NumGlyphs = NumGlyphs;
+		if(NumGlyphs)
+		{
+			mem_copy(&m_aLayoutQuads[m_NumLayoutQuads], &m_aOutlineQuads[0], NumGlyphs*sizeof(IGraphics::CTexturedQuadItem));
+			mem_copy(&m_aLayoutQuads[m_NumLayoutQuads+NumGlyphs], &m_aGlyphQuads[0], NumGlyphs*sizeof(IGraphics::CTexturedQuadItem));
+		}
+		m_NumLayoutQuads += NumGlyphs*2;
+
+		pLayout->m_EndX = Cursor.m_X - pSnap->m_CursorX;
+		pLayout->m_EndY = Cursor.m_Y - pSnap->m_CursorY;
+		pLayout->m_EndLineCount = Cursor.m_LineCount;
+		pLayout->m_CharCount = Cursor.m_CharCount;
+		pLayout->m_GotNewLine = GotNewLine;
+		return pLayout;
+	}
+
+	void DrawQuads(const IGraphics::CTexturedQuadItem *pQuads, int Num, float OffsetX, float OffsetY)
+	{
+		while(Num > 0)
+		{
+			int Count = min(Num, (int)MAX_DRAW_QUADS);
+			for(int i = 0; i < Count; i++)
+			{
+				m_aDrawQuads[i] = pQuads[i];
+				m_aDrawQuads[i].m_X += OffsetX;
+				m_aDrawQuads[i].m_Y += OffsetY;
+			}
+			Graphics()->QuadsDrawTexturedTL(m_aDrawQuads, Count);
+			pQuads += Count;
+			Num -= Count;
+		}
+	}
+
+	void RenderGlyphs(BMFont *pFont, const IGraphics::CTexturedQuadItem *pOutlines, const IGraphics::CTexturedQuadItem *pGlyphs, int Num, const CTextSnap *pSnap)
+	{
+		if(!Num)
+			return;
+
+		Graphics()->TextureSet(pFont->Texture());
+		Graphics()->QuadsBegin();
+		Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
+		DrawQuads(pOutlines, Num, pSnap->m_CursorX, pSnap->m_CursorY);
+		Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
+		DrawQuads(pGlyphs, Num, pSnap->m_CursorX, pSnap->m_CursorY);
+		Graphics()->QuadsEnd();
+	}
+
 public:
 	CTextRender()
 	{
@@ -363,6 +749,8 @@ public:
 		m_TextOutlineA = 0.3f;
 
 		m_pDefaultFont = 0;
+
+		ClearLayouts();
 	}
 
 	virtual void Init()
@@ -386,6 +774,8 @@ public:
 
 	virtual void DestroyFont(BMFont *pFont)
 	{
+		// a new font could get the same address
+		ClearLayouts();
 		delete pFont;
 	}
 
@@ -458,178 +848,57 @@ public:
 
 		//dbg_msg("textrender", "rendering text '%s'", text);
 
-		float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
-		float FakeToScreenX, FakeToScreenY;
-		int ActualX, ActualY;
-
-		int ActualSize;
-		int GotNewLine = 0;
-		float DrawX = 0.0f, DrawY = 0.0f;
-		int LineCount = 0;
-		float CursorX, CursorY;
-
-		float Size = pCursor->m_FontSize;
-
-		// to correct coords, convert to screen coords, round, and convert back
-		Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
-
-		FakeToScreenX = (Graphics()->ScreenWidth()/(ScreenX1-ScreenX0));
-		FakeToScreenY = (Graphics()->ScreenHeight()/(ScreenY1-ScreenY0));
-		ActualX = (int)(pCursor->m_X * FakeToScreenX);
-		ActualY = (int)(pCursor->m_Y * FakeToScreenY);
-
-		CursorX = ActualX / FakeToScreenX;
-		CursorY = ActualY / FakeToScreenY;
-
-		// same with size
-		ActualSize = (int)(Size * FakeToScreenY);
-		Size = ActualSize / FakeToScreenY;
-
-		//pSizeData = GetSize(pFont, ActualSize);
-		//RenderSetup(pFont, ActualSize);
-
-		//float Scale = 1/pSizeData->m_FontSize;
-		float DefaultScale = 0.75f;
-
 		// set length
 		if(Length < 0)
 			Length = str_length(pText);
 
-		// if we don't want to render, we can just skip the first outline pass
-		int i = 1;
-		if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			i = 0;
-
-		auto& chars = pFont->Chars();
+		CTextSnap Snap;
+		SnapCursor(pCursor, &Snap);
 
-		for(;i < 2; i++)
+		if(!g_Config.m_GfxTextCache || Length > MAX_LAYOUT_LENGTH)
 		{
-			const char *pCurrent = (char *)pText;
-			const char *pEnd = pCurrent+Length;
-			DrawX = CursorX;
-			DrawY = CursorY;
-			float Scale = DefaultScale;
-			LineCount = pCursor->m_LineCount;
-
-			if (i == 0)
-				Scale *= 1.3f;
-
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			{
-				Graphics()->TextureSet(pFont->Texture());
-				Graphics()->QuadsBegin();
-				if (i == 0)
-					Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
-				else
-					Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
-			}
-
-			while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
-			{
-				int NewLine = 0;
-				const char *pBatchEnd = pEnd;
-				if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
-				{
-					int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
-					CTextCursor Compare = *pCursor;
-					Compare.m_X = DrawX;
-					Compare.m_Y = DrawY;
-					Compare.m_Flags &= ~TEXTFLAG_RENDER;
-					Compare.m_LineWidth = -1;
-					TextEx(&Compare, pCurrent, Wlen);
-
-					if(Compare.m_X-DrawX > pCursor->m_LineWidth)
-					{
-						// word can't be fitted in one line, cut it
-						CTextCursor Cutter = *pCursor;
-						Cutter.m_CharCount = 0;
-						Cutter.m_X = DrawX;
-						Cutter.m_Y = DrawY;
-						Cutter.m_Flags &= ~TEXTFLAG_RENDER;
-						Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
-
-						TextEx(&Cutter, (const char *)pCurrent, Wlen);
-						Wlen = Cutter.m_CharCount;
-						NewLine = 1;
-
-						if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
-							Wlen = 0;
-					}
-					else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
-					{
-						NewLine = 1;
-						Wlen = 0;
-					}
-
-					pBatchEnd = pCurrent + Wlen;
-				}
-
-				const char *pTmp = pCurrent;
-				int NextCharacter = str_utf8_decode(&pTmp);
-				while(pCurrent < pBatchEnd)
-				{
-					uint8_t Character = (uint8_t)NextCharacter;
-					pCurrent = pTmp;
-					NextCharacter = str_utf8_decode(&pTmp);
-
-					if(Character == '\n')
-					{
-						DrawX = pCursor->m_StartX;
-						DrawY += Size;
-						DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-						DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-						++LineCount;
-						if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
-							break;
-						continue;
-					}
-
-					if (chars.count(Character))
-					{
-						float Advance = chars[Character].xadvance * DefaultScale / 10.f;
-						if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
-						{
-							// we hit the end of the line, no more to render or count
-							pCurrent = pEnd;
-							break;
-						}
-
-						if(pCursor->m_Flags&TEXTFLAG_RENDER)
-						{
-							float offsetX = (i==0) ? DefaultScale*Size/4.f : 0;
-							float offsetY = (i==0) ? DefaultScale*Size/4.f : 0;
-							DrawX -= offsetX;
-							DrawY -= offsetY;
-							pFont->RenderChar(Character, DrawX, DrawY, Scale, Size, i==0);
-							DrawX += offsetX;
-							DrawY += offsetY;
-						}
-
-						DrawX += Advance*Size;
-						pCursor->m_CharCount++;
-					}
-				}
+			bool Render = pCursor->m_Flags&TEXTFLAG_RENDER;
+			m_aOutlineQuads.clear();
+			m_aGlyphQuads.clear();
+			LayoutText(pCursor, pText, Length, &Snap, Render ? &m_aOutlineQuads : 0, Render ? &m_aGlyphQuads : 0);
+			if(Render && !m_aGlyphQuads.empty())
+				RenderGlyphs(pFont, &m_aOutlineQuads[0], &m_aGlyphQuads[0], m_aGlyphQuads.size(), &Snap);
+			return;
+		}
 
-				if(NewLine)
-				{
-					DrawX = pCursor->m_StartX;
-					DrawY += Size;
-					GotNewLine = 1;
-					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-					++LineCount;
-				}
-			}
+		// strings that are drawn every frame are laid out once
+		CLayoutKey Key;
+		mem_zero(&Key, sizeof(Key));
+		Key.m_pFont = pFont;
+		Key.m_ActualSize = Snap.m_ActualSize;
+		Key.m_FakeToScreenX = Snap.m_FakeToScreenX;
+		Key.m_FakeToScreenY = Snap.m_FakeToScreenY;
+		Key.m_StartOffset = pCursor->m_X - pCursor->m_StartX;
+		Key.m_LineWidth = pCursor->m_LineWidth;
+		Key.m_MaxLines = pCursor->m_MaxLines;
+		Key.m_Flags = pCursor->m_Flags&TEXTFLAG_STOP_AT_END;
+		Key.m_LineCount = pCursor->m_LineCount;
+		Key.m_Length = Length;
+
+		unsigned Hash = 5381;
+		for(int i = 0; i < Length; i++)
+			Hash = (Hash<<5) + Hash + (unsigned char)pText[i];
+
+		const CTextLayout *pLayout = FindLayout(&Key, Hash, pText);
+		if(!pLayout)
+			pLayout = AddLayout(pCursor, &Key, Hash, pText, &Snap);
 
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-				Graphics()->QuadsEnd();
+		if(pCursor->m_Flags&TEXTFLAG_RENDER)
+		{
+			const IGraphics::CTexturedQuadItem *pQuads = &m_aLayoutQuads[pLayout->m_FirstQuad];
+			RenderGlyphs(pFont, pQuads, pQuads + pLayout->m_NumGlyphs, pLayout->m_NumGlyphs, &Snap);
 		}
 
-		pCursor->m_X = DrawX;
-		pCursor->m_LineCount = LineCount;
-
-		if(GotNewLine)
-			pCursor->m_Y = DrawY;
+		pCursor->m_X = Snap.m_CursorX + pLayout->m_EndX;
+		pCursor->m_LineCount = pLayout->m_EndLineCount;
+		pCursor->m_CharCount += pLayout->m_CharCount;
+		if(pLayout->m_GotNewLine)
+			pCursor->m_Y = Snap.m_CursorY + pLayout->m_EndY;
 	}
 
 };
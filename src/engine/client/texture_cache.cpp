@@ -0,0 +1,371 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gsKit.h>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/config.h>
+#include <engine/graphics.h>
+#include <engine/storage.h>
+
+#include <zlib.h>
+
+#include "texture_cache.h"
+
+static const char s_aIndexPath[] = "gstex/index.dat";
+
+CTextureCache::CTextureCache()
+{
+	m_pStorage = 0;
+	m_Lock = lock_create();
+	m_NumEntries = 0;
+	m_TotalSize = 0;
+	m_UseCounter = 0;
+	m_NextTemp = 0;
+	m_IndexDirty = false;
+}
+
+CTextureCache::~CTextureCache()
+{
+	lock_destroy(m_Lock);
+}
+
+int CTextureCache::Settings(int StoreFormat, int Flags)
+{
+	return (g_Config.m_GfxTextureQuality ? 1 : 0) |
+		(g_Config.m_GfxTexturePalette ? 2 : 0) |
+		((Flags&IGraphics::TEXLOAD_NORESAMPLE) ? 4 : 0) |
+		((StoreFormat+1)&3)<<3;
+}
+
+int CTextureCache::PaletteError()
+{
+	// without palettes the error limit changes nothing
+	return g_Config.m_GfxTexturePalette ? g_Config.m_GfxTexturePaletteError : 0;
+}
+
+void CTextureCache::GetName(unsigned SourceKey, int Settings, char *pBuffer, int BufferSize)
+{
+	// short enough for memory card file names
+	str_format(pBuffer, BufferSize, "%08x%02x.gst", SourceKey, Settings);
+}
+
+CTextureCache::CEntry *CTextureCache::Find(const char *pName)
+{
+	for(int i = 0; i < m_NumEntries; i++)
+		if(str_comp(m_aEntries[i].m_aName, pName) == 0)
+			return &m_aEntries[i];
+	return 0;
+}
+
+void CTextureCache::AddEntry(const char *pName, int Size, int LastUse)
+{
+	if(m_NumEntries == MAX_ENTRIES)
+		return;
+	CEntry *pEntry = &m_aEntries[m_NumEntries++];
+	str_copy(pEntry->m_aName, pName, sizeof(pEntry->m_aName));
+	pEntry->m_Size = Size;
+	pEntry->m_LastUse = LastUse;
+	m_TotalSize += Size;
+	m_IndexDirty = true;
+}
+
+void CTextureCache::RemoveEntry(int Index)
+{
+	m_TotalSize -= m_aEntries[Index].m_Size;
+	m_aEntries[Index] = m_aEntries[--m_NumEntries];
+	m_IndexDirty = true;
+}
+
+void CTextureCache::Evict(int NewSize)
+{
+	// the least recently used go until an entry of NewSize fits
+	const int Limit = g_Config.m_GfxTextureCacheSize*1024;
+	while(m_NumEntries > 0 && (m_TotalSize + NewSize > Limit || (NewSize && m_NumEntries == MAX_ENTRIES)))
+	{
+		int Oldest = 0;
+		for(int i = 1; i < m_NumEntries; i++)
+			if(m_aEntries[i].m_LastUse < m_aEntries[Oldest].m_LastUse)
+				Oldest = i;
+
+		char aPath[64];
+		str_format(aPath, sizeof(aPath), "gstex/%s", m_aEntries[Oldest].m_aName);
+		m_pStorage->RemoveFile(aPath, IStorage::TYPE_SAVE);
+		RemoveEntry(Oldest);
+	}
+}
+
+int CTextureCache::ReadIndex(CEntry *pEntries)
+{
+	IOHANDLE File = m_pStorage->OpenFile(s_aIndexPath, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return 0;
+
+	CIndexHeader Header;
+	int Num = 0;
+	if(io_read(File, &Header, sizeof(Header)) == sizeof(Header) && mem_comp(Header.m_aID, "GSTI", 4) == 0 &&
+		Header.m_Version == INDEX_VERSION && Header.m_NumEntries >= 0 && Header.m_NumEntries <= MAX_ENTRIES &&
+		io_read(File, pEntries, Header.m_NumEntries*sizeof(CEntry)) == Header.m_NumEntries*sizeof(CEntry))
+		Num = Header.m_NumEntries;
+	io_close(File);
+
+	for(int i = 0; i < Num; i++)
+		pEntries[i].m_aName[sizeof(pEntries[i].m_aName)-1] = 0;
+	return Num;
+}
+
+void CTextureCache::WriteIndex()
+{
+	IOHANDLE File = m_pStorage->OpenFile(s_aIndexPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+
+	CIndexHeader Header;
+	mem_copy(Header.m_aID, "GSTI", 4);
+	Header.m_Version = INDEX_VERSION;
+	Header.m_NumEntries = m_NumEntries;
+	io_write(File, &Header, sizeof(Header));
+	io_write(File, m_aEntries, m_NumEntries*sizeof(CEntry));
+	io_close(File);
+	m_IndexDirty = false;
+}
+
+struct CListContext
+{
+	class CTextureCache *m_pThis;
+	const void *m_pKnown;
+	int m_NumKnown;
+};
+
+int CTextureCache::ListCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	CListContext *pContext = (CListContext *)pUser;
+	CTextureCache *pThis = pContext->m_pThis;
+	const CEntry *pKnown = (const CEntry *)pContext->m_pKnown;
+	int Length = str_length(pName);
+	if(IsDir || Length < 4 || Length >= (int)sizeof(pKnown->m_aName) || str_comp(pName+Length-4, ".gst") != 0)
+		return 0;
+
+	// the index has the size and last use of the entries it knows
+	for(int i = 0; i < pContext->m_NumKnown; i++)
+		if(str_comp(pKnown[i].m_aName, pName) == 0)
+		{
+			pThis->AddEntry(pName, pKnown[i].m_Size, pKnown[i].m_LastUse);
+			return 0;
+		}
+
+	// written after the index was, it goes first
+	char aPath[64];
+	str_format(aPath, sizeof(aPath), "gstex/%s", pName);
+	IOHANDLE File = pThis->m_pStorage->OpenFile(aPath, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(File)
+	{
+		pThis->AddEntry(pName, io_length(File), 0);
+		io_close(File);
+	}
+	return 0;
+}
+
+void CTextureCache::Init(IStorage *pStorage)
+{
+	// a video restart comes through here again
+	Shutdown();
+	m_pStorage = pStorage;
+	if(!g_Config.m_GfxTextureCache)
+		return;
+
+	lock_wait(m_Lock);
+	m_NumEntries = 0;
+	m_TotalSize = 0;
+
+	// only what is in the folder counts
+	CEntry *pKnown = (CEntry *)mem_alloc(MAX_ENTRIES*sizeof(CEntry), 1);
+	CListContext Context;
+	Context.m_pThis = this;
+	Context.m_pKnown = pKnown;
+	Context.m_NumKnown = ReadIndex(pKnown);
+	m_pStorage->ListDirectory(IStorage::TYPE_SAVE, "gstex", ListCallback, &Context);
+	_mem_free(pKnown);
+
+	m_UseCounter = 0;
+	for(int i = 0; i < m_NumEntries; i++)
+		m_UseCounter = max(m_UseCounter, m_aEntries[i].m_LastUse);
+
+	// left from saves that didn't finish
+	for(int i = 0; i < MAX_TEMP_FILES; i++)
+	{
+		char aTemp[64];
+		str_format(aTemp, sizeof(aTemp), "gstex/save%d.tmp", i);
+		m_pStorage->RemoveFile(aTemp, IStorage::TYPE_SAVE);
+	}
+
+	// a lower limit takes effect right away
+	Evict(0);
+	lock_unlock(m_Lock);
+}
+
+void CTextureCache::Shutdown()
+{
+	if(!m_pStorage)
+		return;
+
+	lock_wait(m_Lock);
+	if(m_IndexDirty)
+		WriteIndex();
+	lock_unlock(m_Lock);
+}
+
+bool CTextureCache::SourceKey(const char *pFilename, int StorageType, unsigned *pKey)
+{
+	char aCompleteFilename[512];
+	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
+	if(!File)
+		return false;
+
+	// the signature and IHDR, with the size and bit depth of the image
+	unsigned char aHead[64];
+	unsigned HeadSize = io_read(File, aHead, sizeof(aHead));
+	int Length = io_length(File);
+	io_close(File);
+	int64 Time = fs_getmtime(aCompleteFilename);
+
+	unsigned Key = crc32(0, (const Bytef *)pFilename, str_length(pFilename)); // ignore_convention
+	Key = crc32(Key, (const Bytef *)&Length, sizeof(Length)); // ignore_convention
+	Key = crc32(Key, (const Bytef *)&Time, sizeof(Time)); // ignore_convention
+	*pKey = crc32(Key, aHead, HeadSize); // ignore_convention
+	return true;
+}
+
+GSTEXTURE *CTextureCache::Load(unsigned SourceKey, int StoreFormat, int Flags, int *pMemSize)
+{
+	char aName[16];
+	char aPath[64];
+	int Settings = CTextureCache::Settings(StoreFormat, Flags);
+	GetName(SourceKey, Settings, aName, sizeof(aName));
+	str_format(aPath, sizeof(aPath), "gstex/%s", aName);
+	IOHANDLE File = m_pStorage->OpenFile(aPath, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return 0;
+
+	CHeader Header;
+	if(io_read(File, &Header, sizeof(Header)) != sizeof(Header) ||
+		mem_comp(Header.m_aID, "GSTX", 4) != 0 || Header.m_Version != VERSION ||
+		Header.m_SourceKey != SourceKey || Header.m_Settings != Settings ||
+		Header.m_PaletteError != PaletteError() ||
+		Header.m_Width <= 0 || Header.m_Height <= 0 ||
+		Header.m_DataSize != (int)gsKit_texture_size_ee(Header.m_Width, Header.m_Height, Header.m_PSM) ||
+		Header.m_ClutSize < 0 || Header.m_ClutSize > 256*(int)sizeof(u32))
+	{
+		io_close(File);
+		return 0;
+	}
+
+	GSTEXTURE *pTex = (GSTEXTURE*)mem_alloc(sizeof(GSTEXTURE), 1);
+	mem_zero(pTex, sizeof(GSTEXTURE));
+	pTex->Width = Header.m_Width;
+	pTex->Height = Header.m_Height;
+	pTex->PSM = Header.m_PSM;
+	pTex->ClutPSM = Header.m_ClutPSM;
+	pTex->ClutStorageMode = Header.m_ClutStorageMode;
+	pTex->Filter = Header.m_Filter;
+	pTex->Mem = (u32*)mem_alloc(Header.m_DataSize, 1);
+	if(Header.m_ClutSize)
+		pTex->Clut = (u32*)mem_alloc(Header.m_ClutSize, 1);
+
+	bool Valid = io_read(File, pTex->Mem, Header.m_DataSize) == (unsigned)Header.m_DataSize;
+	if(Valid && Header.m_ClutSize)
+		Valid = io_read(File, pTex->Clut, Header.m_ClutSize) == (unsigned)Header.m_ClutSize;
+	io_close(File);
+
+	if(!Valid)
+	{
+		// cut short, it gets written again
+		_mem_free(pTex->Mem);
+		if(pTex->Clut)
+			_mem_free(pTex->Clut);
+		_mem_free(pTex);
+		return 0;
+	}
+
+	lock_wait(m_Lock);
+	CEntry *pEntry = Find(aName);
+	if(pEntry)
+	{
+		pEntry->m_LastUse = ++m_UseCounter;
+		m_IndexDirty = true;
+	}
+	lock_unlock(m_Lock);
+
+	*pMemSize = Header.m_MemSize;
+	return pTex;
+}
+
+void CTextureCache::Save(unsigned SourceKey, int StoreFormat, int Flags, const GSTEXTURE *pTex, int MemSize)
+{
+	CHeader Header;
+	mem_zero(&Header, sizeof(Header));
+	mem_copy(Header.m_aID, "GSTX", 4);
+	Header.m_Version = VERSION;
+	Header.m_SourceKey = SourceKey;
+	Header.m_Settings = Settings(StoreFormat, Flags);
+	Header.m_PaletteError = PaletteError();
+	Header.m_Width = pTex->Width;
+	Header.m_Height = pTex->Height;
+	Header.m_PSM = pTex->PSM;
+	Header.m_ClutPSM = pTex->ClutPSM;
+	Header.m_ClutStorageMode = pTex->ClutStorageMode;
+	Header.m_Filter = pTex->Filter;
+	Header.m_DataSize = gsKit_texture_size_ee(pTex->Width, pTex->Height, pTex->PSM);
+	if(pTex->Clut)
+		Header.m_ClutSize = (pTex->PSM == GS_PSM_T4 ? 16 : 256)*sizeof(u32);
+	Header.m_MemSize = MemSize;
+
+	const int Size = sizeof(Header) + Header.m_DataSize + Header.m_ClutSize;
+	if(Size > g_Config.m_GfxTextureCacheSize*1024)
+		return;
+
+	// written under a name of its own, a load never sees it half done
+	char aTemp[64];
+	lock_wait(m_Lock);
+	str_format(aTemp, sizeof(aTemp), "gstex/save%d.tmp", m_NextTemp);
+	m_NextTemp = (m_NextTemp+1)%MAX_TEMP_FILES;
+	lock_unlock(m_Lock);
+
+	IOHANDLE File = m_pStorage->OpenFile(aTemp, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+
+	bool Valid = io_write(File, &Header, sizeof(Header)) == sizeof(Header) &&
+		io_write(File, pTex->Mem, Header.m_DataSize) == (unsigned)Header.m_DataSize;
+	if(Valid && Header.m_ClutSize)
+		Valid = io_write(File, pTex->Clut, Header.m_ClutSize) == (unsigned)Header.m_ClutSize;
+	io_close(File);
+	if(!Valid)
+	{
+		// most likely the card is full
+		m_pStorage->RemoveFile(aTemp, IStorage::TYPE_SAVE);
+		return;
+	}
+
+	char aName[16];
+	char aPath[64];
+	GetName(SourceKey, Header.m_Settings, aName, sizeof(aName));
+	str_format(aPath, sizeof(aPath), "gstex/%s", aName);
+
+	lock_wait(m_Lock);
+	// the other thread may have saved the same texture meanwhile
+	CEntry *pOld = Find(aName);
+	if(pOld)
+		RemoveEntry(pOld - m_aEntries);
+	Evict(Size);
+
+	// not every file system renames over an existing file
+	m_pStorage->RemoveFile(aPath, IStorage::TYPE_SAVE);
+	if(m_pStorage->RenameFile(aTemp, aPath, IStorage::TYPE_SAVE))
+		AddEntry(aName, Size, ++m_UseCounter);
+	else
+		m_pStorage->RemoveFile(aTemp, IStorage::TYPE_SAVE);
+	WriteIndex();
+	lock_unlock(m_Lock);
+}
@@ -0,0 +1,115 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_TEXTURE_CACHE_H
+#define ENGINE_CLIENT_TEXTURE_CACHE_H
+
+#include <base/system.h>
+
+/*
+	Class: CTextureCache
+		Keeps converted textures in the save storage so a png that was
+		seen before does not have to be decoded, resampled and swizzled
+		again.
+
+		Entries are found by a key of the png file together with the
+		settings that change the conversion (texture quality, palettes,
+		store format and resample flag). An entry holds the GSTEXTURE
+		exactly as it is uploaded, pixels and palette included, and is
+		read straight into the texture's buffers.
+
+		The key is made from the name, size and modification time of the
+		png and its first bytes, so a hit doesn't read the png. A png that
+		is replaced by one of the same size within the same second, with
+		the same header, still finds the old entry.
+
+		The folder is kept under gfx_texture_cache_size. An index file
+		remembers when each entry was used last, the oldest go first.
+		Entries are written under a temporary name and renamed, so a load
+		on another thread never reads half a file.
+*/
+class CTextureCache
+{
+	enum
+	{
+		VERSION = 2,
+		INDEX_VERSION = 1,
+		MAX_ENTRIES = 512,
+		MAX_TEMP_FILES = 4, // saves that can run at once
+	};
+
+	struct CHeader
+	{
+		char m_aID[4];
+		int m_Version;
+
+		// the key, compared again in case two of them share a file name
+		unsigned m_SourceKey;
+		int m_Settings;
+		int m_PaletteError; // 0 when palettes are off
+
+		int m_Width;
+		int m_Height;
+		int m_PSM;
+		int m_ClutPSM;
+		int m_ClutStorageMode;
+		int m_Filter;
+		int m_DataSize;
+		int m_ClutSize;
+		int m_MemSize; // what the texture counts as in MemoryUsage
+	};
+
+	// a file in gstex/, the index holds these
+	struct CEntry
+	{
+		char m_aName[16];
+		int m_Size;
+		int m_LastUse;
+	};
+
+	struct CIndexHeader
+	{
+		char m_aID[4];
+		int m_Version;
+		int m_NumEntries;
+	};
+
+	class IStorage *m_pStorage;
+
+	// guards the entries, loads and saves run on the main thread and the job pool
+	LOCK m_Lock;
+	CEntry m_aEntries[MAX_ENTRIES];
+	int m_NumEntries;
+	int m_TotalSize;
+	int m_UseCounter;
+	int m_NextTemp;
+	bool m_IndexDirty;
+
+	static int Settings(int StoreFormat, int Flags);
+	static int PaletteError();
+	static void GetName(unsigned SourceKey, int Settings, char *pBuffer, int BufferSize);
+	static int ListCallback(const char *pName, int IsDir, int StorageType, void *pUser);
+
+	// the rest expect the lock to be held
+	CEntry *Find(const char *pName);
+	void AddEntry(const char *pName, int Size, int LastUse);
+	void RemoveEntry(int Index);
+	void Evict(int NewSize);
+	int ReadIndex(CEntry *pEntries);
+	void WriteIndex();
+
+public:
+	CTextureCache();
+	~CTextureCache();
+
+	void Init(class IStorage *pStorage);
+	// writes back when the entries were used
+	void Shutdown();
+
+	// reads the start of the png, false when it can't be opened
+	bool SourceKey(const char *pFilename, int StorageType, unsigned *pKey);
+
+	GSTEXTURE *Load(unsigned SourceKey, int StoreFormat, int Flags, int *pMemSize);
+	void Save(unsigned SourceKey, int StoreFormat, int Flags, const GSTEXTURE *pTex, int MemSize);
+};
+
+#endif
@@ -0,0 +1,174 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "texture_quantize.h"
+
+static inline int Channel(unsigned Color, int c) { return (Color >> (c*8)) & 0xff; }
+
+void CTextureQuantizer::MeasureBox(const unsigned *pColors, CBox *pBox)
+{
+	int aMin[4] = {255, 255, 255, 255};
+	int aMax[4] = {0, 0, 0, 0};
+	for(int i = pBox->m_First; i < pBox->m_First + pBox->m_Num; i++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			int v = Channel(pColors[i], c);
+			if(v < aMin[c]) aMin[c] = v;
+			if(v > aMax[c]) aMax[c] = v;
+		}
+	}
+
+	pBox->m_Channel = 0;
+	pBox->m_Range = -1;
+	for(int c = 0; c < 4; c++)
+	{
+		if(aMax[c] - aMin[c] > pBox->m_Range)
+		{
+			pBox->m_Channel = c;
+			pBox->m_Range = aMax[c] - aMin[c];
+		}
+	}
+}
+
+int CTextureQuantizer::ExactPalette(const unsigned *pPixels, int NumPixels, int MaxColors, CResult *pResult)
+{
+	// open addressing, big enough to stay sparse with MAX_COLORS entries
+	enum { HASH_SIZE = 1024 };
+	unsigned aKeys[HASH_SIZE];
+	bool aUsed[HASH_SIZE];
+	mem_zero(aUsed, sizeof(aUsed));
+
+	int Num = 0;
+	for(int i = 0; i < NumPixels; i++)
+	{
+		unsigned Color = pPixels[i];
+		unsigned Slot = (Color * 2654435761u) >> 22;
+		while(aUsed[Slot] && aKeys[Slot] != Color)
+			Slot = (Slot + 1) & (HASH_SIZE-1);
+		if(aUsed[Slot])
+			continue;
+
+		if(Num == MaxColors)
+			return -1;
+		aUsed[Slot] = true;
+		aKeys[Slot] = Color;
+		pResult->m_aPalette[Num++] = Color;
+	}
+	return Num;
+}
+
+void CTextureQuantizer::MedianCut(const unsigned *pPixels, int NumPixels, int MaxColors, CResult *pResult)
+{
+	unsigned *pColors = (unsigned *)mem_alloc(NumPixels*sizeof(unsigned), 1);
+	unsigned *pTemp = (unsigned *)mem_alloc(NumPixels*sizeof(unsigned), 1);
+	mem_copy(pColors, pPixels, NumPixels*sizeof(unsigned));
+
+	CBox aBoxes[MAX_COLORS];
+	int NumBoxes = 1;
+	aBoxes[0].m_First = 0;
+	aBoxes[0].m_Num = NumPixels;
+	MeasureBox(pColors, &aBoxes[0]);
+
+	while(NumBoxes < MaxColors)
+	{
+		// split the box with the widest channel
+		int Split = -1;
+		for(int b = 0; b < NumBoxes; b++)
+			if(aBoxes[b].m_Num > 1 && aBoxes[b].m_Range > 0 && (Split == -1 || aBoxes[b].m_Range > aBoxes[Split].m_Range))
+				Split = b;
+		if(Split == -1)
+			break;
+
+		// counting sort along that channel
+		CBox *pBox = &aBoxes[Split];
+		int c = pBox->m_Channel;
+		int aCount[257] = {0};
+		for(int i = pBox->m_First; i < pBox->m_First + pBox->m_Num; i++)
+			aCount[Channel(pColors[i], c) + 1]++;
+		for(int v = 0; v < 256; v++)
+			aCount[v+1] += aCount[v];
+		for(int i = pBox->m_First; i < pBox->m_First + pBox->m_Num; i++)
+			pTemp[pBox->m_First + aCount[Channel(pColors[i], c)]++] = pColors[i];
+		mem_copy(&pColors[pBox->m_First], &pTemp[pBox->m_First], pBox->m_Num*sizeof(unsigned));
+
+		CBox *pNew = &aBoxes[NumBoxes++];
+		int Half = pBox->m_Num/2;
+		pNew->m_First = pBox->m_First + Half;
+		pNew->m_Num = pBox->m_Num - Half;
+		pBox->m_Num = Half;
+		MeasureBox(pColors, pBox);
+		MeasureBox(pColors, pNew);
+	}
+
+	// every box is represented by its average
+	for(int b = 0; b < NumBoxes; b++)
+	{
+		unsigned aSum[4] = {0, 0, 0, 0};
+		for(int i = aBoxes[b].m_First; i < aBoxes[b].m_First + aBoxes[b].m_Num; i++)
+			for(int c = 0; c < 4; c++)
+				aSum[c] += Channel(pColors[i], c);
+
+		unsigned Color = 0;
+		for(int c = 0; c < 4; c++)
+			Color |= ((aSum[c] + aBoxes[b].m_Num/2) / aBoxes[b].m_Num) << (c*8);
+		pResult->m_aPalette[b] = Color;
+	}
+	pResult->m_NumColors = NumBoxes;
+
+	_mem_free(pTemp);
+	_mem_free(pColors);
+}
+
+int CTextureQuantizer::CountColors(const unsigned *pPixels, int NumPixels, int MaxColors)
+{
+	CResult Result;
+	return ExactPalette(pPixels, NumPixels, MaxColors, &Result);
+}
+
+bool CTextureQuantizer::Quantize(const unsigned *pPixels, int NumPixels, int MaxColors, float MaxError, unsigned char *pIndices, CResult *pResult)
+{
+	dbg_assert(MaxColors > 0 && MaxColors <= MAX_COLORS, "quantizer: invalid palette size");
+
+	pResult->m_NumColors = NumPixels ? ExactPalette(pPixels, NumPixels, MaxColors, pResult) : 0;
+	pResult->m_Error = 0.0f;
+	if(pResult->m_NumColors == -1)
+		MedianCut(pPixels, NumPixels, MaxColors, pResult);
+
+	// map every pixel to its nearest entry, remembering the last match since
+	// neighbouring pixels are usually the same color
+	double Error = 0.0;
+	unsigned LastColor = 0;
+	int LastIndex = -1;
+	int LastDist = 0;
+	for(int i = 0; i < NumPixels; i++)
+	{
+		unsigned Color = pPixels[i];
+		if(LastIndex == -1 || Color != LastColor)
+		{
+			LastDist = -1;
+			for(int p = 0; p < pResult->m_NumColors && LastDist != 0; p++)
+			{
+				int Dist = 0;
+				for(int c = 0; c < 4; c++)
+				{
+					int d = Channel(Color, c) - Channel(pResult->m_aPalette[p], c);
+					Dist += d*d;
+				}
+				if(LastDist == -1 || Dist < LastDist)
+				{
+					LastDist = Dist;
+					LastIndex = p;
+				}
+			}
+			LastColor = Color;
+		}
+		Error += LastDist;
+		pIndices[i] = LastIndex;
+	}
+
+	if(NumPixels)
+		pResult->m_Error = (float)(Error / (NumPixels*4.0));
+	return pResult->m_Error <= MaxError;
+}
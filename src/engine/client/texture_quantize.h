@@ -0,0 +1,55 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_TEXTURE_QUANTIZE_H
+#define ENGINE_CLIENT_TEXTURE_QUANTIZE_H
+
+/*
+	Class: CTextureQuantizer
+		Reduces 32 bit pixels (r in the lowest byte, a in the highest) to a
+		palette and one index per pixel.
+
+		Images with few enough distinct colors are converted without loss.
+		Everything else goes through a median cut over all four channels,
+		after which every pixel is mapped to its nearest palette entry.
+
+		Does not depend on the GS, palette layout for the hardware (CLUT
+		swizzling, 4 bit packing) is up to the caller.
+*/
+class CTextureQuantizer
+{
+public:
+	enum
+	{
+		MAX_COLORS = 256,
+	};
+
+	struct CResult
+	{
+		unsigned m_aPalette[MAX_COLORS];
+		int m_NumColors;
+		float m_Error; // mean squared error per channel
+	};
+
+private:
+	struct CBox
+	{
+		int m_First;
+		int m_Num;
+		int m_Channel; // channel with the widest range
+		int m_Range;
+	};
+
+	static void MeasureBox(const unsigned *pColors, CBox *pBox);
+	static int ExactPalette(const unsigned *pPixels, int NumPixels, int MaxColors, CResult *pResult);
+	static void MedianCut(const unsigned *pPixels, int NumPixels, int MaxColors, CResult *pResult);
+
+public:
+	// distinct colors in the image, -1 when there are more than MaxColors
+	static int CountColors(const unsigned *pPixels, int NumPixels, int MaxColors);
+
+	// returns false when the best palette with MaxColors entries is worse than MaxError,
+	// pIndices (NumPixels bytes) and pResult are filled in either case
+	static bool Quantize(const unsigned *pPixels, int NumPixels, int MaxColors, float MaxError, unsigned char *pIndices, CResult *pResult);
+};
+
+#endif
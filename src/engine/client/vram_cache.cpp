@@ -0,0 +1,167 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "vram_cache.h"
+
+CVramCache::CVramCache()
+{
+	Init(0, 0);
+}
+
+void CVramCache::Init(int FirstPage, int NumPages)
+{
+	dbg_assert(NumPages <= MAX_PAGES, "vram cache: too many pages");
+
+	m_FirstPage = FirstPage;
+	m_NumPages = NumPages;
+	m_Frame = 0;
+
+	for(int i = 0; i < MAX_ENTRIES; i++)
+	{
+		m_aEntries[i].m_Page = -1;
+		m_aEntries[i].m_NumPages = 0;
+		m_aEntries[i].m_Size = 0;
+		m_aEntries[i].m_LastUse = 0;
+		m_aEntries[i].m_Pinned = false;
+	}
+	for(int i = 0; i < MAX_PAGES; i++)
+		m_aPageOwner[i] = -1;
+
+	mem_zero(&m_Stats, sizeof(m_Stats));
+	mem_zero(&m_LastStats, sizeof(m_LastStats));
+}
+
+float CVramCache::EvictCost(int Entry) const
+{
+	// what it costs to upload it again, discounted by how long it has been unused
+	const CEntry *pEntry = &m_aEntries[Entry];
+	return pEntry->m_Size / (float)(1 + m_Frame - pEntry->m_LastUse);
+}
+
+int CVramCache::FindWindow(int NumPages) const
+{
+	int Best = -1;
+	float BestCost = 0.0f;
+
+	for(int Start = 0; Start + NumPages <= m_NumPages; Start++)
+	{
+		float Cost = 0.0f;
+		for(int p = Start; p < Start + NumPages; p++)
+		{
+			int Owner = m_aPageOwner[p];
+			if(Owner != -1 && m_aEntries[Owner].m_Pinned)
+			{
+				Cost = -1.0f;
+				break;
+			}
+			if(Owner != -1 && (p == Start || m_aPageOwner[p-1] != Owner))
+				Cost += EvictCost(Owner);
+		}
+		if(Cost < 0.0f)
+			continue;
+
+		if(Best == -1 || Cost < BestCost)
+		{
+			Best = Start;
+			BestCost = Cost;
+			if(Cost == 0.0f)
+				break;
+		}
+	}
+
+	return Best;
+}
+
+void CVramCache::Evict(int Entry)
+{
+	CEntry *pEntry = &m_aEntries[Entry];
+	if(pEntry->m_Page == -1)
+		return;
+
+	for(int p = 0; p < pEntry->m_NumPages; p++)
+		m_aPageOwner[pEntry->m_Page - m_FirstPage + p] = -1;
+	pEntry->m_Page = -1;
+}
+
+int CVramCache::Place(int Entry, int Size)
+{
+	CEntry *pEntry = &m_aEntries[Entry];
+	int NumPages = (Size + PAGE_SIZE - 1) / PAGE_SIZE;
+	int Start = FindWindow(NumPages);
+	if(Start == -1)
+		return -1;
+
+	// free the window
+	for(int p = Start; p < Start + NumPages; p++)
+	{
+		if(m_aPageOwner[p] != -1)
+		{
+			Evict(m_aPageOwner[p]);
+			m_Stats.m_Evictions++;
+		}
+	}
+
+	for(int p = Start; p < Start + NumPages; p++)
+		m_aPageOwner[p] = Entry;
+
+	pEntry->m_Page = m_FirstPage + Start;
+	pEntry->m_NumPages = NumPages;
+	pEntry->m_Size = Size;
+	return pEntry->m_Page;
+}
+
+int CVramCache::Use(int Entry, int Size, bool *pUpload)
+{
+	CEntry *pEntry = &m_aEntries[Entry];
+	pEntry->m_LastUse = m_Frame;
+	*pUpload = false;
+
+	if(pEntry->m_Page != -1)
+	{
+		m_Stats.m_Hits++;
+		return pEntry->m_Page;
+	}
+
+	if(Place(Entry, Size) == -1)
+		return -1;
+
+	m_Stats.m_Uploads++;
+	m_Stats.m_UploadBytes += Size;
+	*pUpload = true;
+	return pEntry->m_Page;
+}
+
+int CVramCache::Pin(int Entry, int Size)
+{
+	CEntry *pEntry = &m_aEntries[Entry];
+	pEntry->m_LastUse = m_Frame;
+	if(pEntry->m_Page == -1 && Place(Entry, Size) == -1)
+		return -1;
+
+	pEntry->m_Pinned = true;
+	return pEntry->m_Page;
+}
+
+void CVramCache::Remove(int Entry)
+{
+	Evict(Entry);
+	m_aEntries[Entry].m_Size = 0;
+	m_aEntries[Entry].m_Pinned = false;
+}
+
+void CVramCache::NextFrame()
+{
+	m_Frame++;
+	m_LastStats = m_Stats;
+	mem_zero(&m_Stats, sizeof(m_Stats));
+}
+
+int CVramCache::FreePages() const
+{
+	int Num = 0;
+	for(int p = 0; p < m_NumPages; p++)
+		if(m_aPageOwner[p] == -1)
+			Num++;
+	return Num;
+}
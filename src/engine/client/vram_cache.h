@@ -0,0 +1,82 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_CLIENT_VRAM_CACHE_H
+#define ENGINE_CLIENT_VRAM_CACHE_H
+
+/*
+	Class: CVramCache
+		Keeps track of which textures are resident in GS local memory.
+
+		Memory is handed out in whole GS pages. When a texture does not fit,
+		the window of pages that is cheapest to free is evicted. The cost of
+		a resident texture is its size scaled down by the number of frames
+		since it was last used, so old and small textures go first and large
+		textures that are still in use stay. Pinned entries, like render
+		targets, are never evicted.
+
+		The cache only does the bookkeeping, uploading is up to the caller.
+		It does not touch the hardware so it can run against any VRAM size.
+*/
+class CVramCache
+{
+public:
+	enum
+	{
+		PAGE_SIZE = 8192,
+		MAX_PAGES = 512, // 4 MB
+		MAX_ENTRIES = 1024*4,
+	};
+
+	struct CStats
+	{
+		int m_Hits;
+		int m_Uploads;
+		int m_UploadBytes;
+		int m_Evictions;
+	};
+
+private:
+	struct CEntry
+	{
+		int m_Page; // -1 when not resident
+		int m_NumPages;
+		int m_Size;
+		int m_LastUse;
+		bool m_Pinned;
+	};
+
+	CEntry m_aEntries[MAX_ENTRIES];
+	short m_aPageOwner[MAX_PAGES];
+	int m_FirstPage;
+	int m_NumPages;
+	int m_Frame;
+
+	CStats m_Stats;
+	CStats m_LastStats;
+
+	float EvictCost(int Entry) const;
+	int FindWindow(int NumPages) const;
+	void Evict(int Entry);
+	int Place(int Entry, int Size);
+
+public:
+	CVramCache();
+
+	// manage the pages [FirstPage, FirstPage+NumPages)
+	void Init(int FirstPage, int NumPages);
+
+	// makes the texture resident and returns its first page, -1 if it can never fit.
+	// *pUpload is set when the texture data has to be sent to the GS
+	int Use(int Entry, int Size, bool *pUpload);
+	// like Use, but the entry stays until it is removed
+	int Pin(int Entry, int Size);
+	void Remove(int Entry);
+	bool IsResident(int Entry) const { return m_aEntries[Entry].m_Page != -1; }
+	int Page(int Entry) const { return m_aEntries[Entry].m_Page; }
+
+	void NextFrame();
+	const CStats &Stats() const { return m_LastStats; }
+	int FreePages() const;
+};
+
+#endif
@@ -60,6 +60,18 @@ public:
 		TEXLOAD_NOMIPMAPS = 2,
 	};
 
+	/* Constants: Texture Load Priorities
+		TEXPRIORITY_LOW - Decoration that can pop in late
+		TEXPRIORITY_NORMAL - Default
+		TEXPRIORITY_HIGH - Needed to play, loaded before everything else
+	*/
+	enum
+	{
+		TEXPRIORITY_LOW = 0,
+		TEXPRIORITY_NORMAL,
+		TEXPRIORITY_HIGH,
+	};
+
 	int ScreenWidth() const { return m_ScreenWidth; }
 	int ScreenHeight() const { return m_ScreenHeight; }
 	float ScreenAspect() const { return (float)ScreenWidth()/(float)ScreenHeight(); }
@@ -80,13 +92,45 @@ public:
 	virtual void WrapClamp() = 0;
 	virtual int MemoryUsage() const = 0;
 
+	// counters of the last finished frame
+	struct CRenderStats
+	{
+		int m_DrawCalls; // QuadsEnd/LinesEnd with geometry
+		int m_Batches; // runs of equal state sent to the GPU
+		int m_StateChanges; // texture, blend, wrap or clip switches
+		int m_Vertices;
+		int m_Sprites; // quads that went out as two vertex sprites
+		int m_TextureUploads; // textures sent to GS memory
+		int m_UploadBytes;
+		int m_Evictions;
+	};
+	virtual const CRenderStats &RenderStats() const = 0;
+
 	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType) = 0;
 	virtual int UnloadTexture(int Index) = 0;
 	virtual int LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags) = 0;
 	virtual int LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags) = 0;
+	// returns the id right away, it draws as the invalid texture until the image is loaded
+	virtual int LoadTextureAsync(const char *pFilename, int StorageType, int StoreFormat, int Flags, int Priority) = 0;
 	virtual int LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData) = 0;
 	virtual void TextureSet(int TextureID) = 0;
 
+	// moves small textures into one shared texture so they can be drawn without switching,
+	// the ids stay valid. returns how many of them were moved
+	virtual int BuildTextureAtlas(const int *pTextures, int Num) = 0;
+
+	// an offscreen buffer that the whole screen is drawn into at the size
+	// of the target. it is drawn like a texture with the returned id and
+	// freed with UnloadTexture, -1 when there is no room for it
+	virtual int CreateRenderTarget(int Width, int Height) = 0;
+	// draws go into the target until RenderTargetEnd, it starts out in the
+	// color of the last Clear
+	virtual void RenderTargetBegin(int TextureID) = 0;
+	virtual void RenderTargetEnd() = 0;
+	// false when drawing it again would give a different result, because it
+	// was never drawn, a texture finished loading or the clear color changed
+	virtual bool RenderTargetValid(int TextureID) = 0;
+
 	struct CLineItem
 	{
 		float m_X0, m_Y0, m_X1, m_Y1;
@@ -120,6 +164,25 @@ public:
 			: m_X0(x0), m_Y0(y0), m_X1(x1), m_Y1(y1), m_X2(x2), m_Y2(y2), m_X3(x3), m_Y3(y3) {}
 	};
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num) = 0;
+
+	// a top-left quad that carries its own texture coordinates,
+	// corners are top left, top right, bottom right, bottom left
+	struct CTexturedQuadItem
+	{
+		float m_X, m_Y, m_Width, m_Height;
+		float m_aU[4], m_aV[4];
+	};
+	virtual void QuadsDrawTexturedTL(const CTexturedQuadItem *pArray, int Num) = 0;
+
+	// a freeform quad that carries its own texture coordinates and colors,
+	// point i uses texture coordinate and color i like with QuadsSetSubsetFree
+	struct CColoredFreeformItem
+	{
+		float m_aX[4], m_aY[4];
+		float m_aU[4], m_aV[4];
+		float m_aColors[4][4];
+	};
+	virtual void QuadsDrawColoredFreeform(const CColoredFreeformItem *pArray, int Num) = 0;
 	virtual void QuadsText(float x, float y, float Size, const char *pText) = 0;
 
 	struct CColorVertex
@@ -138,6 +201,23 @@ public:
 
 	virtual void Swap() = 0;
 
+	// from the next frame on the screen is drawn at half its height and
+	// stretched by the display, coordinates stay the same. false when the
+	// backend can't do that
+	virtual bool SetHalfHeight(bool Half) = 0;
+
+	// when the frames reached the screen, for pacing them. m_Frame counts
+	// the swaps before the frame and is -1 while nothing was shown
+	struct CFrameTiming
+	{
+		int m_Frame;
+		int64 m_ReadyTime; // the backend was done with it
+		int64 m_FlipTime; // it was shown
+	};
+	virtual void LastFrameTiming(CFrameTiming *pTiming) = 0;
+	// the number the frame that is recorded now gets
+	virtual int FrameNumber() = 0;
+
 	// syncronization
 	virtual void InsertSignal(class semaphore *pSemaphore) = 0;
 	virtual bool IsIdle() = 0;
@@ -162,5 +242,6 @@ public:
 
 extern IEngineGraphics *CreateEngineGraphics();
 extern IEngineGraphics *CreateEngineGraphicsThreaded();
+extern IEngineGraphics *CreateEngineGraphicsNull();
 
 #endif
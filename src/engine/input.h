@@ -93,5 +93,6 @@ public:
 };
 
 extern IEngineInput *CreateEngineInput();
+extern IEngineInput *CreateEngineInputNull();
 
 #endif
@@ -0,0 +1,199 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "adpcm.h"
+
+// predictors of the SPU, in 64ths
+static const int s_aK0[5] = {0, 60, 115, 98, 122};
+static const int s_aK1[5] = {0, 0, -52, -55, -60};
+
+enum
+{
+	FLAG_END = 1,
+	FLAG_REPEAT = 2,
+	FLAG_LOOP_START = 4,
+};
+
+static int Predict(int Filter, int Hist1, int Hist2)
+{
+	return (Hist1*s_aK0[Filter] + Hist2*s_aK1[Filter] + 32) >> 6;
+}
+
+// encodes a block with one predictor and shift like the SPU decodes it,
+// returns the squared error
+static int64 TryBlock(const int *pSamples, int Filter, int Shift, int Hist1, int Hist2, int *pNibbles)
+{
+	const int Step = 1<<(12-Shift);
+	int64 Error = 0;
+	for(int i = 0; i < CAdpcmEncoder::BLOCK_SAMPLES; i++)
+	{
+		int Prediction = Predict(Filter, Hist1, Hist2);
+		int Residual = pSamples[i] - Prediction;
+		int Nibble = clamp((Residual + (Residual >= 0 ? Step/2 : -Step/2)) / Step, -8, 7);
+		int Decoded = clamp(((Nibble*4096) >> Shift) + Prediction, -32768, 32767);
+		Error += (int64)(pSamples[i]-Decoded)*(pSamples[i]-Decoded);
+		Hist2 = Hist1;
+		Hist1 = Decoded;
+		if(pNibbles)
+			pNibbles[i] = Nibble;
+	}
+	return Error;
+}
+
+void CAdpcmEncoder::EncodeBlock(const int *pSamples, int *pHist1, int *pHist2, unsigned char *pOut)
+{
+	int BestFilter = 0, BestShift = 12;
+	int64 BestError = -1;
+
+	for(int f = 0; f < 5; f++)
+	{
+		// the largest residual decides which shifts are worth a try
+		int MaxResidual = 0;
+		int Hist1 = *pHist1, Hist2 = *pHist2;
+		for(int i = 0; i < BLOCK_SAMPLES; i++)
+		{
+			MaxResidual = max(MaxResidual, absolute(pSamples[i] - Predict(f, Hist1, Hist2)));
+			Hist2 = Hist1;
+			Hist1 = pSamples[i];
+		}
+		int Range = 0;
+		while(Range < 12 && MaxResidual > 7*(1<<Range) + (1<<Range)/2)
+			Range++;
+
+		for(int r = Range; r <= min(Range+1, 12); r++)
+		{
+			int64 Error = TryBlock(pSamples, f, 12-r, *pHist1, *pHist2, 0);
+			if(BestError < 0 || Error < BestError)
+			{
+				BestError = Error;
+				BestFilter = f;
+				BestShift = 12-r;
+			}
+		}
+	}
+
+	int aNibbles[BLOCK_SAMPLES];
+	TryBlock(pSamples, BestFilter, BestShift, *pHist1, *pHist2, aNibbles);
+
+	// follow the decoder into the next block
+	for(int i = 0; i < BLOCK_SAMPLES; i++)
+	{
+		int Decoded = clamp(((aNibbles[i]*4096) >> BestShift) + Predict(BestFilter, *pHist1, *pHist2), -32768, 32767);
+		*pHist2 = *pHist1;
+		*pHist1 = Decoded;
+	}
+
+	pOut[0] = (BestFilter<<4) | BestShift;
+	pOut[1] = 0;
+	for(int i = 0; i < BLOCK_SAMPLES/2; i++)
+		pOut[2+i] = (aNibbles[i*2]&0xf) | ((aNibbles[i*2+1]&0xf)<<4);
+}
+
+static int NumBlocks(int NumFrames)
+{
+	return max((NumFrames + CAdpcmEncoder::BLOCK_SAMPLES-1) / CAdpcmEncoder::BLOCK_SAMPLES, 1);
+}
+
+int CAdpcmEncoder::EncodedSize(int NumFrames, bool Loop)
+{
+	return HEADER_SIZE + (NumBlocks(NumFrames) + (Loop ? 0 : 1))*BLOCK_SIZE;
+}
+
+static int ReadInt(const unsigned char *pIn)
+{
+	return pIn[0] | (pIn[1]<<8) | (pIn[2]<<16) | (pIn[3]<<24);
+}
+
+static void WriteInt(unsigned char *pOut, unsigned Value)
+{
+	pOut[0] = Value&0xff;
+	pOut[1] = (Value>>8)&0xff;
+	pOut[2] = (Value>>16)&0xff;
+	pOut[3] = (Value>>24)&0xff;
+}
+
+int CAdpcmEncoder::Encode(const short *pSamples, int NumFrames, int Channels, int Rate, bool Loop, unsigned char *pOut)
+{
+	unsigned char *pStart = pOut;
+
+	mem_copy(pOut, "APCM", 4);
+	pOut[4] = 1; // version
+	pOut[5] = 1; // channels
+	pOut[6] = Loop ? 1 : 0;
+	pOut[7] = 0;
+	WriteInt(pOut+8, (unsigned)((int64)Rate*4096/SPU_RATE));
+	WriteInt(pOut+12, NumFrames);
+	pOut += HEADER_SIZE;
+
+	const int Blocks = NumBlocks(NumFrames);
+	int Hist1 = 0, Hist2 = 0;
+	for(int b = 0; b < Blocks; b++, pOut += BLOCK_SIZE)
+	{
+		int aBlock[BLOCK_SAMPLES];
+		for(int i = 0; i < BLOCK_SAMPLES; i++)
+		{
+			int Frame = b*BLOCK_SAMPLES + i;
+			int Sum = 0;
+			if(Frame < NumFrames)
+				for(int c = 0; c < Channels; c++)
+					Sum += pSamples[Frame*Channels + c];
+			aBlock[i] = Sum/Channels;
+		}
+		EncodeBlock(aBlock, &Hist1, &Hist2, pOut);
+
+		if(Loop)
+		{
+			pOut[1] = FLAG_REPEAT;
+			if(b == 0)
+				pOut[1] |= FLAG_LOOP_START;
+		}
+		if(b == Blocks-1)
+			pOut[1] |= FLAG_END;
+	}
+
+	if(!Loop)
+	{
+		// silence that stops the voice
+		mem_zero(pOut, BLOCK_SIZE);
+		pOut[0] = 12;
+		pOut[1] = FLAG_END|FLAG_REPEAT|FLAG_LOOP_START;
+		pOut += BLOCK_SIZE;
+	}
+
+	return pOut - pStart;
+}
+
+short *CAdpcmDecoder::Decode(const unsigned char *pData, int DataSize, int *pNumFrames, int *pRate, bool *pLoop)
+{
+	if(DataSize < CAdpcmEncoder::HEADER_SIZE || mem_comp(pData, "APCM", 4) != 0)
+		return 0;
+
+	const int Blocks = (DataSize-CAdpcmEncoder::HEADER_SIZE)/CAdpcmEncoder::BLOCK_SIZE;
+	const int NumFrames = clamp(ReadInt(pData+12), 0, Blocks*CAdpcmEncoder::BLOCK_SAMPLES);
+	short *pSamples = (short *)mem_alloc(max(NumFrames, 1)*sizeof(short), 1);
+
+	const unsigned char *pBlock = pData+CAdpcmEncoder::HEADER_SIZE;
+	int Hist1 = 0, Hist2 = 0;
+	for(int Frame = 0; Frame < NumFrames; pBlock += CAdpcmEncoder::BLOCK_SIZE)
+	{
+		const int Filter = min(pBlock[0]>>4, 4);
+		const int Shift = min(pBlock[0]&0xf, 12);
+		for(int i = 0; i < CAdpcmEncoder::BLOCK_SAMPLES && Frame < NumFrames; i++, Frame++)
+		{
+			int Nibble = (pBlock[2+i/2]>>((i&1)*4))&0xf;
+			if(Nibble >= 8)
+				Nibble -= 16;
+			int Decoded = clamp(((Nibble*4096) >> Shift) + Predict(Filter, Hist1, Hist2), -32768, 32767);
+			pSamples[Frame] = Decoded;
+			Hist2 = Hist1;
+			Hist1 = Decoded;
+		}
+	}
+
+	*pNumFrames = NumFrames;
+	*pRate = max((int)((int64)ReadInt(pData+8)*CAdpcmEncoder::SPU_RATE/4096), 1);
+	*pLoop = pData[6] != 0;
+	return pSamples;
+}
@@ -0,0 +1,56 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_ADPCM_H
+#define ENGINE_SHARED_ADPCM_H
+
+/*
+	Class: CAdpcmEncoder
+		Converts 16 bit samples to the SPU2 ADPCM that audsrv_load_adpcm
+		takes, the same format the .adp files in data/audio have.
+
+		The output starts with a 16 byte APCM header (id, version,
+		channels, loop, pitch and number of samples) followed by blocks
+		of 28 samples in 16 bytes. Every block tries the predictors and
+		the shifts that can hold its samples and keeps the one with the
+		smallest error, tracking the decoder so errors don't add up.
+
+		Stereo is mixed down, the SPU plays mono voices. A looped sample
+		repeats from its first block, a sample played once ends in a
+		silent block like the ones adpenc writes.
+*/
+class CAdpcmEncoder
+{
+public:
+	enum
+	{
+		HEADER_SIZE = 16,
+		BLOCK_SIZE = 16,
+		BLOCK_SAMPLES = 28,
+		SPU_RATE = 48000,
+	};
+
+private:
+	static void EncodeBlock(const int *pSamples, int *pHist1, int *pHist2, unsigned char *pOut);
+
+public:
+	// bytes Encode writes for NumFrames frames
+	static int EncodedSize(int NumFrames, bool Loop);
+
+	// pSamples holds NumFrames frames of Channels interleaved samples,
+	// returns the bytes written to pOut
+	static int Encode(const short *pSamples, int NumFrames, int Channels, int Rate, bool Loop, unsigned char *pOut);
+};
+
+/*
+	Class: CAdpcmDecoder
+		Turns an APCM blob back into mono 16 bit samples, for mixing on
+		the EE instead of uploading it to the SPU.
+*/
+class CAdpcmDecoder
+{
+public:
+	// the samples are allocated with mem_alloc, 0 when it isn't APCM
+	static short *Decode(const unsigned char *pData, int DataSize, int *pNumFrames, int *pRate, bool *pLoop);
+};
+
+#endif
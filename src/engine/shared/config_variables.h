@@ -86,6 +86,9 @@ MACRO_CONFIG_INT(SndChat, snd_chat, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Enabl
 MACRO_CONFIG_INT(SndTeamChat, snd_team_chat, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Enable team chat sound")
 MACRO_CONFIG_INT(SndServerMessage, snd_servermessage, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Enable server message sound")
 MACRO_CONFIG_INT(SndHighlight, snd_highlight, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Enable highlighted chat sound")
+MACRO_CONFIG_INT(SndCache, snd_cache, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Keep map sounds converted to ADPCM in the gssnd folder so they load without decoding")
+MACRO_CONFIG_INT(SndMixer, snd_mixer, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Mix sounds on the EE into one stream instead of one SPU2 channel per sound (needs restart)")
+MACRO_CONFIG_INT(SndStreamSize, snd_stream_size, 256, 0, 16384, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Opus sounds larger than this (in KB) are decoded while they play instead of when they load, 0 to turn it off (needs restart)")
 
 MACRO_CONFIG_INT(GfxScreenWidth, gfx_screen_width, 0, 0, 0, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Screen resolution width")
 MACRO_CONFIG_INT(GfxScreenHeight, gfx_screen_height, 0, 0, 0, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Screen resolution height")
@@ -128,6 +131,20 @@ MACRO_CONFIG_INT(GfxQuadAsTriangle, gfx_quad_as_triangle, 0, 0, 0, CFGFLAG_SAVE|
 #else
 MACRO_CONFIG_INT(GfxQuadAsTriangle, gfx_quad_as_triangle, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Render quads as triangles (fixes quad coloring on some GPUs)")
 #endif
+MACRO_CONFIG_INT(GfxQuadSprites, gfx_quad_sprites, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Send unrotated single color quads to the GS as sprites")
+MACRO_CONFIG_INT(GfxRenderQueue, gfx_render_queue, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Queue draws until the end of the frame and merge the ones with the same state")
+MACRO_CONFIG_INT(GfxTexturePalette, gfx_texture_palette, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Store textures with 16 or 256 color palettes when they are close enough")
+MACRO_CONFIG_INT(GfxTexturePaletteError, gfx_texture_palette_error, 16, 0, 1000, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Highest mean squared error per channel a palette texture may have")
+MACRO_CONFIG_INT(GfxTextureCache, gfx_texture_cache, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Keep converted textures in the gstex folder so they load without decoding")
+MACRO_CONFIG_INT(GfxTextureCacheSize, gfx_texture_cache_size, 2048, 64, 8192, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Kilobytes the gstex folder may take, the textures that were used least recently make room")
+MACRO_CONFIG_INT(GfxTextCache, gfx_text_cache, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Keep the layout of drawn strings so repeated text is not laid out again")
+MACRO_CONFIG_INT(GfxLayerCache, gfx_layer_cache, 1, 0, 2, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Draw unchanging background groups once into an offscreen buffer (1 = half resolution, 2 = full resolution)")
+MACRO_CONFIG_INT(GfxFramePacing, gfx_frame_pacing, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Start frames as late as they can still make the next vsync, so input is read closer to when it is shown")
+MACRO_CONFIG_INT(GfxFramePacingMargin, gfx_frame_pacing_margin, 2, 0, 20, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Milliseconds kept in reserve when pacing frames")
+MACRO_CONFIG_INT(GfxAsyncTextures, gfx_async_textures, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Decode map textures in the background while the game keeps running")
+MACRO_CONFIG_INT(GfxHeadless, gfx_headless, 0, 0, 1, CFGFLAG_CLIENT, "Record graphics calls instead of drawing them (set on the command line)")
+MACRO_CONFIG_INT(GfxHeadlessRaster, gfx_headless_raster, 0, 0, 1, CFGFLAG_CLIENT, "Draw the recorded calls in software so screenshots work while headless")
+MACRO_CONFIG_STR(GfxHeadlessLog, gfx_headless_log, 128, "", CFGFLAG_CLIENT, "File to write the recorded graphics calls to while headless")
 
 MACRO_CONFIG_INT(InpMousesens, inp_mousesens, 100, 5, 100000, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Mouse sensitivity")
 
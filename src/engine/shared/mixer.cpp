@@ -0,0 +1,275 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "mixer.h"
+
+#if defined(__SSE2__) && !defined(_EE)
+	#include <emmintrin.h>
+#endif
+
+CMixer::CMixer()
+{
+	Init(48000);
+}
+
+void CMixer::Init(int Rate)
+{
+	mem_zero(m_aVoices, sizeof(m_aVoices));
+	mem_zero(m_aWindowUsed, sizeof(m_aWindowUsed));
+	m_Rate = Rate;
+	m_NumMixed = 0;
+}
+
+void CMixer::Play(int Voice, const short *pData, int NumFrames, int Channels, int Rate, bool Loop, int Frame)
+{
+	Stop(Voice);
+
+	CVoice *pVoice = &m_aVoices[Voice];
+	pVoice->m_pData = pData;
+	pVoice->m_NumFrames = NumFrames;
+	pVoice->m_Channels = Channels;
+	pVoice->m_Step = (unsigned)(((int64)Rate<<16)/m_Rate);
+	pVoice->m_VolLeft = 0;
+	pVoice->m_VolRight = 0;
+	pVoice->m_Loop = Loop;
+	pVoice->m_Active = pData && NumFrames > 0;
+	Seek(Voice, Frame);
+}
+
+bool CMixer::PlayStream(int Voice, IStream *pStream, int Channels, int Rate)
+{
+	Stop(Voice);
+
+	int Window = 0;
+	while(Window < MAX_STREAMS && m_aWindowUsed[Window])
+		Window++;
+	if(Window == MAX_STREAMS)
+		return false;
+	m_aWindowUsed[Window] = true;
+
+	CVoice *pVoice = &m_aVoices[Voice];
+	pVoice->m_pData = m_aaWindows[Window];
+	pVoice->m_NumFrames = 0;
+	pVoice->m_Channels = Channels;
+	pVoice->m_Step = (unsigned)min(((int64)Rate<<16)/m_Rate, (int64)MAX_STREAM_STEP<<16);
+	pVoice->m_Pos = 0;
+	pVoice->m_VolLeft = 0;
+	pVoice->m_VolRight = 0;
+	pVoice->m_Loop = false;
+	pVoice->m_Active = true;
+	pVoice->m_pStream = pStream;
+	pVoice->m_Window = Window;
+	pVoice->m_WindowFrames = 0;
+	return true;
+}
+
+void CMixer::Stop(int Voice)
+{
+	CVoice *pVoice = &m_aVoices[Voice];
+	if(pVoice->m_pStream)
+	{
+		m_aWindowUsed[pVoice->m_Window] = false;
+		pVoice->m_pStream = 0;
+	}
+	pVoice->m_Active = false;
+}
+
+void CMixer::SetVolume(int Voice, int Left, int Right)
+{
+	m_aVoices[Voice].m_VolLeft = clamp(Left, 0, (int)MAX_VOLUME);
+	m_aVoices[Voice].m_VolRight = clamp(Right, 0, (int)MAX_VOLUME);
+}
+
+void CMixer::Seek(int Voice, int Frame)
+{
+	CVoice *pVoice = &m_aVoices[Voice];
+	if(pVoice->m_pStream)
+	{
+		pVoice->m_pStream->Seek(Frame);
+		pVoice->m_WindowFrames = 0;
+		pVoice->m_Pos = 0;
+		return;
+	}
+
+	if(pVoice->m_Loop && pVoice->m_NumFrames > 0)
+		Frame %= pVoice->m_NumFrames;
+	pVoice->m_Pos = (int64)max(Frame, 0)<<16;
+	if(Frame >= pVoice->m_NumFrames)
+		pVoice->m_Active = false;
+}
+
+bool CMixer::Advance(CVoice *pVoice, int NumFrames)
+{
+	const int64 End = (int64)pVoice->m_NumFrames<<16;
+	pVoice->m_Pos += (int64)pVoice->m_Step*NumFrames;
+	if(pVoice->m_Pos < End)
+		return true;
+
+	if(pVoice->m_Loop)
+	{
+		pVoice->m_Pos %= End;
+		return true;
+	}
+
+	pVoice->m_Active = false;
+	return false;
+}
+
+int CMixer::Render(CVoice *pVoice, int NumFrames)
+{
+	const short *pData = pVoice->m_pData;
+	const int Channels = pVoice->m_Channels;
+	const int64 End = (int64)pVoice->m_NumFrames<<16;
+	const int Right = Channels > 1 ? 1 : 0;
+	short *pOut = m_aScratch;
+
+	int i;
+	for(i = 0; i < NumFrames; i++, pOut += 2)
+	{
+		if(pVoice->m_Pos >= End)
+		{
+			if(!pVoice->m_Loop)
+			{
+				pVoice->m_Active = false;
+				break;
+			}
+			pVoice->m_Pos %= End;
+		}
+
+		int Frame = (int)(pVoice->m_Pos>>16);
+		int Frac = (int)(pVoice->m_Pos&0xffff)>>1;
+		int Next = Frame+1 < pVoice->m_NumFrames ? Frame+1 : (pVoice->m_Loop ? 0 : Frame);
+
+		const short *pA = pData + Frame*Channels;
+		const short *pB = pData + Next*Channels;
+		int Left = pA[0] + (((pB[0]-pA[0])*Frac)>>15);
+		int RightSample = pA[Right] + (((pB[Right]-pA[Right])*Frac)>>15);
+
+		pOut[0] = (Left*pVoice->m_VolLeft)>>8;
+		pOut[1] = (RightSample*pVoice->m_VolRight)>>8;
+
+		pVoice->m_Pos += pVoice->m_Step;
+	}
+
+	// the rest adds nothing
+	if(i < NumFrames)
+		mem_zero(pOut, (NumFrames-i)*2*sizeof(short));
+	return i;
+}
+
+void CMixer::RenderStream(CVoice *pVoice, int NumFrames)
+{
+	const int Channels = pVoice->m_Channels;
+	short *pWindow = m_aaWindows[pVoice->m_Window];
+
+	// drop the frames that are behind, then fill up to what this call reads
+	int Behind = min((int)(pVoice->m_Pos>>16), pVoice->m_WindowFrames);
+	pVoice->m_WindowFrames -= Behind;
+	pVoice->m_Pos -= (int64)Behind<<16;
+	mem_move(pWindow, pWindow + Behind*Channels, pVoice->m_WindowFrames*Channels*sizeof(short));
+
+	int Need = min((int)((pVoice->m_Pos + (int64)pVoice->m_Step*NumFrames)>>16) + 2, (int)WINDOW_FRAMES);
+	if(pVoice->m_WindowFrames < Need)
+		pVoice->m_WindowFrames += pVoice->m_pStream->Read(pWindow + pVoice->m_WindowFrames*Channels, Need-pVoice->m_WindowFrames);
+
+	// the window is a sample that ends where the decoder is
+	pVoice->m_pData = pWindow;
+	pVoice->m_NumFrames = pVoice->m_WindowFrames;
+	Render(pVoice, NumFrames);
+	if(!pVoice->m_Active)
+	{
+		if(pVoice->m_pStream->Ended())
+			Stop(pVoice - m_aVoices);
+		else
+		{
+			// the decoder fell behind, wait for it
+			pVoice->m_Active = true;
+			pVoice->m_Pos = min(pVoice->m_Pos, (int64)pVoice->m_WindowFrames<<16);
+		}
+	}
+}
+
+void CMixer::Mix(short *pOut, int NumFrames)
+{
+	NumFrames = min(NumFrames, (int)MAX_FRAMES);
+	mem_zero(pOut, NumFrames*2*sizeof(short));
+
+	m_NumMixed = 0;
+	for(int v = 0; v < MAX_VOICES; v++)
+	{
+		CVoice *pVoice = &m_aVoices[v];
+		if(!pVoice->m_Active)
+			continue;
+
+		// streams are always read so they stay where they should be
+		if(pVoice->m_pStream)
+		{
+			RenderStream(pVoice, NumFrames);
+			if(pVoice->m_VolLeft || pVoice->m_VolRight)
+			{
+				AddSaturate(pOut, m_aScratch, NumFrames*2);
+				m_NumMixed++;
+			}
+			continue;
+		}
+
+		if(!pVoice->m_VolLeft && !pVoice->m_VolRight)
+		{
+			Advance(pVoice, NumFrames);
+			continue;
+		}
+
+		Render(pVoice, NumFrames);
+		AddSaturate(pOut, m_aScratch, NumFrames*2);
+		m_NumMixed++;
+	}
+}
+
+void CMixer::AddSaturateRef(short *pDst, const short *pSrc, int Num)
+{
+	for(int i = 0; i < Num; i++)
+		pDst[i] = clamp(pDst[i] + pSrc[i], -32768, 32767);
+}
+
+#if defined(_EE)
+
+// paddsh adds eight halfwords with signed saturation
+void CMixer::AddSaturateSimd(short *pDst, const short *pSrc, int Num)
+{
+	int i;
+	for(i = 0; i+8 <= Num; i += 8)
+	{
+		__asm__ __volatile__(
+			"lq		$8, 0x00(%0)\n"
+			"lq		$9, 0x00(%1)\n"
+			"paddsh		$8, $8, $9\n"
+			"sq		$8, 0x00(%0)\n"
+			: : "r"(pDst+i), "r"(pSrc+i) : "$8", "$9", "memory");
+	}
+	AddSaturateRef(pDst+i, pSrc+i, Num-i);
+}
+
+#elif defined(__SSE2__)
+
+void CMixer::AddSaturateSimd(short *pDst, const short *pSrc, int Num)
+{
+	int i;
+	for(i = 0; i+8 <= Num; i += 8)
+	{
+		__m128i Dst = _mm_load_si128((const __m128i *)(pDst+i));
+		__m128i Src = _mm_load_si128((const __m128i *)(pSrc+i));
+		_mm_store_si128((__m128i *)(pDst+i), _mm_adds_epi16(Dst, Src));
+	}
+	AddSaturateRef(pDst+i, pSrc+i, Num-i);
+}
+
+#else
+
+void CMixer::AddSaturateSimd(short *pDst, const short *pSrc, int Num)
+{
+	AddSaturateRef(pDst, pSrc, Num);
+}
+
+#endif
@@ -0,0 +1,123 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_MIXER_H
+#define ENGINE_SHARED_MIXER_H
+
+#include <base/system.h>
+
+#if defined(_EE) || defined(__SSE2__)
+	#define CONF_MIXER_SIMD 1
+#endif
+
+/*
+	Class: CMixer
+		Mixes 16 bit PCM voices into one interleaved stereo stream, for
+		the backend that feeds audsrv_play_audio instead of playing each
+		sound on its own SPU2 channel.
+
+		Every voice is resampled (linear) and scaled by its left and right
+		volume into a scratch buffer, which is then added to the output
+		with signed saturation. The add is the part done for every voice
+		and every sample, it has a scalar reference and a SIMD kernel
+		(MMI paddsh on the EE, SSE2 on the host) with the same results.
+
+		Voices at zero volume only move forward. Nothing here touches the
+		IOP or locks, the caller keeps voices and Mix apart.
+
+		A streamed voice pulls its frames from an IStream into a small
+		window instead of reading a whole sample, so a long sound never
+		has to be decoded at once. The stream loops by itself, running
+		short of frames plays silence without ending the voice.
+*/
+class CMixer
+{
+public:
+	enum
+	{
+		MAX_VOICES = 256,
+		MAX_FRAMES = 1024, // per Mix call
+		MAX_VOLUME = 256,
+		MAX_STREAMS = 4,
+		MAX_STREAM_STEP = 2, // source frames per output frame a stream can have
+	};
+
+	class IStream
+	{
+	public:
+		virtual ~IStream() {}
+		// interleaved frames, fewer than NumFrames when the decoder is behind
+		virtual int Read(short *pOut, int NumFrames) = 0;
+		virtual void Seek(int Frame) = 0;
+		// no frames will come anymore
+		virtual bool Ended() const = 0;
+	};
+
+private:
+	enum
+	{
+		WINDOW_FRAMES = MAX_FRAMES*MAX_STREAM_STEP + 2,
+	};
+	struct CVoice
+	{
+		const short *m_pData;
+		int m_NumFrames;
+		int m_Channels;
+		unsigned m_Step; // source frames per output frame, 16.16
+		int64 m_Pos; // 16.16
+		int m_VolLeft;
+		int m_VolRight;
+		bool m_Loop;
+		bool m_Active;
+
+		IStream *m_pStream;
+		int m_Window; // index in m_aaWindows
+		int m_WindowFrames;
+	};
+
+	CVoice m_aVoices[MAX_VOICES];
+	short m_aaWindows[MAX_STREAMS][WINDOW_FRAMES*2];
+	bool m_aWindowUsed[MAX_STREAMS];
+	short m_aScratch[MAX_FRAMES*2] __attribute__((aligned(16)));
+	int m_Rate;
+	int m_NumMixed;
+
+	// moves a voice NumFrames output frames on, false when it ended
+	bool Advance(CVoice *pVoice, int NumFrames);
+	// writes NumFrames scaled frames to m_aScratch, returns how many it wrote before the end
+	int Render(CVoice *pVoice, int NumFrames);
+	void RenderStream(CVoice *pVoice, int NumFrames);
+
+public:
+	CMixer();
+	void Init(int Rate);
+	int Rate() const { return m_Rate; }
+
+	// pData stays owned by the caller and has to live until the voice is stopped
+	void Play(int Voice, const short *pData, int NumFrames, int Channels, int Rate, bool Loop, int Frame);
+	// false when all stream windows are taken
+	bool PlayStream(int Voice, IStream *pStream, int Channels, int Rate);
+	void Stop(int Voice);
+	void SetVolume(int Voice, int Left, int Right); // 0 - MAX_VOLUME
+	void Seek(int Voice, int Frame);
+
+	bool IsPlaying(int Voice) const { return m_aVoices[Voice].m_Active; }
+	int Position(int Voice) const { return (int)(m_aVoices[Voice].m_Pos>>16); }
+
+	// interleaved stereo, NumFrames up to MAX_FRAMES, pOut aligned to 16 bytes
+	void Mix(short *pOut, int NumFrames);
+	int NumMixed() const { return m_NumMixed; }
+
+	// pDst[i] = saturate(pDst[i] + pSrc[i]), both aligned to 16 bytes
+	static void AddSaturateRef(short *pDst, const short *pSrc, int Num);
+	static void AddSaturateSimd(short *pDst, const short *pSrc, int Num);
+	static void AddSaturate(short *pDst, const short *pSrc, int Num)
+	{
+#if defined(CONF_MIXER_SIMD)
+		AddSaturateSimd(pDst, pSrc, Num);
+#else
+		AddSaturateRef(pDst, pSrc, Num);
+#endif
+	}
+};
+
+#endif
@@ -52,7 +52,27 @@ public:
 	};
 
 
+	struct CSoundStats
+	{
+		int m_Played; // got an audsrv channel in the last frame
+		int m_Culled; // too quiet to be sent to the IOP
+		int m_Dropped; // audible but all channels had louder sounds
+		int m_Stolen; // channels and voices taken from quieter sounds
+		int m_ActiveVoices;
+		int m_ActiveChannels;
+	};
+
+	struct CSoundEvent
+	{
+		int m_Channel;
+		int m_SampleID;
+		int m_Flags;
+		float m_X, m_Y;
+		float m_Volume; // up to 2 for events that stand for several sounds
+	};
+
 	virtual bool IsSoundEnabled() = 0;
+	virtual const CSoundStats &SoundStats() const = 0;
 
 	virtual int LoadWV(const char *pFilename) = 0;
 	virtual int LoadOpus(const char *pFilename) = 0;
@@ -75,6 +95,8 @@ public:
 
 	virtual CVoiceHandle PlayAt(int ChannelID, int SampleID, int Flags, float x, float y) = 0;
 	virtual CVoiceHandle Play(int ChannelID, int SampleID, int Flags) = 0;
+	// plays sounds nobody needs a handle for, all under one lock
+	virtual void PlayEvents(const CSoundEvent *pEvents, int Num) = 0;
 	virtual void Stop(int SampleID) = 0;
 	virtual void StopAll() = 0;
 	virtual void StopVoice(CVoiceHandle Voice) = 0;
@@ -100,5 +122,6 @@ public:
 };
 
 extern IEngineSound *CreateEngineSound();
+extern IEngineSound *CreateEngineSoundNull();
 
 #endif
@@ -7,6 +7,7 @@
 #include <game/client/components/camera.h>
 #include <game/client/components/maplayers.h>
 #include <game/client/components/mapimages.h>
+#include <game/client/quadlayer_cache.h>
 
 #include "background.h"
 
@@ -49,7 +50,11 @@ void CBackground::LoadBackground()
 		return;
 
 	if(m_Loaded && m_pMap == m_pBackgroundMap)
+	{
+		if(RenderTools()->m_pQuadLayerCache)
+			RenderTools()->m_pQuadLayerCache->Clear(m_pMap);
 		m_pMap->Unload();
+	}
 
 	m_Loaded = false;
 	m_pMap = m_pBackgroundMap;
@@ -64,6 +69,7 @@ void CBackground::LoadBackground()
 		m_pLayers->m_pLayers->InitBackground(m_pMap);
 		m_pImages->LoadBackground(m_pMap);
 		RenderTools()->RenderTilemapGenerateSkip(m_pLayers->m_pLayers);
+		m_pLayers->ClearEnvelopeMemo();
 		m_Loaded = true;
 	}
 	else if(str_comp(g_Config.m_ClBackgroundEntities, CURRENT) == 0)
@@ -71,6 +77,7 @@ void CBackground::LoadBackground()
 		m_pMap = Kernel()->RequestInterface<IEngineMap>();
 		m_pLayers->m_pLayers = GameClient()->Layers();
 		m_pImages = GameClient()->m_pMapimages;
+		m_pLayers->ClearEnvelopeMemo();
 		m_Loaded = true;
 	}
 
@@ -142,7 +149,7 @@ void CBackground::OnRender()
 		{
 			CMapItemLayer *pLayer = m_pLayers->m_pLayers->GetLayer(pGroup->m_StartLayer+l);
 			// skip rendering if detail layers if not wanted
-			if(pLayer->m_Flags&LAYERFLAG_DETAIL && !g_Config.m_GfxHighDetail)
+			if(pLayer->m_Flags&LAYERFLAG_DETAIL && !m_pClient->HighDetail())
 				continue;
 
 			if(pLayer == (CMapItemLayer*)m_pLayers->m_pLayers->GameLayer())
@@ -184,9 +191,11 @@ void CBackground::OnRender()
 				CQuad *pQuads = (CQuad *)m_pMap->GetDataSwapped(pQLayer->m_Data);
 
 				Graphics()->BlendNone();
-				RenderTools()->ForceRenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_OPAQUE, m_pLayers->EnvelopeEval, m_pLayers);
+				RenderTools()->ForceRenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_OPAQUE, m_pLayers->EnvelopeEval, m_pLayers,
+					1.0f, m_pLayers->m_pLayers->Map(), pGroup->m_StartLayer+l);
 				Graphics()->BlendNormal();
-				RenderTools()->ForceRenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_TRANSPARENT, m_pLayers->EnvelopeEval, m_pLayers);
+				RenderTools()->ForceRenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_TRANSPARENT, m_pLayers->EnvelopeEval, m_pLayers,
+					1.0f, m_pLayers->m_pLayers->Map(), pGroup->m_StartLayer+l);
 			}
 		}
 		if(!g_Config.m_GfxNoclip)
@@ -4,8 +4,6 @@
 
 #include <base/math.h>
 
-#include <libpad.h>
-
 #include <engine/shared/config.h>
 #include <engine/serverbrowser.h>
 
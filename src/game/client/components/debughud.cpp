@@ -1,7 +1,9 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <engine/engine.h>
 #include <engine/shared/config.h>
 #include <engine/graphics.h>
+#include <engine/sound.h>
 #include <engine/textrender.h>
 
 #include <game/generated/protocol.h>
@@ -9,6 +11,7 @@
 
 #include <game/layers.h>
 
+#include <game/client/components/sounds.h>
 #include <game/client/gameclient.h>
 #include <game/client/animstate.h>
 #include <game/client/render.h>
@@ -135,8 +138,51 @@ void CDebugHud::RenderTuning()
 	TextRender()->TextColor(1,1,1,1);
 }
 
+void CDebugHud::RenderFrameGovernor()
+{
+	if(!g_Config.m_Debug)
+		return;
+
+	const CFrameGovernor *pGovernor = &m_pClient->m_FrameGovernor;
+	float Width = 300*Graphics()->ScreenAspect();
+	Graphics()->MapScreen(0, 0, Width, 300);
+
+	const float LineHeight = 6.0f;
+	const float Fontsize = 5.0f;
+	float x = 5.0f, y = 300.0f-(CFrameGovernor::MAX_LOG+2)*LineHeight;
+
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "governor: %.1f ms, target %.1f ms, step %d/%d%s",
+		pGovernor->AverageFrameTime()*1000.0f, 1000.0f/g_Config.m_ClFrameGovernorFps,
+		pGovernor->Level(), (int)CFrameGovernor::NUM_STEPS, g_Config.m_ClFrameGovernor ? "" : " (off)");
+	TextRender()->Text(0, x, y, Fontsize, aBuf, -1);
+	for(int i = 0; i < pGovernor->NumLog(); i++)
+		TextRender()->Text(0, x, y+(i+1)*LineHeight, Fontsize, pGovernor->GetLog(i), -1);
+}
+
+void CDebugHud::RenderSounds()
+{
+	if(!g_Config.m_Debug)
+		return;
+
+	const ISound::CSoundStats &Stats = Sound()->SoundStats();
+	float Width = 300*Graphics()->ScreenAspect();
+	Graphics()->MapScreen(0, 0, Width, 300);
+
+	const float LineHeight = 6.0f;
+	const float Fontsize = 5.0f;
+	float x = 5.0f, y = 300.0f-(CFrameGovernor::MAX_LOG+3)*LineHeight;
+
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "sound events: %d requested, %d coalesced, %d played, %d culled",
+		m_pClient->m_pSounds->NumRequested(), m_pClient->m_pSounds->NumCoalesced(), Stats.m_Played, Stats.m_Culled);
+	TextRender()->Text(0, x, y, Fontsize, aBuf, -1);
+}
+
 void CDebugHud::OnRender()
 {
 	RenderTuning();
 	RenderNetCorrections();
+	RenderFrameGovernor();
+	RenderSounds();
 }
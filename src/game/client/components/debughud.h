@@ -8,6 +8,8 @@ class CDebugHud : public CComponent
 {
 	void RenderNetCorrections();
 	void RenderTuning();
+	void RenderFrameGovernor();
+	void RenderSounds();
 public:
 	virtual void OnRender();
 };
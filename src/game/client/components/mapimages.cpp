@@ -4,6 +4,7 @@
 #include <engine/map.h>
 #include <engine/storage.h>
 #include <game/client/component.h>
+#include <game/layers.h>
 #include <game/mapitems.h>
 
 #include "mapimages.h"
@@ -29,6 +30,21 @@ void CMapImages::OnMapLoad()
 	int Start;
 	pMap->GetType(MAPITEMTYPE_IMAGE, &Start, &m_Count);
 
+	// the images of the game group are drawn around the players, they load first
+	bool aGameImages[64] = {false};
+	CMapItemGroup *pGameGroup = Layers()->GameGroup();
+	for(int l = 0; pGameGroup && l < pGameGroup->m_NumLayers; l++)
+	{
+		CMapItemLayer *pLayer = Layers()->GetLayer(pGameGroup->m_StartLayer+l);
+		int Image = -1;
+		if(pLayer->m_Type == LAYERTYPE_TILES)
+			Image = ((CMapItemLayerTilemap *)pLayer)->m_Image;
+		else if(pLayer->m_Type == LAYERTYPE_QUADS)
+			Image = ((CMapItemLayerQuads *)pLayer)->m_Image;
+		if(Image >= 0 && Image < 64)
+			aGameImages[Image] = true;
+	}
+
 	// load new textures
 	for(int i = 0; i < m_Count; i++)
 	{
@@ -40,7 +56,8 @@ void CMapImages::OnMapLoad()
 			char Buf[256];
 			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
 			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+			m_aTextures[i] = Graphics()->LoadTextureAsync(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0,
+				aGameImages[i] ? IGraphics::TEXPRIORITY_HIGH : IGraphics::TEXPRIORITY_NORMAL);
 		}
 		else
 		{
@@ -75,7 +92,7 @@ void CMapImages::LoadBackground(class IMap *pMap)
 			char Buf[256];
 			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
 			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+			m_aTextures[i] = Graphics()->LoadTextureAsync(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0, IGraphics::TEXPRIORITY_LOW);
 		}
 		else
 		{
@@ -25,6 +25,11 @@ CMapLayers::CMapLayers(int t)
 	m_CurrentLocalTick = 0;
 	m_LastLocalTick = 0;
 	m_EnvelopeUpdate = false;
+	m_NumStaticGroups = 0;
+	m_CacheTarget = -1;
+	m_CacheMode = 0;
+	m_NumCachedGroups = 0;
+	m_CacheSettings = 0;
 }
 
 void CMapLayers::OnInit()
@@ -32,6 +37,168 @@ void CMapLayers::OnInit()
 	m_pLayers = Layers();
 }
 
+void CMapLayers::OnMapLoad()
+{
+	// the game group always comes after the cached ones
+	m_NumStaticGroups = 0;
+	if(m_Type == TYPE_BACKGROUND)
+	{
+		while(m_NumStaticGroups < MAX_CACHED_GROUPS && m_NumStaticGroups+1 < m_pLayers->NumGroups() &&
+			IsStaticGroup(m_pLayers->GetGroup(m_NumStaticGroups)))
+			m_NumStaticGroups++;
+	}
+	m_NumCachedGroups = 0;
+	mem_zero(m_aLastViews, sizeof(m_aLastViews));
+	ClearEnvelopeMemo();
+}
+
+bool CMapLayers::IsStaticEnvelope(int Env)
+{
+	if(Env < 0)
+		return true;
+
+	int Start, Num;
+	m_pLayers->Map()->GetType(MAPITEMTYPE_ENVELOPE, &Start, &Num);
+	if(Env >= Num)
+		return true;
+	CMapItemEnvelope *pItem = (CMapItemEnvelope *)m_pLayers->Map()->GetItem(Start+Env, 0, 0);
+
+	m_pLayers->Map()->GetType(MAPITEMTYPE_ENVPOINTS, &Start, &Num);
+	if(!Num)
+		return true;
+	CEnvPoint *pPoints = (CEnvPoint *)m_pLayers->Map()->GetItem(Start, 0, 0) + pItem->m_StartPoint;
+
+	// the curve between equal points is flat whatever its type
+	for(int i = 1; i < pItem->m_NumPoints; i++)
+		if(mem_comp(pPoints[i].m_aValues, pPoints[0].m_aValues, sizeof(pPoints[0].m_aValues)) != 0)
+			return false;
+	return true;
+}
+
+bool CMapLayers::IsStaticGroup(CMapItemGroup *pGroup)
+{
+	if(!pGroup)
+		return false;
+
+	for(int l = 0; l < pGroup->m_NumLayers; l++)
+	{
+		CMapItemLayer *pLayer = m_pLayers->GetLayer(pGroup->m_StartLayer+l);
+		if(pLayer == (CMapItemLayer*)m_pLayers->GameLayer() || pLayer == (CMapItemLayer*)m_pLayers->FrontLayer() ||
+			pLayer == (CMapItemLayer*)m_pLayers->SwitchLayer() || pLayer == (CMapItemLayer*)m_pLayers->TeleLayer() ||
+			pLayer == (CMapItemLayer*)m_pLayers->SpeedupLayer() || pLayer == (CMapItemLayer*)m_pLayers->TuneLayer())
+			return false;
+
+		if(pLayer->m_Type == LAYERTYPE_TILES)
+		{
+			if(!IsStaticEnvelope(((CMapItemLayerTilemap *)pLayer)->m_ColorEnv))
+				return false;
+		}
+		else if(pLayer->m_Type == LAYERTYPE_QUADS)
+		{
+			CMapItemLayerQuads *pQLayer = (CMapItemLayerQuads *)pLayer;
+			CQuad *pQuads = (CQuad *)m_pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
+			for(int q = 0; q < pQLayer->m_NumQuads; q++)
+				if(!IsStaticEnvelope(pQuads[q].m_PosEnv) || !IsStaticEnvelope(pQuads[q].m_ColorEnv))
+					return false;
+		}
+	}
+	return true;
+}
+
+void CMapLayers::GetGroupView(CMapItemGroup *pGroup, vec2 Center, CGroupView *pView)
+{
+	mem_zero(pView, sizeof(*pView));
+
+	if(!g_Config.m_GfxNoclip && pGroup->m_Version >= 2 && pGroup->m_UseClipping)
+	{
+		// the clip rectangle is given in game group coordinates
+		CMapItemGroup *pGameGroup = m_pLayers->GameGroup();
+		float Points[4];
+		RenderTools()->MapscreenToWorld(Center.x, Center.y, pGameGroup->m_ParallaxX/100.0f, pGameGroup->m_ParallaxY/100.0f,
+			pGameGroup->m_OffsetX, pGameGroup->m_OffsetY, Graphics()->ScreenAspect(), m_pClient->m_pCamera->m_Zoom, Points);
+		float x0 = (pGroup->m_ClipX - Points[0]) / (Points[2]-Points[0]);
+		float y0 = (pGroup->m_ClipY - Points[1]) / (Points[3]-Points[1]);
+		float x1 = ((pGroup->m_ClipX+pGroup->m_ClipW) - Points[0]) / (Points[2]-Points[0]);
+		float y1 = ((pGroup->m_ClipY+pGroup->m_ClipH) - Points[1]) / (Points[3]-Points[1]);
+
+		pView->m_ClipEnable = 1;
+		pView->m_aClip[0] = (int)(x0*Graphics()->ScreenWidth());
+		pView->m_aClip[1] = (int)(y0*Graphics()->ScreenHeight());
+		pView->m_aClip[2] = (int)((x1-x0)*Graphics()->ScreenWidth());
+		pView->m_aClip[3] = (int)((y1-y0)*Graphics()->ScreenHeight());
+	}
+
+	float Zoom = m_pClient->m_pCamera->m_Zoom;
+	if(!g_Config.m_ClZoomBackgroundLayers && !pGroup->m_ParallaxX && !pGroup->m_ParallaxY)
+		Zoom = 1.0f;
+	RenderTools()->MapscreenToWorld(Center.x, Center.y, pGroup->m_ParallaxX/100.0f, pGroup->m_ParallaxY/100.0f,
+		pGroup->m_OffsetX, pGroup->m_OffsetY, Graphics()->ScreenAspect(), Zoom, pView->m_aScreen);
+}
+
+int CMapLayers::UpdateCache(vec2 Center, bool *pRedraw)
+{
+	*pRedraw = false;
+
+	// the entity background is drawn below by CBackground
+	int Mode = m_Type == TYPE_BACKGROUND ? g_Config.m_GfxLayerCache : 0;
+	if(Mode != m_CacheMode)
+	{
+		if(m_CacheTarget != -1)
+			Graphics()->UnloadTexture(m_CacheTarget);
+		m_CacheTarget = -1;
+		m_CacheMode = Mode;
+		m_NumCachedGroups = 0;
+		if(Mode)
+		{
+			int Div = Mode == 1 ? 2 : 1;
+			m_CacheTarget = Graphics()->CreateRenderTarget(Graphics()->ScreenWidth()/Div, Graphics()->ScreenHeight()/Div);
+		}
+	}
+	if(m_CacheTarget == -1 || g_Config.m_ClOverlayEntities == 100)
+		return 0;
+
+	// a group is only worth caching once its view held still for a frame
+	int NumStable = 0;
+	bool SameViews = true;
+	for(int g = 0; g < m_NumStaticGroups; g++)
+	{
+		CGroupView View;
+		GetGroupView(m_pLayers->GetGroup(g), Center, &View);
+		if(NumStable == g && mem_comp(&View, &m_aLastViews[g], sizeof(View)) == 0)
+			NumStable++;
+		if(g < m_NumCachedGroups && mem_comp(&View, &m_aCachedViews[g], sizeof(View)) != 0)
+			SameViews = false;
+		m_aLastViews[g] = View;
+	}
+	if(!NumStable)
+		return 0;
+
+	int Settings = m_pClient->HighDetail() | g_Config.m_ClShowQuads<<1 | g_Config.m_GfxNoclip<<2 | g_Config.m_ClOverlayEntities<<3;
+	if(NumStable != m_NumCachedGroups || !SameViews || Settings != m_CacheSettings || !Graphics()->RenderTargetValid(m_CacheTarget))
+	{
+		m_NumCachedGroups = NumStable;
+		m_CacheSettings = Settings;
+		mem_copy(m_aCachedViews, m_aLastViews, sizeof(CGroupView)*NumStable);
+		*pRedraw = true;
+	}
+	return m_NumCachedGroups;
+}
+
+void CMapLayers::DrawCache()
+{
+	// the target holds the whole screen
+	Graphics()->MapScreen(0, 0, 1, 1);
+	Graphics()->TextureSet(m_CacheTarget);
+	Graphics()->BlendNone();
+	Graphics()->WrapClamp();
+	Graphics()->QuadsBegin();
+	IGraphics::CQuadItem QuadItem(0, 0, 1, 1);
+	Graphics()->QuadsDrawTL(&QuadItem, 1);
+	Graphics()->QuadsEnd();
+	Graphics()->WrapNormal();
+	Graphics()->BlendNormal();
+}
+
 void CMapLayers::EnvelopeUpdate()
 {
 	if(Client()->State() == IClient::STATE_DEMOPLAYBACK)
@@ -52,6 +219,29 @@ void CMapLayers::MapScreenToGroup(float CenterX, float CenterY, CMapItemGroup *p
 	Graphics()->MapScreen(Points[0], Points[1], Points[2], Points[3]);
 }
 
+void CMapLayers::EvalEnvelope(int Env, const CMapItemEnvelope *pItem, CEnvPoint *pPoints, float Time, float *pChannels)
+{
+	if(Env >= m_lEnvelopeMemo.size())
+	{
+		int OldSize = m_lEnvelopeMemo.size();
+		m_lEnvelopeMemo.set_size(Env+1);
+		for(int i = OldSize; i < m_lEnvelopeMemo.size(); i++)
+			m_lEnvelopeMemo[i].m_pItem = 0;
+	}
+
+	CEnvelopeMemo *pMemo = &m_lEnvelopeMemo[Env];
+	if(pMemo->m_pItem == pItem && pMemo->m_Time == Time)
+	{
+		mem_copy(pChannels, pMemo->m_aResult, sizeof(pMemo->m_aResult));
+		return;
+	}
+
+	RenderTools()->RenderEvalEnvelope(pPoints+pItem->m_StartPoint, pItem->m_NumPoints, 4, Time, pChannels);
+	pMemo->m_pItem = pItem;
+	pMemo->m_Time = Time;
+	mem_copy(pMemo->m_aResult, pChannels, sizeof(pMemo->m_aResult));
+}
+
 void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void *pUser)
 {
 	CMapLayers *pThis = (CMapLayers *)pUser;
@@ -96,7 +286,7 @@ void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void
 						pThis->Client()->IntraGameTick());
 		}
 
-		pThis->RenderTools()->RenderEvalEnvelope(pPoints+pItem->m_StartPoint, pItem->m_NumPoints, 4, s_Time+TimeOffset, pChannels);
+		pThis->EvalEnvelope(Env, pItem, pPoints, s_Time+TimeOffset, pChannels);
 	}
 	else
 	{
@@ -111,7 +301,7 @@ void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void
 			else
 				s_Time += pThis->Client()->LocalTime()-s_LastLocalTime;
 		}
-		pThis->RenderTools()->RenderEvalEnvelope(pPoints+pItem->m_StartPoint, pItem->m_NumPoints, 4, s_Time+TimeOffset, pChannels);
+		pThis->EvalEnvelope(Env, pItem, pPoints, s_Time+TimeOffset, pChannels);
 		s_LastLocalTime = pThis->Client()->LocalTime();
 	}
 }
@@ -128,8 +318,23 @@ void CMapLayers::OnRender()
 
 	bool PassedGameLayer = false;
 
+	// the first groups come from the cache, drawn into it again when they changed
+	bool RedrawCache;
+	int NumCached = UpdateCache(Center, &RedrawCache);
+	if(RedrawCache)
+		Graphics()->RenderTargetBegin(m_CacheTarget);
+
 	for(int g = 0; g < m_pLayers->NumGroups(); g++)
 	{
+		if(NumCached && g == NumCached)
+		{
+			if(RedrawCache)
+				Graphics()->RenderTargetEnd();
+			DrawCache();
+		}
+		if(g < NumCached && !RedrawCache)
+			continue;
+
 		CMapItemGroup *pGroup = m_pLayers->GetGroup(g);
 
 		if(!pGroup)
@@ -140,25 +345,11 @@ void CMapLayers::OnRender()
 			continue;
 		}
 
-		if(!g_Config.m_GfxNoclip && pGroup->m_Version >= 2 && pGroup->m_UseClipping)
-		{
-			// set clipping
-			float Points[4];
-			MapScreenToGroup(Center.x, Center.y, m_pLayers->GameGroup(), m_pClient->m_pCamera->m_Zoom);
-			Graphics()->GetScreen(&Points[0], &Points[1], &Points[2], &Points[3]);
-			float x0 = (pGroup->m_ClipX - Points[0]) / (Points[2]-Points[0]);
-			float y0 = (pGroup->m_ClipY - Points[1]) / (Points[3]-Points[1]);
-			float x1 = ((pGroup->m_ClipX+pGroup->m_ClipW) - Points[0]) / (Points[2]-Points[0]);
-			float y1 = ((pGroup->m_ClipY+pGroup->m_ClipH) - Points[1]) / (Points[3]-Points[1]);
-
-			Graphics()->ClipEnable((int)(x0*Graphics()->ScreenWidth()), (int)(y0*Graphics()->ScreenHeight()),
-				(int)((x1-x0)*Graphics()->ScreenWidth()), (int)((y1-y0)*Graphics()->ScreenHeight()));
-		}
-
-		if(!g_Config.m_ClZoomBackgroundLayers && !pGroup->m_ParallaxX && !pGroup->m_ParallaxY)
-			MapScreenToGroup(Center.x, Center.y, pGroup, 1.0);
-		else
-			MapScreenToGroup(Center.x, Center.y, pGroup, m_pClient->m_pCamera->m_Zoom);
+		CGroupView View;
+		GetGroupView(pGroup, Center, &View);
+		if(View.m_ClipEnable)
+			Graphics()->ClipEnable(View.m_aClip[0], View.m_aClip[1], View.m_aClip[2], View.m_aClip[3]);
+		Graphics()->MapScreen(View.m_aScreen[0], View.m_aScreen[1], View.m_aScreen[2], View.m_aScreen[3]);
 
 		for(int l = 0; l < pGroup->m_NumLayers; l++)
 		{
@@ -193,7 +384,7 @@ void CMapLayers::OnRender()
 				IsTuneLayer = true;
 
 			// skip rendering if detail layers if not wanted
-			if(pLayer->m_Flags&LAYERFLAG_DETAIL && !g_Config.m_GfxHighDetail && !IsGameLayer)
+			if(pLayer->m_Flags&LAYERFLAG_DETAIL && !m_pClient->HighDetail() && !IsGameLayer)
 				continue;
 
 			if(m_Type == -1)
@@ -275,9 +466,11 @@ void CMapLayers::OnRender()
 					CQuad *pQuads = (CQuad *)m_pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
 
 					Graphics()->BlendNone();
-					RenderTools()->RenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_OPAQUE, EnvelopeEval, this);
+					RenderTools()->RenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_OPAQUE, EnvelopeEval, this,
+						m_pLayers->Map(), pGroup->m_StartLayer+l);
 					Graphics()->BlendNormal();
-					RenderTools()->RenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_TRANSPARENT, EnvelopeEval, this);
+					RenderTools()->RenderQuads(pQuads, pQLayer->m_NumQuads, LAYERRENDERFLAG_TRANSPARENT, EnvelopeEval, this,
+						m_pLayers->Map(), pGroup->m_StartLayer+l);
 				}
 			}
 			else if(Render && g_Config.m_ClOverlayEntities && IsFrontLayer)
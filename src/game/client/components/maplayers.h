@@ -2,6 +2,8 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_MAPLAYERS_H
 #define GAME_CLIENT_COMPONENTS_MAPLAYERS_H
+#include <base/tl/array.h>
+
 #include <game/client/component.h>
 
 class CMapLayers : public CComponent
@@ -14,7 +16,46 @@ class CMapLayers : public CComponent
 	int m_LastLocalTick;
 	bool m_EnvelopeUpdate;
 
+	// the last result of every envelope, quads sharing one evaluate it once per frame
+	struct CEnvelopeMemo
+	{
+		const struct CMapItemEnvelope *m_pItem; // 0 when nothing is stored
+		float m_Time;
+		float m_aResult[4];
+	};
+	array<CEnvelopeMemo> m_lEnvelopeMemo;
+
+	enum
+	{
+		MAX_CACHED_GROUPS=32,
+	};
+
+	// where a group ends up on the screen
+	struct CGroupView
+	{
+		float m_aScreen[4];
+		int m_ClipEnable;
+		int m_aClip[4];
+	};
+
+	// the leading background groups draw the same for the same view, they
+	// are kept in a render target while their views stay the same
+	int m_NumStaticGroups;
+	int m_CacheTarget;
+	int m_CacheMode; // gfx_layer_cache the target was made for
+	int m_NumCachedGroups; // 0 when the target holds nothing
+	int m_CacheSettings;
+	CGroupView m_aCachedViews[MAX_CACHED_GROUPS];
+	CGroupView m_aLastViews[MAX_CACHED_GROUPS];
+
 	void MapScreenToGroup(float CenterX, float CenterY, CMapItemGroup *pGroup, float Zoom = 1.0f);
+	void GetGroupView(CMapItemGroup *pGroup, vec2 Center, CGroupView *pView);
+	bool IsStaticEnvelope(int Env);
+	bool IsStaticGroup(CMapItemGroup *pGroup);
+	int UpdateCache(vec2 Center, bool *pRedraw);
+	void DrawCache();
+	void EvalEnvelope(int Env, const struct CMapItemEnvelope *pItem, CEnvPoint *pPoints, float Time, float *pChannels);
+	void ClearEnvelopeMemo() { m_lEnvelopeMemo.clear(); }
 public:
 	enum
 	{
@@ -24,6 +65,7 @@ public:
 
 	CMapLayers(int Type);
 	virtual void OnInit();
+	virtual void OnMapLoad();
 	virtual void OnRender();
 
 	void EnvelopeUpdate();
@@ -8,6 +8,7 @@
 #include <game/client/gameclient.h>
 #include <game/client/animstate.h>
 #include "nameplates.h"
+#include "camera.h"
 #include "controls.h"
 
 void CNamePlates::RenderNameplate(
@@ -20,6 +21,10 @@ void CNamePlates::RenderNameplate(
 
 	vec2 Position = mix(vec2(pPrevChar->m_X, pPrevChar->m_Y), vec2(pPlayerChar->m_X, pPlayerChar->m_Y), IntraTick);
 
+	// the frame governor keeps only the ones close to the middle of the screen
+	if(m_pClient->m_FrameGovernor.Reduced(CFrameGovernor::STEP_NAMEPLATES) && distance(m_pClient->m_pCamera->m_Center, Position) > 400.0f)
+		return;
+
 	bool OtherTeam;
 
 	if (m_pClient->m_aClients[m_pClient->m_Snap.m_LocalClientID].m_Team == TEAM_SPECTATORS && m_pClient->m_Snap.m_SpecInfo.m_SpectatorID == SPEC_FREEVIEW)
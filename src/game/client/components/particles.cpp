@@ -30,6 +30,7 @@ void CParticles::OnReset()
 	m_aParticles[0].m_PrevPart = 0;
 	m_aParticles[MAX_PARTICLES-1].m_NextPart = -1;
 	m_FirstFree = 0;
+	m_NumParticles = 0;
 
 	for(int i = 0; i < NUM_GROUPS; i++)
 		m_aFirstPart[i] = -1;
@@ -52,6 +53,9 @@ void CParticles::Add(int Group, CParticle *pPart)
 	if (m_FirstFree == -1)
 		return;
 
+	if(m_NumParticles >= REDUCED_PARTICLES && m_pClient->m_FrameGovernor.Reduced(CFrameGovernor::STEP_PARTICLES))
+		return;
+
 	// remove from the free list
 	int Id = m_FirstFree;
 	m_FirstFree = m_aParticles[Id].m_NextPart;
@@ -60,6 +64,7 @@ void CParticles::Add(int Group, CParticle *pPart)
 
 	// copy data
 	m_aParticles[Id] = *pPart;
+	m_NumParticles++;
 
 	// insert to the group list
 	m_aParticles[Id].m_PrevPart = -1;
@@ -125,6 +130,7 @@ void CParticles::Update(float TimePassed)
 				m_aParticles[i].m_PrevPart = -1;
 				m_aParticles[i].m_NextPart = m_FirstFree;
 				m_FirstFree = i;
+				m_NumParticles--;
 			}
 
 			i = Next;
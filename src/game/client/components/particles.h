@@ -72,10 +72,12 @@ private:
 	enum
 	{
 		MAX_PARTICLES=1024*8,
+		REDUCED_PARTICLES=512, // while the frame governor caps them
 	};
 
 	CParticle m_aParticles[MAX_PARTICLES];
 	int m_FirstFree;
+	int m_NumParticles;
 	int m_aFirstPart[NUM_GROUPS];
 
 	void RenderGroup(int Group);
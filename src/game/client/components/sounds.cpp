@@ -12,6 +12,9 @@
 #include <game/client/components/menus.h>
 #include "sounds.h"
 
+static const float COALESCE_DISTANCE = 64.0f;
+static const float MAX_EVENT_POWER = 4.0f; // twice as loud as one sound
+
 
 struct CUserData
 {
@@ -75,6 +78,9 @@ void CSounds::OnInit()
 	Sound()->SetListenerPos(0.0f, 0.0f);
 
 	ClearQueue();
+	m_NumEvents = 0;
+	m_NumRequested = m_NumCoalesced = 0;
+	m_LastRequested = m_LastCoalesced = 0;
 
 	// load sounds
 	if(g_Config.m_ClThreadsoundloading)
@@ -99,6 +105,7 @@ void CSounds::OnReset()
 	{
 		Sound()->StopAll();
 		ClearQueue();
+		m_NumEvents = 0;
 	}
 }
 
@@ -130,6 +137,10 @@ void CSounds::OnRender()
 		Sound()->SetChannel(CSounds::CHN_MAPSOUND, m_MapSoundVolume, 1.0f);
 	}
 
+	m_LastRequested = m_NumRequested;
+	m_LastCoalesced = m_NumCoalesced;
+	m_NumRequested = m_NumCoalesced = 0;
+
 	// play sound from queue
 	if(m_QueuePos > 0)
 	{
@@ -178,15 +189,7 @@ void CSounds::Play(int Chn, int SetId, float Vol)
 	if(Chn == CHN_MUSIC && !g_Config.m_SndMusic)
 		return;
 
-	int SampleId = GetSampleId(SetId);
-	if(SampleId == -1)
-		return;
-
-	int Flags = 0;
-	if(Chn == CHN_MUSIC)
-		Flags = ISound::FLAG_LOOP;
-
-	Sound()->Play(Chn, SampleId, Flags);
+	AddEvent(Chn, SetId, false, vec2(0.0f, 0.0f));
 }
 
 void CSounds::PlayAt(int Chn, int SetId, float Vol, vec2 Pos)
@@ -194,15 +197,64 @@ void CSounds::PlayAt(int Chn, int SetId, float Vol, vec2 Pos)
 	if(Chn == CHN_MUSIC && !g_Config.m_SndMusic)
 		return;
 
-	int SampleId = GetSampleId(SetId);
-	if(SampleId == -1)
-		return;
+	AddEvent(Chn, SetId, true, Pos);
+}
 
-	int Flags = 0;
-	if(Chn == CHN_MUSIC)
-		Flags = ISound::FLAG_LOOP;
+void CSounds::AddEvent(int Chn, int SetId, bool Positional, vec2 Pos)
+{
+	m_NumRequested++;
+
+	for(int i = 0; i < m_NumEvents; i++)
+	{
+		CEvent *pEvent = &m_aEvents[i];
+		if(pEvent->m_Channel == Chn && pEvent->m_SetId == SetId && pEvent->m_Positional == Positional &&
+			(!Positional || distance(pEvent->m_Pos, Pos) < COALESCE_DISTANCE))
+		{
+			// sounds that don't line up add up in power
+			pEvent->m_Power = min(pEvent->m_Power+1.0f, MAX_EVENT_POWER);
+			m_NumCoalesced++;
+			return;
+		}
+	}
+
+	if(m_NumEvents == MAX_EVENTS)
+		FlushEvents();
+
+	CEvent *pEvent = &m_aEvents[m_NumEvents++];
+	pEvent->m_Channel = Chn;
+	pEvent->m_SetId = SetId;
+	pEvent->m_Positional = Positional;
+	pEvent->m_Pos = Pos;
+	pEvent->m_Power = 1.0f;
+}
+
+void CSounds::FlushEvents()
+{
+	ISound::CSoundEvent aEvents[MAX_EVENTS];
+	int Num = 0;
+	for(int i = 0; i < m_NumEvents; i++)
+	{
+		const CEvent *pEvent = &m_aEvents[i];
+		int SampleId = GetSampleId(pEvent->m_SetId);
+		if(SampleId == -1)
+			continue;
+
+		ISound::CSoundEvent *pOut = &aEvents[Num++];
+		pOut->m_Channel = pEvent->m_Channel;
+		pOut->m_SampleID = SampleId;
+		pOut->m_Flags = 0;
+		if(pEvent->m_Channel == CHN_MUSIC)
+			pOut->m_Flags |= ISound::FLAG_LOOP;
+		if(pEvent->m_Positional)
+			pOut->m_Flags |= ISound::FLAG_POS;
+		pOut->m_X = pEvent->m_Pos.x;
+		pOut->m_Y = pEvent->m_Pos.y;
+		pOut->m_Volume = sqrtf(pEvent->m_Power);
+	}
+	m_NumEvents = 0;
 
-	Sound()->PlayAt(Chn, SampleId, Flags, Pos.x, Pos.y);
+	if(Num)
+		Sound()->PlayEvents(aEvents, Num);
 }
 
 void CSounds::Stop(int SetId)
@@ -210,6 +262,13 @@ void CSounds::Stop(int SetId)
 	if(m_WaitForSoundJob || SetId < 0 || SetId >= g_pData->m_NumSounds)
 		return;
 
+	// a play of this set that hasn't been flushed yet would start after the stop
+	int Num = 0;
+	for(int i = 0; i < m_NumEvents; i++)
+		if(m_aEvents[i].m_SetId != SetId)
+			m_aEvents[Num++] = m_aEvents[i];
+	m_NumEvents = Num;
+
 	CDataSoundset *pSet = &g_pData->m_aSounds[SetId];
 
 	for(int i = 0; i < pSet->m_NumSounds; i++)
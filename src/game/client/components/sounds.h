@@ -10,6 +10,7 @@ class CSounds : public CComponent
 	enum
 	{
 		QUEUE_SIZE = 32,
+		MAX_EVENTS = 64,
 	};
 	struct QueueEntry
 	{
@@ -21,7 +22,25 @@ class CSounds : public CComponent
 	class CJob m_SoundJob;
 	bool m_WaitForSoundJob;
 
+	// sounds played this frame, the same sound close to one that is
+	// already there makes it louder instead of taking another voice
+	struct CEvent
+	{
+		int m_Channel;
+		int m_SetId;
+		bool m_Positional;
+		vec2 m_Pos;
+		float m_Power; // sum of the squared volumes
+	};
+	CEvent m_aEvents[MAX_EVENTS];
+	int m_NumEvents;
+	int m_NumRequested;
+	int m_NumCoalesced;
+	int m_LastRequested;
+	int m_LastCoalesced;
+
 	int GetSampleId(int SetId);
+	void AddEvent(int Channel, int SetId, bool Positional, vec2 Pos);
 
 	float m_MapSoundVolume;
 
@@ -48,6 +67,11 @@ public:
 	void PlayAndRecord(int Channel, int SetId, float Vol, vec2 Pos);
 	void Stop(int SetId);
 
+	// plays this frame's sounds, once per frame
+	void FlushEvents();
+	int NumRequested() const { return m_LastRequested; }
+	int NumCoalesced() const { return m_LastCoalesced; }
+
 	void PlayMusic();
 	void StopMusic();
 
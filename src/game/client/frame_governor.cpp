@@ -0,0 +1,128 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/graphics.h>
+#include <engine/shared/config.h>
+
+#include "frame_governor.h"
+
+static const float SLOW_FACTOR = 1.15f;
+static const float FAST_FACTOR = 1.05f;
+static const float SLOW_TIME = 0.5f;
+static const float SETTLE_TIME = 1.0f;
+static const float RESTORE_DELAY = 4.0f;
+static const float MAX_RESTORE_DELAY = 64.0f;
+
+CFrameGovernor::CFrameGovernor()
+{
+	m_pGraphics = 0;
+	m_Level = 0;
+	m_LogStart = 0;
+	m_NumLog = 0;
+	Reset();
+}
+
+void CFrameGovernor::Reset()
+{
+	if(m_Level && m_pGraphics)
+		m_pGraphics->SetHalfHeight(false);
+	m_Level = 0;
+	m_Average = 0.0f;
+	m_SlowTime = 0.0f;
+	m_FastTime = 0.0f;
+	m_LastChange = -SETTLE_TIME;
+	m_LastRestore = -MAX_RESTORE_DELAY;
+	m_RestoreDelay = RESTORE_DELAY;
+}
+
+const char *CFrameGovernor::StepName(int Step)
+{
+	static const char *s_apNames[NUM_STEPS] = {"detail layers", "particles", "full height", "far nameplates"};
+	return s_apNames[Step];
+}
+
+void CFrameGovernor::Log(const char *pText)
+{
+	if(m_NumLog < MAX_LOG)
+		str_copy(m_aaLog[(m_LogStart+m_NumLog++)%MAX_LOG], pText, sizeof(m_aaLog[0]));
+	else
+	{
+		str_copy(m_aaLog[m_LogStart], pText, sizeof(m_aaLog[0]));
+		m_LogStart = (m_LogStart+1)%MAX_LOG;
+	}
+	dbg_msg("governor", "%s", pText);
+}
+
+void CFrameGovernor::Step(int Level, float Now, const char *pWhy)
+{
+	const bool Up = Level > m_Level;
+
+	// a step the backend can't do is passed over
+	if(!m_pGraphics->SetHalfHeight(Level > STEP_HALF_HEIGHT))
+		Level += Up ? 1 : -1;
+
+	char aBuf[64];
+	if(Up)
+		str_format(aBuf, sizeof(aBuf), "%.1fs %.1f ms %s, drop %s", Now, m_Average*1000.0f, pWhy, StepName(Level-1));
+	else
+		str_format(aBuf, sizeof(aBuf), "%.1fs %.1f ms %s, restore %s", Now, m_Average*1000.0f, pWhy, StepName(m_Level-1));
+	Log(aBuf);
+
+	m_Level = Level;
+	m_LastChange = Now;
+	m_SlowTime = 0.0f;
+	m_FastTime = 0.0f;
+}
+
+void CFrameGovernor::Update(float FrameTime, float Now)
+{
+	if(!g_Config.m_ClFrameGovernor)
+	{
+		if(m_Level)
+		{
+			Log("off, full detail");
+			Reset();
+		}
+		return;
+	}
+
+	m_Average = m_Average > 0.0f ? m_Average*0.9f + FrameTime*0.1f : FrameTime;
+
+	// the average needs a moment to show what the last step changed
+	if(Now - m_LastChange < SETTLE_TIME)
+		return;
+
+	const float Target = 1.0f/g_Config.m_ClFrameGovernorFps;
+	if(m_Average > Target*SLOW_FACTOR)
+	{
+		m_SlowTime += FrameTime;
+		m_FastTime = 0.0f;
+	}
+	else if(m_Average < Target*FAST_FACTOR)
+	{
+		m_FastTime += FrameTime;
+		m_SlowTime = 0.0f;
+	}
+	else
+		m_SlowTime = m_FastTime = 0.0f;
+
+	if(m_SlowTime > SLOW_TIME && m_Level < NUM_STEPS)
+	{
+		// what was given back last did not fit, wait longer next time
+		if(Now - m_LastRestore < m_RestoreDelay + SETTLE_TIME)
+			m_RestoreDelay = min(m_RestoreDelay*2.0f, MAX_RESTORE_DELAY);
+		Step(m_Level+1, Now, "slow");
+	}
+	else if(m_FastTime > m_RestoreDelay)
+	{
+		if(m_Level > 0)
+		{
+			Step(m_Level-1, Now, "fast");
+			m_LastRestore = Now;
+		}
+		else
+			m_RestoreDelay = RESTORE_DELAY;
+	}
+}
@@ -0,0 +1,74 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_FRAME_GOVERNOR_H
+#define GAME_CLIENT_FRAME_GOVERNOR_H
+
+/*
+	Class: CFrameGovernor
+		Trades detail for frame rate while the game can't keep up with
+		cl_frame_governor_fps.
+
+		The moving average of the frame time is compared against the
+		target. When it stays too slow the next step of the ladder is
+		taken, when it meets the target for long enough the last step is
+		given back. A step that had to be taken again right after it was
+		given back waits twice as long before the next try. The decisions
+		are kept for the debug hud.
+
+		The steps are, in this order: skip detail layers, cap the number
+		of particles, draw at half height and hide the nameplates of tees
+		far from the camera. Steps the graphics backend can't do are
+		passed over.
+*/
+class CFrameGovernor
+{
+public:
+	enum
+	{
+		STEP_DETAIL=0,
+		STEP_PARTICLES,
+		STEP_HALF_HEIGHT,
+		STEP_NAMEPLATES,
+		NUM_STEPS,
+
+		MAX_LOG = 4,
+	};
+
+private:
+	class IGraphics *m_pGraphics;
+
+	int m_Level;
+	float m_Average;
+	float m_SlowTime;
+	float m_FastTime;
+	float m_LastChange;
+	float m_LastRestore;
+	float m_RestoreDelay;
+
+	char m_aaLog[MAX_LOG][64];
+	int m_LogStart;
+	int m_NumLog;
+
+	void Step(int Level, float Now, const char *pWhy);
+	void Log(const char *pText);
+
+public:
+	CFrameGovernor();
+	void Init(class IGraphics *pGraphics) { m_pGraphics = pGraphics; }
+
+	// back to full detail
+	void Reset();
+	void Update(float FrameTime, float Now);
+
+	int Level() const { return m_Level; }
+	bool Reduced(int Step) const { return m_Level > Step; }
+	float AverageFrameTime() const { return m_Average; }
+
+	static const char *StepName(int Step);
+
+	// oldest first
+	int NumLog() const { return m_NumLog; }
+	const char *GetLog(int Index) const { return m_aaLog[(m_LogStart+Index)%MAX_LOG]; }
+};
+
+#endif
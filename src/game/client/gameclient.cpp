@@ -280,6 +280,10 @@ void CGameClient::OnInit()
 	m_UI.SetGraphics(Graphics(), TextRender());
 	m_RenderTools.m_pGraphics = Graphics();
 	m_RenderTools.m_pUI = UI();
+	m_RenderTools.m_pTilemapCache = &m_TilemapCache;
+	m_RenderTools.m_pTileOccupancy = &m_TileOccupancy;
+	m_RenderTools.m_pQuadLayerCache = &m_QuadLayerCache;
+	m_FrameGovernor.Init(Graphics());
 
 	int64 Start = time_get();
 
@@ -317,6 +321,16 @@ void CGameClient::OnInit()
 		g_GameClient.m_pMenus->RenderLoading();
 	}
 
+	// the sprite sheets are only drawn through their sprites, so they can share one texture
+	{
+		static const int s_aAtlasImages[] = {IMAGE_GAME, IMAGE_PARTICLES, IMAGE_EMOTICONS, IMAGE_BROWSEICONS,
+			IMAGE_GUIBUTTONS, IMAGE_GUIICONS, IMAGE_FILEICONS, IMAGE_DEMOBUTTONS, IMAGE_DEMOBUTTONS2};
+		int aTextures[sizeof(s_aAtlasImages)/sizeof(s_aAtlasImages[0])];
+		for(unsigned i = 0; i < sizeof(s_aAtlasImages)/sizeof(s_aAtlasImages[0]); i++)
+			aTextures[i] = g_pData->m_aImages[s_aAtlasImages[i]].m_Id;
+		Graphics()->BuildTextureAtlas(aTextures, sizeof(aTextures)/sizeof(aTextures[0]));
+	}
+
 #if defined(__ANDROID__)
 	m_pMapimages->OnMapLoad(); // Reload map textures on Android
 #endif
@@ -409,6 +423,7 @@ void CGameClient::OnConnected()
 	m_Collision.Init(Layers());
 
 	RenderTools()->RenderTilemapGenerateSkip(Layers());
+	m_FrameGovernor.Reset();
 
 	for(int i = 0; i < m_All.m_Num; i++)
 	{
@@ -439,6 +454,9 @@ void CGameClient::OnReset()
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		m_aClients[i].Reset();
 
+	// the map goes with the connection
+	m_QuadLayerCache.Clear(Layers()->Map());
+
 	for(int i = 0; i < m_All.m_Num; i++)
 		m_All.m_paComponents[i]->OnReset();
 
@@ -570,6 +588,10 @@ void CGameClient::OnRender()
 
 	return;*/
 
+	// loading frames say nothing about what the game costs
+	if(Client()->State() == IClient::STATE_ONLINE || Client()->State() == IClient::STATE_DEMOPLAYBACK)
+		m_FrameGovernor.Update(Client()->RenderFrameTime(), Client()->LocalTime());
+
 	// update the local character and spectate position
 	UpdatePositions();
 
@@ -580,6 +602,9 @@ void CGameClient::OnRender()
 	for(int i = 0; i < m_All.m_Num; i++)
 		m_All.m_paComponents[i]->OnRender();
 
+	// the sounds of this frame, snapshot events included
+	m_pSounds->FlushEvents();
+
 	// clear new tick flags
 	m_NewTick = false;
 	m_NewPredictedTick = false;
@@ -9,6 +9,10 @@
 #include <game/layers.h>
 #include <game/gamecore.h>
 #include "render.h"
+#include "frame_governor.h"
+#include "quadlayer_cache.h"
+#include "tile_occupancy.h"
+#include "tilemap_cache.h"
 
 #include <game/teamscore.h>
 
@@ -286,6 +290,13 @@ public:
 	CClientStats m_aStats[MAX_CLIENTS];
 
 	CRenderTools m_RenderTools;
+	CTilemapCache m_TilemapCache;
+	CTileOccupancy m_TileOccupancy;
+	CQuadLayerCache m_QuadLayerCache;
+	CFrameGovernor m_FrameGovernor;
+
+	// gfx_high_detail unless the frame governor dropped the detail layers
+	bool HighDetail() const { return g_Config.m_GfxHighDetail && !m_FrameGovernor.Reduced(CFrameGovernor::STEP_DETAIL); }
 
 	void OnReset();
 
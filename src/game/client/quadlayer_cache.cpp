@@ -0,0 +1,103 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <game/layers.h>
+
+#include "quadlayer_cache.h"
+
+CQuadLayerCache::CQuadLayerCache()
+{
+	m_NumQuads = 0;
+	m_NumStatic = 0;
+}
+
+CQuadLayerCache::~CQuadLayerCache()
+{
+	Clear();
+}
+
+void CQuadLayerCache::Init(CLayers *pLayers)
+{
+	Clear(pLayers->Map());
+
+	for(int g = 0; g < pLayers->NumGroups(); g++)
+	{
+		CMapItemGroup *pGroup = pLayers->GetGroup(g);
+		if(!pGroup)
+			continue;
+
+		for(int l = 0; l < pGroup->m_NumLayers; l++)
+		{
+			CMapItemLayer *pLayer = pLayers->GetLayer(pGroup->m_StartLayer+l);
+			if(pLayer->m_Type != LAYERTYPE_QUADS)
+				continue;
+
+			CMapItemLayerQuads *pQLayer = (CMapItemLayerQuads *)pLayer;
+			if(pQLayer->m_NumQuads <= 0)
+				continue;
+
+			const CQuad *pQuads = (CQuad *)pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
+			CLayer Layer;
+			Layer.m_pMap = pLayers->Map();
+			Layer.m_Layer = pGroup->m_StartLayer+l;
+			Layer.m_NumQuads = pQLayer->m_NumQuads;
+			Layer.m_pItems = (IGraphics::CColoredFreeformItem *)mem_alloc(Layer.m_NumQuads*sizeof(IGraphics::CColoredFreeformItem), 1);
+			Layer.m_pAnimated = (int *)mem_alloc(Layer.m_NumQuads*sizeof(int), 1);
+			Layer.m_NumAnimated = 0;
+			Layer.m_Alpha = -1.0f;
+
+			for(int q = 0; q < Layer.m_NumQuads; q++)
+				if(pQuads[q].m_PosEnv >= 0 || pQuads[q].m_ColorEnv >= 0)
+					Layer.m_pAnimated[Layer.m_NumAnimated++] = q;
+
+			m_lLayers.add(Layer);
+		}
+	}
+
+	CountQuads();
+	dbg_msg("quadlayers", "%d of %d quads in %d layers are static", m_NumStatic, m_NumQuads, m_lLayers.size());
+}
+
+void CQuadLayerCache::CountQuads()
+{
+	m_NumQuads = 0;
+	m_NumStatic = 0;
+	for(int i = 0; i < m_lLayers.size(); i++)
+	{
+		m_NumQuads += m_lLayers[i].m_NumQuads;
+		m_NumStatic += m_lLayers[i].m_NumQuads - m_lLayers[i].m_NumAnimated;
+	}
+}
+
+void CQuadLayerCache::Clear(const IMap *pMap)
+{
+	for(int i = 0; i < m_lLayers.size(); i++)
+		if(m_lLayers[i].m_pMap == pMap)
+		{
+			_mem_free(m_lLayers[i].m_pItems);
+			_mem_free(m_lLayers[i].m_pAnimated);
+			m_lLayers.remove_index(i--);
+		}
+	CountQuads();
+}
+
+void CQuadLayerCache::Clear()
+{
+	for(int i = 0; i < m_lLayers.size(); i++)
+	{
+		_mem_free(m_lLayers[i].m_pItems);
+		_mem_free(m_lLayers[i].m_pAnimated);
+	}
+	m_lLayers.clear();
+	m_NumQuads = 0;
+	m_NumStatic = 0;
+}
+
+CQuadLayerCache::CLayer *CQuadLayerCache::Find(const IMap *pMap, int Layer, int NumQuads)
+{
+	for(int i = 0; i < m_lLayers.size(); i++)
+		if(m_lLayers[i].m_pMap == pMap && m_lLayers[i].m_Layer == Layer && m_lLayers[i].m_NumQuads == NumQuads)
+			return &m_lLayers[i];
+	return 0;
+}
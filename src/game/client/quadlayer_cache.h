@@ -0,0 +1,59 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_QUADLAYER_CACHE_H
+#define GAME_CLIENT_QUADLAYER_CACHE_H
+
+#include <base/tl/array.h>
+
+#include <engine/graphics.h>
+#include <game/mapitems.h>
+
+/*
+	Class: CQuadLayerCache
+		Keeps the quads of the map's quad layers as ready to draw items.
+
+		Init splits the quads of every layer into static ones, which use
+		no envelopes, and animated ones. Layers are found by their map and
+		index, the menu background can be cached next to the game map. A static quad is built once,
+		with the overlay alpha it is drawn with, and stays as it is. Only
+		the animated quads are built again every frame, and then the whole
+		layer goes to the graphics in one call.
+*/
+class CQuadLayerCache
+{
+public:
+	struct CLayer
+	{
+		const class IMap *m_pMap;
+		int m_Layer;
+		int m_NumQuads;
+		IGraphics::CColoredFreeformItem *m_pItems;
+		int *m_pAnimated; // indices of the quads with envelopes
+		int m_NumAnimated;
+		float m_Alpha; // what the static quads were built with, -1 before the first draw
+	};
+
+private:
+	array<CLayer> m_lLayers;
+	int m_NumQuads;
+	int m_NumStatic;
+
+	void CountQuads();
+
+public:
+	CQuadLayerCache();
+	~CQuadLayerCache();
+
+	// replaces what was cached for the map of the layers
+	void Init(class CLayers *pLayers);
+	void Clear(const class IMap *pMap);
+	void Clear();
+
+	// returns 0 for layers that were not cached
+	CLayer *Find(const class IMap *pMap, int Layer, int NumQuads);
+
+	int NumQuads() const { return m_NumQuads; }
+	int NumStaticQuads() const { return m_NumStatic; }
+};
+
+#endif
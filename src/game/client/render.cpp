@@ -11,7 +11,10 @@
 #include <game/generated/protocol.h>
 #include <game/layers.h>
 #include "animstate.h"
+#include "quadlayer_cache.h"
 #include "render.h"
+#include "tile_occupancy.h"
+#include "tilemap_cache.h"
 
 static float gs_SpriteWScale;
 static float gs_SpriteHScale;
@@ -341,6 +344,14 @@ void CRenderTools::MapscreenToWorld(float CenterX, float CenterY, float Parallax
 
 void CRenderTools::RenderTilemapGenerateSkip(class CLayers *pLayers)
 {
+	// a new map might reuse the memory of the old layers
+	if(m_pTilemapCache)
+		m_pTilemapCache->Clear();
+	if(m_pTileOccupancy)
+		m_pTileOccupancy->Clear();
+	if(m_pQuadLayerCache)
+		m_pQuadLayerCache->Init(pLayers);
+
 	for(int g = 0; g < pLayers->NumGroups(); g++)
 	{
 		CMapItemGroup *pGroup = pLayers->GetGroup(g);
@@ -46,6 +46,12 @@ class CRenderTools
 public:
 	class IGraphics *m_pGraphics;
 	class CUI *m_pUI;
+	// optional, only for layers that don't change behind their back
+	class CTilemapCache *m_pTilemapCache;
+	class CTileOccupancy *m_pTileOccupancy;
+	class CQuadLayerCache *m_pQuadLayerCache;
+
+	CRenderTools() : m_pGraphics(0), m_pUI(0), m_pTilemapCache(0), m_pTileOccupancy(0), m_pQuadLayerCache(0) {}
 
 	class IGraphics *Graphics() const { return m_pGraphics; }
 	class CUI *UI() const { return m_pUI; }
@@ -73,8 +79,9 @@ public:
 
 	// map render methods (gc_render_map.cpp)
 	static void RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Channels, float Time, float *pResult);
-	void RenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser);
-	void ForceRenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser, float Alpha = 1.0f);
+	// quads of a map layer, pMap and Layer find its prebuilt quads in the quad layer cache
+	void RenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser, const class IMap *pMap = 0, int Layer = -1);
+	void ForceRenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser, float Alpha = 1.0f, const class IMap *pMap = 0, int Layer = -1);
 	void RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
 
 	// helpers
@@ -5,6 +5,9 @@
 #include <engine/graphics.h>
 
 #include "render.h"
+#include "quadlayer_cache.h"
+#include "tile_occupancy.h"
+#include "tilemap_cache.h"
 
 #include <engine/textrender.h>
 #include <engine/shared/config.h>
@@ -32,8 +35,21 @@ void CRenderTools::RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Cha
 	}
 
 	Time = fmod(Time, pPoints[NumPoints-1].m_Time/1000.0f)*1000.0f;
-	for(int i = 0; i < NumPoints-1; i++)
+
+	// the points are sorted by time, find the first segment that ends at or after it
+	int First = 0, Last = NumPoints-1;
+	while(First < Last)
 	{
+		int Mid = (First+Last)/2;
+		if(pPoints[Mid+1].m_Time >= Time)
+			Last = Mid;
+		else
+			First = Mid+1;
+	}
+
+	if(First < NumPoints-1)
+	{
+		int i = First;
 		if(Time >= pPoints[i].m_Time && Time <= pPoints[i+1].m_Time)
 		{
 			float Delta = pPoints[i+1].m_Time-pPoints[i].m_Time;
@@ -83,99 +99,123 @@ static void Rotate(CPoint *pCenter, CPoint *pPoint, float Rotation)
 	pPoint->y = (int)(x * sinf(Rotation) + y * cosf(Rotation) + pCenter->y);
 }
 
-void CRenderTools::RenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser)
+void CRenderTools::RenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, const IMap *pMap, int Layer)
 {
 	if(!g_Config.m_ClShowQuads || g_Config.m_ClOverlayEntities == 100)
 		return;
 
-	ForceRenderQuads(pQuads, NumQuads, RenderFlags, pfnEval, pUser, (100-g_Config.m_ClOverlayEntities)/100.0f);
+	ForceRenderQuads(pQuads, NumQuads, RenderFlags, pfnEval, pUser, (100-g_Config.m_ClOverlayEntities)/100.0f, pMap, Layer);
 }
 
-void CRenderTools::ForceRenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, float Alpha)
+// everything a quad is drawn with, envelopes applied
+static void BuildQuad(const CQuad *q, float Alpha, ENVELOPE_EVAL pfnEval, void *pUser, IGraphics::CColoredFreeformItem *pItem)
 {
-	Graphics()->QuadsBegin();
 	float Conv = 1/255.0f;
-	for(int i = 0; i < NumQuads; i++)
+	float r=1, g=1, b=1, a=1;
+
+	if(q->m_ColorEnv >= 0)
 	{
-		CQuad *q = &pQuads[i];
+		float aChannels[4];
+		pfnEval(q->m_ColorEnvOffset/1000.0f, q->m_ColorEnv, aChannels, pUser);
+		r = aChannels[0];
+		g = aChannels[1];
+		b = aChannels[2];
+		a = aChannels[3];
+	}
 
-		float r=1, g=1, b=1, a=1;
+	float OffsetX = 0;
+	float OffsetY = 0;
+	float Rot = 0;
 
-		if(q->m_ColorEnv >= 0)
-		{
-			float aChannels[4];
-			pfnEval(q->m_ColorEnvOffset/1000.0f, q->m_ColorEnv, aChannels, pUser);
-			r = aChannels[0];
-			g = aChannels[1];
-			b = aChannels[2];
-			a = aChannels[3];
-		}
+	// TODO: fix this
+	if(q->m_PosEnv >= 0)
+	{
+		float aChannels[4];
+		pfnEval(q->m_PosEnvOffset/1000.0f, q->m_PosEnv, aChannels, pUser);
+		OffsetX = aChannels[0];
+		OffsetY = aChannels[1];
+		Rot = aChannels[2]/360.0f*pi*2;
+	}
 
-		bool Opaque = false;
-		/* TODO: Analyze quadtexture
-		if(a < 0.01f || (q->m_aColors[0].a < 0.01f && q->m_aColors[1].a < 0.01f && q->m_aColors[2].a < 0.01f && q->m_aColors[3].a < 0.01f))
-			Opaque = true;
-		*/
-		if(Opaque && !(RenderFlags&LAYERRENDERFLAG_OPAQUE))
-			continue;
-		if(!Opaque && !(RenderFlags&LAYERRENDERFLAG_TRANSPARENT))
-			continue;
-
-		Graphics()->QuadsSetSubsetFree(
-			fx2f(q->m_aTexcoords[0].x), fx2f(q->m_aTexcoords[0].y),
-			fx2f(q->m_aTexcoords[1].x), fx2f(q->m_aTexcoords[1].y),
-			fx2f(q->m_aTexcoords[2].x), fx2f(q->m_aTexcoords[2].y),
-			fx2f(q->m_aTexcoords[3].x), fx2f(q->m_aTexcoords[3].y)
-		);
-
-		float OffsetX = 0;
-		float OffsetY = 0;
-		float Rot = 0;
-
-		// TODO: fix this
-		if(q->m_PosEnv >= 0)
-		{
-			float aChannels[4];
-			pfnEval(q->m_PosEnvOffset/1000.0f, q->m_PosEnv, aChannels, pUser);
-			OffsetX = aChannels[0];
-			OffsetY = aChannels[1];
-			Rot = aChannels[2]/360.0f*pi*2;
-		}
+	CPoint aPoints[4] = {q->m_aPoints[0], q->m_aPoints[1], q->m_aPoints[2], q->m_aPoints[3]};
+	if(Rot != 0)
+	{
+		CPoint Center = q->m_aPoints[4];
+		for(int i = 0; i < 4; i++)
+			Rotate(&Center, &aPoints[i], Rot);
+	}
 
-		IGraphics::CColorVertex Array[4] = {
-			IGraphics::CColorVertex(0, q->m_aColors[0].r*Conv*r, q->m_aColors[0].g*Conv*g, q->m_aColors[0].b*Conv*b, q->m_aColors[0].a*Conv*a*Alpha),
-			IGraphics::CColorVertex(1, q->m_aColors[1].r*Conv*r, q->m_aColors[1].g*Conv*g, q->m_aColors[1].b*Conv*b, q->m_aColors[1].a*Conv*a*Alpha),
-			IGraphics::CColorVertex(2, q->m_aColors[2].r*Conv*r, q->m_aColors[2].g*Conv*g, q->m_aColors[2].b*Conv*b, q->m_aColors[2].a*Conv*a*Alpha),
-			IGraphics::CColorVertex(3, q->m_aColors[3].r*Conv*r, q->m_aColors[3].g*Conv*g, q->m_aColors[3].b*Conv*b, q->m_aColors[3].a*Conv*a*Alpha)};
-		Graphics()->SetColorVertex(Array, 4);
+	for(int i = 0; i < 4; i++)
+	{
+		pItem->m_aX[i] = fx2f(aPoints[i].x)+OffsetX;
+		pItem->m_aY[i] = fx2f(aPoints[i].y)+OffsetY;
+		pItem->m_aU[i] = fx2f(q->m_aTexcoords[i].x);
+		pItem->m_aV[i] = fx2f(q->m_aTexcoords[i].y);
+		pItem->m_aColors[i][0] = q->m_aColors[i].r*Conv*r;
+		pItem->m_aColors[i][1] = q->m_aColors[i].g*Conv*g;
+		pItem->m_aColors[i][2] = q->m_aColors[i].b*Conv*b;
+		pItem->m_aColors[i][3] = q->m_aColors[i].a*Conv*a*Alpha;
+	}
+}
 
-		CPoint *pPoints = q->m_aPoints;
+void CRenderTools::ForceRenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, float Alpha, const IMap *pMap, int Layer)
+{
+	/* TODO: Analyze quadtexture
+	if(a < 0.01f || (q->m_aColors[0].a < 0.01f && q->m_aColors[1].a < 0.01f && q->m_aColors[2].a < 0.01f && q->m_aColors[3].a < 0.01f))
+		Opaque = true;
+	*/
+	// no quad is known to be opaque, they are all drawn in the transparent pass
+	if(!(RenderFlags&LAYERRENDERFLAG_TRANSPARENT))
+		return;
 
-		if(Rot != 0)
+	Graphics()->QuadsBegin();
+
+	CQuadLayerCache::CLayer *pCached = (m_pQuadLayerCache && g_Config.m_ClQuadLayerCache && pMap) ? m_pQuadLayerCache->Find(pMap, Layer, NumQuads) : 0;
+	if(pCached)
+	{
+		// static quads only change with the overlay alpha
+		if(pCached->m_Alpha != Alpha)
 		{
-			static CPoint aRotated[4];
-			aRotated[0] = q->m_aPoints[0];
-			aRotated[1] = q->m_aPoints[1];
-			aRotated[2] = q->m_aPoints[2];
-			aRotated[3] = q->m_aPoints[3];
-			pPoints = aRotated;
-
-			Rotate(&q->m_aPoints[4], &aRotated[0], Rot);
-			Rotate(&q->m_aPoints[4], &aRotated[1], Rot);
-			Rotate(&q->m_aPoints[4], &aRotated[2], Rot);
-			Rotate(&q->m_aPoints[4], &aRotated[3], Rot);
+			for(int i = 0; i < NumQuads; i++)
+				BuildQuad(&pQuads[i], Alpha, pfnEval, pUser, &pCached->m_pItems[i]);
+			pCached->m_Alpha = Alpha;
 		}
-
-		IGraphics::CFreeformItem Freeform(
-			fx2f(pPoints[0].x)+OffsetX, fx2f(pPoints[0].y)+OffsetY,
-			fx2f(pPoints[1].x)+OffsetX, fx2f(pPoints[1].y)+OffsetY,
-			fx2f(pPoints[2].x)+OffsetX, fx2f(pPoints[2].y)+OffsetY,
-			fx2f(pPoints[3].x)+OffsetX, fx2f(pPoints[3].y)+OffsetY);
-		Graphics()->QuadsDrawFreeform(&Freeform, 1);
+		else
+		{
+			for(int i = 0; i < pCached->m_NumAnimated; i++)
+			{
+				int q = pCached->m_pAnimated[i];
+				BuildQuad(&pQuads[q], Alpha, pfnEval, pUser, &pCached->m_pItems[q]);
+			}
+		}
+		Graphics()->QuadsDrawColoredFreeform(pCached->m_pItems, NumQuads);
 	}
+	else
+	{
+		IGraphics::CColoredFreeformItem aItems[64];
+		for(int i = 0; i < NumQuads; i += 64)
+		{
+			int Num = min(NumQuads-i, 64);
+			for(int j = 0; j < Num; j++)
+				BuildQuad(&pQuads[i+j], Alpha, pfnEval, pUser, &aItems[j]);
+			Graphics()->QuadsDrawColoredFreeform(aItems, Num);
+		}
+	}
+
 	Graphics()->QuadsEnd();
 }
 
+// occupancy bits of the tiles a layer pass draws
+static int PassMask(int RenderFlags)
+{
+	int Mask = 0;
+	if(RenderFlags&LAYERRENDERFLAG_OPAQUE)
+		Mask |= CTileOccupancy::TILE_OPAQUE;
+	if(RenderFlags&LAYERRENDERFLAG_TRANSPARENT)
+		Mask |= CTileOccupancy::TILE_TRANSPARENT;
+	return Mask;
+}
+
 void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags,
 									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
 {
@@ -200,6 +240,15 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 		a = aChannels[3];
 	}
 
+	// opaque tiles only count as such when the layer is fully opaque
+	bool FullAlpha = Color.a*a > 254.0f/255.0f;
+	int Mask = PassMask(RenderFlags);
+	if(!FullAlpha)
+		Mask = (RenderFlags&LAYERRENDERFLAG_TRANSPARENT) ? CTileOccupancy::TILE_OPAQUE|CTileOccupancy::TILE_TRANSPARENT : 0;
+	if(!Mask)
+		return;
+	const CTileOccupancy::CLayer *pOccupancy = m_pTileOccupancy ? m_pTileOccupancy->Find(pTiles, w, h) : 0;
+
 	Graphics()->QuadsBegin();
 	Graphics()->SetColor(Color.r*r, Color.g*g, Color.b*b, Color.a*a);
 
@@ -213,9 +262,52 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 	float Frac = (1.25f/TexSize) * (1/FinalTilesetScale);
 	float Nudge = (0.5f/TexSize) * (1/FinalTilesetScale);
 
+	CTilemapCache::CLayer *pCached = (m_pTilemapCache && g_Config.m_ClTilemapCache) ? m_pTilemapCache->Find(pTiles, w, h) : 0;
+	if(pCached)
+	{
+		int x0 = max(StartX, 0), x1 = min(EndX, w);
+		int y0 = max(StartY, 0), y1 = min(EndY, h);
+		for(int cy = y0/CTilemapCache::CHUNK_SIZE; y0 < y1 && cy <= (y1-1)/CTilemapCache::CHUNK_SIZE; cy++)
+			for(int cx = x0/CTilemapCache::CHUNK_SIZE; x0 < x1 && cx <= (x1-1)/CTilemapCache::CHUNK_SIZE; cx++)
+			{
+				if(pOccupancy && !(pOccupancy->BlockFlags(cx, cy)&Mask))
+					continue;
+
+				const CTilemapCache::CChunk *pChunk = m_pTilemapCache->Chunk(pCached, cx, cy, Scale, Frac, Nudge);
+				int First = 0, Last = 0;
+				if(FullAlpha)
+				{
+					First = (RenderFlags&LAYERRENDERFLAG_OPAQUE) ? 0 : pChunk->m_NumOpaque;
+					Last = (RenderFlags&LAYERRENDERFLAG_TRANSPARENT) ? pChunk->m_NumQuads : pChunk->m_NumOpaque;
+				}
+				else if(RenderFlags&LAYERRENDERFLAG_TRANSPARENT)
+					Last = pChunk->m_NumQuads;
+
+				if(Last > First)
+					Graphics()->QuadsDrawTexturedTL(&pChunk->m_pQuads[First], Last-First);
+			}
+	}
+
 	for(int y = StartY; y < EndY; y++)
 		for(int x = StartX; x < EndX; x++)
 		{
+			// the cache already drew everything inside the map, only the extended border is left
+			if(pCached && y >= 0 && y < h && x >= 0 && x < w)
+			{
+				x = w-1;
+				continue;
+			}
+
+			if(pOccupancy && x >= 0 && x < w && y >= 0 && y < h)
+			{
+				int Skip = pOccupancy->SkipTo(x, y, Mask);
+				if(Skip >= 0)
+				{
+					x = Skip;
+					continue;
+				}
+			}
+
 			int mx = x;
 			int my = y;
 
@@ -264,53 +356,9 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 				if(Render)
 				{
 
-					int tx = Index%16;
-					int ty = Index/16;
-					int Px0 = tx*(1024/16);
-					int Py0 = ty*(1024/16);
-					int Px1 = Px0+(1024/16)-1;
-					int Py1 = Py0+(1024/16)-1;
-
-					float x0 = Nudge + Px0/TexSize+Frac;
-					float y0 = Nudge + Py0/TexSize+Frac;
-					float x1 = Nudge + Px1/TexSize-Frac;
-					float y1 = Nudge + Py0/TexSize+Frac;
-					float x2 = Nudge + Px1/TexSize-Frac;
-					float y2 = Nudge + Py1/TexSize-Frac;
-					float x3 = Nudge + Px0/TexSize+Frac;
-					float y3 = Nudge + Py1/TexSize-Frac;
-
-					if(Flags&TILEFLAG_VFLIP)
-					{
-						x0 = x2;
-						x1 = x3;
-						x2 = x3;
-						x3 = x0;
-					}
-
-					if(Flags&TILEFLAG_HFLIP)
-					{
-						y0 = y3;
-						y2 = y1;
-						y3 = y1;
-						y1 = y0;
-					}
-
-					if(Flags&TILEFLAG_ROTATE)
-					{
-						float Tmp = x0;
-						x0 = x3;
-						x3 = x2;
-						x2 = x1;
-						x1 = Tmp;
-						Tmp = y0;
-						y0 = y3;
-						y3 = y2;
-						y2 = y1;
-						y1 = Tmp;
-					}
-
-					Graphics()->QuadsSetSubsetFree(x0, y0, x1, y1, x2, y2, x3, y3);
+					float aU[4], aV[4];
+					CTilemapCache::TileTexCoords(Index, Flags, Frac, Nudge, aU, aV);
+					Graphics()->QuadsSetSubsetFree(aU[0], aV[0], aU[1], aV[1], aU[2], aV[2], aU[3], aV[3]);
 					IGraphics::CQuadItem QuadItem(x*Scale, y*Scale, Scale, Scale);
 					Graphics()->QuadsDrawTL(&QuadItem, 1);
 				}
@@ -552,6 +600,12 @@ void CRenderTools::RenderTelemap(CTeleTile *pTele, int w, int h, float Scale, ve
 	float FinalTileSize = Scale/(ScreenX1-ScreenX0) * Graphics()->ScreenWidth();
 	float FinalTilesetScale = FinalTileSize/TilePixelSize;
 
+	// these tiles are only drawn in the transparent pass
+	int Mask = PassMask(RenderFlags)&CTileOccupancy::TILE_TRANSPARENT;
+	if(!Mask)
+		return;
+	const CTileOccupancy::CLayer *pOccupancy = m_pTileOccupancy ? m_pTileOccupancy->Find(pTele, w, h) : 0;
+
 	Graphics()->QuadsBegin();
 	Graphics()->SetColor(Color.r, Color.g, Color.b, Color.a);
 
@@ -568,6 +622,16 @@ void CRenderTools::RenderTelemap(CTeleTile *pTele, int w, int h, float Scale, ve
 	for(int y = StartY; y < EndY; y++)
 		for(int x = StartX; x < EndX; x++)
 		{
+			if(pOccupancy && x >= 0 && x < w && y >= 0 && y < h)
+			{
+				int Skip = pOccupancy->SkipTo(x, y, Mask);
+				if(Skip >= 0)
+				{
+					x = Skip;
+					continue;
+				}
+			}
+
 			int mx = x;
 			int my = y;
 
@@ -645,6 +709,12 @@ void CRenderTools::RenderSpeedupmap(CSpeedupTile *pSpeedupTile, int w, int h, fl
 	float FinalTileSize = Scale/(ScreenX1-ScreenX0) * Graphics()->ScreenWidth();
 	float FinalTilesetScale = FinalTileSize/TilePixelSize;
 
+	// these tiles are only drawn in the transparent pass
+	int Mask = PassMask(RenderFlags)&CTileOccupancy::TILE_TRANSPARENT;
+	if(!Mask)
+		return;
+	const CTileOccupancy::CLayer *pOccupancy = m_pTileOccupancy ? m_pTileOccupancy->Find(pSpeedupTile, w, h) : 0;
+
 	Graphics()->QuadsBegin();
 	Graphics()->SetColor(Color.r, Color.g, Color.b, Color.a);
 
@@ -661,6 +731,16 @@ void CRenderTools::RenderSpeedupmap(CSpeedupTile *pSpeedupTile, int w, int h, fl
 	for(int y = StartY; y < EndY; y++)
 		for(int x = StartX; x < EndX; x++)
 		{
+			if(pOccupancy && x >= 0 && x < w && y >= 0 && y < h)
+			{
+				int Skip = pOccupancy->SkipTo(x, y, Mask);
+				if(Skip >= 0)
+				{
+					x = Skip;
+					continue;
+				}
+			}
+
 			int mx = x;
 			int my = y;
 
@@ -738,6 +818,11 @@ void CRenderTools::RenderSwitchmap(CSwitchTile *pSwitchTile, int w, int h, float
 	float FinalTileSize = Scale/(ScreenX1-ScreenX0) * Graphics()->ScreenWidth();
 	float FinalTilesetScale = FinalTileSize/TilePixelSize;
 
+	int Mask = PassMask(RenderFlags);
+	if(!Mask)
+		return;
+	const CTileOccupancy::CLayer *pOccupancy = m_pTileOccupancy ? m_pTileOccupancy->Find(pSwitchTile, w, h) : 0;
+
 	Graphics()->QuadsBegin();
 	Graphics()->SetColor(Color.r, Color.g, Color.b, Color.a);
 
@@ -754,6 +839,16 @@ void CRenderTools::RenderSwitchmap(CSwitchTile *pSwitchTile, int w, int h, float
 	for(int y = StartY; y < EndY; y++)
 		for(int x = StartX; x < EndX; x++)
 		{
+			if(pOccupancy && x >= 0 && x < w && y >= 0 && y < h)
+			{
+				int Skip = pOccupancy->SkipTo(x, y, Mask);
+				if(Skip >= 0)
+				{
+					x = Skip;
+					continue;
+				}
+			}
+
 			int mx = x;
 			int my = y;
 
@@ -872,6 +967,12 @@ void CRenderTools::RenderTunemap(CTuneTile *pTune, int w, int h, float Scale, ve
 	float FinalTileSize = Scale/(ScreenX1-ScreenX0) * Graphics()->ScreenWidth();
 	float FinalTilesetScale = FinalTileSize/TilePixelSize;
 
+	// these tiles are only drawn in the transparent pass
+	int Mask = PassMask(RenderFlags)&CTileOccupancy::TILE_TRANSPARENT;
+	if(!Mask)
+		return;
+	const CTileOccupancy::CLayer *pOccupancy = m_pTileOccupancy ? m_pTileOccupancy->Find(pTune, w, h) : 0;
+
 	Graphics()->QuadsBegin();
 	Graphics()->SetColor(Color.r, Color.g, Color.b, Color.a);
 
@@ -888,6 +989,16 @@ void CRenderTools::RenderTunemap(CTuneTile *pTune, int w, int h, float Scale, ve
 	for(int y = StartY; y < EndY; y++)
 		for(int x = StartX; x < EndX; x++)
 		{
+			if(pOccupancy && x >= 0 && x < w && y >= 0 && y < h)
+			{
+				int Skip = pOccupancy->SkipTo(x, y, Mask);
+				if(Skip >= 0)
+				{
+					x = Skip;
+					continue;
+				}
+			}
+
 			int mx = x;
 			int my = y;
 
@@ -0,0 +1,112 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "tile_occupancy.h"
+
+// the same opaque/transparent split the renderers use
+static int TileFlags(const void *pTiles, int Index)
+{
+	const CTile *pTile = &((const CTile *)pTiles)[Index];
+	if(!pTile->m_Index)
+		return 0;
+	return (pTile->m_Flags&TILEFLAG_OPAQUE) ? CTileOccupancy::TILE_OPAQUE : CTileOccupancy::TILE_TRANSPARENT;
+}
+
+static int TeleFlags(const void *pTiles, int Index)
+{
+	return ((const CTeleTile *)pTiles)[Index].m_Type ? CTileOccupancy::TILE_TRANSPARENT : 0;
+}
+
+static int SpeedupFlags(const void *pTiles, int Index)
+{
+	return ((const CSpeedupTile *)pTiles)[Index].m_Type ? CTileOccupancy::TILE_TRANSPARENT : 0;
+}
+
+static int SwitchFlags(const void *pTiles, int Index)
+{
+	const CSwitchTile *pTile = &((const CSwitchTile *)pTiles)[Index];
+	if(!pTile->m_Type)
+		return 0;
+	return (pTile->m_Flags&TILEFLAG_OPAQUE) ? CTileOccupancy::TILE_OPAQUE : CTileOccupancy::TILE_TRANSPARENT;
+}
+
+static int TuneFlags(const void *pTiles, int Index)
+{
+	return ((const CTuneTile *)pTiles)[Index].m_Type ? CTileOccupancy::TILE_TRANSPARENT : 0;
+}
+
+CTileOccupancy::CTileOccupancy()
+{
+	m_NumLayers = 0;
+}
+
+CTileOccupancy::~CTileOccupancy()
+{
+	Clear();
+}
+
+void CTileOccupancy::UpdateBlock(CLayer *pLayer, int bx, int by)
+{
+	int x0 = bx*BLOCK_SIZE, x1 = min(x0 + (int)BLOCK_SIZE, pLayer->m_Width);
+	int y0 = by*BLOCK_SIZE, y1 = min(y0 + (int)BLOCK_SIZE, pLayer->m_Height);
+
+	int Flags = 0;
+	for(int y = y0; y < y1; y++)
+		for(int x = x0; x < x1; x++)
+			Flags |= pLayer->m_pfnTileFlags(pLayer->m_pTiles, y*pLayer->m_Width + x);
+	pLayer->m_pBlocks[by*pLayer->m_BlocksX + bx] = Flags;
+}
+
+void CTileOccupancy::UpdateRow(CLayer *pLayer, int by)
+{
+	int Flags = 0;
+	for(int bx = 0; bx < pLayer->m_BlocksX; bx++)
+		Flags |= pLayer->m_pBlocks[by*pLayer->m_BlocksX + bx];
+	pLayer->m_pRows[by] = Flags;
+}
+
+CTileOccupancy::CLayer *CTileOccupancy::Find(const void *pTiles, int Width, int Height, TILE_FLAGS pfnTileFlags)
+{
+	for(int i = 0; i < m_NumLayers; i++)
+		if(m_aLayers[i].m_pTiles == pTiles && m_aLayers[i].m_Width == Width && m_aLayers[i].m_Height == Height)
+			return &m_aLayers[i];
+
+	if(m_NumLayers == MAX_LAYERS)
+		return 0;
+
+	CLayer *pLayer = &m_aLayers[m_NumLayers++];
+	pLayer->m_pTiles = pTiles;
+	pLayer->m_Width = Width;
+	pLayer->m_Height = Height;
+	pLayer->m_BlocksX = (Width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	pLayer->m_BlocksY = (Height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	pLayer->m_pfnTileFlags = pfnTileFlags;
+	pLayer->m_pBlocks = (unsigned char *)mem_alloc(pLayer->m_BlocksX*pLayer->m_BlocksY, 1);
+	pLayer->m_pRows = (unsigned char *)mem_alloc(pLayer->m_BlocksY, 1);
+
+	for(int by = 0; by < pLayer->m_BlocksY; by++)
+	{
+		for(int bx = 0; bx < pLayer->m_BlocksX; bx++)
+			UpdateBlock(pLayer, bx, by);
+		UpdateRow(pLayer, by);
+	}
+	return pLayer;
+}
+
+const CTileOccupancy::CLayer *CTileOccupancy::Find(const CTile *pTiles, int Width, int Height) { return Find(pTiles, Width, Height, TileFlags); }
+const CTileOccupancy::CLayer *CTileOccupancy::Find(const CTeleTile *pTiles, int Width, int Height) { return Find(pTiles, Width, Height, TeleFlags); }
+const CTileOccupancy::CLayer *CTileOccupancy::Find(const CSpeedupTile *pTiles, int Width, int Height) { return Find(pTiles, Width, Height, SpeedupFlags); }
+const CTileOccupancy::CLayer *CTileOccupancy::Find(const CSwitchTile *pTiles, int Width, int Height) { return Find(pTiles, Width, Height, SwitchFlags); }
+const CTileOccupancy::CLayer *CTileOccupancy::Find(const CTuneTile *pTiles, int Width, int Height) { return Find(pTiles, Width, Height, TuneFlags); }
+
+void CTileOccupancy::Clear()
+{
+	for(int i = 0; i < m_NumLayers; i++)
+	{
+		_mem_free(m_aLayers[i].m_pBlocks);
+		_mem_free(m_aLayers[i].m_pRows);
+	}
+	m_NumLayers = 0;
+}
@@ -0,0 +1,82 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_TILE_OCCUPANCY_H
+#define GAME_CLIENT_TILE_OCCUPANCY_H
+
+#include <game/mapitems.h>
+
+/*
+	Class: CTileOccupancy
+		Remembers which parts of a tile layer hold tiles, so the renderers
+		can step over empty areas instead of looking at every tile.
+
+		A layer is split into blocks of BLOCK_SIZE x BLOCK_SIZE tiles (the
+		same as the chunks of CTilemapCache). Every block has a TILE_OPAQUE
+		and a TILE_TRANSPARENT bit, and every row of blocks has the union of
+		its blocks. Layers are indexed the first time they are asked for.
+*/
+class CTileOccupancy
+{
+public:
+	enum
+	{
+		BLOCK_SIZE = 16,
+		MAX_LAYERS = 64,
+
+		TILE_OPAQUE = 1,
+		TILE_TRANSPARENT = 2,
+	};
+
+	typedef int (*TILE_FLAGS)(const void *pTiles, int Index);
+
+	class CLayer
+	{
+	public:
+		const void *m_pTiles;
+		int m_Width, m_Height;
+		int m_BlocksX, m_BlocksY;
+		TILE_FLAGS m_pfnTileFlags;
+		unsigned char *m_pBlocks;
+		unsigned char *m_pRows;
+
+		int BlockFlags(int bx, int by) const { return m_pBlocks[by*m_BlocksX + bx]; }
+
+		// last column of the empty stretch the tile x, y is in, -1 if its block has tiles in Mask
+		int SkipTo(int x, int y, int Mask) const
+		{
+			int by = y/BLOCK_SIZE;
+			if(!(m_pRows[by]&Mask))
+				return m_Width-1;
+			int bx = x/BLOCK_SIZE;
+			if(!(m_pBlocks[by*m_BlocksX + bx]&Mask))
+			{
+				int End = (bx+1)*BLOCK_SIZE;
+				return (End < m_Width ? End : m_Width) - 1;
+			}
+			return -1;
+		}
+	};
+
+private:
+	CLayer m_aLayers[MAX_LAYERS];
+	int m_NumLayers;
+
+	CLayer *Find(const void *pTiles, int Width, int Height, TILE_FLAGS pfnTileFlags);
+	void UpdateBlock(CLayer *pLayer, int bx, int by);
+	void UpdateRow(CLayer *pLayer, int by);
+
+public:
+	CTileOccupancy();
+	~CTileOccupancy();
+
+	// return 0 when all layer slots are taken
+	const CLayer *Find(const CTile *pTiles, int Width, int Height);
+	const CLayer *Find(const CTeleTile *pTiles, int Width, int Height);
+	const CLayer *Find(const CSpeedupTile *pTiles, int Width, int Height);
+	const CLayer *Find(const CSwitchTile *pTiles, int Width, int Height);
+	const CLayer *Find(const CTuneTile *pTiles, int Width, int Height);
+
+	void Clear();
+};
+
+#endif
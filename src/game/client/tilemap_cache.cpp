@@ -0,0 +1,169 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "tilemap_cache.h"
+
+CTilemapCache::CTilemapCache()
+{
+	m_NumLayers = 0;
+}
+
+CTilemapCache::~CTilemapCache()
+{
+	Clear();
+}
+
+void CTilemapCache::TileTexCoords(int Index, int Flags, float Frac, float Nudge, float *pU, float *pV)
+{
+	const float TexSize = 1024.0f;
+	int tx = Index%16;
+	int ty = Index/16;
+	int Px0 = tx*(1024/16);
+	int Py0 = ty*(1024/16);
+	int Px1 = Px0+(1024/16)-1;
+	int Py1 = Py0+(1024/16)-1;
+
+	float x0 = Nudge + Px0/TexSize+Frac;
+	float y0 = Nudge + Py0/TexSize+Frac;
+	float x1 = Nudge + Px1/TexSize-Frac;
+	float y1 = Nudge + Py0/TexSize+Frac;
+	float x2 = Nudge + Px1/TexSize-Frac;
+	float y2 = Nudge + Py1/TexSize-Frac;
+	float x3 = Nudge + Px0/TexSize+Frac;
+	float y3 = Nudge + Py1/TexSize-Frac;
+
+	if(Flags&TILEFLAG_VFLIP)
+	{
+		x0 = x2;
+		x1 = x3;
+		x2 = x3;
+		x3 = x0;
+	}
+
+	if(Flags&TILEFLAG_HFLIP)
+	{
+		y0 = y3;
+		y2 = y1;
+		y3 = y1;
+		y1 = y0;
+	}
+
+	if(Flags&TILEFLAG_ROTATE)
+	{
+		float Tmp = x0;
+		x0 = x3;
+		x3 = x2;
+		x2 = x1;
+		x1 = Tmp;
+		Tmp = y0;
+		y0 = y3;
+		y3 = y2;
+		y2 = y1;
+		y1 = Tmp;
+	}
+
+	pU[0] = x0; pV[0] = y0;
+	pU[1] = x1; pV[1] = y1;
+	pU[2] = x2; pV[2] = y2;
+	pU[3] = x3; pV[3] = y3;
+}
+
+CTilemapCache::CLayer *CTilemapCache::Find(const CTile *pTiles, int Width, int Height)
+{
+	for(int i = 0; i < m_NumLayers; i++)
+		if(m_aLayers[i].m_pTiles == pTiles && m_aLayers[i].m_Width == Width && m_aLayers[i].m_Height == Height)
+			return &m_aLayers[i];
+
+	if(m_NumLayers == MAX_LAYERS)
+		return 0;
+
+	CLayer *pLayer = &m_aLayers[m_NumLayers++];
+	pLayer->m_pTiles = pTiles;
+	pLayer->m_Width = Width;
+	pLayer->m_Height = Height;
+	pLayer->m_ChunksX = (Width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	pLayer->m_ChunksY = (Height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	int NumChunks = pLayer->m_ChunksX * pLayer->m_ChunksY;
+	pLayer->m_pChunks = (CChunk *)mem_alloc(NumChunks*sizeof(CChunk), 1);
+	mem_zero(pLayer->m_pChunks, NumChunks*sizeof(CChunk));
+	return pLayer;
+}
+
+void CTilemapCache::BuildChunk(const CLayer *pLayer, int cx, int cy, CChunk *pChunk)
+{
+	int x0 = cx*CHUNK_SIZE, x1 = min(x0 + (int)CHUNK_SIZE, pLayer->m_Width);
+	int y0 = cy*CHUNK_SIZE, y1 = min(y0 + (int)CHUNK_SIZE, pLayer->m_Height);
+
+	int NumQuads = 0;
+	int NumOpaque = 0;
+	for(int y = y0; y < y1; y++)
+		for(int x = x0; x < x1; x++)
+		{
+			const CTile *pTile = &pLayer->m_pTiles[y*pLayer->m_Width + x];
+			if(pTile->m_Index)
+			{
+				NumQuads++;
+				if(pTile->m_Flags&TILEFLAG_OPAQUE)
+					NumOpaque++;
+			}
+		}
+
+	if(NumQuads > pChunk->m_Capacity)
+	{
+		if(pChunk->m_pQuads)
+			_mem_free(pChunk->m_pQuads);
+		pChunk->m_pQuads = (IGraphics::CTexturedQuadItem *)mem_alloc(NumQuads*sizeof(IGraphics::CTexturedQuadItem), 1);
+		pChunk->m_Capacity = NumQuads;
+	}
+
+	// opaque tiles first, so each pass is one contiguous range
+	int Opaque = 0;
+	int Other = NumOpaque;
+	for(int y = y0; y < y1; y++)
+		for(int x = x0; x < x1; x++)
+		{
+			const CTile *pTile = &pLayer->m_pTiles[y*pLayer->m_Width + x];
+			if(!pTile->m_Index)
+				continue;
+
+			IGraphics::CTexturedQuadItem *pQuad = &pChunk->m_pQuads[(pTile->m_Flags&TILEFLAG_OPAQUE) ? Opaque++ : Other++];
+			pQuad->m_X = x*pChunk->m_Scale;
+			pQuad->m_Y = y*pChunk->m_Scale;
+			pQuad->m_Width = pChunk->m_Scale;
+			pQuad->m_Height = pChunk->m_Scale;
+			TileTexCoords(pTile->m_Index, pTile->m_Flags, pChunk->m_Frac, pChunk->m_Nudge, pQuad->m_aU, pQuad->m_aV);
+		}
+
+	pChunk->m_NumQuads = NumQuads;
+	pChunk->m_NumOpaque = NumOpaque;
+	pChunk->m_Valid = true;
+}
+
+const CTilemapCache::CChunk *CTilemapCache::Chunk(CLayer *pLayer, int cx, int cy, float Scale, float Frac, float Nudge)
+{
+	CChunk *pChunk = &pLayer->m_pChunks[cy*pLayer->m_ChunksX + cx];
+	if(!pChunk->m_Valid || pChunk->m_Scale != Scale || pChunk->m_Frac != Frac || pChunk->m_Nudge != Nudge)
+	{
+		pChunk->m_Scale = Scale;
+		pChunk->m_Frac = Frac;
+		pChunk->m_Nudge = Nudge;
+		BuildChunk(pLayer, cx, cy, pChunk);
+	}
+	return pChunk;
+}
+
+void CTilemapCache::Clear()
+{
+	for(int i = 0; i < m_NumLayers; i++)
+	{
+		CLayer *pLayer = &m_aLayers[i];
+		for(int c = 0; c < pLayer->m_ChunksX*pLayer->m_ChunksY; c++)
+			if(pLayer->m_pChunks[c].m_pQuads)
+				_mem_free(pLayer->m_pChunks[c].m_pQuads);
+		_mem_free(pLayer->m_pChunks);
+	}
+	m_NumLayers = 0;
+}
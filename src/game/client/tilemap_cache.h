@@ -0,0 +1,67 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_TILEMAP_CACHE_H
+#define GAME_CLIENT_TILEMAP_CACHE_H
+
+#include <engine/graphics.h>
+#include <game/mapitems.h>
+
+/*
+	Class: CTilemapCache
+		Keeps the quads of tile layers so they don't have to be generated
+		tile by tile every frame.
+
+		Layers are split into chunks of CHUNK_SIZE x CHUNK_SIZE tiles. A
+		chunk is built the first time it is seen and holds the quads of its
+		opaque tiles followed by the rest. The texture coordinates depend on
+		the zoom, so a chunk is rebuilt when it is drawn with another tile
+		scale than it was built for.
+*/
+class CTilemapCache
+{
+public:
+	enum
+	{
+		CHUNK_SIZE = 16,
+		MAX_LAYERS = 64,
+	};
+
+	struct CChunk
+	{
+		IGraphics::CTexturedQuadItem *m_pQuads;
+		int m_NumQuads;
+		int m_NumOpaque;
+		int m_Capacity;
+		bool m_Valid;
+		float m_Scale, m_Frac, m_Nudge;
+	};
+
+	struct CLayer
+	{
+		const CTile *m_pTiles;
+		int m_Width, m_Height;
+		int m_ChunksX, m_ChunksY;
+		CChunk *m_pChunks;
+	};
+
+private:
+	CLayer m_aLayers[MAX_LAYERS];
+	int m_NumLayers;
+
+	void BuildChunk(const CLayer *pLayer, int cx, int cy, CChunk *pChunk);
+
+public:
+	CTilemapCache();
+	~CTilemapCache();
+
+	// texture coordinates of a tile in the 16x16 tileset, in the corner order of CTexturedQuadItem
+	static void TileTexCoords(int Index, int Flags, float Frac, float Nudge, float *pU, float *pV);
+
+	// returns 0 when all layer slots are taken
+	CLayer *Find(const CTile *pTiles, int Width, int Height);
+	const CChunk *Chunk(CLayer *pLayer, int cx, int cy, float Scale, float Frac, float Nudge);
+
+	void Clear();
+};
+
+#endif
@@ -18,6 +18,10 @@ MACRO_CONFIG_INT(ClNameplatesSize, cl_nameplates_size, 50, 0, 100, CFGFLAG_CLIEN
 MACRO_CONFIG_INT(ClNameplatesClan, cl_nameplates_clan, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Show clan in name plates")
 MACRO_CONFIG_INT(ClNameplatesClanSize, cl_nameplates_clan_size, 30, 0, 100, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Size of the clan plates from 0 to 100%")
 MACRO_CONFIG_INT(ClTextEntities, cl_text_entities, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Render textual entity data")
+MACRO_CONFIG_INT(ClTilemapCache, cl_tilemap_cache, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Keep the geometry of tile layers between frames")
+MACRO_CONFIG_INT(ClFrameGovernor, cl_frame_governor, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Lower the detail step by step while the frame rate stays below cl_frame_governor_fps")
+MACRO_CONFIG_INT(ClFrameGovernorFps, cl_frame_governor_fps, 50, 10, 60, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Frame rate the frame governor tries to keep")
+MACRO_CONFIG_INT(ClQuadLayerCache, cl_quad_layer_cache, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Keep the quads of quad layers without envelopes between frames")
 #if defined(__ANDROID__)
 MACRO_CONFIG_INT(ClAutoswitchWeapons, cl_autoswitch_weapons, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Auto switch weapon on pickup")
 MACRO_CONFIG_INT(ClAutoswitchWeaponsOutOfAmmo, cl_autoswitch_weapons_out_of_ammo, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Auto switch weapon when out of ammo")
@@ -0,0 +1,155 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/client/atlas_packer.h>
+#include <engine/client/gs_transform.h>
+
+enum
+{
+	// what the gsKit backend uses
+	PADDING = 1,
+	MAX_ATLAS_SIZE = 512,
+
+	NUM_SETS = 200,
+};
+
+static int s_Failures = 0;
+
+static void Fail(int Set, const char *pWhat, int Rect)
+{
+	if(s_Failures++ < 10)
+		dbg_msg("atlas_remap_test", "set %d, rect %d: %s", Set, Rect, pWhat);
+}
+
+// the texel a GS sampling the packet would read, u in 12.4 fixed point as the transform writes it
+static int SampledTexel(const CGsTransform &Transform, float u, float v, int *pV)
+{
+	CGsVertex Vertex = {0.0f, 0.0f, u, v, 1.0f, 1.0f, 1.0f, 1.0f};
+	uint64_t aWords[3];
+	Transform.TransformRef(&Vertex, 1, true, aWords);
+	*pV = (int)((aWords[1]>>16)&0x3fff) >> 4;
+	return (int)(aWords[1]&0x3fff) >> 4;
+}
+
+// the placements, with their padding, stay inside the atlas and apart from each other
+static void CheckPacking(int Set, const CAtlasPacker::CRect *pRects, int Num, int Width, int Height)
+{
+	for(int i = 0; i < Num; i++)
+	{
+		const CAtlasPacker::CRect *pA = &pRects[i];
+		if(pA->m_X == -1)
+			continue;
+		if(pA->m_X < PADDING || pA->m_Y < PADDING || pA->m_X+pA->m_W+PADDING > Width || pA->m_Y+pA->m_H+PADDING > Height)
+			Fail(Set, "placed outside the atlas", i);
+		for(int j = 0; j < i; j++)
+		{
+			const CAtlasPacker::CRect *pB = &pRects[j];
+			if(pB->m_X != -1 &&
+				pA->m_X-PADDING < pB->m_X+pB->m_W+PADDING && pB->m_X-PADDING < pA->m_X+pA->m_W+PADDING &&
+				pA->m_Y-PADDING < pB->m_Y+pB->m_H+PADDING && pB->m_Y-PADDING < pA->m_Y+pA->m_H+PADDING)
+				Fail(Set, "overlaps another rectangle", i);
+		}
+	}
+}
+
+// every texel of the member is read from its own place in the atlas, through
+// RemapU/V and through the offset and scale the backend keeps per member
+static void CheckRemap(int Set, const CAtlasPacker::CRect *pRect, int Index, int Width, int Height)
+{
+	if(CAtlasPacker::RemapU(*pRect, Width, 0.0f) != pRect->m_X/(float)Width ||
+		CAtlasPacker::RemapU(*pRect, Width, 1.0f) != (pRect->m_X+pRect->m_W)/(float)Width ||
+		CAtlasPacker::RemapV(*pRect, Height, 0.0f) != pRect->m_Y/(float)Height ||
+		CAtlasPacker::RemapV(*pRect, Height, 1.0f) != (pRect->m_Y+pRect->m_H)/(float)Height)
+	{
+		Fail(Set, "the edges don't map onto the placement", Index);
+		return;
+	}
+
+	const float OffsetU = CAtlasPacker::RemapU(*pRect, Width, 0.0f);
+	const float OffsetV = CAtlasPacker::RemapV(*pRect, Height, 0.0f);
+	const float ScaleU = pRect->m_W / (float)Width;
+	const float ScaleV = pRect->m_H / (float)Height;
+
+	CGsTransform Transform;
+	Transform.SetTexture(Width, Height);
+	for(int i = 0; i < max(pRect->m_W, pRect->m_H); i++)
+	{
+		int x = min(i, pRect->m_W-1), y = min(i, pRect->m_H-1);
+		float u = (x+0.5f)/pRect->m_W, v = (y+0.5f)/pRect->m_H;
+		float RemappedU = CAtlasPacker::RemapU(*pRect, Width, u);
+		float RemappedV = CAtlasPacker::RemapV(*pRect, Height, v);
+		if(RemappedU != OffsetU + u*ScaleU || RemappedV != OffsetV + v*ScaleV)
+		{
+			Fail(Set, "offset and scale disagree with the remap", Index);
+			return;
+		}
+
+		int SampledV;
+		int SampledU = SampledTexel(Transform, RemappedU, RemappedV, &SampledV);
+		if(SampledU != pRect->m_X+x || SampledV != pRect->m_Y+y)
+		{
+			Fail(Set, "a texel center is read from the wrong atlas texel", Index);
+			return;
+		}
+	}
+
+	// filtering at the edges reaches half a texel out, into the padding but not past it
+	int SampledV;
+	int SampledU = SampledTexel(Transform, CAtlasPacker::RemapU(*pRect, Width, 0.0f) - 0.5f/Width, CAtlasPacker::RemapV(*pRect, Height, 0.0f) - 0.5f/Height, &SampledV);
+	if(SampledU < pRect->m_X-PADDING || SampledV < pRect->m_Y-PADDING)
+		Fail(Set, "filtering the top left edge reads past the padding", Index);
+	SampledU = SampledTexel(Transform, CAtlasPacker::RemapU(*pRect, Width, 1.0f) + 0.5f/Width, CAtlasPacker::RemapV(*pRect, Height, 1.0f) + 0.5f/Height, &SampledV);
+	if(SampledU >= pRect->m_X+pRect->m_W+PADDING || SampledV >= pRect->m_Y+pRect->m_H+PADDING)
+		Fail(Set, "filtering the bottom right edge reads past the padding", Index);
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	unsigned Seed = 1;
+	int Rects = 0, Placed = 0;
+	for(int s = 0; s < NUM_SETS; s++)
+	{
+		// icons, glyph pages and odd sized mapres, a few to a full atlas.
+		// Every tenth set has more than the largest atlas holds
+		CAtlasPacker::CRect aRects[CAtlasPacker::MAX_RECTS];
+		Seed = Seed*1103515245+12345;
+		const int Num = 2 + (Seed>>8)%(CAtlasPacker::MAX_RECTS-1);
+		const int Large = s%10 == 9 ? 100 : 0;
+		for(int i = 0; i < Num; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			bool PowerOfTwo = (Seed>>8)%2;
+			aRects[i].m_W = PowerOfTwo ? 1<<((Seed>>10)%7) : 1 + Large + (Seed>>10)%96;
+			aRects[i].m_H = PowerOfTwo ? 1<<((Seed>>14)%7) : 1 + Large + (Seed>>14)%96;
+		}
+
+		// grown like BuildTextureAtlas does
+		int Width = 64, Height = 64;
+		while(CAtlasPacker::Pack(aRects, Num, Width, Height, PADDING) < Num && Height < MAX_ATLAS_SIZE)
+		{
+			if(Width <= Height)
+				Width *= 2;
+			else
+				Height *= 2;
+		}
+		int SetPlaced = CAtlasPacker::Pack(aRects, Num, Width, Height, PADDING);
+
+		CheckPacking(s, aRects, Num, Width, Height);
+		int NumPlaced = 0;
+		for(int i = 0; i < Num; i++)
+			NumPlaced += aRects[i].m_X != -1 ? 1 : 0;
+		if(NumPlaced != SetPlaced)
+			Fail(s, "the count doesn't match the placements", -1);
+		for(int i = 0; i < Num; i++)
+			if(aRects[i].m_X != -1)
+				CheckRemap(s, &aRects[i], i, Width, Height);
+		Rects += Num;
+		Placed += SetPlaced;
+	}
+
+	dbg_msg("atlas_remap_test", "%d sets, %d of %d rectangles placed, %d failed checks", NUM_SETS, Placed, Rects, s_Failures);
+	return s_Failures ? 1 : 0;
+}
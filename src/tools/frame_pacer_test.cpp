@@ -0,0 +1,178 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/client/frame_pacer.h>
+
+enum
+{
+	FREQ = 1000000, // the fake clock counts microseconds
+	NUM_FRAMES = 3000,
+	WARMUP = 120,
+};
+
+struct CScenario
+{
+	const char *m_pName;
+	float m_RefreshRate; // of the display, the pacer is told 60
+	int m_Cost;
+	int m_CostJitter;
+	int m_SpikeInterval;
+	int m_SpikeCost;
+	int m_MarginMs;
+};
+
+struct CResult
+{
+	int64 m_Period;
+	int m_Missed;
+	int m_Dropped; // vsyncs that showed the same frame again
+	int m_Waits;
+	int64 m_Latency; // from reading the input to the flip, on average
+	int64 m_MaxCost;
+};
+
+static int64 s_aStart[NUM_FRAMES];
+static int64 s_aReady[NUM_FRAMES];
+static int64 s_aFlip[NUM_FRAMES];
+
+static unsigned Random(unsigned *pSeed, unsigned Max)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return ((*pSeed>>8)&0xffff)%Max;
+}
+
+// the client loop against the double buffered gsKit backend. The backend
+// reports the last frame it showed, PaceFrame passes it on and sleeps whole
+// milliseconds, and handing a frame over waits for the one before it to flip
+static void Simulate(const CScenario *pScenario, bool Pacing, CResult *pResult)
+{
+	const int64 Period = (int64)(FREQ/pScenario->m_RefreshRate);
+	const int64 Margin = (int64)pScenario->m_MarginMs*FREQ/1000;
+	CFramePacer Pacer;
+	Pacer.Init(FREQ, 60);
+	mem_zero(pResult, sizeof(*pResult));
+
+	unsigned Seed = 1;
+	int64 Now = 0;
+	int Reported = -1;
+	int MissedAtWarmup = 0;
+	for(int f = 0; f < NUM_FRAMES; f++)
+	{
+		int Shown = Reported;
+		while(Shown+1 < f && s_aFlip[Shown+1] <= Now)
+			Shown++;
+		if(Shown != Reported)
+		{
+			Pacer.FrameShown(Shown, s_aReady[Shown], s_aFlip[Shown]);
+			Reported = Shown;
+		}
+		if(f == WARMUP)
+			MissedAtWarmup = Pacer.NumMissed();
+
+		if(Pacing)
+		{
+			int Wait = (int)((Pacer.WakeTime(Now, Margin) - Now)*1000/FREQ);
+			if(Wait > 0)
+			{
+				Now += (int64)Wait*FREQ/1000;
+				if(f >= WARMUP)
+					pResult->m_Waits++;
+			}
+		}
+		Pacer.FrameStart(f, Now, Margin);
+
+		int64 Cost = pScenario->m_Cost;
+		if(pScenario->m_CostJitter)
+			Cost += Random(&Seed, pScenario->m_CostJitter);
+		if(pScenario->m_SpikeInterval && f%pScenario->m_SpikeInterval == pScenario->m_SpikeInterval-1)
+			Cost = pScenario->m_SpikeCost;
+		pResult->m_MaxCost = max(pResult->m_MaxCost, Cost);
+
+		// half of it is recording, the backend starts on the rest once the
+		// frame before has been flipped and then waits for the next vsync
+		s_aStart[f] = Now;
+		int64 Handoff = max(Now + Cost/2, f > 0 ? s_aFlip[f-1] : 0);
+		s_aReady[f] = Handoff + (Cost - Cost/2);
+		s_aFlip[f] = (s_aReady[f]/Period + 1)*Period;
+		Now = Handoff;
+
+		if(f >= WARMUP)
+		{
+			pResult->m_Latency += s_aFlip[f] - s_aStart[f];
+			if(s_aFlip[f] - s_aFlip[f-1] > Period + Period/2)
+				pResult->m_Dropped++;
+		}
+	}
+
+	pResult->m_Period = Pacer.Period();
+	pResult->m_Missed = Pacer.NumMissed() - MissedAtWarmup;
+	pResult->m_Latency /= NUM_FRAMES-WARMUP;
+}
+
+static int Check(bool Failed, const char *pName, const char *pWhat)
+{
+	if(Failed)
+		dbg_msg("frame_pacer_test", "%s: %s", pName, pWhat);
+	return Failed ? 1 : 0;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	static const CScenario s_aScenarios[] = {
+		{"ntsc, light frames", 59.94f, 5000, 0, 0, 0, 2},
+		{"ntsc, jittery frames", 59.94f, 3000, 6000, 0, 0, 2},
+		{"pal, light frames", 50.0f, 8000, 1000, 0, 0, 2},
+		{"ntsc, a spike every 2s", 59.94f, 4000, 1000, 120, 30000, 2},
+		{"ntsc, frames over two vsyncs", 59.94f, 36000, 2000, 0, 0, 2},
+	};
+
+	int Failures = 0;
+	for(unsigned i = 0; i < sizeof(s_aScenarios)/sizeof(s_aScenarios[0]); i++)
+	{
+		const CScenario *pScenario = &s_aScenarios[i];
+		const char *pName = pScenario->m_pName;
+		const int64 Period = (int64)(FREQ/pScenario->m_RefreshRate);
+		const int64 Margin = (int64)pScenario->m_MarginMs*FREQ/1000;
+		CResult Paced, Unpaced;
+		Simulate(pScenario, true, &Paced);
+		Simulate(pScenario, false, &Unpaced);
+
+		dbg_msg("frame_pacer_test", "%s: vsync %.3f ms, learned %.3f ms, latency %.2f ms paced, %.2f ms unpaced, %d missed, %d dropped",
+			pName, Period*1000.0/FREQ, Paced.m_Period*1000.0/FREQ, Paced.m_Latency*1000.0/FREQ, Unpaced.m_Latency*1000.0/FREQ,
+			Paced.m_Missed, Paced.m_Dropped);
+
+		// it follows the display whatever it was told at first
+		Failures += Check(absolute(Paced.m_Period - Period) > Period/200, pName, "the learned vsync period is off");
+
+		const int Spikes = pScenario->m_SpikeInterval ? (NUM_FRAMES-WARMUP)/pScenario->m_SpikeInterval : 0;
+		if(Paced.m_MaxCost + Margin < Period && !Spikes)
+		{
+			// every vsync gets a new frame, and the input is read for it as late as the margin allows.
+			// A jittery frame can take longer than the ones before it, the odd one may miss
+			const int Allowed = pScenario->m_CostJitter ? (NUM_FRAMES-WARMUP)/100 : 0;
+			Failures += Check(Paced.m_Missed > Allowed, pName, "frames missed the vsync they aimed at");
+			Failures += Check(Paced.m_Dropped > Allowed, pName, "vsyncs went without a new frame");
+			Failures += Check(Paced.m_Latency > Paced.m_MaxCost + Margin + FREQ/1000, pName, "the input is read earlier than needed");
+			Failures += Check(Paced.m_Latency >= Unpaced.m_Latency, pName, "pacing doesn't shorten the latency");
+		}
+		else if(Spikes)
+		{
+			// a spike costs its own vsync and maybe the next, then it settles again
+			Failures += Check(Paced.m_Missed > Spikes*2, pName, "it doesn't recover from spikes");
+			Failures += Check(Paced.m_Dropped > Spikes*2, pName, "spikes drop more than two vsyncs");
+			Failures += Check(Paced.m_Latency >= Unpaced.m_Latency, pName, "pacing doesn't shorten the latency");
+		}
+		else
+		{
+			// nothing to gain, it must not sleep
+			Failures += Check(Paced.m_Waits != 0, pName, "frames over a vsync were delayed");
+			Failures += Check(Paced.m_Latency != Unpaced.m_Latency, pName, "frames over a vsync are paced differently");
+		}
+	}
+
+	dbg_msg("frame_pacer_test", "%d failed checks", Failures);
+	return Failures ? 1 : 0;
+}
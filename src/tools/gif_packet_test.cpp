@@ -0,0 +1,166 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <engine/client/gif_packet.h>
+#include <engine/client/gs_transform.h>
+
+static const char *s_pDefaultGolden = "src/tools/gif_packet_test.txt";
+
+enum
+{
+	MAX_QWORDS = 256,
+	MAX_DUMP = 64*1024,
+};
+
+static uint64_t s_aPacket[MAX_QWORDS*2] __attribute__((aligned(16)));
+static char s_aDump[MAX_DUMP];
+static int s_DumpSize = 0;
+
+// one quadword per line, the high word first like the GS manual draws them
+static void Dump(const char *pName, const CGifPacket &Packet)
+{
+	s_DumpSize += str_format(s_aDump+s_DumpSize, sizeof(s_aDump)-s_DumpSize, "# %s, %d qwords\n", pName, Packet.Size());
+	for(int i = 0; i < Packet.Size(); i++)
+		s_DumpSize += str_format(s_aDump+s_DumpSize, sizeof(s_aDump)-s_DumpSize, "%016llx %016llx\n",
+			(unsigned long long)Packet.Data()[i*2+1], (unsigned long long)Packet.Data()[i*2]);
+}
+
+// the state a texture switch sends
+static void BuildState(CGifPacket *pPacket)
+{
+	pPacket->BeginAD();
+	pPacket->AddAD(CGifPacket::GS_REG_TEX0_1, 0x0000000540014000ull);
+	pPacket->AddAD(CGifPacket::GS_REG_TEX1_1, 0x0000000000000060ull);
+	pPacket->AddAD(CGifPacket::GS_REG_FRAME_1, CGifPacket::RegFRAME(140, 10, 0));
+}
+
+// a gouraud shaded untextured triangle
+static void BuildTriangle(CGifPacket *pPacket)
+{
+	pPacket->BeginPrims(CGifPacket::Prim(CGifPacket::GS_PRIM_TRIANGLE, CGifPacket::PRIMFLAG_GOURAUD|CGifPacket::PRIMFLAG_ALPHA), false);
+	pPacket->AddVertex(CGifPacket::RegRGBAQ(255, 0, 0, 128), CGifPacket::RegXYZ2(0x8000, 0x8000, 0));
+	pPacket->AddVertex(CGifPacket::RegRGBAQ(0, 255, 0, 128), CGifPacket::RegXYZ2(0x8100, 0x8000, 0));
+	pPacket->AddVertex(CGifPacket::RegRGBAQ(0, 0, 255, 0), CGifPacket::RegXYZ2(0x8000, 0x8100, 0));
+}
+
+// two textured sprites, what a tile row turns into
+static void BuildSprites(CGifPacket *pPacket)
+{
+	pPacket->BeginPrims(CGifPacket::Prim(CGifPacket::GS_PRIM_SPRITE, CGifPacket::PRIMFLAG_TEXTURED|CGifPacket::PRIMFLAG_UV|CGifPacket::PRIMFLAG_ALPHA), true);
+	for(int i = 0; i < 2; i++)
+	{
+		int x = 0x8000 + i*16*16;
+		pPacket->AddVertex(CGifPacket::RegRGBAQ(128, 128, 128, 128), CGifPacket::RegUV(i*256+8, 8), CGifPacket::RegXYZ2(x, 0x8000, 0));
+		pPacket->AddVertex(CGifPacket::RegRGBAQ(128, 128, 128, 128), CGifPacket::RegUV(i*256+248, 248), CGifPacket::RegXYZ2(x+16*16, 0x8000+16*16, 0));
+	}
+}
+
+// state, then a triangle and a line written by the transform straight into
+// the packet. The triangle has an odd number of register words and gets padded
+static void BuildTransformed(CGifPacket *pPacket)
+{
+	static const CGsVertex s_aVertices[3] = {
+		{10.0f, 20.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+		{74.0f, 20.0f, 1.0f, 0.0f, 1.0f, 0.5f, 1.0f, 1.0f},
+		{10.0f, 84.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.5f, 0.5f},
+	};
+
+	CGsTransform Transform;
+	Transform.SetScreen(0.0f, 0.0f, 640.0f, 448.0f, 640, 448, 2048*16, 2048*16);
+	Transform.SetTexture(64, 64);
+
+	pPacket->BeginAD();
+	pPacket->AddAD(CGifPacket::GS_REG_TEX0_1, 0x0000000360006000ull);
+	pPacket->BeginPrims(CGifPacket::Prim(CGifPacket::GS_PRIM_TRIANGLE, CGifPacket::PRIMFLAG_GOURAUD|CGifPacket::PRIMFLAG_TEXTURED|CGifPacket::PRIMFLAG_UV|CGifPacket::PRIMFLAG_ALPHA), true);
+	Transform.TransformRef(s_aVertices, 3, true, pPacket->AllocVertices(3));
+
+	Transform.SetTexture(0, 0);
+	pPacket->BeginPrims(CGifPacket::Prim(CGifPacket::GS_PRIM_LINE, 0), false);
+	Transform.TransformRef(s_aVertices, 2, false, pPacket->AllocVertices(2));
+}
+
+static int Compare(const char *pFileName)
+{
+	IOHANDLE File = io_open(pFileName, IOFLAG_READ);
+	if(!File)
+	{
+		dbg_msg("gif_packet_test", "failed to open %s", pFileName);
+		return 1;
+	}
+	static char s_aGolden[MAX_DUMP];
+	int GoldenSize = io_read(File, s_aGolden, sizeof(s_aGolden)-1);
+	io_close(File);
+	s_aGolden[GoldenSize] = 0;
+
+	// report the first line that differs
+	int Line = 1;
+	for(int i = 0; i < s_DumpSize || i < GoldenSize; i++)
+	{
+		if(i < s_DumpSize && i < GoldenSize && s_aDump[i] == s_aGolden[i])
+		{
+			if(s_aDump[i] == '\n')
+				Line++;
+			continue;
+		}
+		dbg_msg("gif_packet_test", "%s differs on line %d", pFileName, Line);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+	bool Write = argc > 1 && str_comp(argv[1], "-w") == 0;
+	if(argc > 2+(Write ? 1 : 0))
+	{
+		dbg_msg("Usage", "%s [-w] [GOLDEN.txt]", argv[0]);
+		return -1;
+	}
+	const char *pFileName = argc > 1+(Write ? 1 : 0) ? argv[argc-1] : s_pDefaultGolden;
+
+	static const struct
+	{
+		const char *m_pName;
+		void (*m_pfnBuild)(CGifPacket *pPacket);
+	} s_aSequences[] = {
+		{"state", BuildState},
+		{"triangle", BuildTriangle},
+		{"sprites", BuildSprites},
+		{"transformed", BuildTransformed},
+	};
+
+	// each on its own and all of them in one packet, like a flush does
+	CGifPacket Packet;
+	Packet.Init(s_aPacket, MAX_QWORDS);
+	for(unsigned i = 0; i < sizeof(s_aSequences)/sizeof(s_aSequences[0]); i++)
+	{
+		Packet.Reset();
+		s_aSequences[i].m_pfnBuild(&Packet);
+		Packet.Finish();
+		Dump(s_aSequences[i].m_pName, Packet);
+	}
+	Packet.Reset();
+	for(unsigned i = 0; i < sizeof(s_aSequences)/sizeof(s_aSequences[0]); i++)
+		s_aSequences[i].m_pfnBuild(&Packet);
+	Packet.Finish();
+	Dump("all in one packet", Packet);
+
+	if(Write)
+	{
+		IOHANDLE File = io_open(pFileName, IOFLAG_WRITE);
+		if(!File)
+		{
+			dbg_msg("gif_packet_test", "failed to open %s", pFileName);
+			return 1;
+		}
+		io_write(File, s_aDump, s_DumpSize);
+		io_close(File);
+		dbg_msg("gif_packet_test", "wrote %s", pFileName);
+		return 0;
+	}
+
+	int Result = Compare(pFileName);
+	dbg_msg("gif_packet_test", "%s", Result ? "packets differ from the golden dump" : "packets match the golden dump");
+	return Result;
+}
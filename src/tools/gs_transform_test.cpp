@@ -0,0 +1,110 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <engine/client/gs_transform.h>
+
+enum
+{
+	NUM_VERTICES = 4096,
+	RUNS = 200,
+};
+
+static CGsVertex s_aVertices[NUM_VERTICES];
+static uint64_t s_aRef[NUM_VERTICES*3];
+static uint64_t s_aSimd[NUM_VERTICES*3];
+
+static float Random(unsigned *pSeed, float Min, float Max)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return Min + ((*pSeed>>8)&0xffff)/65535.0f*(Max-Min);
+}
+
+// what the game sends: positions around and past the screen, texture
+// coordinates with some wrapping, colors in 0..1 with the odd exact edge
+static void MakeVertices(unsigned *pSeed)
+{
+	for(int i = 0; i < NUM_VERTICES; i++)
+	{
+		CGsVertex *pV = &s_aVertices[i];
+		pV->m_X = Random(pSeed, -200.0f, 1200.0f);
+		pV->m_Y = Random(pSeed, -200.0f, 1000.0f);
+		pV->m_U = Random(pSeed, -1.0f, 2.0f);
+		pV->m_V = Random(pSeed, -1.0f, 2.0f);
+		pV->m_R = Random(pSeed, 0.0f, 1.0f);
+		pV->m_G = Random(pSeed, 0.0f, 1.0f);
+		pV->m_B = Random(pSeed, 0.0f, 1.0f);
+		pV->m_A = Random(pSeed, 0.0f, 1.0f);
+		if(i%16 == 0)
+		{
+			pV->m_X = (float)(i%1024);
+			pV->m_U = 0.5f;
+			pV->m_R = 1.0f;
+			pV->m_A = 0.0f;
+		}
+	}
+}
+
+// compares both kernels on every vertex, returns the mismatching words
+static int Compare(const CGsTransform &Transform, bool Textured, const char *pName)
+{
+	const int Words = NUM_VERTICES*(Textured ? 3 : 2);
+	mem_zero(s_aRef, sizeof(s_aRef));
+	mem_zero(s_aSimd, sizeof(s_aSimd));
+	Transform.TransformRef(s_aVertices, NUM_VERTICES, Textured, s_aRef);
+	Transform.TransformSimd(s_aVertices, NUM_VERTICES, Textured, s_aSimd);
+
+	int Mismatches = 0;
+	for(int i = 0; i < Words; i++)
+	{
+		if(s_aRef[i] == s_aSimd[i])
+			continue;
+		if(Mismatches++ == 0)
+			dbg_msg("gs_transform_test", "%s: word %d differs, ref %016llx simd %016llx", pName, i,
+				(unsigned long long)s_aRef[i], (unsigned long long)s_aSimd[i]);
+	}
+
+	int64 Start = time_get();
+	for(int r = 0; r < RUNS; r++)
+		Transform.TransformRef(s_aVertices, NUM_VERTICES, Textured, s_aRef);
+	int64 RefTime = time_get()-Start;
+	Start = time_get();
+	for(int r = 0; r < RUNS; r++)
+		Transform.TransformSimd(s_aVertices, NUM_VERTICES, Textured, s_aSimd);
+	int64 SimdTime = time_get()-Start;
+
+	const double Freq = (double)time_freq();
+	dbg_msg("gs_transform_test", "%s: %d mismatching words, per %d vertices ref %.3f us, simd %.3f us",
+		pName, Mismatches, NUM_VERTICES, RefTime*1e6/Freq/RUNS, SimdTime*1e6/Freq/RUNS);
+	return Mismatches;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+#if !defined(CONF_GS_TRANSFORM_SIMD)
+	dbg_msg("gs_transform_test", "no SIMD kernel on this machine, comparing the reference with itself");
+#endif
+
+	unsigned Seed = 1;
+	MakeVertices(&Seed);
+
+	int Mismatches = 0;
+	CGsTransform Transform;
+
+	// the menus and the hud, the screen is the ortho rectangle
+	Transform.SetScreen(0.0f, 0.0f, 640.0f, 448.0f, 640, 448, 2048*16, 2048*16);
+	Transform.SetTexture(256, 256);
+	Mismatches += Compare(Transform, true, "screen, 256x256 texture");
+	Transform.SetTexture(0, 0);
+	Mismatches += Compare(Transform, false, "screen, untextured");
+
+	// the game view, zoomed out and off the origin
+	Transform.SetScreen(-312.5f, 120.25f, 1187.5f, 1170.25f, 640, 448, 2048*16, 2048*16);
+	Transform.SetTexture(1024, 64);
+	Mismatches += Compare(Transform, true, "world, 1024x64 texture");
+	Transform.SetTexture(0, 0);
+	Mismatches += Compare(Transform, false, "world, untextured");
+
+	return Mismatches ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/shared/mixer.h>
+
+#include <math.h>
+
+enum
+{
+	RATE = 48000,
+	CHUNK = 512,
+};
+
+static short s_aRef[CHUNK*2] __attribute__((aligned(16)));
+static short s_aSimd[CHUNK*2] __attribute__((aligned(16)));
+static short s_aSrc[CHUNK*2] __attribute__((aligned(16)));
+
+static void WriteInt(unsigned char *pOut, unsigned Value, int Bytes)
+{
+	for(int i = 0; i < Bytes; i++)
+		pOut[i] = (Value>>(i*8))&0xff;
+}
+
+static void WriteWav(const char *pFileName, const short *pSamples, int NumFrames)
+{
+	IOHANDLE File = io_open(pFileName, IOFLAG_WRITE);
+	if(!File)
+	{
+		dbg_msg("mixer_bench", "failed to open %s", pFileName);
+		return;
+	}
+
+	const int DataSize = NumFrames*2*sizeof(short);
+	unsigned char aHeader[44];
+	mem_copy(aHeader, "RIFF", 4);
+	WriteInt(aHeader+4, 36+DataSize, 4);
+	mem_copy(aHeader+8, "WAVEfmt ", 8);
+	WriteInt(aHeader+16, 16, 4);
+	WriteInt(aHeader+20, 1, 2); // pcm
+	WriteInt(aHeader+22, 2, 2);
+	WriteInt(aHeader+24, RATE, 4);
+	WriteInt(aHeader+28, RATE*2*sizeof(short), 4);
+	WriteInt(aHeader+32, 2*sizeof(short), 2);
+	WriteInt(aHeader+34, 16, 2);
+	mem_copy(aHeader+36, "data", 4);
+	WriteInt(aHeader+40, DataSize, 4);
+
+	// the samples are little endian like the host
+	io_write(File, aHeader, sizeof(aHeader));
+	io_write(File, pSamples, DataSize);
+	io_close(File);
+}
+
+// a decaying tone with some noise, like a short game sound
+static short *MakeSample(int NumFrames, int Channels, float Freq, unsigned *pSeed)
+{
+	short *pData = (short *)mem_alloc(NumFrames*Channels*sizeof(short), 1);
+	for(int i = 0; i < NumFrames; i++)
+	{
+		*pSeed = *pSeed*1103515245+12345;
+		float Noise = ((*pSeed>>16)&0x7fff)/16384.0f - 1.0f;
+		float Env = expf(-3.0f*i/NumFrames);
+		float Value = (sinf(i*Freq*2*pi/RATE)*0.8f + Noise*0.2f)*Env;
+		for(int c = 0; c < Channels; c++)
+			pData[i*Channels+c] = (short)(Value*32000.0f);
+	}
+	return pData;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+	if(argc < 2 || argc > 4)
+	{
+		dbg_msg("Usage", "%s OUT.wav [VOICES] [SECONDS]", argv[0]);
+		return -1;
+	}
+
+	const int NumVoices = clamp(argc > 2 ? str_toint(argv[2]) : 32, 1, (int)CMixer::MAX_VOICES);
+	const int Seconds = max(argc > 3 ? str_toint(argv[3]) : 10, 1);
+	const int NumChunks = Seconds*RATE/CHUNK;
+
+	// a few samples at the rates the game has
+	enum { NUM_SAMPLES = 4 };
+	static const int s_aRates[NUM_SAMPLES] = {44100, 48000, 22050, 44100};
+	short *apSamples[NUM_SAMPLES];
+	int aNumFrames[NUM_SAMPLES];
+	unsigned Seed = 1;
+	for(int s = 0; s < NUM_SAMPLES; s++)
+	{
+		aNumFrames[s] = s_aRates[s]/2 + s*4000;
+		apSamples[s] = MakeSample(aNumFrames[s], 1 + s%2, 220.0f*(s+1), &Seed);
+	}
+
+	short *pOut = (short *)mem_alloc(NumChunks*CHUNK*2*sizeof(short), 16);
+
+	CMixer Mixer;
+	Mixer.Init(RATE);
+	int64 MixTime = 0;
+	int Mismatches = 0;
+	for(int c = 0; c < NumChunks; c++)
+	{
+		// keep the voices busy, a new sound every few chunks
+		for(int v = 0; v < NumVoices; v++)
+		{
+			if(Mixer.IsPlaying(v))
+				continue;
+			Seed = Seed*1103515245+12345;
+			int s = (Seed>>16)%NUM_SAMPLES;
+			Mixer.Play(v, apSamples[s], aNumFrames[s], 1 + s%2, s_aRates[s], v == 0, 0);
+			Mixer.SetVolume(v, 64 + (Seed>>8)%192, 64 + (Seed>>4)%192);
+		}
+
+		short *pChunk = pOut + c*CHUNK*2;
+		int64 Start = time_get();
+		Mixer.Mix(pChunk, CHUNK);
+		MixTime += time_get()-Start;
+
+		// the kernels have to agree, saturation included
+		for(int i = 0; i < CHUNK*2; i++)
+		{
+			s_aRef[i] = s_aSimd[i] = pChunk[i];
+			s_aSrc[i] = pChunk[(i*7)%(CHUNK*2)];
+		}
+		CMixer::AddSaturateRef(s_aRef, s_aSrc, CHUNK*2);
+		CMixer::AddSaturateSimd(s_aSimd, s_aSrc, CHUNK*2);
+		if(mem_comp(s_aRef, s_aSimd, sizeof(s_aRef)) != 0)
+			Mismatches++;
+	}
+
+	// the add kernels alone, on the last chunk
+	const int Runs = 20000;
+	int64 Start = time_get();
+	for(int r = 0; r < Runs; r++)
+		CMixer::AddSaturateRef(s_aRef, s_aSrc, CHUNK*2);
+	int64 RefTime = time_get()-Start;
+	Start = time_get();
+	for(int r = 0; r < Runs; r++)
+		CMixer::AddSaturateSimd(s_aSimd, s_aSrc, CHUNK*2);
+	int64 SimdTime = time_get()-Start;
+
+	const double Freq = (double)time_freq();
+	dbg_msg("mixer_bench", "%d voices, %d s: mixing took %.1f ms (%.2f%% of real time)",
+		NumVoices, Seconds, MixTime*1000.0/Freq, MixTime/Freq*100.0/Seconds);
+	dbg_msg("mixer_bench", "add kernel per %d samples: ref %.3f us, simd %.3f us, %d mismatching chunks",
+		CHUNK*2, RefTime*1e6/Freq/Runs, SimdTime*1e6/Freq/Runs, Mismatches);
+
+	WriteWav(argv[1], pOut, NumChunks*CHUNK);
+
+	for(int s = 0; s < NUM_SAMPLES; s++)
+		_mem_free(apSamples[s]);
+	_mem_free(pOut);
+	return Mismatches ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/client/quad_emit.h>
+
+#include <math.h> // cosf, sinf
+
+enum
+{
+	NUM_QUADS = 4096,
+	RUNS = 2000,
+};
+
+static float s_aInput[NUM_QUADS*8];
+static CGsVertex s_aRef[NUM_QUADS*CQuadEmitter::MAX_QUAD_VERTICES] __attribute__((aligned(16)));
+static CGsVertex s_aSimd[NUM_QUADS*CQuadEmitter::MAX_QUAD_VERTICES] __attribute__((aligned(16)));
+
+// the corners each output vertex takes, for rects and for freeform points
+static const int s_aaRectCorners[2][CQuadEmitter::MAX_QUAD_VERTICES] = {{0, 1, 2, 3}, {0, 1, 2, 0, 2, 3}};
+static const int s_aaFreeformPoints[2][CQuadEmitter::MAX_QUAD_VERTICES] = {{0, 1, 3, 2}, {0, 1, 3, 0, 3, 2}};
+
+static const float s_aTex[8] = {0.1f, 0.2f, 0.9f, 0.2f, 0.9f, 0.8f, 0.1f, 0.8f};
+static float s_aColors[16];
+
+static float Random(unsigned *pSeed, float Min, float Max)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return Min + ((*pSeed>>8)&0xffff)/65535.0f*(Max-Min);
+}
+
+// the corner a kernel should have written, position from the caller and the rest from Setup
+static bool Expect(const CGsVertex *pV, float x, float y, int Corner)
+{
+	return pV->m_X == x && pV->m_Y == y && pV->m_U == s_aTex[Corner*2] && pV->m_V == s_aTex[Corner*2+1] &&
+		pV->m_R == s_aColors[Corner*4] && pV->m_G == s_aColors[Corner*4+1] &&
+		pV->m_B == s_aColors[Corner*4+2] && pV->m_A == s_aColors[Corner*4+3];
+}
+
+// the reference against the layout the old per quad code wrote, returns the wrong vertices
+static int CheckLayout(const CQuadEmitter &Emitter, int Triangles)
+{
+	const int Vertices = Emitter.QuadVertices();
+	int Errors = 0;
+
+	Emitter.RectsRef(s_aInput, NUM_QUADS, s_aRef);
+	for(int q = 0; q < NUM_QUADS; q++)
+		for(int j = 0; j < Vertices; j++)
+		{
+			const float *pRect = &s_aInput[q*4];
+			int Corner = s_aaRectCorners[Triangles][j];
+			float x = pRect[0] + ((Corner == 1 || Corner == 2) ? pRect[2] : 0.0f);
+			float y = pRect[1] + (Corner >= 2 ? pRect[3] : 0.0f);
+			if(!Expect(&s_aRef[q*Vertices+j], x, y, Corner))
+				Errors++;
+		}
+
+	Emitter.FreeformRef(s_aInput, NUM_QUADS, s_aRef);
+	for(int q = 0; q < NUM_QUADS; q++)
+		for(int j = 0; j < Vertices; j++)
+		{
+			// texture coordinates and colors follow the point, not the corner it ends up at
+			int Point = s_aaFreeformPoints[Triangles][j];
+			if(!Expect(&s_aRef[q*Vertices+j], s_aInput[q*8+Point*2], s_aInput[q*8+Point*2+1], Point))
+				Errors++;
+		}
+
+	// rotation only has to be close, the kernels multiply in another order
+	const float Angle = 0.7f;
+	Emitter.RotatedRef(s_aInput, NUM_QUADS, Angle, s_aRef);
+	for(int q = 0; q < NUM_QUADS; q++)
+		for(int j = 0; j < Vertices; j++)
+		{
+			const float *pRect = &s_aInput[q*4];
+			int Corner = s_aaRectCorners[Triangles][j];
+			float cx = pRect[0] + pRect[2]/2, cy = pRect[1] + pRect[3]/2;
+			float x = ((Corner == 1 || Corner == 2) ? pRect[2] : 0.0f) - pRect[2]/2;
+			float y = (Corner >= 2 ? pRect[3] : 0.0f) - pRect[3]/2;
+			const CGsVertex *pV = &s_aRef[q*Vertices+j];
+			if(absolute(pV->m_X - (x*cosf(Angle) - y*sinf(Angle) + cx)) > 0.01f || absolute(pV->m_Y - (x*sinf(Angle) + y*cosf(Angle) + cy)) > 0.01f)
+				Errors++;
+		}
+	return Errors;
+}
+
+// the SIMD kernels against the reference, and both timed
+static int Compare(const CQuadEmitter &Emitter, int Kernel, const char *pName)
+{
+	const int Size = NUM_QUADS*Emitter.QuadVertices()*sizeof(CGsVertex);
+	const float Angle = 0.7f;
+	int64 aTimes[2];
+	for(int Simd = 0; Simd < 2; Simd++)
+	{
+		CGsVertex *pOut = Simd ? s_aSimd : s_aRef;
+		int64 Start = time_get();
+		for(int r = 0; r < RUNS; r++)
+		{
+			if(Kernel == 0)
+				Simd ? Emitter.RectsSimd(s_aInput, NUM_QUADS, pOut) : Emitter.RectsRef(s_aInput, NUM_QUADS, pOut);
+			else if(Kernel == 1)
+				Simd ? Emitter.RotatedSimd(s_aInput, NUM_QUADS, Angle, pOut) : Emitter.RotatedRef(s_aInput, NUM_QUADS, Angle, pOut);
+			else
+				Simd ? Emitter.FreeformSimd(s_aInput, NUM_QUADS, pOut) : Emitter.FreeformRef(s_aInput, NUM_QUADS, pOut);
+		}
+		aTimes[Simd] = time_get()-Start;
+	}
+
+	const bool Same = mem_comp(s_aRef, s_aSimd, Size) == 0;
+	const double Freq = (double)time_freq();
+	dbg_msg("quad_emit_bench", "%s: %s, ref %.1f, simd %.1f million quads per second", pName, Same ? "same" : "DIFFERENT",
+		RUNS*(double)NUM_QUADS/(aTimes[0]/Freq)/1e6, RUNS*(double)NUM_QUADS/(aTimes[1]/Freq)/1e6);
+	return Same ? 0 : 1;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+#if !defined(CONF_QUAD_EMIT_SIMD)
+	dbg_msg("quad_emit_bench", "no SIMD kernels on this machine, comparing the reference with itself");
+#endif
+
+	unsigned Seed = 1;
+	for(int i = 0; i < NUM_QUADS*8; i++)
+		s_aInput[i] = Random(&Seed, -1500.0f, 1500.0f);
+	for(int i = 0; i < 16; i++)
+		s_aColors[i] = i/16.0f;
+
+	static const char *s_apKernels[] = {"rects", "rotated", "freeform"};
+	int Errors = 0;
+	for(int Triangles = 0; Triangles < 2; Triangles++)
+	{
+		CQuadEmitter Emitter;
+		Emitter.Setup(Triangles != 0, s_aTex, s_aColors);
+
+		int LayoutErrors = CheckLayout(Emitter, Triangles);
+		dbg_msg("quad_emit_bench", "%s: %d wrong vertices in the reference", Triangles ? "triangles" : "quads", LayoutErrors);
+		Errors += LayoutErrors;
+
+		for(int k = 0; k < 3; k++)
+		{
+			char aName[64];
+			str_format(aName, sizeof(aName), "%s %s", Triangles ? "triangles" : "quads", s_apKernels[k]);
+			Errors += Compare(Emitter, k, aName);
+		}
+	}
+	return Errors ? 1 : 0;
+}
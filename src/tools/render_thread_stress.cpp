@@ -0,0 +1,198 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/client/render_thread.h>
+
+enum
+{
+	NUM_BUFFERS = 2,
+	BUFFER_WORDS = 1024,
+	RESTART_INTERVAL = 5000,
+
+	OVERLAP_FRAMES = 100,
+	OVERLAP_MS = 2,
+};
+
+static unsigned Random(unsigned *pSeed, unsigned Max)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return ((*pSeed>>8)&0xffff)%Max;
+}
+
+/*
+	Class: CStressProcessor
+		Stands in for a backend. Every buffer holds its frame number in
+		every word plus how long to chew on it. The processor checks that
+		the words stay the same while it reads them, that frames arrive in
+		order, and flags the buffer busy so the front end can check it
+		never records into a buffer that is being run.
+*/
+class CStressProcessor : public CRenderThread::ICommandProcessor
+{
+public:
+	unsigned m_aaBuffers[NUM_BUFFERS][BUFFER_WORDS];
+	volatile int m_aBusy[NUM_BUFFERS];
+	volatile int m_Processed;
+	int m_LastFrame;
+	int m_Errors;
+
+	CStressProcessor()
+	{
+		mem_zero(m_aaBuffers, sizeof(m_aaBuffers));
+		m_aBusy[0] = m_aBusy[1] = 0;
+		m_Processed = 0;
+		m_LastFrame = -1;
+		m_Errors = 0;
+	}
+
+	virtual void RunBuffer(int Buffer)
+	{
+		m_aBusy[Buffer] = 1;
+		sync_barrier();
+
+		const volatile unsigned *pWords = m_aaBuffers[Buffer];
+		const unsigned Frame = pWords[0];
+		if((int)Frame != m_LastFrame+1)
+		{
+			if(m_Errors++ == 0)
+				dbg_msg("render_thread_stress", "buffer %d: frame %u after frame %d", Buffer, Frame, m_LastFrame);
+		}
+		m_LastFrame = Frame;
+
+		// read it a few times over, a front end writing into it shows up here
+		const int Passes = pWords[1];
+		for(int p = 0; p < Passes; p++)
+			for(int i = 2; i < BUFFER_WORDS; i++)
+				if(pWords[i] != Frame)
+				{
+					if(m_Errors++ == 0)
+						dbg_msg("render_thread_stress", "buffer %d: word %d of frame %u changed to %u", Buffer, i, Frame, pWords[i]);
+					break;
+				}
+
+		sync_barrier();
+		m_aBusy[Buffer] = 0;
+		m_Processed = m_Processed+1;
+	}
+};
+
+/*
+	Class: CWaitProcessor
+		Stands in for a backend that blocks on the GS, it only sleeps.
+*/
+class CWaitProcessor : public CRenderThread::ICommandProcessor
+{
+public:
+	virtual void RunBuffer(int Buffer) { thread_sleep(OVERLAP_MS); }
+};
+
+// the front end busy for as long as the processor waits, per frame
+static int64 TimeOverlap(bool Threaded)
+{
+	CRenderThread Thread;
+	CWaitProcessor Processor;
+	Thread.StartProcessor(&Processor, Threaded);
+	int64 Start = time_get();
+	for(int f = 0; f < OVERLAP_FRAMES; f++)
+	{
+		int64 End = time_get() + time_freq()*OVERLAP_MS/1000;
+		while(time_get() < End)
+			;
+		Thread.RunBuffer(f%NUM_BUFFERS);
+	}
+	Thread.StopProcessor();
+	return time_get()-Start;
+}
+
+// records and hands over Frames buffers, alternating like the graphics front ends do
+static int Run(CRenderThread *pThread, CStressProcessor *pProcessor, int Frames, bool Threaded, unsigned Seed)
+{
+	int Errors = 0;
+	int Buffer = 0;
+	pThread->StartProcessor(pProcessor, Threaded);
+	for(int f = 0; f < Frames; f++)
+	{
+		if(pProcessor->m_aBusy[Buffer])
+		{
+			if(Errors++ == 0)
+				dbg_msg("render_thread_stress", "frame %d: recording into buffer %d while it runs", f, Buffer);
+		}
+
+		// the front end takes its time as well, so either side ends up waiting
+		unsigned *pWords = pProcessor->m_aaBuffers[Buffer];
+		const unsigned Frame = f;
+		pWords[0] = Frame;
+		pWords[1] = Random(&Seed, 4);
+		const int Passes = Random(&Seed, 4);
+		for(int p = 0; p <= Passes; p++)
+			for(int i = 2; i < BUFFER_WORDS; i++)
+				pWords[i] = Frame;
+
+		pThread->RunBuffer(Buffer);
+		Buffer ^= 1;
+
+		// a screenshot or a texture upload in between
+		if(Random(&Seed, 16) == 0)
+		{
+			pThread->WaitForIdle();
+			if(pProcessor->m_Processed != f+1 || !pThread->IsIdle())
+			{
+				if(Errors++ == 0)
+					dbg_msg("render_thread_stress", "frame %d: idle with %d buffers processed", f, pProcessor->m_Processed);
+			}
+		}
+
+		// a video restart
+		if(f%RESTART_INTERVAL == RESTART_INTERVAL-1)
+		{
+			pThread->StopProcessor();
+			pThread->StartProcessor(pProcessor, Threaded);
+		}
+	}
+	pThread->StopProcessor();
+
+	if(pProcessor->m_Processed != Frames)
+	{
+		if(Errors++ == 0)
+			dbg_msg("render_thread_stress", "%d of %d buffers processed after the stop", pProcessor->m_Processed, Frames);
+	}
+	return Errors + pProcessor->m_Errors;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+	if(argc > 2)
+	{
+		dbg_msg("Usage", "%s [FRAMES]", argv[0]);
+		return -1;
+	}
+	const int Frames = max(argc > 1 ? str_toint(argv[1]) : 100000, 1);
+
+	int Errors = 0;
+	for(int t = 0; t < 2; t++)
+	{
+		const bool Threaded = t == 1;
+		CRenderThread Thread;
+		CStressProcessor *pProcessor = new CStressProcessor();
+		int64 Start = time_get();
+		int RunErrors = Run(&Thread, pProcessor, Frames, Threaded, 1);
+		int64 Time = time_get()-Start;
+		dbg_msg("render_thread_stress", "%s: %d buffers, %d errors, %.2f us per handoff", Threaded ? "threaded" : "unthreaded",
+			pProcessor->m_Processed, RunErrors, Time*1e6/time_freq()/Frames);
+		Errors += RunErrors;
+		delete pProcessor;
+	}
+
+	// with the thread the next frame is recorded while the last one waits,
+	// a frame should cost about one of the two instead of both
+	int64 Unthreaded = TimeOverlap(false);
+	int64 Threaded = TimeOverlap(true);
+	const bool Overlaps = Threaded*4 < Unthreaded*3;
+	dbg_msg("render_thread_stress", "overlap: %.2f ms per frame threaded, %.2f ms unthreaded%s", Threaded*1e3/time_freq()/OVERLAP_FRAMES,
+		Unthreaded*1e3/time_freq()/OVERLAP_FRAMES, Overlaps ? "" : ", the waits don't overlap the recording");
+	if(!Overlaps)
+		Errors++;
+	return Errors ? 1 : 0;
+}
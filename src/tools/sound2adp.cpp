@@ -0,0 +1,145 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <engine/shared/adpcm.h>
+
+extern "C" {
+	#include <engine/external/wavpack/wavpack.h>
+	#include <opusfile.h>
+}
+
+static IOHANDLE s_File = 0;
+
+static int ReadData(void *pBuffer, int Size)
+{
+	return io_read(s_File, pBuffer, Size);
+}
+
+// reads a whole file to 16 bit interleaved samples
+static short *DecodeWV(const char *pFileName, int *pNumFrames, int *pChannels, int *pRate)
+{
+	s_File = io_open(pFileName, IOFLAG_READ);
+	if(!s_File)
+		return 0;
+
+	char aError[100];
+	WavpackContext *pContext = WavpackOpenFileInput(ReadData, aError);
+	if(!pContext)
+	{
+		dbg_msg("sound2adp", "%s: %s", pFileName, aError);
+		io_close(s_File);
+		return 0;
+	}
+
+	int NumFrames = WavpackGetNumSamples(pContext);
+	int Channels = WavpackGetNumChannels(pContext);
+	int BitsPerSample = WavpackGetBitsPerSample(pContext);
+	if(Channels > 2 || BitsPerSample != 16)
+	{
+		dbg_msg("sound2adp", "%s: not 16 bit mono or stereo", pFileName);
+		io_close(s_File);
+		return 0;
+	}
+
+	int *pSrc = (int *)mem_alloc(NumFrames*Channels*sizeof(int), 1);
+	WavpackUnpackSamples(pContext, pSrc, NumFrames);
+	io_close(s_File);
+
+	short *pSamples = (short *)mem_alloc(NumFrames*Channels*sizeof(short), 1);
+	for(int i = 0; i < NumFrames*Channels; i++)
+		pSamples[i] = (short)pSrc[i];
+	_mem_free(pSrc);
+
+	*pNumFrames = NumFrames;
+	*pChannels = Channels;
+	*pRate = WavpackGetSampleRate(pContext);
+	return pSamples;
+}
+
+static short *DecodeOpus(const char *pFileName, int *pNumFrames, int *pChannels, int *pRate)
+{
+	OggOpusFile *pOpusFile = op_open_file(pFileName, 0);
+	if(!pOpusFile)
+		return 0;
+
+	int Channels = op_channel_count(pOpusFile, -1);
+	int NumFrames = op_pcm_total(pOpusFile, -1);
+	if(Channels > 2 || NumFrames <= 0)
+	{
+		dbg_msg("sound2adp", "%s: not mono or stereo", pFileName);
+		op_free(pOpusFile);
+		return 0;
+	}
+
+	short *pSamples = (short *)mem_alloc(NumFrames*Channels*sizeof(short), 1);
+	int Pos = 0;
+	while(Pos < NumFrames)
+	{
+		int Read = op_read(pOpusFile, pSamples + Pos*Channels, (NumFrames-Pos)*Channels, 0);
+		if(Read <= 0)
+			break;
+		Pos += Read;
+	}
+	op_free(pOpusFile);
+
+	*pNumFrames = Pos;
+	*pChannels = Channels;
+	*pRate = 48000; // opus always decodes at 48 kHz
+	return pSamples;
+}
+
+static int ConvertFile(const char *pSrcName, const char *pDstName, bool Loop)
+{
+	int NumFrames, Channels, Rate;
+	int Length = str_length(pSrcName);
+	short *pSamples;
+	if(Length > 5 && str_comp_nocase(pSrcName+Length-5, ".opus") == 0)
+		pSamples = DecodeOpus(pSrcName, &NumFrames, &Channels, &Rate);
+	else
+		pSamples = DecodeWV(pSrcName, &NumFrames, &Channels, &Rate);
+
+	if(!pSamples)
+	{
+		dbg_msg("sound2adp", "failed to decode %s", pSrcName);
+		return 1;
+	}
+
+	unsigned char *pData = (unsigned char *)mem_alloc(CAdpcmEncoder::EncodedSize(NumFrames, Loop), 1);
+	int Size = CAdpcmEncoder::Encode(pSamples, NumFrames, Channels, Rate, Loop, pData);
+	_mem_free(pSamples);
+
+	IOHANDLE File = io_open(pDstName, IOFLAG_WRITE);
+	if(!File)
+	{
+		dbg_msg("sound2adp", "failed to open %s", pDstName);
+		_mem_free(pData);
+		return 1;
+	}
+	io_write(File, pData, Size);
+	io_close(File);
+	_mem_free(pData);
+
+	dbg_msg("sound2adp", "%s: %d frames at %d Hz, %d bytes", pDstName, NumFrames, Rate, Size);
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	bool Loop = false;
+	if(argc > 1 && str_comp(argv[1], "-l") == 0)
+	{
+		Loop = true;
+		argc--;
+		argv++;
+	}
+
+	if(argc != 3)
+	{
+		dbg_msg("Usage", "%s [-l] IN.wv|IN.opus OUT.adp", argv[0]);
+		return -1;
+	}
+
+	return ConvertFile(argv[1], argv[2], Loop);
+}
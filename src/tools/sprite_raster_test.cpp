@@ -0,0 +1,179 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/graphics.h>
+#include <engine/kernel.h>
+#include <engine/storage.h>
+#include <engine/client/graphics_null.h>
+#include <engine/shared/config.h>
+
+enum
+{
+	TEXTURE_SIZE = 64,
+	NUM_QUADS = 256,
+};
+
+// the null backend with its frame buffer in reach
+class CGraphics_NullRaster : public CGraphics_Null
+{
+public:
+	const unsigned char *FrameBuffer() const { return m_pFrameBuffer; }
+};
+
+static unsigned Random(unsigned *pSeed, unsigned Max)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return ((*pSeed>>8)&0xffff)%Max;
+}
+
+// every texel differs from its neighbours, with some translucency
+static int CreateTexture(IGraphics *pGraphics)
+{
+	static unsigned char s_aData[TEXTURE_SIZE*TEXTURE_SIZE*4];
+	for(int y = 0; y < TEXTURE_SIZE; y++)
+		for(int x = 0; x < TEXTURE_SIZE; x++)
+		{
+			unsigned char *p = &s_aData[(y*TEXTURE_SIZE+x)*4];
+			p[0] = 64 + x*3;
+			p[1] = 64 + y*3;
+			p[2] = 255 - ((x^y)&15)*8;
+			p[3] = (x+y)%3 == 0 ? 160 : 255;
+		}
+	return pGraphics->LoadTextureRaw(TEXTURE_SIZE, TEXTURE_SIZE, CImageInfo::FORMAT_RGBA, s_aData, CImageInfo::FORMAT_RGBA, IGraphics::TEXLOAD_NORESAMPLE);
+}
+
+// what the game draws: tiles and sprites on whole and quarter pixels with texel
+// aligned subsets, some mirrored, most of them sprites. The rest is rotated or
+// gradient shaded and stays on the triangle path in both runs
+static void DrawScene(IGraphics *pGraphics, int Texture, unsigned Seed)
+{
+	pGraphics->MapScreen(0, 0, pGraphics->ScreenWidth(), pGraphics->ScreenHeight());
+	pGraphics->Clear(0.1f, 0.2f, 0.3f);
+	if(Seed%4 == 3)
+		pGraphics->ClipEnable(40, 30, pGraphics->ScreenWidth()-100, pGraphics->ScreenHeight()-90);
+
+	for(int i = 0; i < NUM_QUADS; i++)
+	{
+		const unsigned Blend = Random(&Seed, 3);
+		if(Blend == 0)
+			pGraphics->BlendNone();
+		else if(Blend == 1)
+			pGraphics->BlendNormal();
+		else
+			pGraphics->BlendAdditive();
+
+		const bool Textured = Random(&Seed, 4) != 0;
+		pGraphics->TextureSet(Textured ? Texture : -1);
+		pGraphics->QuadsBegin();
+
+		const int Scale = 1 + Random(&Seed, 2);
+		const int Texels = 4 + Random(&Seed, 28);
+		const int u0 = Random(&Seed, TEXTURE_SIZE-Texels), v0 = Random(&Seed, TEXTURE_SIZE-Texels);
+		const float U0 = u0/(float)TEXTURE_SIZE, V0 = v0/(float)TEXTURE_SIZE;
+		const float U1 = (u0+Texels)/(float)TEXTURE_SIZE, V1 = (v0+Texels)/(float)TEXTURE_SIZE;
+		const bool MirrorU = Random(&Seed, 4) == 0, MirrorV = Random(&Seed, 4) == 0;
+		pGraphics->QuadsSetSubset(MirrorU ? U1 : U0, MirrorV ? V1 : V0, MirrorU ? U0 : U1, MirrorV ? V0 : V1);
+
+		const unsigned Kind = Random(&Seed, 8);
+		if(Kind == 0)
+			pGraphics->QuadsSetRotation((1+Random(&Seed, 100))/50.0f);
+		if(Kind == 1)
+		{
+			IGraphics::CColorVertex aColors[4] = {
+				IGraphics::CColorVertex(0, 1.0f, 0.5f, 0.5f, 1.0f),
+				IGraphics::CColorVertex(1, 0.5f, 1.0f, 0.5f, 0.5f),
+				IGraphics::CColorVertex(2, 0.5f, 0.5f, 1.0f, 1.0f),
+				IGraphics::CColorVertex(3, 1.0f, 1.0f, 1.0f, 0.5f)};
+			pGraphics->SetColorVertex(aColors, 4);
+		}
+		else
+			pGraphics->SetColor((2+Random(&Seed, 7))/8.0f, (2+Random(&Seed, 7))/8.0f, (2+Random(&Seed, 7))/8.0f, (1+Random(&Seed, 8))/8.0f);
+
+		float x = (float)Random(&Seed, pGraphics->ScreenWidth()-Texels*Scale);
+		float y = (float)Random(&Seed, pGraphics->ScreenHeight()-Texels*Scale);
+		if(Random(&Seed, 2))
+		{
+			x += 0.25f;
+			y += 0.75f;
+		}
+		IGraphics::CQuadItem Quad(x, y, (float)Texels*Scale, (float)Texels*Scale);
+		pGraphics->QuadsDrawTL(&Quad, 1);
+		pGraphics->QuadsEnd();
+	}
+	pGraphics->ClipDisable();
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	if(argc > 2)
+	{
+		dbg_msg("Usage", "%s [FRAMES]", argv[0]);
+		return -1;
+	}
+	const int Frames = max(argc > 1 ? str_toint(argv[1]) : 16, 1);
+
+	IKernel *pKernel = IKernel::Create();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, 1, argv);
+	IConfig *pConfig = CreateConfig();
+	CGraphics_NullRaster *pGraphics = new CGraphics_NullRaster();
+
+	bool RegisterFail = !pKernel->RegisterInterface(pStorage);
+	RegisterFail |= !pKernel->RegisterInterface(pConfig);
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IEngineGraphics*>(pGraphics));
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IGraphics*>(pGraphics));
+	if(RegisterFail)
+		return -1;
+
+	pConfig->Init();
+	g_Config.m_GfxThreadedOld = 0;
+	g_Config.m_GfxHeadlessRaster = 1;
+	if(pGraphics->Init() != 0 || !pGraphics->FrameBuffer())
+	{
+		dbg_msg("sprite_raster_test", "failed to init the null backend");
+		return 1;
+	}
+
+	const int Texture = CreateTexture(pGraphics);
+	const int Size = pGraphics->ScreenWidth()*pGraphics->ScreenHeight()*4;
+	unsigned char *pTriangles = (unsigned char *)mem_alloc(Size, 1);
+
+	// the same frame through the triangle path and the sprite path, every pixel has to match
+	int Sprites = 0, Failures = 0;
+	for(int f = 0; f < Frames; f++)
+	{
+		g_Config.m_GfxQuadSprites = 0;
+		DrawScene(pGraphics, Texture, f+1);
+		pGraphics->Swap();
+		mem_copy(pTriangles, pGraphics->FrameBuffer(), Size);
+
+		g_Config.m_GfxQuadSprites = 1;
+		DrawScene(pGraphics, Texture, f+1);
+		pGraphics->Swap();
+		Sprites += pGraphics->RenderStats().m_Sprites;
+
+		const unsigned char *pSprites = pGraphics->FrameBuffer();
+		int Differing = 0;
+		for(int i = 0; i < Size; i++)
+		{
+			if(pTriangles[i] != pSprites[i] && Differing++ == 0)
+				dbg_msg("sprite_raster_test", "frame %d: pixel %d,%d differs, triangles %d sprites %d", f,
+					(i/4)%pGraphics->ScreenWidth(), (i/4)/pGraphics->ScreenWidth(), pTriangles[i], pSprites[i]);
+		}
+		if(Differing)
+			Failures++;
+	}
+	_mem_free(pTriangles);
+
+	dbg_msg("sprite_raster_test", "%d frames, %d sprites, %d frames differ", Frames, Sprites, Failures);
+	pGraphics->Shutdown();
+	if(!Sprites)
+	{
+		dbg_msg("sprite_raster_test", "no quad took the sprite path");
+		return 1;
+	}
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/client/texture_quantize.h>
+#include <engine/external/pnglite/pnglite.h>
+
+struct CTotals
+{
+	const char *m_pDir;
+	float m_MaxError;
+	int m_Textures;
+	int m_Palettized;
+	int m_Failures;
+	int64 m_Time;
+	int m_TrueColorBytes;
+	int m_Bytes;
+};
+
+// the pixels the gsKit backend palettizes: r, g, b and the GS alpha (0-128)
+static unsigned *LoadPixels(const char *pFileName, int *pWidth, int *pHeight)
+{
+	png_t Png; // ignore_convention
+	int Error = png_open_file(&Png, pFileName); // ignore_convention
+	if(Error != PNG_NO_ERROR)
+	{
+		if(Error != PNG_FILE_ERROR)
+			png_close_file(&Png); // ignore_convention
+		return 0;
+	}
+	if(Png.depth != 8 || (Png.color_type != PNG_TRUECOLOR && Png.color_type != PNG_TRUECOLOR_ALPHA)) // ignore_convention
+	{
+		png_close_file(&Png); // ignore_convention
+		return 0;
+	}
+
+	unsigned char *pData = (unsigned char *)mem_alloc(Png.width*Png.height*Png.bpp, 1); // ignore_convention
+	png_get_data(&Png, pData); // ignore_convention
+	png_close_file(&Png); // ignore_convention
+
+	const int NumPixels = Png.width*Png.height; // ignore_convention
+	unsigned *pPixels = (unsigned *)mem_alloc(NumPixels*sizeof(unsigned), 1);
+	for(int i = 0; i < NumPixels; i++)
+	{
+		const unsigned char *p = pData + i*Png.bpp; // ignore_convention
+		unsigned a = 128 - (Png.bpp == 4 ? (unsigned char)(p[3]/255.f*128) : 128); // ignore_convention
+		pPixels[i] = p[0] | (p[1]<<8) | (p[2]<<16) | (a<<24);
+	}
+	_mem_free(pData);
+
+	*pWidth = Png.width; // ignore_convention
+	*pHeight = Png.height; // ignore_convention
+	return pPixels;
+}
+
+// the mean squared error per channel of the palette image, as Quantize reports it
+static float MeasureError(const unsigned *pPixels, const unsigned char *pIndices, int NumPixels, const CTextureQuantizer::CResult *pResult)
+{
+	double Error = 0.0;
+	for(int i = 0; i < NumPixels; i++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			int d = (int)((pPixels[i]>>(c*8))&0xff) - (int)((pResult->m_aPalette[pIndices[i]]>>(c*8))&0xff);
+			Error += d*d;
+		}
+	}
+	return NumPixels ? (float)(Error/(NumPixels*4.0)) : 0.0f;
+}
+
+static int QuantizeFile(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	CTotals *pTotals = (CTotals *)pUser;
+	int Length = str_length(pName);
+	if(Length < 4 || IsDir || str_comp(pName+Length-4, ".png") != 0)
+		return 0;
+
+	char aPath[512];
+	str_format(aPath, sizeof(aPath), "%s/%s", pTotals->m_pDir, pName);
+	int Width, Height;
+	unsigned *pPixels = LoadPixels(aPath, &Width, &Height);
+	if(!pPixels)
+	{
+		dbg_msg("texture_quantize_bench", "%s: not a truecolor png, skipped", pName);
+		return 0;
+	}
+
+	// the choice Palettize makes
+	const int NumPixels = Width*Height;
+	int NumColors = CTextureQuantizer::CountColors(pPixels, NumPixels, 16);
+	int Colors = Width%2 == 0 && NumColors != -1 ? 16 : 256;
+
+	unsigned char *pIndices = (unsigned char *)mem_alloc(NumPixels, 1);
+	CTextureQuantizer::CResult Result;
+	int64 Start = time_get();
+	bool Fits = CTextureQuantizer::Quantize(pPixels, NumPixels, Colors, pTotals->m_MaxError, pIndices, &Result);
+	int64 Time = time_get()-Start;
+
+	// the reported error has to be the real one, and zero when nothing was merged
+	float Error = MeasureError(pPixels, pIndices, NumPixels, &Result);
+	bool Lossless = CTextureQuantizer::CountColors(pPixels, NumPixels, Colors) != -1;
+	if(absolute(Error - Result.m_Error) > 0.001f + Error*0.0001f || (Lossless && Result.m_Error != 0.0f))
+	{
+		dbg_msg("texture_quantize_bench", "%s: reported error %.4f, measured %.4f", pName, Result.m_Error, Error);
+		pTotals->m_Failures++;
+	}
+
+	dbg_msg("texture_quantize_bench", "%s: %dx%d, %d colors, error %.2f, %s, %.2f ms", pName, Width, Height,
+		Result.m_NumColors, Result.m_Error, Fits ? (Colors == 16 ? "4 bit" : "8 bit") : "truecolor",
+		Time*1000.0/time_freq());
+
+	pTotals->m_Textures++;
+	pTotals->m_Time += Time;
+	pTotals->m_TrueColorBytes += NumPixels*4;
+	if(Fits)
+	{
+		pTotals->m_Palettized++;
+		pTotals->m_Bytes += (Colors == 16 ? NumPixels/2 : NumPixels) + Colors*4;
+	}
+	else
+		pTotals->m_Bytes += NumPixels*4;
+
+	_mem_free(pIndices);
+	_mem_free(pPixels);
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+	if(argc > 3)
+	{
+		dbg_msg("Usage", "%s [DIR] [MAXERROR]", argv[0]);
+		return -1;
+	}
+
+	CTotals Totals;
+	mem_zero(&Totals, sizeof(Totals));
+	Totals.m_pDir = argc > 1 ? argv[1] : "data/mapres";
+	Totals.m_MaxError = argc > 2 ? str_tofloat(argv[2]) : 16.0f;
+
+	png_init(0, 0); // ignore_convention
+	fs_listdir(Totals.m_pDir, QuantizeFile, 0, &Totals);
+	if(!Totals.m_Textures)
+	{
+		dbg_msg("texture_quantize_bench", "no textures in %s", Totals.m_pDir);
+		return 1;
+	}
+
+	dbg_msg("texture_quantize_bench", "%d textures, %d palettized at error %.1f, %.1f ms in total",
+		Totals.m_Textures, Totals.m_Palettized, Totals.m_MaxError, Totals.m_Time*1000.0/time_freq());
+	dbg_msg("texture_quantize_bench", "%d KB truecolor, %d KB with palettes, %d wrong error reports",
+		Totals.m_TrueColorBytes/1024, Totals.m_Bytes/1024, Totals.m_Failures);
+	return Totals.m_Failures ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/graphics.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+#include <game/layers.h>
+#include <game/client/render.h>
+#include <game/client/tile_occupancy.h>
+#include <game/client/tilemap_cache.h>
+
+struct CRun
+{
+	int64 m_Time;
+	int m_DrawCalls;
+	int m_Vertices;
+};
+
+// the tile layers the client draws with entities off, each in an opaque and a transparent pass
+static void RenderLayers(IGraphics *pGraphics, CRenderTools *pRenderTools, CLayers *pLayers, vec2 Center)
+{
+	for(int g = 0; g < pLayers->NumGroups(); g++)
+	{
+		CMapItemGroup *pGroup = pLayers->GetGroup(g);
+		float aPoints[4];
+		pRenderTools->MapscreenToWorld(Center.x, Center.y, pGroup->m_ParallaxX/100.0f, pGroup->m_ParallaxY/100.0f,
+			pGroup->m_OffsetX, pGroup->m_OffsetY, pGraphics->ScreenAspect(), 1.0f, aPoints);
+		pGraphics->MapScreen(aPoints[0], aPoints[1], aPoints[2], aPoints[3]);
+
+		for(int l = 0; l < pGroup->m_NumLayers; l++)
+		{
+			CMapItemLayer *pLayer = pLayers->GetLayer(pGroup->m_StartLayer+l);
+			if(pLayer->m_Type != LAYERTYPE_TILES)
+				continue;
+			CMapItemLayerTilemap *pTMap = (CMapItemLayerTilemap *)pLayer;
+			if(pTMap->m_Flags)
+				continue;
+
+			CTile *pTiles = (CTile *)pLayers->Map()->GetData(pTMap->m_Data);
+			if(pLayers->Map()->GetUncompressedDataSize(pTMap->m_Data) < (int)(pTMap->m_Width*pTMap->m_Height*sizeof(CTile)))
+				continue;
+
+			vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
+			pGraphics->BlendNone();
+			pRenderTools->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, 0, 0, -1, 0);
+			pGraphics->BlendNormal();
+			pRenderTools->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, 0, 0, -1, 0);
+		}
+	}
+}
+
+// a camera going back and forth over the whole game layer, about as fast as a running tee
+static void Run(IEngineGraphics *pGraphics, CRenderTools *pRenderTools, CLayers *pLayers, int Frames, CRun *pRun)
+{
+	const float Width = pLayers->GameLayer()->m_Width*32.0f;
+	const float Height = pLayers->GameLayer()->m_Height*32.0f;
+	mem_zero(pRun, sizeof(*pRun));
+
+	for(int f = 0; f < Frames; f++)
+	{
+		float t = f/(float)Frames;
+		vec2 Center = vec2(Width*(0.5f + 0.45f*sinf(t*2*pi*3)), Height*(0.5f + 0.45f*sinf(t*2*pi*2)));
+
+		int64 Start = time_get();
+		RenderLayers(pGraphics, pRenderTools, pLayers, Center);
+		const IGraphics::CRenderStats Stats = pGraphics->RenderStats();
+		pGraphics->Swap();
+		pRun->m_Time += time_get()-Start;
+		pRun->m_DrawCalls += Stats.m_DrawCalls;
+		pRun->m_Vertices += Stats.m_Vertices;
+	}
+}
+
+static void Report(const char *pName, const CRun *pRun, int Frames)
+{
+	dbg_msg("tilemap_cache_bench", "%s: %.3f ms per frame, %d draw calls, %d vertices", pName,
+		pRun->m_Time*1000.0/time_freq()/Frames, pRun->m_DrawCalls/Frames, pRun->m_Vertices/Frames);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	if(argc < 2 || argc > 3)
+	{
+		dbg_msg("Usage", "%s MAP [FRAMES]", argv[0]);
+		return -1;
+	}
+	const int Frames = max(argc > 2 ? str_toint(argv[2]) : 2000, 1);
+
+	IKernel *pKernel = IKernel::Create();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, 1, argv);
+	IConfig *pConfig = CreateConfig();
+	IEngineMap *pMap = CreateEngineMap();
+	IEngineGraphics *pGraphics = CreateEngineGraphicsNull();
+
+	bool RegisterFail = !pKernel->RegisterInterface(pStorage);
+	RegisterFail |= !pKernel->RegisterInterface(pConfig);
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IEngineMap*>(pMap));
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IMap*>(pMap));
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IEngineGraphics*>(pGraphics));
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IGraphics*>(pGraphics));
+	if(RegisterFail)
+		return -1;
+
+	pConfig->Init();
+	// replay on this thread, the PS2 pays for it on its only core as well
+	g_Config.m_GfxThreadedOld = 0;
+	if(pGraphics->Init() != 0 || !pMap->Load(argv[1]))
+	{
+		dbg_msg("tilemap_cache_bench", "failed to load '%s'", argv[1]);
+		return 1;
+	}
+
+	CLayers Layers;
+	Layers.Init(pKernel);
+	if(!Layers.GameLayer())
+	{
+		dbg_msg("tilemap_cache_bench", "'%s' has no game layer", argv[1]);
+		return 1;
+	}
+
+	CTilemapCache TilemapCache;
+	CTileOccupancy TileOccupancy;
+	CRenderTools RenderTools;
+	RenderTools.m_pGraphics = pGraphics;
+	RenderTools.m_pTilemapCache = &TilemapCache;
+	RenderTools.m_pTileOccupancy = &TileOccupancy;
+	RenderTools.RenderTilemapGenerateSkip(&Layers);
+
+	CRun PerTile, Cached;
+	g_Config.m_ClTilemapCache = 0;
+	Run(pGraphics, &RenderTools, &Layers, Frames, &PerTile);
+	g_Config.m_ClTilemapCache = 1;
+	Run(pGraphics, &RenderTools, &Layers, Frames, &Cached);
+
+	dbg_msg("tilemap_cache_bench", "%s, %dx%d game layer, %d frames", argv[1],
+		Layers.GameLayer()->m_Width, Layers.GameLayer()->m_Height, Frames);
+	Report("per tile", &PerTile, Frames);
+	Report("cached", &Cached, Frames);
+
+	pGraphics->Shutdown();
+	return 0;
+}
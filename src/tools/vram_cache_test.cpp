@@ -0,0 +1,215 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <engine/client/vram_cache.h>
+
+enum
+{
+	FIRST_PAGE = 100, // behind the frame buffers, like on the GS
+	NUM_PAGES = 16,
+	PAGE = CVramCache::PAGE_SIZE,
+
+	STRESS_ENTRIES = 200,
+	STRESS_FRAMES = 2000,
+};
+
+static CVramCache s_Cache;
+static int s_aSizes[CVramCache::MAX_ENTRIES];
+static int s_Failures = 0;
+
+static void Check(bool Ok, const char *pTest, const char *pWhat)
+{
+	if(Ok)
+		return;
+	dbg_msg("vram_cache_test", "%s: %s", pTest, pWhat);
+	s_Failures++;
+}
+
+static int Use(int Entry, int Size)
+{
+	bool Upload;
+	s_aSizes[Entry] = Size;
+	return s_Cache.Use(Entry, Size, &Upload);
+}
+
+// resident entries stay inside the managed pages, don't overlap and
+// account for every page that isn't free
+static bool Consistent(int NumEntries)
+{
+	int aOwner[NUM_PAGES];
+	for(int p = 0; p < NUM_PAGES; p++)
+		aOwner[p] = -1;
+
+	int Used = 0;
+	for(int e = 0; e < NumEntries; e++)
+	{
+		if(!s_Cache.IsResident(e))
+			continue;
+		int Page = s_Cache.Page(e) - FIRST_PAGE;
+		int NumPages = (s_aSizes[e] + PAGE - 1) / PAGE;
+		if(Page < 0 || Page + NumPages > NUM_PAGES)
+			return false;
+		for(int p = Page; p < Page + NumPages; p++)
+		{
+			if(aOwner[p] != -1)
+				return false;
+			aOwner[p] = e;
+		}
+		Used += NumPages;
+	}
+	return s_Cache.FreePages() == NUM_PAGES - Used;
+}
+
+static void TestFill()
+{
+	s_Cache.Init(FIRST_PAGE, NUM_PAGES);
+	for(int e = 0; e < NUM_PAGES; e++)
+		Check(Use(e, PAGE) != -1, "fill", "a texture didn't fit into free pages");
+	s_Cache.NextFrame();
+	Check(s_Cache.Stats().m_Uploads == NUM_PAGES && s_Cache.Stats().m_Evictions == 0, "fill", "free pages were not used first");
+	Check(s_Cache.FreePages() == 0 && Consistent(NUM_PAGES), "fill", "pages are handed out twice");
+
+	// everything is resident, using it again costs nothing
+	for(int e = 0; e < NUM_PAGES; e++)
+		Use(e, PAGE);
+	s_Cache.NextFrame();
+	Check(s_Cache.Stats().m_Hits == NUM_PAGES && s_Cache.Stats().m_Uploads == 0, "fill", "resident textures were uploaded again");
+}
+
+static void TestLeastRecentlyUsed()
+{
+	// same sizes, the one unused for longest goes
+	s_Cache.Init(FIRST_PAGE, NUM_PAGES);
+	for(int e = 0; e < NUM_PAGES; e++)
+		Use(e, PAGE);
+	for(int f = 0; f < 3; f++)
+	{
+		s_Cache.NextFrame();
+		for(int e = 0; e < NUM_PAGES; e++)
+			if(e != 5)
+				Use(e, PAGE);
+	}
+	Check(Use(NUM_PAGES, PAGE) != -1, "lru", "no room was made");
+	Check(!s_Cache.IsResident(5), "lru", "the least recently used texture stayed");
+	for(int e = 0; e <= NUM_PAGES; e++)
+		Check(e == 5 || s_Cache.IsResident(e), "lru", "a recently used texture was evicted");
+	Check(Consistent(NUM_PAGES+1), "lru", "pages are handed out twice");
+}
+
+static void TestSizeAndAge()
+{
+	// a large texture in use stays, old small ones make room
+	s_Cache.Init(FIRST_PAGE, NUM_PAGES);
+	Use(0, 8*PAGE);
+	for(int e = 1; e <= 8; e++)
+		Use(e, PAGE);
+	for(int f = 0; f < 10; f++)
+	{
+		s_Cache.NextFrame();
+		Use(0, 8*PAGE);
+	}
+	Check(Use(9, 4*PAGE) != -1, "size", "no room was made");
+	Check(s_Cache.IsResident(0), "size", "the large texture in use was evicted");
+	s_Cache.NextFrame();
+	Check(s_Cache.Stats().m_Evictions == 4, "size", "more small textures than needed were evicted");
+
+	// a large texture nobody has used for long goes before small ones in use
+	s_Cache.Init(FIRST_PAGE, NUM_PAGES);
+	Use(0, 8*PAGE);
+	for(int f = 0; f < 100; f++)
+	{
+		s_Cache.NextFrame();
+		for(int e = 1; e <= 8; e++)
+			Use(e, PAGE);
+	}
+	Check(Use(9, 8*PAGE) != -1, "age", "no room was made");
+	Check(!s_Cache.IsResident(0), "age", "the old large texture stayed");
+	for(int e = 1; e <= 8; e++)
+		Check(s_Cache.IsResident(e), "age", "a small texture in use was evicted");
+}
+
+static void TestPinned()
+{
+	s_Cache.Init(FIRST_PAGE, NUM_PAGES);
+	Check(s_Cache.Pin(0, 4*PAGE) != -1, "pinned", "the render target didn't fit");
+	for(int e = 1; e <= 12; e++)
+		Use(e, PAGE);
+	for(int f = 0; f < 100; f++)
+		s_Cache.NextFrame();
+
+	// the pinned pages are never given up, even when everything else is older
+	Check(Use(13, NUM_PAGES*PAGE) == -1, "pinned", "a texture was placed over a pinned one");
+	Check(s_Cache.IsResident(0), "pinned", "the pinned entry was evicted");
+	Check(Use(14, 12*PAGE) != -1, "pinned", "the unpinned pages could not be reused");
+	Check(s_Cache.IsResident(0), "pinned", "the pinned entry was evicted");
+
+	// once removed its pages are free again
+	s_Cache.Remove(0);
+	Check(!s_Cache.IsResident(0) && s_Cache.FreePages() == 4, "pinned", "removing didn't free the pages");
+	Check(Use(15, 4*PAGE) != -1 && s_Cache.IsResident(14), "pinned", "the freed pages were not used");
+}
+
+static void TestTooLarge()
+{
+	s_Cache.Init(FIRST_PAGE, NUM_PAGES);
+	for(int e = 0; e < NUM_PAGES; e++)
+		Use(e, PAGE);
+	Check(Use(NUM_PAGES, (NUM_PAGES+1)*PAGE) == -1, "too large", "a texture larger than the cache was placed");
+	for(int e = 0; e < NUM_PAGES; e++)
+		Check(s_Cache.IsResident(e), "too large", "a texture was evicted for nothing");
+}
+
+// random uses of textures from a part of a page to 5 pages, the pages have to stay consistent
+static void TestStress()
+{
+	s_Cache.Init(FIRST_PAGE, NUM_PAGES);
+	unsigned Seed = 1;
+	int Uses = 0;
+	int Hits = 0, Uploads = 0;
+	for(int e = 0; e < STRESS_ENTRIES; e++)
+	{
+		Seed = Seed*1103515245+12345;
+		s_aSizes[e] = 256 + ((Seed>>8)%(5*PAGE));
+	}
+	for(int f = 0; f < STRESS_FRAMES; f++)
+	{
+		for(int i = 0; i < 8; i++)
+		{
+			Seed = Seed*1103515245+12345;
+			// most of the uses go to a small working set
+			int e = (Seed>>8)%4 ? (Seed>>12)%12 : (Seed>>12)%STRESS_ENTRIES;
+			int Page = Use(e, s_aSizes[e]);
+			Uses++;
+			if(Page < FIRST_PAGE || !s_Cache.IsResident(e))
+			{
+				Check(false, "stress", "a texture that fits was not placed");
+				return;
+			}
+		}
+		if(f%50 == 0 && !Consistent(STRESS_ENTRIES))
+		{
+			Check(false, "stress", "pages are handed out twice");
+			return;
+		}
+		s_Cache.NextFrame();
+		Hits += s_Cache.Stats().m_Hits;
+		Uploads += s_Cache.Stats().m_Uploads;
+	}
+	Check(Hits + Uploads == Uses, "stress", "uses are neither hits nor uploads");
+	dbg_msg("vram_cache_test", "stress: %d uses, %d hits, %d uploads", Uses, Hits, Uploads);
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	TestFill();
+	TestLeastRecentlyUsed();
+	TestSizeAndAge();
+	TestPinned();
+	TestTooLarge();
+	TestStress();
+
+	dbg_msg("vram_cache_test", "%d failed checks", s_Failures);
+	return s_Failures ? 1 : 0;
+}